@@ -0,0 +1,94 @@
+#include "BenchBaseline.hpp"
+
+#include "JsonParser.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+double numberMember(const JsonValue& object, const char* key, double fallback) {
+    const JsonValue* v = object.find(key);
+    if (!v) return fallback;
+    if (v->type != JsonValue::Type::Number) {
+        throw std::runtime_error(std::string("Baseline member is not a number: ") + key);
+    }
+    return v->number;
+}
+
+std::string formatNumber(double v) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.10g", v);
+    return buf;
+}
+
+std::string escapeString(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+} // namespace
+
+BenchBaseline loadBenchBaseline(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open baseline: " + path);
+    }
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    JsonValue root;
+    try {
+        root = parseJson(text);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+    const JsonValue* benchmarks = root.find("benchmarks");
+    if (root.type != JsonValue::Type::Object || !benchmarks || benchmarks->type != JsonValue::Type::Object) {
+        throw std::runtime_error("Not a benchmark baseline: " + path);
+    }
+
+    BenchBaseline baseline;
+    baseline.sampleRate = static_cast<int>(numberMember(root, "sample_rate", 0.0));
+    baseline.durationSeconds = numberMember(root, "duration_seconds", 0.0);
+    for (const auto& [name, value] : benchmarks->members) {
+        if (value.type != JsonValue::Type::Object) {
+            throw std::runtime_error("Baseline entry is not an object: " + name);
+        }
+        BaselineEntry entry;
+        entry.nsPerOp = numberMember(value, "ns_per_op", 0.0);
+        entry.allocsPerOp = numberMember(value, "allocs_per_op", 0.0);
+        entry.maxSlowdown = numberMember(value, "max_slowdown", -1.0);
+        baseline.entries[name] = entry;
+    }
+    return baseline;
+}
+
+void writeBenchBaseline(const std::string& path, const BenchBaseline& baseline) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to create baseline: " + path);
+    }
+    out << "{\n";
+    out << "  \"sample_rate\": " << baseline.sampleRate << ",\n";
+    out << "  \"duration_seconds\": " << formatNumber(baseline.durationSeconds) << ",\n";
+    out << "  \"benchmarks\": {";
+    bool first = true;
+    for (const auto& [name, entry] : baseline.entries) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    \"" << escapeString(name) << "\": { \"ns_per_op\": " << formatNumber(entry.nsPerOp)
+            << ", \"allocs_per_op\": " << formatNumber(entry.allocsPerOp);
+        if (entry.maxSlowdown >= 0.0) out << ", \"max_slowdown\": " << formatNumber(entry.maxSlowdown);
+        out << " }";
+    }
+    out << "\n  }\n}\n";
+    if (!out) {
+        throw std::runtime_error("Failed to write baseline: " + path);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+// Stored result of one benchmark.
+struct BaselineEntry {
+    double nsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double maxSlowdown = -1.0; // per-benchmark override of the allowed slowdown; < 0 = use the default
+};
+
+// Baseline file: the generator settings the numbers were taken with, and one entry per benchmark.
+//
+//   {
+//     "sample_rate": 44100,
+//     "duration_seconds": 30,
+//     "benchmarks": {
+//       "estimateBPM": { "ns_per_op": 3100000, "allocs_per_op": 4, "max_slowdown": 0.5 },
+//       ...
+//     }
+//   }
+struct BenchBaseline {
+    int sampleRate = 0;
+    double durationSeconds = 0.0;
+    std::map<std::string, BaselineEntry> entries;
+};
+
+// Throws std::runtime_error if the file cannot be read or is not a baseline.
+BenchBaseline loadBenchBaseline(const std::string& path);
+
+// Throws std::runtime_error on failure.
+void writeBenchBaseline(const std::string& path, const BenchBaseline& baseline);
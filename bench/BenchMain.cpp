@@ -0,0 +1,659 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisPipeline.hpp"
+#include "AnalysisTypes.hpp"
+#include "AnalysisWorkspace.hpp"
+#include "AudioLoader.hpp"
+#include "BeatTracker.hpp"
+#include "BenchBaseline.hpp"
+#include "BpmAnalyzer.hpp"
+#include "CandidateIndex.hpp"
+#include "EnergyAnalyzer.hpp"
+#include "KeyAnalyzer.hpp"
+#include "LiveAnalyzer.hpp"
+#include "Resampler.hpp"
+#include "SetSequencer.hpp"
+#include "SyntheticAudio.hpp"
+#include "TempoKeyTracker.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
+#include "TransitionAnalyzer.hpp"
+#include "TransitionRenderer.hpp"
+#include "TransitionServer.hpp"
+
+namespace fs = std::filesystem;
+
+// Every allocation in the process goes through these, so each benchmark can report how many
+// heap allocations one operation makes.
+namespace {
+std::atomic<uint64_t> gAllocations{0};
+
+void* countedAlloc(std::size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = countedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* p = countedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+// GCC takes the pointers for the library's operator new and flags std::free on them; they come
+// from countedAlloc()'s malloc.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+struct BenchConfig {
+    int sampleRate = 44100;
+    double durationSeconds = 30.0;
+    double minSeconds = 0.5; // measuring time per benchmark
+    size_t jobs = 0;         // pool size for the parallel pipelines; 0 = hardware concurrency
+    std::string filter;
+    std::string baselinePath;
+    std::string writeBaselinePath;
+    double maxSlowdown = 0.25; // fail when ns/op exceeds the baseline by more than this fraction
+    double maxExtraAllocs = 0.0; // fail when allocs/op exceed the baseline by more than this
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void()> body;
+    double itemsPerOp = 0.0; // samples or window pairs handled by one call of `body`
+    const char* unit = "samples";
+};
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double itemsPerOp = 0.0;
+    const char* unit = "";
+};
+
+// A TransitionServer running on a background thread for as long as this lives.
+struct BackgroundServer {
+    explicit BackgroundServer(const ServerOptions& options) : server(options), thread([this] { server.run(); }) {}
+    ~BackgroundServer() {
+        server.stop();
+        thread.join();
+    }
+
+    TransitionServer server;
+    std::thread thread;
+};
+
+// Keeps results observable so the optimizer cannot drop the work being measured.
+volatile double gSink = 0.0;
+
+void printUsage(const char* exeName) {
+    std::cerr << "Usage: " << exeName << " [options]\n"
+              << "  --rate HZ              synthetic track sample rate (default 44100)\n"
+              << "  --duration SEC         synthetic track length (default 30)\n"
+              << "  --min-time SEC         measuring time per benchmark (default 0.5)\n"
+              << "  --filter TEXT          run only benchmarks whose name contains TEXT\n"
+              << "  --jobs N               threads for the parallel pipelines (default: all cores)\n"
+              << "  --baseline FILE        compare against a stored baseline; exit 1 on regression\n"
+              << "  --max-slowdown F       allowed ns/op increase over the baseline, as a fraction"
+                 " (default 0.25)\n"
+              << "  --max-extra-allocs N   allowed allocs/op increase over the baseline (default 0)\n"
+              << "  --write-baseline FILE  store this run as a baseline\n";
+}
+
+bool parseNumber(const std::string& text, double& out) {
+    char* end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(out);
+}
+
+// Returns false (after printing why) on a malformed command line.
+bool parseArgs(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+        double number = 0.0;
+        if (arg == "--rate") {
+            if (!value(text) || !parseNumber(text, number) || number < 8000.0 || number > 384000.0) {
+                std::cerr << "Error: --rate expects a sample rate in Hz (8000-384000)\n";
+                return false;
+            }
+            config.sampleRate = static_cast<int>(number);
+        } else if (arg == "--duration") {
+            if (!value(text) || !parseNumber(text, number) || number < 5.0 || number > 3600.0) {
+                std::cerr << "Error: --duration expects seconds (5-3600)\n";
+                return false;
+            }
+            config.durationSeconds = number;
+        } else if (arg == "--min-time") {
+            if (!value(text) || !parseNumber(text, number) || number < 0.0) {
+                std::cerr << "Error: --min-time expects non-negative seconds\n";
+                return false;
+            }
+            config.minSeconds = number;
+        } else if (arg == "--jobs") {
+            if (!value(text) || !parseNumber(text, number) || number < 1.0 || number > 1024.0 ||
+                number != std::floor(number)) {
+                std::cerr << "Error: --jobs expects a thread count (1-1024)\n";
+                return false;
+            }
+            config.jobs = static_cast<size_t>(number);
+        } else if (arg == "--filter") {
+            if (!value(config.filter)) {
+                std::cerr << "Error: --filter expects a name fragment\n";
+                return false;
+            }
+        } else if (arg == "--baseline") {
+            if (!value(config.baselinePath)) {
+                std::cerr << "Error: --baseline expects a file\n";
+                return false;
+            }
+        } else if (arg == "--write-baseline") {
+            if (!value(config.writeBaselinePath)) {
+                std::cerr << "Error: --write-baseline expects a file\n";
+                return false;
+            }
+        } else if (arg == "--max-slowdown") {
+            if (!value(text) || !parseNumber(text, number) || number < 0.0) {
+                std::cerr << "Error: --max-slowdown expects a non-negative fraction\n";
+                return false;
+            }
+            config.maxSlowdown = number;
+        } else if (arg == "--max-extra-allocs") {
+            if (!value(text) || !parseNumber(text, number) || number < 0.0) {
+                std::cerr << "Error: --max-extra-allocs expects a non-negative count\n";
+                return false;
+            }
+            config.maxExtraAllocs = number;
+        } else {
+            std::cerr << "Error: unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// One untimed warm-up call (sizes workspaces, faults in pages), then timed calls until
+// `minSeconds` have passed and at least three were made. Reports the fastest call: on a shared
+// machine interference only ever adds time, so the minimum is the most repeatable figure.
+BenchResult runBenchmark(const Benchmark& bench, double minSeconds) {
+    using Clock = std::chrono::steady_clock;
+    bench.body();
+
+    std::vector<double> samples;
+    uint64_t allocs = 0;
+    const Clock::time_point start = Clock::now();
+    do {
+        const uint64_t allocsBefore = gAllocations.load(std::memory_order_relaxed);
+        const Clock::time_point t0 = Clock::now();
+        bench.body();
+        const Clock::time_point t1 = Clock::now();
+        allocs += gAllocations.load(std::memory_order_relaxed) - allocsBefore;
+        samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    } while (samples.size() < 3 ||
+             std::chrono::duration<double>(Clock::now() - start).count() < minSeconds);
+
+    BenchResult result;
+    result.name = bench.name;
+    result.itemsPerOp = bench.itemsPerOp;
+    result.unit = bench.unit;
+    result.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(samples.size());
+    result.nsPerOp = *std::min_element(samples.begin(), samples.end());
+    return result;
+}
+
+std::string formatThroughput(const BenchResult& r) {
+    std::ostringstream oss;
+    oss << std::fixed;
+    if (r.itemsPerOp <= 0.0 || r.nsPerOp <= 0.0) {
+        oss << "-";
+    } else if (std::string(r.unit) == "samples") {
+        oss << std::setprecision(1) << r.itemsPerOp / r.nsPerOp * 1e3 << " Msamples/s";
+    } else {
+        oss << std::setprecision(2) << r.nsPerOp / r.itemsPerOp << " ns/" << r.unit;
+    }
+    return oss.str();
+}
+
+// Detected vs. generated BPM and key; a broken analyzer would otherwise show up only as a
+// suspiciously fast benchmark.
+bool checkAnalysis(const char* label, const TrackAnalysis& analysis, const SyntheticTrackSpec& spec) {
+    const bool bpmOk = std::abs(analysis.bpm - spec.bpm) <= 0.02 * spec.bpm;
+    const bool keyOk = analysis.key == syntheticKeyName(spec);
+    // Clicks fall on every beat from the start; the grid's last beat must still land on one.
+    const BeatGrid& grid = analysis.beatGrid;
+    const double clickSeconds = 60.0 / spec.bpm;
+    const double lastBeat = grid.empty() ? 0.0 : grid.beatTime(grid.beats - 1);
+    const double offBeat = std::abs(lastBeat - std::round(lastBeat / clickSeconds) * clickSeconds);
+    const bool gridOk = !grid.empty() && offBeat <= 0.02;
+    std::cout << "  " << label << ": BPM " << std::fixed << std::setprecision(2) << analysis.bpm << " (expected "
+              << spec.bpm << "), key " << analysis.key << " (expected " << syntheticKeyName(spec) << "), grid "
+              << std::setprecision(1) << 1000.0 * offBeat << " ms off the clicks"
+              << (bpmOk && keyOk && gridOk ? "" : "  MISMATCH") << "\n";
+    return bpmOk && keyOk && gridOk;
+}
+
+// Bit-for-bit equality; the parallel analysis must not depend on the thread count.
+bool sameAnalysis(const TrackAnalysis& a, const TrackAnalysis& b) {
+    return std::memcmp(&a.bpm, &b.bpm, sizeof(double)) == 0 && a.key == b.key &&
+           a.energyCurve.size() == b.energyCurve.size() &&
+           std::memcmp(a.energyCurve.data(), b.energyCurve.data(), a.energyCurve.size() * sizeof(double)) == 0 &&
+           a.energyIndex.blockSums() == b.energyIndex.blockSums() &&
+           std::memcmp(&a.beatGrid.firstBeat, &b.beatGrid.firstBeat, sizeof(double)) == 0 &&
+           std::memcmp(&a.beatGrid.beatSeconds, &b.beatGrid.beatSeconds, sizeof(double)) == 0 &&
+           a.beatGrid.beats == b.beatGrid.beats && a.beatGrid.downbeat == b.beatGrid.downbeat;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    BenchBaseline baseline;
+    if (!config.baselinePath.empty()) {
+        try {
+            baseline = loadBenchBaseline(config.baselinePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 2;
+        }
+        if (baseline.sampleRate != config.sampleRate ||
+            std::abs(baseline.durationSeconds - config.durationSeconds) > 1e-9) {
+            std::cerr << "Error: baseline was taken at " << baseline.sampleRate << " Hz, "
+                      << baseline.durationSeconds << " s; rerun with matching --rate/--duration\n";
+            return 2;
+        }
+    }
+
+    // Two tracks a DJ might mix: A minor into C major (relative keys), 124 into 126 BPM. Track A
+    // builds up, track B starts loud and winds down.
+    SyntheticTrackSpec specA;
+    specA.sampleRate = config.sampleRate;
+    specA.durationSeconds = config.durationSeconds;
+    specA.bpm = 124.0;
+    specA.keyRoot = 9;
+    specA.major = false;
+    specA.seed = 1;
+
+    SyntheticTrackSpec specB = specA;
+    specB.bpm = 126.0;
+    specB.keyRoot = 0;
+    specB.major = true;
+    specB.energyStart = 1.0;
+    specB.energyEnd = 0.4;
+    specB.seed = 2;
+
+    const AudioData audioA = generateSyntheticTrack(specA);
+    const AudioData audioB = generateSyntheticTrack(specB);
+
+    const fs::path wavPath = fs::temp_directory_path() /
+                             ("djtransition_bench_" + std::to_string(config.sampleRate) + "_" +
+                              std::to_string(static_cast<long long>(std::chrono::steady_clock::now()
+                                                                        .time_since_epoch()
+                                                                        .count())) +
+                              ".wav");
+    try {
+        writeWavFile(wavPath.string(), audioA, 2);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+
+    AnalysisWorkspace workspace;
+    const double windowSeconds = kDefaultEnergyWindowSeconds;
+    const double samples = static_cast<double>(audioA.samples.size());
+
+    ThreadPool pool(config.jobs);
+    AnalysisWorkspace parallelWorkspace;
+
+    const TrackAnalysis analysisA = analyzeAudio(audioA, windowSeconds, &workspace);
+    const TrackAnalysis analysisB = analyzeAudio(audioB, windowSeconds, &workspace);
+    const TransitionProfile profileA(analysisA);
+    const TransitionProfile profileB(analysisB);
+    const double windowPairs =
+        static_cast<double>(analysisA.energyCurve.size()) * static_cast<double>(analysisB.energyCurve.size());
+    // The same pair searched over every window rather than on phrase boundaries.
+    TrackAnalysis ungriddedA = analysisA;
+    TrackAnalysis ungriddedB = analysisB;
+    ungriddedA.beatGrid = BeatGrid{};
+    ungriddedB.beatGrid = BeatGrid{};
+    const TransitionProfile windowProfileA(ungriddedA);
+    const TransitionProfile windowProfileB(ungriddedB);
+
+    // Onsets of A as the analysis hands them to the beat tracker.
+    std::vector<OnsetSpan> onsetsA;
+    {
+        AnalysisDecimator decimator(audioA.sampleRate, workspace);
+        BpmAccumulator bpm(decimator.bpmRate());
+        decimator.push(audioA.samples.data(), audioA.samples.size());
+        bpm.push(decimator.bpmBlock(), decimator.bpmCount());
+        onsetsA.push_back(bpm.onsets());
+    }
+
+    // The store stays readable once opened, so its file is removed straight away.
+    fs::path storePath = wavPath;
+    storePath.replace_extension(".djts");
+    std::unique_ptr<TrackStore> store;
+    try {
+        writeTrackStore(storePath.string(), {"A", "B"}, {analysisA, analysisB});
+        store = std::make_unique<TrackStore>(storePath.string());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::error_code ec;
+        fs::remove(storePath, ec);
+        fs::remove(wavPath, ec);
+        return 2;
+    }
+    {
+        std::error_code ec;
+        fs::remove(storePath, ec);
+    }
+    const TrackView viewA = store->track(0);
+    const TrackView viewB = store->track(1);
+
+    // A crate for the sequencer: the two tracks with their tempo, key and level varied.
+    std::vector<TrackAnalysis> crate;
+    const char* crateKeys[] = {"C major", "G major", "A minor", "E minor", "F major", "D minor"};
+    for (size_t i = 0; i < 64; ++i) {
+        TrackAnalysis track = i % 2 == 0 ? analysisA : analysisB;
+        track.energyIndex = EnergyIndex();
+        track.bpm *= 1.0 + 0.004 * static_cast<double>(i % 11);
+        track.key = crateKeys[i % 6];
+        for (double& e : track.energyCurve) e *= 0.5 + 0.03 * static_cast<double>(i % 17);
+        crate.push_back(std::move(track));
+    }
+    SequenceOptions sequenceOptions;
+    sequenceOptions.jobs = config.jobs;
+    sequenceOptions.arc = EnergyArc::Peak;
+
+    // A library for the candidate index: the two tracks' fingerprints spread over tempos, keys
+    // (chroma rotated) and levels.
+    std::vector<TrackFingerprint> library(4096);
+    const TrackFingerprint fingerprints[] = {makeFingerprint(analysisA), makeFingerprint(analysisB)};
+    for (size_t i = 0; i < library.size(); ++i) {
+        const TrackFingerprint& base = fingerprints[i % 2];
+        TrackFingerprint& track = library[i];
+        track = base;
+        track.bpm = base.bpm * (0.8 + 0.4 * static_cast<double>((i * 37) % 101) / 100.0);
+        for (size_t pc = 0; pc < 12; ++pc) track.chroma[pc] = base.chroma[(pc + i * 7) % 12];
+        track.introLevel = base.introLevel * (0.5 + static_cast<double>(i % 13) / 24.0);
+        track.outroLow = base.outroLow * (0.5 + static_cast<double>(i % 11) / 20.0);
+    }
+    IndexOptions indexOptions;
+    indexOptions.jobs = config.jobs;
+    const CandidateIndex candidateIndex(library, indexOptions);
+    size_t nextQuery = 0;
+
+    // Warm queries against a server holding the stored pair: one round trip per op.
+    fs::path socketPath = wavPath;
+    socketPath.replace_extension(".sock");
+    ServerOptions serverOptions;
+    serverOptions.socketPath = socketPath.string();
+    serverOptions.jobs = config.jobs;
+    serverOptions.store = store.get();
+    std::unique_ptr<BackgroundServer> server;
+    std::unique_ptr<TransitionClient> client;
+    const std::string query = "{\"id\":1,\"a\":\"A\",\"b\":\"B\"}";
+    try {
+        server = std::make_unique<BackgroundServer>(serverOptions);
+        client = std::make_unique<TransitionClient>(serverOptions.socketPath);
+        if (client->request(query).find("\"ok\":true") == std::string::npos) {
+            throw std::runtime_error("server rejected the benchmark query");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::error_code ec;
+        fs::remove(wavPath, ec);
+        return 2;
+    }
+
+    // Rendering reads both tracks from disk and writes the mix back; 4 s of A, an 8 s fade and
+    // 4 s of B, stretched from 126 to 124 BPM.
+    fs::path wavPathB = wavPath;
+    wavPathB.replace_extension(".b.wav");
+    fs::path renderPath = wavPath;
+    renderPath.replace_extension(".render.wav");
+    try {
+        writeWavFile(wavPathB.string(), audioB, 2);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::error_code ec;
+        fs::remove(wavPath, ec);
+        return 2;
+    }
+    TransitionSuggestion renderCue;
+    renderCue.timeA = 0.5 * config.durationSeconds;
+    renderCue.timeB = 0.25 * config.durationSeconds;
+    RenderOptions renderOptions;
+    renderOptions.leadSeconds = 4.0;
+    renderOptions.fadeSeconds = 8.0;
+    renderOptions.tailSeconds = 4.0;
+    const double renderFrames = 16.0 * config.sampleRate;
+
+    std::vector<Benchmark> benchmarks;
+    benchmarks.push_back({"loadAudioFile", [&] {
+        gSink = gSink + loadAudioFile(wavPath.string()).samples.size();
+    }, samples});
+    benchmarks.push_back({"candidateIndex/build", [&] {
+        gSink = gSink + static_cast<double>(CandidateIndex(library, indexOptions).size());
+    }, static_cast<double>(library.size()), "track"});
+    benchmarks.push_back({"candidateIndex/search", [&] {
+        const size_t from = nextQuery++ % library.size();
+        gSink = gSink + static_cast<double>(candidateIndex.search(library[from], 20, 0, from).size());
+    }, 1.0, "query"});
+    benchmarks.push_back({"decimate", [&] {
+        AnalysisDecimator decimator(audioA.sampleRate, workspace);
+        for (size_t pos = 0; pos < audioA.samples.size(); pos += AudioStreamReader::kDefaultBlockFrames) {
+            const size_t count = std::min(AudioStreamReader::kDefaultBlockFrames, audioA.samples.size() - pos);
+            decimator.push(audioA.samples.data() + pos, count);
+            gSink = gSink + decimator.keyCount();
+        }
+    }, samples});
+    benchmarks.push_back({"estimateBPM", [&] {
+        gSink = gSink + estimateBPM(audioA, 80.0, 180.0, &workspace);
+    }, samples});
+    benchmarks.push_back({"computeEnergyCurve", [&] {
+        gSink = gSink + computeEnergyCurve(audioA, windowSeconds, &workspace).size();
+    }, samples});
+    benchmarks.push_back({"computeEnergyIndex", [&] {
+        gSink = gSink + computeEnergyIndex(audioA, &workspace).blockCount();
+    }, samples});
+    benchmarks.push_back({"estimateKey", [&] {
+        gSink = gSink + estimateKey(audioA, &workspace).size();
+    }, samples});
+    benchmarks.push_back({"trackTempoAndKey", [&] {
+        gSink = gSink + trackTempoAndKey(audioA, TempoKeyOptions(), &workspace).points.size();
+    }, samples});
+    benchmarks.push_back({"liveAnalyzer", [&] {
+        // A live session over the track: blocks as the reader hands them over, an estimate a second.
+        LiveOptions options;
+        LiveAnalyzer analyzer(audioA.sampleRate, options);
+        LiveEstimate estimate;
+        const size_t interval = static_cast<size_t>(audioA.sampleRate);
+        for (size_t pos = 0; pos < audioA.samples.size(); pos += AudioStreamReader::kDefaultBlockFrames) {
+            const size_t count = std::min(AudioStreamReader::kDefaultBlockFrames, audioA.samples.size() - pos);
+            analyzer.push(audioA.samples.data() + pos, count);
+            if ((pos + count) / interval != pos / interval) analyzer.estimate(estimate);
+        }
+        gSink = gSink + estimate.bpm;
+    }, samples});
+    benchmarks.push_back({"findBestTransition", [&] {
+        gSink = gSink + findBestTransition(analysisA, analysisB).score;
+    }, windowPairs, "window pair"});
+    benchmarks.push_back({"findBestTransition/profile", [&] {
+        gSink = gSink + findBestTransition(profileA, profileB).score;
+    }, windowPairs, "window pair"});
+    benchmarks.push_back({"findBestTransition/view", [&] {
+        gSink = gSink + findBestTransition(viewA, viewB).score;
+    }, windowPairs, "window pair"});
+    benchmarks.push_back({"findBestTransition/windows", [&] {
+        gSink = gSink + findBestTransition(windowProfileA, windowProfileB).score;
+    }, windowPairs, "window pair"});
+    benchmarks.push_back({"fitBeatGrid", [&] {
+        gSink = gSink + static_cast<double>(fitBeatGrid(onsetsA, analysisA.bpm, config.durationSeconds).beats);
+    }, samples});
+    benchmarks.push_back({"pipeline/inMemory", [&] {
+        const AudioData audio = loadAudioFile(wavPath.string());
+        gSink = gSink + analyzeAudio(audio, windowSeconds, &workspace).bpm;
+    }, samples});
+    benchmarks.push_back({"pipeline/inMemory/parallel", [&] {
+        const AudioData audio = loadAudioFile(wavPath.string());
+        gSink = gSink + analyzeAudio(audio, windowSeconds, &parallelWorkspace, &pool).bpm;
+    }, samples});
+    benchmarks.push_back({"pipeline/streaming", [&] {
+        gSink = gSink + analyzeTrackFile(wavPath.string(), windowSeconds, nullptr, &workspace).bpm;
+    }, samples});
+    benchmarks.push_back({"pipeline/streaming/parallel", [&] {
+        gSink = gSink + analyzeTrackFile(wavPath.string(), windowSeconds, nullptr, &parallelWorkspace, &pool).bpm;
+    }, samples});
+    // A 30 s track would fall back to a full pass under the default regions; scale them down.
+    RoiOptions roi;
+    roi.headSeconds = 4.0;
+    roi.tailSeconds = 4.0;
+    roi.probes = 4;
+    roi.probeSeconds = 1.0;
+    benchmarks.push_back({"pipeline/roi", [&] {
+        gSink = gSink + analyzeTrackRegions(wavPath.string(), roi, windowSeconds, nullptr, &workspace).bpm;
+    }, samples});
+    benchmarks.push_back({"renderTransition", [&] {
+        gSink = gSink + static_cast<double>(renderTransition(wavPath.string(), specA.bpm, wavPathB.string(), specB.bpm,
+                                                             renderCue, renderPath.string(), renderOptions)
+                                                .frames);
+    }, renderFrames});
+    benchmarks.push_back({"sequenceSet", [&] {
+        gSink = gSink + sequenceSet(crate, sequenceOptions).totalScore;
+    }, static_cast<double>(crate.size()), "track"});
+    benchmarks.push_back({"server/query", [&] {
+        gSink = gSink + static_cast<double>(client->request(query).size());
+    }, 1.0, "request"});
+
+    std::cout << "Synthetic tracks: " << config.sampleRate << " Hz, " << config.durationSeconds << " s\n";
+    bool analysisOk = checkAnalysis("A", analysisA, specA);
+    analysisOk = checkAnalysis("B", analysisB, specB) && analysisOk;
+    const bool deterministic = sameAnalysis(analysisA, analyzeAudio(audioA, windowSeconds, &parallelWorkspace, &pool));
+    std::cout << "  A on " << pool.size() << " thread" << (pool.size() == 1 ? "" : "s") << ": "
+              << (deterministic ? "identical to the serial analysis" : "DIFFERS from the serial analysis") << "\n";
+    analysisOk = deterministic && analysisOk;
+    std::cout << "\n";
+
+    std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(14) << "ns/op"
+              << std::setw(24) << "throughput" << std::setw(12) << "allocs/op" << std::setw(10) << "vs base"
+              << "\n";
+
+    BenchBaseline current;
+    current.sampleRate = config.sampleRate;
+    current.durationSeconds = config.durationSeconds;
+    size_t regressions = 0;
+    size_t ran = 0;
+    for (const Benchmark& bench : benchmarks) {
+        if (!config.filter.empty() && bench.name.find(config.filter) == std::string::npos) continue;
+        BenchResult r;
+        try {
+            r = runBenchmark(bench, config.minSeconds);
+        } catch (const std::exception& e) {
+            std::cerr << "Error in " << bench.name << ": " << e.what() << "\n";
+            std::error_code ec;
+            fs::remove(wavPath, ec);
+            fs::remove(wavPathB, ec);
+            fs::remove(renderPath, ec);
+            return 2;
+        }
+        ++ran;
+        current.entries[r.name] = {r.nsPerOp, r.allocsPerOp, -1.0};
+
+        std::cout << std::left << std::setw(28) << r.name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << r.nsPerOp << std::setw(24) << formatThroughput(r) << std::setw(12)
+                  << r.allocsPerOp;
+
+        auto it = baseline.entries.find(r.name);
+        if (config.baselinePath.empty()) {
+            std::cout << "\n";
+        } else if (it == baseline.entries.end() || it->second.nsPerOp <= 0.0) {
+            std::cout << std::setw(10) << "new" << "\n";
+        } else {
+            const BaselineEntry& base = it->second;
+            const double change = r.nsPerOp / base.nsPerOp - 1.0;
+            const double allowed = base.maxSlowdown >= 0.0 ? base.maxSlowdown : config.maxSlowdown;
+            const bool slower = change > allowed;
+            const bool moreAllocs = r.allocsPerOp > base.allocsPerOp + config.maxExtraAllocs;
+            std::ostringstream delta;
+            delta << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%";
+            std::cout << std::setw(10) << delta.str();
+            if (slower) std::cout << "  REGRESSION (allowed +" << std::setprecision(0) << allowed * 100.0 << "%)";
+            if (moreAllocs) {
+                std::cout << "  ALLOCS (baseline " << std::setprecision(0) << base.allocsPerOp << ")";
+            }
+            std::cout << "\n";
+            // Carry per-benchmark thresholds over when the baseline is rewritten.
+            current.entries[r.name].maxSlowdown = base.maxSlowdown;
+            if (slower || moreAllocs) ++regressions;
+        }
+    }
+
+    std::error_code ec;
+    fs::remove(wavPath, ec);
+    fs::remove(wavPathB, ec);
+    fs::remove(renderPath, ec);
+
+    if (ran == 0) {
+        std::cerr << "Error: no benchmark matches --filter " << config.filter << "\n";
+        return 2;
+    }
+    if (!config.writeBaselinePath.empty()) {
+        try {
+            writeBenchBaseline(config.writeBaselinePath, current);
+            std::cout << "\nBaseline written to " << config.writeBaselinePath << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 2;
+        }
+    }
+    if (!analysisOk) {
+        std::cerr << "Analysis of the synthetic tracks does not match their parameters\n";
+        return 1;
+    }
+    if (regressions > 0) {
+        std::cerr << regressions << " benchmark(s) regressed against " << config.baselinePath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "SyntheticAudio.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTargetPeak = 0.9;
+constexpr int kBeatsPerBar = 4;
+constexpr double kClickSeconds = 0.03;
+constexpr double kClickDecaySeconds = 0.008;
+constexpr double kChordFadeSeconds = 0.01;
+
+const std::array<const char*, 12> kNoteNames = {
+    "C", "C#/Db", "D", "D#/Eb", "E", "F", "F#/Gb", "G", "G#/Ab", "A", "A#/Bb", "B"};
+
+// Degrees of the four-bar progression: tonic, subdominant, dominant, tonic.
+constexpr std::array<int, 4> kProgression = {0, 5, 7, 0};
+
+double pitchHz(int midiNote) {
+    return 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
+}
+
+// Small LCG so the click noise does not depend on the standard library's generators.
+struct Lcg {
+    uint32_t state;
+    float next() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24) * 2.0f - 1.0f;
+    }
+};
+
+void putU16(std::FILE* f, uint16_t v) {
+    const unsigned char b[2] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8)};
+    std::fwrite(b, 1, 2, f);
+}
+
+void putU32(std::FILE* f, uint32_t v) {
+    const unsigned char b[4] = {static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8),
+                                static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24)};
+    std::fwrite(b, 1, 4, f);
+}
+} // namespace
+
+AudioData generateSyntheticTrack(const SyntheticTrackSpec& spec) {
+    if (spec.sampleRate <= 0 || !(spec.durationSeconds > 0.0) || !(spec.bpm > 0.0) || spec.keyRoot < 0 ||
+        spec.keyRoot > 11) {
+        throw std::invalid_argument("Invalid synthetic track parameters");
+    }
+
+    AudioData audio;
+    audio.sampleRate = spec.sampleRate;
+    audio.channels = 1;
+    const double rate = static_cast<double>(spec.sampleRate);
+    const size_t total = static_cast<size_t>(std::llround(spec.durationSeconds * rate));
+    audio.samples.assign(total, 0.0f);
+
+    // Chord tones: root-position triads from C6 up, high enough that neighbouring pitch classes
+    // fall in separate bins of the key analyzer's FFT. Each bar plays one chord of the
+    // progression, with short fades at the bar line.
+    const double beatSeconds = 60.0 / spec.bpm;
+    const double barSeconds = beatSeconds * kBeatsPerBar;
+    const int third = spec.major ? 4 : 3;
+    const size_t fadeSamples = std::max<size_t>(1, static_cast<size_t>(kChordFadeSeconds * rate));
+    for (size_t n = 0; n < total; ++n) {
+        const double t = static_cast<double>(n) / rate;
+        const size_t bar = static_cast<size_t>(t / barSeconds);
+        const int degree = kProgression[bar % kProgression.size()];
+        const int root = 84 + (spec.keyRoot + degree) % 12;
+
+        const double intoBar = t - static_cast<double>(bar) * barSeconds;
+        const double toBarEnd = barSeconds - intoBar;
+        const double fade = std::min({1.0, intoBar * rate / fadeSamples, toBarEnd * rate / fadeSamples});
+
+        double tone = std::sin(2.0 * kPi * pitchHz(root) * t);
+        tone += 0.8 * std::sin(2.0 * kPi * pitchHz(root + third) * t);
+        tone += 0.8 * std::sin(2.0 * kPi * pitchHz(root + 7) * t);
+        audio.samples[n] = static_cast<float>(0.3 * fade * tone);
+    }
+
+    // Clicks: equal decaying noise bursts on every beat. An accented downbeat would give the
+    // bar period as much weight as the beat and invite half-tempo estimates.
+    Lcg rng{spec.seed};
+    const size_t clickSamples = static_cast<size_t>(kClickSeconds * rate);
+    for (size_t beat = 0;; ++beat) {
+        const size_t start = static_cast<size_t>(std::llround(static_cast<double>(beat) * beatSeconds * rate));
+        if (start >= total) break;
+        const size_t end = std::min(total, start + clickSamples);
+        for (size_t n = start; n < end; ++n) {
+            const double decay = std::exp(-static_cast<double>(n - start) / (kClickDecaySeconds * rate));
+            audio.samples[n] += static_cast<float>(spec.clickLevel * decay * rng.next());
+        }
+    }
+
+    // Energy ramp over the whole track, then normalize the peak.
+    float peak = 0.0f;
+    for (size_t n = 0; n < total; ++n) {
+        const double x = total > 1 ? static_cast<double>(n) / static_cast<double>(total - 1) : 0.0;
+        const double level = spec.energyStart + (spec.energyEnd - spec.energyStart) * x;
+        audio.samples[n] = static_cast<float>(audio.samples[n] * level);
+        peak = std::max(peak, std::fabs(audio.samples[n]));
+    }
+    if (peak > 0.0f) {
+        const float gain = static_cast<float>(kTargetPeak) / peak;
+        for (float& s : audio.samples) s *= gain;
+    }
+    return audio;
+}
+
+std::string syntheticKeyName(const SyntheticTrackSpec& spec) {
+    if (spec.keyRoot < 0 || spec.keyRoot > 11) return "Unknown";
+    return std::string(kNoteNames[static_cast<size_t>(spec.keyRoot)]) + (spec.major ? " major" : " minor");
+}
+
+void writeWavFile(const std::string& path, const AudioData& audio, int channels) {
+    if (channels <= 0 || audio.sampleRate <= 0) {
+        throw std::runtime_error("Invalid WAV parameters for: " + path);
+    }
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("Failed to create WAV file: " + path);
+    }
+
+    const uint32_t blockAlign = static_cast<uint32_t>(channels) * 2;
+    const uint32_t dataBytes = static_cast<uint32_t>(audio.samples.size()) * blockAlign;
+    std::fwrite("RIFF", 1, 4, f);
+    putU32(f, 36 + dataBytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    putU32(f, 16);
+    putU16(f, 1); // PCM
+    putU16(f, static_cast<uint16_t>(channels));
+    putU32(f, static_cast<uint32_t>(audio.sampleRate));
+    putU32(f, static_cast<uint32_t>(audio.sampleRate) * blockAlign);
+    putU16(f, static_cast<uint16_t>(blockAlign));
+    putU16(f, 16);
+    std::fwrite("data", 1, 4, f);
+    putU32(f, dataBytes);
+
+    std::vector<unsigned char> frame(blockAlign);
+    for (float s : audio.samples) {
+        const long q = std::lround(std::clamp(s, -1.0f, 1.0f) * 32767.0f);
+        const uint16_t v = static_cast<uint16_t>(static_cast<int16_t>(q));
+        for (int c = 0; c < channels; ++c) {
+            frame[static_cast<size_t>(c) * 2] = static_cast<unsigned char>(v);
+            frame[static_cast<size_t>(c) * 2 + 1] = static_cast<unsigned char>(v >> 8);
+        }
+        std::fwrite(frame.data(), 1, frame.size(), f);
+    }
+
+    const bool failed = std::ferror(f) != 0;
+    if (std::fclose(f) != 0 || failed) {
+        throw std::runtime_error("Failed to write WAV file: " + path);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AudioLoader.hpp"
+
+#include <cstdint>
+#include <string>
+
+// Parameters of a synthetic test track. Every track is a pure function of its spec (no clocks or
+// global random state), so benchmarks and accuracy checks run on the same audio every time
+// without any audio files.
+struct SyntheticTrackSpec {
+    int sampleRate = 44100;
+    double durationSeconds = 30.0;
+    double bpm = 124.0;         // click on every beat
+    int keyRoot = 9;            // pitch class of the tonic, 0 = C
+    bool major = false;         // chord tones follow i-iv-v-i (minor) or I-IV-V-I (major)
+    double energyStart = 0.3;   // overall level at the start, 0-1
+    double energyEnd = 1.0;     // level at the end; linear ramp in between
+    double clickLevel = 2.0;    // click amplitude relative to the chord tones
+    uint32_t seed = 1;          // drives the click noise bursts
+};
+
+// Mono, normalized like loadAudioFile(). Throws std::invalid_argument on a non-positive rate,
+// duration or BPM, or a key root outside 0-11.
+AudioData generateSyntheticTrack(const SyntheticTrackSpec& spec);
+
+// Key name in the analyzer's spelling, e.g. "A minor".
+std::string syntheticKeyName(const SyntheticTrackSpec& spec);
+
+// Write `audio` as a 16-bit PCM WAV with the mono signal copied to `channels` channels.
+// Throws std::runtime_error on failure.
+void writeWavFile(const std::string& path, const AudioData& audio, int channels = 2);
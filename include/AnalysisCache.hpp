@@ -0,0 +1,78 @@
+#pragma once
+
+#include "AnalysisPipeline.hpp"
+#include "AnalysisTypes.hpp"
+#include "AudioLoader.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bump whenever analyzer output or the cached payload changes; entries written by another
+// version no longer match and are re-analyzed.
+constexpr uint32_t kAnalyzerVersion = 6;
+
+struct CacheKey {
+    uint64_t fileSize = 0;
+    int64_t mtimeNs = 0;
+    uint64_t contentHash = 0; // sampled file content, see makeCacheKey()
+    uint64_t paramsHash = 0;  // analyzer version and parameters
+};
+
+// Key for a file at the current analyzer version. The content hash covers the file size and
+// 64 KiB from the start, middle and end, so keying does not read whole files. The energy window
+// is not part of the key: other window sizes are derived from the cached EnergyIndex.
+// Throws std::runtime_error if the file cannot be read.
+CacheKey makeCacheKey(const std::string& path);
+
+// Persistent TrackAnalysis cache in a directory: `index.bin` holds fixed-size records and is
+// memory-mapped, `data.bin` holds the serialized analyses. Both files are append-only and
+// appends take an advisory file lock, so processes can share a directory. Thread-safe.
+class AnalysisCache {
+public:
+    // Creates the directory if needed. Throws std::runtime_error on failure.
+    explicit AnalysisCache(const std::string& directory);
+    ~AnalysisCache();
+
+    AnalysisCache(const AnalysisCache&) = delete;
+    AnalysisCache& operator=(const AnalysisCache&) = delete;
+
+    // Returns true and fills `out` (and `info` when non-null) on a hit.
+    bool lookup(const CacheKey& key, TrackAnalysis& out, AudioStreamInfo* info = nullptr);
+
+    void store(const CacheKey& key, const TrackAnalysis& analysis, const AudioStreamInfo& info);
+
+    // $DJT_CACHE_DIR, else $XDG_CACHE_HOME/djtransition, else $HOME/.cache/djtransition;
+    // empty if none is set.
+    static std::string defaultDirectory();
+
+private:
+    struct Record;
+
+    void refreshIndex(); // pick up records appended since the last mapping (caller locks)
+    bool readPayload(const Record& record, std::vector<unsigned char>& payload) const;
+
+    std::string directory_;
+    int indexFd_ = -1;
+    int dataFd_ = -1;
+    const unsigned char* mapped_ = nullptr;
+    size_t mappedLength_ = 0;
+    size_t recordsIndexed_ = 0;
+    std::unordered_map<uint64_t, size_t> byDigest_; // key digest -> record number
+    std::mutex mutex_;
+};
+
+// analyzeTrackFile() through the cache: returns the cached analysis when the file matches, with
+// the energy curve recomputed from the index if it was cached at another window size;
+// otherwise analyzes and stores the result. `cache` may be null. With `roi`, a miss is analyzed
+// with analyzeTrackRegions() instead and not stored: the cache only holds full analyses.
+TrackAnalysis analyzeTrackCached(AnalysisCache* cache,
+                                 const std::string& path,
+                                 double windowSeconds = kDefaultEnergyWindowSeconds,
+                                 AudioStreamInfo* info = nullptr,
+                                 AnalysisWorkspace* workspace = nullptr,
+                                 ThreadPool* pool = nullptr,
+                                 const RoiOptions* roi = nullptr);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+#include "AnalysisWorkspace.hpp"
+#include "AudioLoader.hpp"
+
+#include <cstddef>
+#include <string>
+
+class ThreadPool;
+
+// Default energy window size in seconds.
+constexpr double kDefaultEnergyWindowSeconds = 0.5;
+
+// Decode and analyze a track in a single streaming pass: the decoded blocks feed a
+// SegmentedAnalysis, so only a few seconds of samples are buffered per segment in flight. With a
+// `pool`, segments (and the energy and tempo/key passes within each) run concurrently while
+// decoding continues; results are bit-identical with or without one. Fills `info` when non-null.
+// Scratch memory comes from `workspace` when given; reuse one per thread across tracks.
+// Throws std::runtime_error on failure.
+TrackAnalysis analyzeTrackFile(const std::string& path,
+                               double windowSeconds = kDefaultEnergyWindowSeconds,
+                               AudioStreamInfo* info = nullptr,
+                               AnalysisWorkspace* workspace = nullptr,
+                               ThreadPool* pool = nullptr);
+
+// BPM, energy and key of a track already in memory (e.g. from loadAudioFile()), in one
+// segmented pass over the shared samples; concurrent on `pool` when given.
+TrackAnalysis analyzeAudio(const AudioData& audio,
+                           double windowSeconds = kDefaultEnergyWindowSeconds,
+                           AnalysisWorkspace* workspace = nullptr,
+                           ThreadPool* pool = nullptr);
+
+// Parts of a track decoded by analyzeTrackRegions(): the intro and outro a transition is searched
+// in, and short probes spread over the middle for the track's overall tempo and key. The defaults
+// keep a pair query to about a tenth of two 5-minute tracks once each side is decoded for its role.
+struct RoiOptions {
+    double headSeconds = 24.0; // entry side, where a transition into the track lands
+    double tailSeconds = 24.0; // exit side, where a transition out of the track starts
+    size_t probes = 4;
+    double probeSeconds = 1.0;
+
+    // Only the side a transition uses: the tail of the outgoing track, the head of the incoming one.
+    RoiOptions exitSide() const {
+        RoiOptions side = *this;
+        side.headSeconds = 0.0;
+        return side;
+    }
+    RoiOptions entrySide() const {
+        RoiOptions side = *this;
+        side.tailSeconds = 0.0;
+        return side;
+    }
+};
+
+// BPM, key and energy from only the regions of interest of a file, seeking past the rest
+// without decoding it. Regions are snapped to the energy window grid. The energy curve covers
+// the whole track, but only the head and tail have values and the rest is NaN, so transitions
+// are only searched there. A pair query passes exitSide() for the outgoing track and entrySide()
+// for the incoming one. The curve is scaled by the peak of the decoded audio. The energy
+// index is left empty. BPM sums the regions' onset autocorrelations and key their pitch-class
+// histograms. Falls back to analyzeTrackFile() when the regions cover most of the track.
+// Throws std::invalid_argument on negative durations and std::runtime_error on failure.
+TrackAnalysis analyzeTrackRegions(const std::string& path,
+                                  const RoiOptions& roi,
+                                  double windowSeconds = kDefaultEnergyWindowSeconds,
+                                  AudioStreamInfo* info = nullptr,
+                                  AnalysisWorkspace* workspace = nullptr);
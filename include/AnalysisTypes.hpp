@@ -1,13 +1,39 @@
 #pragma once
 
+#include "EnergyIndex.hpp"
+
+#include <array>
+#include <cstddef>
 #include <string>
 #include <vector>
 
+// Beats of a track at a constant tempo: beat i falls at firstBeat + i * beatSeconds for
+// i < beats, and bars of kBeatsPerBar beats start on beat `downbeat` and every kBeatsPerBar
+// beats after it.
+struct BeatGrid {
+    static constexpr size_t kBeatsPerBar = 4;
+
+    double firstBeat = 0.0;   // seconds, within the first beat period
+    double beatSeconds = 0.0; // 0 if no grid was found
+    size_t beats = 0;
+    size_t downbeat = 0; // 0 .. kBeatsPerBar - 1
+
+    bool empty() const { return beats == 0 || !(beatSeconds > 0.0); }
+    double beatTime(size_t beat) const { return firstBeat + static_cast<double>(beat) * beatSeconds; }
+
+    // Bars that start within the track.
+    size_t bars() const { return beats > downbeat ? (beats - downbeat + kBeatsPerBar - 1) / kBeatsPerBar : 0; }
+    double barTime(size_t bar) const { return beatTime(downbeat + bar * kBeatsPerBar); }
+};
+
 struct TrackAnalysis {
     double bpm = 0.0;
     std::string key = "Unknown";
+    std::array<double, 12> chroma{}; // pitch-class energy (C = 0 .. B = 11) summing to 1; all 0 if unknown
     std::vector<double> energyCurve; // RMS per window
     double windowSeconds = 0.0;
+    EnergyIndex energyIndex; // energy at any other window size, without the samples
+    BeatGrid beatGrid;       // empty if the tempo is unknown
 };
 
 struct TransitionSuggestion {
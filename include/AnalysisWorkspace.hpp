@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Fft.hpp"
+#include "Resampler.hpp"
+
+#include <complex>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct SegmentSlot;
+
+// Scratch buffers and precomputed tables for the analyzers. Reusing one workspace for every
+// track a thread analyzes means buffers only grow to the largest track seen and FFT plans are
+// built once per size, so steady-state analysis does not allocate per track or per frame.
+// Not thread-safe: use one workspace per thread, and at most one accumulator of each kind on a
+// workspace at a time.
+class AnalysisWorkspace {
+public:
+    AnalysisWorkspace();
+    ~AnalysisWorkspace();
+    AnalysisWorkspace(const AnalysisWorkspace&) = delete;
+    AnalysisWorkspace& operator=(const AnalysisWorkspace&) = delete;
+
+    // Plan for a power-of-two size, built on first use.
+    const FftPlan& fftPlan(size_t size);
+
+    // Resampler for a rate pair and passband, built on first use and reset on every call.
+    PolyphaseResampler& resampler(int inputRate, int outputRate, double passband);
+
+    std::vector<float> audioBlock; // interleaved block read by AudioStreamReader
+    std::vector<float> bpmStream;  // AnalysisDecimator output at kBpmAnalysisRate
+    std::vector<float> keyStream;  // AnalysisDecimator output at kKeyAnalysisRate
+
+    std::vector<double> hopEnergies;             // BpmAccumulator sum of squares per hop
+    std::vector<double> novelty;                 // onset curve derived from hopEnergies
+    std::vector<double> tempoPadded;             // zero-padded novelty / autocorrelation
+    std::vector<std::complex<double>> tempoBins; // novelty power spectrum
+
+    std::vector<double> energyWindows; // EnergyAccumulator sum of squares of completed windows
+    std::vector<double> energyBlocks;  // EnergyAccumulator energy index block sums
+
+    std::vector<float> keyPending;             // KeyAccumulator frame being filled
+    std::vector<float> keyFrame;               // windowed frame
+    std::vector<std::complex<double>> keyBins; // frame spectrum
+
+    // Segments of a SegmentedAnalysis on this workspace, each with its own workspace; kept here
+    // between tracks.
+    std::vector<std::unique_ptr<SegmentSlot>> segmentSlots;
+
+private:
+    // A deque so that references handed out stay valid as plans are added.
+    std::deque<std::pair<size_t, FftPlan>> plans_;
+    std::deque<PolyphaseResampler> resamplers_;
+};
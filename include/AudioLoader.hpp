@@ -1,14 +1,86 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+struct PcmView;
+
 struct AudioData {
     std::vector<float> samples; // mono, normalized
     int sampleRate = 0;
     int channels = 0;
 };
 
+struct AudioStreamInfo {
+    int sampleRate = 0;
+    int channels = 0;    // channels in the file (blocks are always mono)
+    uint64_t frames = 0; // frames reported by the file header
+};
+
+// Reads an audio file block by block, downmixing each block to mono. Uncompressed WAV files are
+// memory-mapped and converted straight from the data chunk; other formats go through
+// libsndfile. Memory use is bounded by the block size, independent of the file length. Blocks
+// are not peak-normalized; apply normalizationGain(peak()) once the stream is exhausted.
+class AudioStreamReader {
+public:
+    static constexpr size_t kDefaultBlockFrames = 8192;
+
+    // Blocks are decoded into `blockBuffer` when given, so a caller reading many files can reuse
+    // one buffer; it must outlive the reader. Throws std::runtime_error on failure.
+    explicit AudioStreamReader(const std::string& path,
+                               size_t blockFrames = kDefaultBlockFrames,
+                               std::vector<float>* blockBuffer = nullptr);
+    ~AudioStreamReader();
+
+    AudioStreamReader(const AudioStreamReader&) = delete;
+    AudioStreamReader& operator=(const AudioStreamReader&) = delete;
+
+    const AudioStreamInfo& info() const;
+
+    // Reads the next mono block of at most `maxFrames` frames. Returns its frame count (0 at end
+    // of file); `mono` stays valid until the next call. Throws std::runtime_error if the file
+    // ends before info().frames.
+    size_t readBlock(const float*& mono, size_t maxFrames = SIZE_MAX);
+
+    // Like readBlock(), but the block keeps all info().channels channels, interleaved, and does
+    // not count toward peak().
+    size_t readInterleaved(const float*& frames, size_t maxFrames = SIZE_MAX);
+
+    // Continue reading at `frame` (at most info().frames), skipping everything in between
+    // without decoding it. Throws std::runtime_error if the file cannot seek.
+    void seek(uint64_t frame);
+
+    // Frame the next readBlock() starts at.
+    uint64_t position() const;
+
+    // Peak absolute mono sample over all blocks read so far (only the decoded parts after a
+    // seek()).
+    float peak() const;
+
+    // Read-only view of the raw interleaved samples when the file is memory-mapped, else nullptr.
+    const PcmView* pcmView() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+using AudioBlockCallback = std::function<void(const float* mono, size_t frames)>;
+
+// Stream every mono block of a file to `onBlock` in order. Returns the file info and, if
+// requested, the peak absolute sample. Throws std::runtime_error on failure.
+AudioStreamInfo streamAudioFile(const std::string& path,
+                                const AudioBlockCallback& onBlock,
+                                float* peakOut = nullptr,
+                                size_t blockFrames = AudioStreamReader::kDefaultBlockFrames);
+
+// Gain that brings `peak` down to the normalization target; 1 when no attenuation is needed.
+float normalizationGain(float peak);
+
 // Load an audio file via libsndfile, convert to mono, normalize to avoid clipping.
 // Throws std::runtime_error on failure.
 AudioData loadAudioFile(const std::string& path);
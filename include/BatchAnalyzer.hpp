@@ -0,0 +1,39 @@
+#pragma once
+
+#include "AnalysisPipeline.hpp"
+#include "AnalysisTypes.hpp"
+#include "AudioLoader.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class AnalysisCache;
+
+struct BatchOptions {
+    size_t jobs = 0;        // worker threads; 0 = hardware concurrency
+    size_t maxInFlight = 0; // tracks queued or running at once; 0 = 2 * jobs
+    double windowSeconds = kDefaultEnergyWindowSeconds;
+    AnalysisCache* cache = nullptr; // consulted before decoding when set
+};
+
+struct BatchResult {
+    std::string path;
+    AudioStreamInfo info;
+    TrackAnalysis analysis;
+    std::string error; // empty on success
+};
+
+// Expand inputs into track paths: directories are scanned recursively for audio files, files
+// with an audio extension are taken as-is, and any other file is read as a list of paths (one
+// per line; blank lines and lines starting with '#' are skipped).
+// Throws std::runtime_error when an input does not exist.
+std::vector<std::string> collectTrackPaths(const std::vector<std::string>& inputs);
+
+// Analyze tracks on a work-stealing pool, at most maxInFlight at a time so memory stays
+// bounded. `onResult` is called once per track, serialized, in completion order.
+// Returns the number of tracks that failed.
+size_t analyzeBatch(const std::vector<std::string>& paths,
+                    const BatchOptions& options,
+                    const std::function<void(const BatchResult&)>& onResult);
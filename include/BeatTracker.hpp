@@ -0,0 +1,17 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+#include "BpmAnalyzer.hpp"
+
+#include <vector>
+
+// Fit a constant-tempo beat grid to the onsets of `spans` (in order, not overlapping; gaps
+// between them are fine), near the tempo `bpm` estimateBPM() found, for a track of
+// `durationSeconds`. Onset novelty, as the BPM estimate uses it, is folded onto one beat period:
+// the period within 1% of 60 / bpm whose fold piles the most onset strength into one phase
+// wins, searched in steps that move the last beat by a quarter beat and then by 1/80 of one.
+// The beats fall on that phase. The downbeat is the one of kBeatsPerBar phases whose bars
+// change loudness most sharply from one to the next, as they do where sections begin; patterns
+// within a bar, like a clap on two and four, weigh the same in every phase. Empty if bpm <= 0 or
+// there are no onsets.
+BeatGrid fitBeatGrid(const std::vector<OnsetSpan>& spans, double bpm, double durationSeconds);
@@ -1,9 +1,106 @@
 #pragma once
 
+#include "AnalysisWorkspace.hpp"
 #include "AudioLoader.hpp"
 
-// Estimate BPM using a simple onset/novelty curve and autocorrelation.
-// Returns 0 on failure/insufficient data.
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Autocorrelation of a novelty curve over every lag, computed once via FFT (Wiener-Khinchin).
+// Any number of BPM ranges can then be queried without re-analysis.
+class TempoSpectrum {
+public:
+    TempoSpectrum() = default;
+    // `novelty` is made zero-mean internally; `hopSeconds` is the spacing of its values.
+    TempoSpectrum(const std::vector<double>& novelty, double hopSeconds);
+
+    bool empty() const { return autocorr_.empty(); }
+    double hopSeconds() const { return hopSeconds_; }
+    const std::vector<double>& autocorrelation() const { return autocorr_; } // index = lag
+
+    // Strongest periodicity within [minBpm, maxBpm]: best integer lag, then refined between
+    // lags by parabolic interpolation. Returns 0 on an invalid range or insufficient data.
+    double bestBpm(double minBpm = 80.0, double maxBpm = 180.0) const;
+
+private:
+    double hopSeconds_ = 0.0;
+    std::vector<double> autocorr_;
+};
+
+// Strongest periodicity within [minBpm, maxBpm] of an autocorrelation given for lags
+// [0, size) of a novelty curve with values every `hopSeconds`; see TempoSpectrum::bestBpm().
+// Only the lags in range and their neighbours are read.
+double bestBpmFromAutocorrelation(const double* autocorr, size_t size, double hopSeconds, double minBpm,
+                                  double maxBpm);
+
+// Hop energies of part of a track: hop i is the sum of squares of the `hopSeconds` starting at
+// startSeconds + i * hopSeconds.
+struct OnsetSpan {
+    double startSeconds = 0.0;
+    double hopSeconds = 0.0;
+    std::vector<double> hopEnergies;
+};
+
+// Incremental onset/novelty accumulator. Feed mono blocks in order, then query estimate(). The
+// frame sizes are tuned for a kBpmAnalysisRate stream (see AnalysisDecimator). Memory grows only
+// with the hop energies (one value per hop), not with the audio. They, the novelty curve and the
+// estimate's FFT buffers live in `workspace` when given (else in a private workspace).
+class BpmAccumulator {
+public:
+    // Short frame for onset sensitivity, 50% overlap so each frame is two hops. At
+    // kBpmAnalysisRate a hop is ~11.6 ms.
+    static constexpr size_t kFrameSize = 512;
+    static constexpr size_t kHopSize = kFrameSize / 2;
+
+    explicit BpmAccumulator(int sampleRate, AnalysisWorkspace* workspace = nullptr);
+
+    BpmAccumulator(const BpmAccumulator&) = delete;
+    BpmAccumulator& operator=(const BpmAccumulator&) = delete;
+
+    // Size the hop energies for a stream of `totalSamples` samples.
+    void reserve(uint64_t totalSamples);
+
+    void push(const float* samples, size_t count);
+
+    // Continue with the hops `next` accumulated over the samples that follow this one's, as if
+    // they had been pushed here. Throws std::invalid_argument unless this accumulator ends on a
+    // hop boundary.
+    void append(const BpmAccumulator& next);
+
+    // Forget all but the last `hops` completed hops, so estimates follow a live stream and
+    // memory stays bounded.
+    void keepRecent(size_t hops);
+
+    // Copy of the completed hops, the first starting `startSeconds` into the track.
+    OnsetSpan onsets(double startSeconds = 0.0) const;
+
+    // Tempo spectrum of everything pushed so far.
+    TempoSpectrum tempoSpectrum() const;
+
+    // Estimate BPM from everything pushed so far. Returns 0 on insufficient data.
+    double estimate(double minBpm = 80.0, double maxBpm = 180.0) const;
+
+private:
+    // Half-wave rectified frame energy differences of the completed hops, into ws_.novelty.
+    const std::vector<double>& novelty() const;
+
+    int sampleRate_ = 0;
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace_;
+    AnalysisWorkspace& ws_; // hopEnergies: sum of squares of each completed hop
+    double hopEnergy_ = 0.0; // sum of squares of the hop being filled
+    size_t hopFill_ = 0;
+};
+
+// Estimate BPM using a simple onset/novelty curve and autocorrelation, on the audio decimated
+// to kBpmAnalysisRate. Returns 0 on failure/insufficient data.
+// The track is cut into segments analyzed concurrently on `pool` when given (see
+// SegmentedAnalysis); the result does not depend on the thread count.
 double estimateBPM(const AudioData& audio,
                    double minBpm = 80.0,
-                   double maxBpm = 180.0);
+                   double maxBpm = 180.0,
+                   AnalysisWorkspace* workspace = nullptr,
+                   ThreadPool* pool = nullptr);
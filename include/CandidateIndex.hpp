@@ -0,0 +1,121 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TrackView;
+class TrackStore;
+
+// Compact summary of a track for finding what to mix into it, or out of it.
+struct TrackFingerprint {
+    double bpm = 0.0;                // 0 if unknown
+    std::array<double, 12> chroma{}; // TrackAnalysis::chroma
+    double introLevel = 0.0;         // mean level of the intro, on the curve's 0-1 range
+    double introRise = 0.0;          // largest rise from one window to the next in the intro
+    double outroLow = 0.0;           // mean of 1 - level over the outro
+    double outroDrop = 0.0;          // largest fall from one window to the next in the outro
+};
+
+// Intro and outro span the first and last kFingerprintEdgeSeconds of the energy curve.
+constexpr double kFingerprintEdgeSeconds = 32.0;
+
+TrackFingerprint makeFingerprint(const TrackAnalysis& analysis);
+TrackFingerprint makeFingerprint(const TrackView& view);
+
+struct IndexOptions {
+    size_t jobs = 0;        // worker threads; 0 = hardware concurrency
+    size_t neighbors = 16;  // links per node and layer (twice as many on the bottom layer)
+    size_t buildBeam = 100; // candidates kept while searching for a new node's links
+    uint64_t seed = 1;      // layer assignment
+    uint64_t source = 0;    // TrackStore::identity() of the store indexed, saved with the index
+};
+
+struct IndexMatch {
+    uint32_t track; // position in the fingerprints the index was built from
+    float affinity; // predicted suitability as the next track; higher is better
+};
+
+// Approximate nearest-neighbour index (HNSW) over track fingerprints, answering "which tracks
+// mix best after this one". Each fingerprint becomes a short vector whose dot product with a
+// query approximates the transition score: tempo as harmonics of log2(BPM) around the circle, so
+// half and double time coincide and nearby tempos score highest; chroma with its mean removed;
+// and the next track's intro level and rise against the outgoing track's outro level and fall,
+// weighted like the score's energy term. One extra coordinate puts every indexed vector at the
+// same length, so the largest dot product is also the nearest neighbour in the graph.
+// Nodes are inserted in batches: every node of a batch searches the graph built so far in
+// parallel, then the reverse links are merged per target node, also in parallel. The first
+// nodes go in one at a time and batches grow with the graph, so the result is the same for
+// any thread count.
+class CandidateIndex {
+public:
+    // Throws std::invalid_argument unless 2 <= neighbors <= 1024 and buildBeam > 0.
+    CandidateIndex(const std::vector<TrackFingerprint>& tracks, const IndexOptions& options = {});
+    // Throws std::runtime_error if the file cannot be read or is not a candidate index.
+    explicit CandidateIndex(const std::string& path);
+    // The index saved for `store`; also throws std::runtime_error if it was built over another
+    // store, even one with as many tracks.
+    CandidateIndex(const std::string& path, const TrackStore& store);
+
+    size_t size() const { return count_; }
+    uint64_t source() const { return source_; }
+
+    // Up to k tracks with the highest affinity after `from`, best first, searching `beam`
+    // candidates on the bottom layer (0: max(k, 64)); more is slower and closer to exact.
+    // `exclude` (e.g. the track itself) is never returned.
+    std::vector<IndexMatch> search(const TrackFingerprint& from,
+                                   size_t k,
+                                   size_t beam = 0,
+                                   size_t exclude = SIZE_MAX) const;
+
+    // Exact affinity of `track` after `from`, as search() ranks it.
+    float affinity(const TrackFingerprint& from, size_t track) const;
+
+    // Written through a temp file renamed over `path`, so an open reader keeps the old index.
+    // Throws std::runtime_error if the file cannot be written.
+    void save(const std::string& path) const;
+
+private:
+    struct Scored;
+    class Visited;
+
+    const float* vector(uint32_t node) const;
+    uint32_t* links(uint32_t node, int level);
+    const uint32_t* links(uint32_t node, int level) const;
+    size_t capacity(int level) const { return level == 0 ? 2 * neighbors_ : neighbors_; }
+    float distance(const float* query, uint32_t node) const;
+    uint32_t descend(const float* query, int level) const;
+    std::vector<Scored> searchLayer(const float* query, uint32_t entry, size_t beam, int level,
+                                    Visited& visited) const;
+    void selectNeighbors(std::vector<Scored>& candidates, size_t keep) const;
+
+    size_t count_ = 0;
+    size_t neighbors_ = 0;
+    uint64_t source_ = 0;
+    uint32_t entry_ = 0;
+    int topLevel_ = -1;
+    std::vector<float> vectors_;         // count_ fixed-size vectors
+    std::vector<uint8_t> levels_;        // top layer of each node
+    std::vector<uint32_t> bottomLinks_;  // per node: count, then capacity(0) slots
+    std::vector<uint64_t> upperOffsets_; // count_ + 1, into upperLinks_
+    std::vector<uint32_t> upperLinks_;   // per node and layer 1..level: count, then capacity(1) slots
+};
+
+struct NextTrack {
+    size_t track;
+    TransitionSuggestion transition;
+};
+
+// The k tracks of `store` that mix best after track `from`: the index shortlists `shortlist`
+// candidates (0: max(4k, 64)) and findBestTransition() ranks them exactly, best first.
+// Throws std::invalid_argument if `from` is out of range or the index was built over another
+// number of tracks; CandidateIndex(path, store) also catches a store with the same count.
+std::vector<NextTrack> suggestNextTracks(const TrackStore& store,
+                                         const CandidateIndex& index,
+                                         size_t from,
+                                         size_t k,
+                                         size_t shortlist = 0);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Spectral tables for the key analyzer. The analysis window and the mapping from FFT bins to
+// pitch classes depend only on the frame size and sample rate, so the common configurations
+// are computed by the compiler and the per-frame work after the FFT is a walk over a table.
+
+// constexpr stand-ins for std::cos / std::log2, which are not constexpr in C++17. Accurate to
+// within a few ulp on the ranges used here.
+constexpr double kTablePi = 3.14159265358979323846;
+
+constexpr double constexprCos(double x) {
+    // Reduce to [-pi, pi], then sum the Taylor series.
+    while (x > kTablePi) x -= 2.0 * kTablePi;
+    while (x < -kTablePi) x += 2.0 * kTablePi;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 30; ++n) {
+        term *= -x * x / static_cast<double>((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprLog2(double x) {
+    // x = m * 2^e with m in [1, 2), then ln(m) = 2 atanh((m - 1) / (m + 1)).
+    double e = 0.0;
+    while (x >= 2.0) {
+        x *= 0.5;
+        e += 1.0;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        e -= 1.0;
+    }
+    const double z = (x - 1.0) / (x + 1.0);
+    double power = z;
+    double sum = 0.0;
+    for (int n = 0; n < 40; ++n) {
+        sum += power / static_cast<double>(2 * n + 1);
+        power *= z * z;
+    }
+    constexpr double kLn2 = 0.69314718055994530942;
+    return e + 2.0 * sum / kLn2;
+}
+
+// Symmetric Hann window: w[n] = 0.5 * (1 - cos(2 pi n / (N - 1))).
+template <size_t N>
+constexpr std::array<float, N> makeHannWindow() {
+    std::array<float, N> w{};
+    for (size_t n = 0; n < N; ++n) {
+        const double phase = 2.0 * kTablePi * static_cast<double>(n) / static_cast<double>(N > 1 ? N - 1 : 1);
+        w[n] = static_cast<float>(0.5 * (1.0 - constexprCos(phase)));
+    }
+    return w;
+}
+
+template <size_t N>
+inline constexpr std::array<float, N> kHannWindow = makeHannWindow<N>();
+
+// Bins [firstBin, endBin) all belong to `pitchClass` (0 = C). The segments of a table are the
+// non-zero rows of the bin -> pitch-class matrix stored as runs, in bin order.
+struct ChromaSegment {
+    uint32_t firstBin;
+    uint32_t endBin;
+    uint32_t pitchClass;
+};
+
+// Bins between 30 Hz and 5 kHz, each assigned to the pitch class of its nearest equal-tempered
+// note (A4 = 440 Hz). Writes at most frameSize / 2 + 1 segments to `out`; returns the count.
+constexpr size_t buildChromaSegments(double sampleRate, size_t frameSize, ChromaSegment* out) {
+    const double binHz = sampleRate / static_cast<double>(frameSize);
+    size_t count = 0;
+    for (size_t k = 1; k <= frameSize / 2; ++k) { // skip DC
+        const double freq = binHz * static_cast<double>(k);
+        if (freq < 30.0 || freq > 5000.0) continue; // ignore extremes
+        const double midi = 69.0 + 12.0 * constexprLog2(freq / 440.0);
+        const uint32_t pc = static_cast<uint32_t>(static_cast<long>(midi + 0.5) % 12); // midi > 0
+        if (count > 0 && out[count - 1].pitchClass == pc && out[count - 1].endBin == k) {
+            ++out[count - 1].endBin;
+        } else {
+            out[count++] = {static_cast<uint32_t>(k), static_cast<uint32_t>(k + 1), pc};
+        }
+    }
+    return count;
+}
+
+template <int SampleRate, size_t FrameSize>
+struct ChromaTable {
+    std::array<ChromaSegment, FrameSize / 2 + 1> segments{};
+    size_t count = 0;
+};
+
+template <int SampleRate, size_t FrameSize>
+constexpr ChromaTable<SampleRate, FrameSize> makeChromaTable() {
+    ChromaTable<SampleRate, FrameSize> table{};
+    table.count = buildChromaSegments(SampleRate, FrameSize, table.segments.data());
+    return table;
+}
+
+template <int SampleRate, size_t FrameSize>
+inline constexpr ChromaTable<SampleRate, FrameSize> kChromaTable = makeChromaTable<SampleRate, FrameSize>();
+
+// Bin -> pitch-class filterbank for one configuration: a compile-time table for the key
+// analysis rate at 512 points (KeyAccumulator's frame), otherwise built once at construction.
+// Cheap to copy.
+class ChromaFilterbank {
+public:
+    ChromaFilterbank(int sampleRate, size_t frameSize);
+
+    size_t segmentCount() const { return count_; }
+
+    // histogram[pc] += |bins[k]| for every mapped bin; `bins` has frameSize / 2 + 1 entries.
+    void accumulate(const std::complex<double>* bins, std::array<double, 12>& histogram) const;
+
+private:
+    const ChromaSegment* segments_ = nullptr;
+    size_t count_ = 0;
+    std::shared_ptr<const std::vector<ChromaSegment>> runtime_; // owns segments_ when not constexpr
+};
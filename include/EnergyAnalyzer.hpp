@@ -1,9 +1,72 @@
 #pragma once
 
+#include "AnalysisWorkspace.hpp"
 #include "AudioLoader.hpp"
+#include "EnergyIndex.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
+class ThreadPool;
+
+// Incremental RMS-per-window accumulator. Feed mono blocks in order, then call finish() for the
+// curve and finishIndex() for the track's EnergyIndex; both come from the same pass. Completed
+// windows and index blocks are kept in `workspace` when given (else in a private workspace).
+class EnergyAccumulator {
+public:
+    // `startSample` places the first pushed sample within the stream, for an accumulator over a
+    // later part of it that is then append()ed to the one before; windows and index blocks stay
+    // on the stream's grid. finish() and finishIndex() expect a start at 0.
+    EnergyAccumulator(int sampleRate, double windowSeconds, AnalysisWorkspace* workspace = nullptr,
+                      uint64_t startSample = 0);
+
+    EnergyAccumulator(const EnergyAccumulator&) = delete;
+    EnergyAccumulator& operator=(const EnergyAccumulator&) = delete;
+
+    // Size the curve for a stream of `totalSamples` samples.
+    void reserve(uint64_t totalSamples);
+
+    void push(const float* samples, size_t count);
+
+    // Continue with what `next` accumulated from where this one stopped, as if its samples had
+    // been pushed here; a window or block split between the two is summed from both halves.
+    // Throws std::invalid_argument unless `next` starts at this one's position with the same
+    // rate and window.
+    void append(const EnergyAccumulator& next);
+
+    // RMS curve including the trailing partial window, scaled by `gain` (the loader's
+    // normalization gain when the blocks were not normalized). Empty on invalid params.
+    std::vector<double> finish(double gain = 1.0) const;
+
+    // Energy index of everything pushed so far, scaled by `gain` like finish().
+    EnergyIndex finishIndex(double gain = 1.0) const;
+
+private:
+    int sampleRate_ = 0;
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace_;
+    AnalysisWorkspace& ws_; // energyWindows, energyBlocks: unscaled sums of squares of completed ones
+    size_t windowSamples_ = 0;
+    double sumSq_ = 0.0; // window being filled
+    size_t fill_ = 0;    // offset within it
+    double blockSumSq_ = 0.0; // index block being filled
+    uint64_t startSample_ = 0;
+    uint64_t position_ = 0; // stream position of the next sample
+    uint64_t blockEnd_ = 0; // first sample of the next index block
+    uint64_t nextBlock_ = 0; // index of the block starting there
+};
+
 // Compute RMS energy over fixed windows (seconds).
 // Returns an empty vector on failure/invalid params.
-std::vector<double> computeEnergyCurve(const AudioData& audio, double windowSeconds);
+// Segments are analyzed concurrently on `pool` when given; the result does not depend on the
+// thread count.
+std::vector<double> computeEnergyCurve(const AudioData& audio,
+                                       double windowSeconds,
+                                       AnalysisWorkspace* workspace = nullptr,
+                                       ThreadPool* pool = nullptr);
+
+// Energy index of a whole track. Empty on failure.
+EnergyIndex computeEnergyIndex(const AudioData& audio,
+                               AnalysisWorkspace* workspace = nullptr,
+                               ThreadPool* pool = nullptr);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-track energy index: the sum of squares of every 25 ms block of the mono stream, with
+// compensated prefix sums over the blocks and an RMS pyramid (level k averages 2^k blocks).
+// RMS over any span and energy curves at any window size come from the index in O(1) per value,
+// without the samples. Block boundaries fall on exact multiples of the block duration (rounded
+// to samples), so windows that are multiples of 25 ms match a pass over the samples to float
+// precision; other spans assume uniform energy within their first and last block.
+class EnergyIndex {
+public:
+    static constexpr int kBlocksPerSecond = 40;
+    static constexpr double kBlockSeconds = 1.0 / kBlocksPerSecond;
+
+    EnergyIndex() = default;
+
+    // `blockSums` holds the sum of squares of each block of a stream of `totalSamples` samples at
+    // `sampleRate`, already scaled by any normalization gain. Empty on inconsistent input.
+    EnergyIndex(int sampleRate, uint64_t totalSamples, std::vector<float> blockSums);
+
+    bool empty() const { return blockSums_.empty(); }
+    int sampleRate() const { return sampleRate_; }
+    uint64_t totalSamples() const { return totalSamples_; }
+    double duration() const;
+
+    // Serialized form: the constructor arguments.
+    const std::vector<float>& blockSums() const { return blockSums_; }
+    size_t blockCount() const { return blockSums_.size(); }
+
+    // RMS over [t0, t1) seconds, clamped to the track; 0 for an empty span.
+    double rms(double t0, double t1) const;
+
+    // RMS per window of `windowSeconds`, including the trailing partial window; the layout of
+    // computeEnergyCurve(). Empty on invalid params.
+    std::vector<double> curve(double windowSeconds) const;
+
+    // Pyramid level k: RMS per 2^k blocks (the last value may cover fewer). Level 0 is per block.
+    size_t levelCount() const { return levels_.size(); }
+    const std::vector<float>& level(size_t k) const { return levels_[k]; }
+    double levelSeconds(size_t k) const { return kBlockSeconds * static_cast<double>(size_t{1} << k); }
+
+    // Finest level whose values span at least `seconds`, for drawing a curve at that
+    // resolution; the coarsest level when none does.
+    size_t levelFor(double seconds) const;
+
+private:
+    double sumOfSquaresBefore(uint64_t sample) const;
+
+    int sampleRate_ = 0;
+    uint64_t totalSamples_ = 0;
+    std::vector<float> blockSums_;
+    std::vector<double> prefix_; // prefix_[i] = sum of blockSums_[0, i), Kahan-compensated
+    std::vector<std::vector<float>> levels_;
+};
+
+// First sample of energy index block `block` at `sampleRate`: round(block * sampleRate / 40).
+inline uint64_t energyBlockStart(uint64_t block, int sampleRate) {
+    const uint64_t rate = static_cast<uint64_t>(sampleRate);
+    return (block * rate + EnergyIndex::kBlocksPerSecond / 2) / EnergyIndex::kBlocksPerSecond;
+}
+
+// Number of blocks covering `totalSamples` samples (the last one may be partial).
+size_t energyBlockCount(uint64_t totalSamples, int sampleRate);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// Radix-2 FFT for real input of a fixed power-of-two size.
+// The plan precomputes bit-reversal and twiddle tables once; transforms do not allocate
+// and a plan can be shared between threads.
+class FftPlan {
+public:
+    // Throws std::invalid_argument unless size is a power of two >= 2.
+    explicit FftPlan(size_t size);
+
+    size_t size() const { return size_; }
+    size_t binCount() const { return size_ / 2 + 1; }
+
+    // Forward transform of size() real samples into binCount() complex bins (unscaled).
+    void forward(const float* input, std::complex<double>* output) const;
+    void forward(const double* input, std::complex<double>* output) const;
+
+    // Inverse of forward(): binCount() bins back to size() real samples, scaled so that
+    // inverse(forward(x)) == x.
+    void inverse(const std::complex<double>* input, double* output) const;
+
+private:
+    template <typename T>
+    void forwardImpl(const T* input, std::complex<double>* output) const;
+    void transformHalf(std::complex<double>* data, bool inverse) const;
+
+    size_t size_ = 0;
+    size_t half_ = 0;
+    std::vector<size_t> bitReverse_;                // permutation for the half-size complex FFT
+    std::vector<std::complex<double>> twiddles_;     // exp(-2*pi*i*k/half), k < half/2
+    std::vector<std::complex<double>> realTwiddles_; // exp(-2*pi*i*k/size), k <= half
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <string>
+
+// Write `size` raw bytes to `out`; a failure is left in the stream's state.
+void writeBytes(std::ofstream& out, const void* data, size_t size);
+
+// Write a file through `path` + ".tmp" and rename it over `path` once `write` has filled the
+// stream, so a process that has the old file open or mapped keeps reading a complete copy.
+// Throws std::runtime_error naming the file as `what` if it cannot be written or replaced.
+void replaceFile(const std::string& path, const std::string& what, const std::function<void(std::ofstream&)>& write);
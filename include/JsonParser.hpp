@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for baseline files and server requests: objects, arrays, numbers, strings
+// and true/false/null. Unknown members are parsed and left to the caller so formats can grow.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    double number = 0.0; // also 1 or 0 for a bool
+    std::string text;    // unescaped string, or the literal token of a number, bool or null
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members; // in document order
+
+    bool isScalar() const { return type != Type::Array && type != Type::Object; }
+
+    // Member `key` of an object, or null; the last of repeated keys wins.
+    const JsonValue* find(const std::string& key) const;
+};
+
+// Parse one complete document. Strings may use every escape, \u and surrogate pairs included.
+// Throws std::runtime_error with the offset of the first error.
+JsonValue parseJson(const std::string& text);
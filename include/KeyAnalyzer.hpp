@@ -1,9 +1,76 @@
 #pragma once
 
+#include "AnalysisWorkspace.hpp"
 #include "AudioLoader.hpp"
+#include "ChromaTables.hpp"
+#include "Fft.hpp"
 
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
 
-// Rough key estimation via pitch-class histogram against major/minor templates.
-// Returns a string like "C major" or "A minor". Falls back to "Unknown".
-std::string estimateKey(const AudioData& audio);
+class ThreadPool;
+
+// Incremental pitch-class histogram accumulator. Feed mono blocks in order, then call estimate().
+// Keeps only one analysis frame of audio buffered, in `workspace` when given (else in a private
+// workspace). The frame and hop sizes are compile-time so the window is a constexpr table;
+// instantiated for 512/256 (KeyAccumulator, ~21.5 Hz bins at kKeyAnalysisRate).
+template <size_t FrameSize, size_t HopSize>
+class BasicKeyAccumulator {
+public:
+    static_assert(HopSize > 0 && HopSize <= FrameSize, "hop must fit in a frame");
+    static constexpr size_t kFrameSize = FrameSize;
+    static constexpr size_t kHopSize = HopSize;
+
+    explicit BasicKeyAccumulator(int sampleRate, AnalysisWorkspace* workspace = nullptr);
+
+    BasicKeyAccumulator(const BasicKeyAccumulator&) = delete;
+    BasicKeyAccumulator& operator=(const BasicKeyAccumulator&) = delete;
+
+    void push(const float* samples, size_t count);
+
+    // Add the frames `next` analyzed, for an accumulator over a later part of the stream; the
+    // caller keeps the two sets of frames disjoint. Samples still pending in `next` are dropped.
+    void append(const BasicKeyAccumulator& next);
+
+    // Scale the histogram by `factor`; called as samples arrive, it makes estimate() favour
+    // recent frames over older ones.
+    void decay(double factor);
+
+    // Pitch-class energy of the frames analyzed so far (C = 0 .. B = 11).
+    const std::array<double, 12>& histogram() const { return histogram_; }
+
+    // Key for everything pushed so far, e.g. "C major"; "Unknown" when nothing was analyzed.
+    std::string estimate() const;
+
+private:
+    void processFrame();
+
+    int sampleRate_ = 0;
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace_;
+    AnalysisWorkspace& ws_; // keyPending holds the samples of the frame being filled
+    const FftPlan& plan_;
+    ChromaFilterbank chroma_;
+    size_t fill_ = 0;
+    std::array<double, 12> histogram_{};
+};
+
+using KeyAccumulator = BasicKeyAccumulator<512, 256>;
+
+// Best-matching major/minor key of a pitch-class histogram, as BasicKeyAccumulator::estimate()
+// returns it; "Unknown" for an empty histogram.
+std::string keyFromHistogram(const std::array<double, 12>& histogram);
+
+// A histogram scaled to sum to 1, as TrackAnalysis::chroma holds it; all zero when empty.
+std::array<double, 12> chromaFromHistogram(const std::array<double, 12>& histogram);
+
+// Name of the key on pitch class `root` (C = 0 .. B = 11), e.g. "F#/Gb minor"; "Unknown" when out
+// of range.
+std::string keyName(int root, bool major);
+
+// Rough key estimation via pitch-class histogram against major/minor templates, on the audio
+// decimated to kKeyAnalysisRate. Returns a string like "C major" or "A minor". Falls back to "Unknown".
+// Segments are analyzed concurrently on `pool` when given; the result does not depend on the
+// thread count.
+std::string estimateKey(const AudioData& audio, AnalysisWorkspace* workspace = nullptr, ThreadPool* pool = nullptr);
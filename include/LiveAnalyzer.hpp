@@ -0,0 +1,95 @@
+#pragma once
+
+#include "AnalysisPipeline.hpp"
+#include "AnalysisWorkspace.hpp"
+#include "BpmAnalyzer.hpp"
+#include "KeyAnalyzer.hpp"
+#include "Resampler.hpp"
+#include "WavMapping.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct LiveOptions {
+    int sampleRate = 48000;
+    int channels = 2;
+    PcmFormat format = PcmFormat::Int16; // interleaved little-endian, as in a WAV data chunk
+    double intervalSeconds = 1.0; // stream time between estimates
+    double tempoSeconds = 12.0;   // audio the BPM estimate looks back over
+    double keySeconds = 30.0;     // time constant of the key histogram's decay
+    double windowSeconds = kDefaultEnergyWindowSeconds; // energy window
+    double historySeconds = 30.0; // energy curve kept
+    double bufferSeconds = 4.0;   // ring buffer between the reader and the analysis
+};
+
+struct LiveEstimate {
+    double seconds = 0.0; // stream time analyzed
+    double bpm = 0.0;     // 0 until there is enough audio
+    std::string key = "Unknown";
+    std::vector<double> energyCurve; // RMS per window over the last historySeconds, oldest first
+    double updateMs = 0.0;       // wall time taken to refresh the estimate
+    double backlogSeconds = 0.0; // audio read but not yet analyzed when it was emitted
+};
+
+struct LiveStats {
+    uint64_t samplesRead = 0;    // frames read from the input
+    uint64_t samplesDropped = 0; // frames lost because the analysis fell a whole buffer behind
+    size_t updates = 0;
+    double maxUpdateMs = 0.0;
+    double meanUpdateMs = 0.0;
+};
+
+// Running BPM, key and energy of an unbounded mono stream. Unlike the track analyzers it keeps
+// only recent history: the BPM comes from the last tempoSeconds of onset hops, the key
+// histogram decays with time constant keySeconds and the energy curve is a fixed ring of
+// windows, so memory and the cost of an estimate stay constant however long the stream runs.
+// Not thread-safe.
+class LiveAnalyzer {
+public:
+    // Throws std::invalid_argument on a non-positive rate or duration.
+    LiveAnalyzer(int sampleRate, const LiveOptions& options);
+
+    LiveAnalyzer(const LiveAnalyzer&) = delete;
+    LiveAnalyzer& operator=(const LiveAnalyzer&) = delete;
+
+    void push(const float* samples, size_t count);
+
+    // Refresh `estimate` from the stream so far, reusing its buffers. Leaves updateMs and
+    // backlogSeconds to the caller.
+    void estimate(LiveEstimate& estimate);
+
+    uint64_t samplesPushed() const { return samples_; }
+
+private:
+    int sampleRate_ = 0;
+    AnalysisWorkspace ws_;
+    AnalysisDecimator decimator_;
+    BpmAccumulator bpm_;
+    KeyAccumulator key_;
+    size_t tempoHops_ = 0;
+    double keyDecayPerSample_ = 0.0; // log of the key histogram decay per native sample
+
+    size_t windowSamples_ = 0;
+    double sumSq_ = 0.0; // energy window being filled
+    size_t fill_ = 0;
+    std::vector<double> windows_; // ring of completed window RMS values
+    uint64_t windowCount_ = 0;    // windows completed so far
+
+    uint64_t samples_ = 0;
+};
+
+// Read interleaved PCM from `input` until end of stream and analyze it as it arrives. A reader
+// thread decodes to mono into a lock-free SpscRingBuffer and never waits for the analysis: if
+// the ring is full, the frames are dropped and counted. The calling thread analyzes and calls
+// `onEstimate` every intervalSeconds of audio, and at the end of the stream for any audio since
+// the last call. If the analysis or `onEstimate` throws, the reader is stopped within a poll
+// interval rather than left waiting for the feed to end. Where poll() exists `input` is read
+// through its descriptor, so it must not have been read through stdio before.
+// Throws std::invalid_argument on invalid options and std::runtime_error on a read error.
+LiveStats analyzeLiveStream(std::FILE* input,
+                            const LiveOptions& options,
+                            const std::function<void(const LiveEstimate&)>& onEstimate);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Lightweight instrumentation for the analysis and transition hot paths: scoped stage timers,
+// per-thread counters and allocation tracking, exported as a Chrome trace (chrome://tracing,
+// Perfetto) and a summary table.
+//
+// The DJT_PROFILE_* macros compile to nothing unless DJT_ENABLE_PROFILING is defined. When
+// compiled in, each site costs one relaxed atomic load until profiling::setEnabled(true); after
+// that a scope costs two clock reads and a few stores into thread-local buffers, with no locks.
+namespace profiling {
+
+enum class Counter {
+    DecodedBytes,    // interleaved float bytes produced by the decoder
+    DecodedFrames,   // frames read from audio files
+    Ffts,            // forward and inverse transforms
+    PairEvaluations, // exit/entry window pairs scored by the transition search
+    kCount
+};
+
+namespace detail {
+extern std::atomic<bool> gEnabled;
+} // namespace detail
+
+#ifdef DJT_ENABLE_PROFILING
+constexpr bool kCompiledIn = true;
+#else
+constexpr bool kCompiledIn = false;
+#endif
+
+inline bool enabled() { return detail::gEnabled.load(std::memory_order_relaxed); }
+
+// Start or stop recording. Enabling resets the trace clock and everything recorded so far.
+void setEnabled(bool on);
+
+// Id of a named stage; `name` must outlive the process (a string literal). Call once per site.
+int registerStage(const char* name);
+
+void addCount(Counter counter, uint64_t amount);
+
+// Called by the allocation hook of the executable, when it installs one.
+void noteAllocation(size_t bytes);
+
+// Times one stage from construction to destruction on the calling thread.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(int stage) {
+        if (enabled()) begin(stage);
+    }
+    ~ScopedTimer() {
+        if (active_) end();
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    void begin(int stage);
+    void end();
+
+    bool active_ = false;
+    int stage_ = 0;
+    uint64_t startNs_ = 0;
+    uint64_t childNs_ = 0; // time spent in nested scopes, for self time
+    uint64_t startAllocs_ = 0;
+    ScopedTimer* parent_ = nullptr;
+};
+
+// Both exports read every thread's buffers: call them once the instrumented work has finished.
+// Throws std::runtime_error if the file cannot be written.
+void writeChromeTrace(const std::string& path);
+
+// Per-stage calls, total and self time, allocations, then counter totals.
+void printSummary(std::ostream& out);
+
+} // namespace profiling
+
+#define DJT_PROFILE_CONCAT_INNER(a, b) a##b
+#define DJT_PROFILE_CONCAT(a, b) DJT_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef DJT_ENABLE_PROFILING
+#define DJT_PROFILE_SCOPE(name)                                                                  \
+    static const int DJT_PROFILE_CONCAT(djtProfileStage_, __LINE__) = ::profiling::registerStage(name); \
+    ::profiling::ScopedTimer DJT_PROFILE_CONCAT(djtProfileScope_, __LINE__)(                     \
+        DJT_PROFILE_CONCAT(djtProfileStage_, __LINE__))
+#define DJT_PROFILE_COUNT(counter, amount)                                                       \
+    do {                                                                                         \
+        if (::profiling::enabled()) ::profiling::addCount(::profiling::Counter::counter, (amount)); \
+    } while (0)
+#else
+#define DJT_PROFILE_SCOPE(name) static_cast<void>(0)
+#define DJT_PROFILE_COUNT(counter, amount) static_cast<void>(0)
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Rates the analyzers run at. Onset energy needs no more than ~11 kHz of bandwidth and the key
+// analyzer ignores everything above 5 kHz, so both work on decimated copies of the audio.
+constexpr int kBpmAnalysisRate = 22050;
+constexpr int kKeyAnalysisRate = 11025;
+
+// Streaming rational resampler: upsample by L, low-pass, downsample by M, evaluated as a
+// polyphase FIR so only the taps of the output phase are computed. The prototype is a
+// Kaiser-windowed sinc (60 dB stopband) cut off at the lower Nyquist frequency. Output lags the input by
+// half the filter length (well under a millisecond at the analysis rates) and the last few input
+// samples of a stream are not flushed; neither matters for tempo or key estimation.
+class PolyphaseResampler {
+public:
+    // `passband` is the fraction of the lower Nyquist frequency kept free of aliases; the filter
+    // gets longer as it approaches 1. Throws std::invalid_argument unless both rates are
+    // positive and 0 < passband < 1.
+    PolyphaseResampler(int inputRate, int outputRate, double passband = 0.9);
+
+    int inputRate() const { return inputRate_; }
+    int outputRate() const { return outputRate_; }
+    double passband() const { return passband_; }
+    size_t tapsPerPhase() const { return taps_; }
+
+    // tapsPerPhase() of a resampler with these parameters, without building it.
+    static size_t tapsFor(int inputRate, int outputRate, double passband);
+
+    // Upper bound on the samples one process() call of `count` inputs can produce.
+    size_t maxOutput(size_t count) const;
+
+    // Resample the next `count` input samples into `out` (room for maxOutput(count)).
+    // Returns the number of samples written.
+    size_t process(const float* in, size_t count, float* out);
+
+    // Forget all history, as if freshly constructed.
+    void reset();
+
+private:
+    int inputRate_ = 0;
+    int outputRate_ = 0;
+    double passband_ = 0.0;
+    size_t up_ = 1;   // L
+    size_t down_ = 1; // M
+    size_t taps_ = 0; // taps per phase
+    std::vector<float> coeffs_; // phase-major, each phase time-reversed (see polyphaseFir)
+    std::vector<float> buffer_; // unconsumed input, starting with the first tap of the next output
+    size_t phase_ = 0;
+};
+
+class AnalysisWorkspace;
+
+// Splits a native-rate mono stream into the BPM (22.05 kHz) and key (11.025 kHz) analysis
+// streams, cascading native -> 22.05 kHz -> 11.025 kHz. A stream is passed through untouched
+// when the native rate is already at or below its target. Resamplers and output buffers come
+// from `workspace`; only one decimator per workspace may be active at a time.
+class AnalysisDecimator {
+public:
+    AnalysisDecimator(int nativeRate, AnalysisWorkspace& workspace, bool withKeyStream = true);
+
+    AnalysisDecimator(const AnalysisDecimator&) = delete;
+    AnalysisDecimator& operator=(const AnalysisDecimator&) = delete;
+
+    int bpmRate() const { return bpmRate_; }
+    int keyRate() const { return keyRate_; }
+
+    // Decimate the next native block. The stream blocks stay valid until the next push().
+    void push(const float* samples, size_t count);
+
+    const float* bpmBlock() const { return bpmBlock_; }
+    size_t bpmCount() const { return bpmCount_; }
+    const float* keyBlock() const { return keyBlock_; }
+    size_t keyCount() const { return keyCount_; }
+
+    // Stream length for `nativeSamples` input samples at `rate`, for reserve() calls. Exact
+    // for multiples of alignment().
+    uint64_t streamLength(uint64_t nativeSamples, int rate) const;
+
+    // Native samples after which both stages are back at filter phase 0 with a whole number of
+    // output samples produced, so a stream can be cut at any multiple of this and decimated in
+    // pieces. Depends only on the native rate (the key stage counts even when not built).
+    static uint64_t alignment(int nativeRate);
+
+    // Native samples of history, a multiple of alignment(), after which a fresh decimator's
+    // output matches that of one that has seen the stream from its start (up to float rounding,
+    // which already varies with how a stream is split into blocks): decimate this much before a
+    // cut and drop the output to continue the stream from there.
+    static uint64_t warmup(int nativeRate);
+
+private:
+    AnalysisWorkspace& ws_; // bpmStream / keyStream hold the resampled blocks
+    int nativeRate_ = 0;
+    int bpmRate_ = 0;
+    int keyRate_ = 0;
+    PolyphaseResampler* toBpm_ = nullptr; // null when passing through
+    PolyphaseResampler* toKey_ = nullptr; // from the BPM stream; null when passing through
+    bool withKey_ = true;
+    const float* bpmBlock_ = nullptr;
+    size_t bpmCount_ = 0;
+    const float* keyBlock_ = nullptr;
+    size_t keyCount_ = 0;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+#include "AnalysisWorkspace.hpp"
+#include "BpmAnalyzer.hpp"
+#include "EnergyAnalyzer.hpp"
+#include "EnergyIndex.hpp"
+#include "KeyAnalyzer.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// One segment of a SegmentedAnalysis: its place in the stream, its samples, workspace and partial
+// results. Slots stay in the owning AnalysisWorkspace between tracks, so steady-state analysis
+// does not allocate.
+struct SegmentSlot {
+    bool inUse = false;
+    uint64_t begin = 0; // stream range the segment accounts for
+    uint64_t end = 0;
+    bool last = false;      // nothing follows: analyze all of `data`
+    uint64_t dataBegin = 0; // stream position of data[0]: begin less the warm-up
+    const float* data = nullptr;
+    size_t dataCount = 0;
+    std::vector<float> samples; // copy of the data when pushed rather than read in place
+
+    AnalysisWorkspace workspace;
+    std::optional<BpmAccumulator> bpm;
+    std::optional<EnergyAccumulator> energy;
+    std::optional<KeyAccumulator> key;
+
+    std::atomic<int> pending{0}; // tasks still running
+    std::exception_ptr energyError;
+    std::exception_ptr streamError;
+};
+
+// Analyzers a SegmentedAnalysis runs; combine with |.
+enum AnalyzerMask : unsigned {
+    kAnalyzeBpm = 1u << 0,
+    kAnalyzeEnergy = 1u << 1,
+    kAnalyzeKey = 1u << 2,
+    kAnalyzeAll = kAnalyzeBpm | kAnalyzeEnergy | kAnalyzeKey,
+};
+
+// Runs the BPM, energy and key analyzers over a native-rate mono stream cut into segments of a
+// few seconds. Each segment has its own decimator and accumulators; with a `pool`, segments run
+// concurrently and within each the energy pass runs alongside decimation, BPM and key. Partial
+// results are merged in stream order. A segment decimates AnalysisDecimator::warmup() samples
+// before its start, so its analysis streams carry on from the previous segment's as a single
+// pass would, and a few after its end for the key frames that straddle the cut. Cuts and block
+// sizes depend only on the sample rate and partial sums are always combined in the same order,
+// so the results are bit-identical for any thread count, including no pool at all.
+class SegmentedAnalysis {
+public:
+    // `windowSeconds` is the energy curve window (unused without kAnalyzeEnergy). The merged
+    // results live in `workspace` when given (else in a private workspace), which also keeps the
+    // segments' workspaces for the next track.
+    SegmentedAnalysis(int sampleRate, double windowSeconds, unsigned analyzers,
+                      AnalysisWorkspace* workspace = nullptr, ThreadPool* pool = nullptr);
+    ~SegmentedAnalysis(); // waits for segments still running
+
+    SegmentedAnalysis(const SegmentedAnalysis&) = delete;
+    SegmentedAnalysis& operator=(const SegmentedAnalysis&) = delete;
+
+    // Samples per segment at `sampleRate`.
+    static uint64_t segmentSamples(int sampleRate);
+
+    // Size the merged results for a stream of `totalSamples` samples.
+    void reserve(uint64_t totalSamples);
+
+    // Append the next samples of the stream. They are copied, so the block can be reused.
+    void push(const float* samples, size_t count);
+
+    // Analyze a whole stream held in memory, reading it in place, then finish(). Use instead of
+    // push().
+    void analyze(const float* samples, size_t count);
+
+    // Analyze what is left and merge every segment; call once, after the last push(). Rethrows
+    // the first exception a segment threw, in stream order.
+    void finish();
+
+    // Results of finish().
+    double bpm(double minBpm = 80.0, double maxBpm = 180.0) const;
+    BeatGrid beatGrid(double bpm) const; // see fitBeatGrid(); `bpm` as bpm() gave it
+    std::string key() const;
+    std::array<double, 12> chroma() const; // see TrackAnalysis::chroma
+    std::vector<double> energyCurve(double gain = 1.0) const;
+    EnergyIndex energyIndex(double gain = 1.0) const;
+
+private:
+    // Upper bound on segments submitted but not yet merged.
+    static constexpr size_t kMaxInFlight = 64;
+
+    SegmentSlot& newSegment(uint64_t begin);
+    void submit(SegmentSlot& segment);
+    void runEnergy(SegmentSlot& segment) const;
+    void runStreams(SegmentSlot& segment) const;
+    void mergeOldest();
+    void release(SegmentSlot& segment);
+
+    int sampleRate_ = 0;
+    double windowSeconds_ = 0.0;
+    unsigned analyzers_ = 0;
+    ThreadPool* pool_ = nullptr;
+    uint64_t segmentSamples_ = 0;
+    uint64_t warmup_ = 0;  // native samples decimated and dropped before a segment
+    uint64_t overlap_ = 0; // native samples past a segment for the key frames across its end
+    size_t maxInFlight_ = 1;
+
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace_;
+    AnalysisWorkspace& ws_; // segmentSlots: every slot, in use or not
+
+    std::optional<BpmAccumulator> bpm_; // merged results
+    std::optional<EnergyAccumulator> energy_;
+    std::optional<KeyAccumulator> key_;
+
+    SegmentSlot* filling_ = nullptr;                  // segment push() is copying into
+    std::array<SegmentSlot*, kMaxInFlight> inFlight_{}; // submitted, not yet merged; a ring, oldest at head
+    size_t inFlightHead_ = 0;
+    size_t inFlightCount_ = 0;
+    uint64_t position_ = 0; // samples pushed
+};
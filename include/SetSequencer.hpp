@@ -0,0 +1,63 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TrackStore;
+
+// Energy shape a set follows from its first track to its last.
+enum class EnergyArc { None, Rise, Fall, Peak };
+
+// SequenceOptions::startTrack / endTrack when any track may open or close the set.
+constexpr size_t kAnyTrack = SIZE_MAX;
+
+struct SequenceOptions {
+    size_t jobs = 0;               // worker threads; 0 = hardware concurrency
+    size_t startTrack = kAnyTrack; // index of the track the set must open with
+    size_t endTrack = kAnyTrack;   // index of the track the set must close with
+    double maxBpmStep = 0.06;      // largest relative tempo change between neighbours, half and
+                                   // double time folded as in bpmCompatibility(); 0 = no limit
+    EnergyArc arc = EnergyArc::None;
+    double arcWeight = 4.0;  // score points lost per unit a track's energy rank strays from the arc
+    size_t beamWidth = 64;   // partial sets kept per step of the beam search
+    size_t branching = 8;    // successors tried from each partial set
+    size_t maxPasses = 100;  // local-search sweeps after the beam search
+};
+
+struct SequenceStats {
+    uint64_t pairsScored = 0;
+    size_t passes = 0; // local-search sweeps run
+    size_t moves = 0;  // improving reversals and segment moves applied
+    double scoreSeconds = 0.0;
+    double beamSeconds = 0.0;
+    double searchSeconds = 0.0;
+};
+
+struct SetPlan {
+    std::vector<size_t> order;                     // track indices, first to last
+    std::vector<TransitionSuggestion> transitions; // transitions[i]: order[i] into order[i + 1]
+    double totalScore = 0.0;    // sum of transition scores (0-10 each)
+    double objective = 0.0;     // what the search maximized: the scores less arc and tempo penalties
+    size_t tempoViolations = 0; // transitions whose tempo step exceeds maxBpmStep
+    double arcDeviation = 0.0;  // mean distance of each track's energy rank from the arc (0-1)
+    SequenceStats stats;
+};
+
+// Order every track into one set that maximizes the total findBestTransition() score, subject
+// to the options' start and end tracks, tempo steps and energy arc. All ordered pairs are scored
+// once, in parallel, into a dense edge table. A beam search builds the set greedily from the best
+// edges, then local search improves it with segment reversals (2-opt) and short segment moves
+// (or-opt): each move is priced from the handful of edges it changes, using prefix sums over the
+// current order, and the sweeps run in parallel, applying every non-overlapping improving move
+// found. A tempo step over the limit is penalized rather than forbidden, so a set always exists.
+// Energy arcs compare each track's rank by mean energy, 0 quietest to 1 loudest, with the arc at
+// its position in the set.
+// Throws std::invalid_argument if startTrack or endTrack is out of range, or both name the
+// same track in a set of more than one.
+SetPlan sequenceSet(const std::vector<TrackAnalysis>& tracks, const SequenceOptions& options);
+
+// Same, over a TrackStore's views.
+SetPlan sequenceSet(const TrackStore& store, const SequenceOptions& options);
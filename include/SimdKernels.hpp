@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-sample hot-loop kernels with runtime CPU dispatch (AVX-512 / AVX2 / SSE2 on x86, scalar
+// elsewhere). Element-wise kernels give the same values as the scalar path; sums accumulate in
+// double on every path and differ from the scalar path only by summation order (relative
+// difference below 1e-12).
+enum class SimdLevel { Scalar, Sse2, Avx2, Avx512 };
+
+// Level chosen at first use: the best the CPU supports, capped by the DJT_SIMD environment
+// variable ("scalar", "sse2", "avx2", "avx512") when set.
+SimdLevel activeSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Sum of x[i]^2 in double precision.
+double sumOfSquares(const float* x, size_t n);
+
+// Largest |x[i]|; NaNs are ignored.
+float maxAbsValue(const float* x, size_t n);
+
+// Average `channels` interleaved channels into `mono` (which may alias `interleaved`) and
+// return the peak absolute mono sample.
+float downmixToMonoPeak(const float* interleaved, size_t frames, int channels, float* mono);
+
+// x[i] *= gain
+void scaleInPlace(float* x, size_t n, float gain);
+
+// out[i] = x[i] * w[i]
+void multiplyWindow(const float* x, const float* w, float* out, size_t n);
+
+// Sum of a[i] * b[i]; vector paths differ from the scalar one only by summation order.
+float dotProduct(const float* a, const float* b, size_t n);
+
+// acc[i] += x[i] * w[i]
+void multiplyAccumulate(const float* x, const float* w, float* acc, size_t n);
+
+// out[i] = a[i] * gainA[i] + b[i] * gainB[i] (out may alias a or b)
+void mixWeighted(const float* a, const float* gainA, const float* b, const float* gainB, float* out, size_t n);
+
+// Polyphase FIR for PolyphaseResampler. `coeffs` holds `up` phases of `taps` time-reversed taps.
+// Each output is the dot product of its phase with in[pos, pos + taps), after which the phase
+// advances by `down` and whole input steps carry into `pos`. Runs while the next output's taps
+// lie within `count` inputs; updates pos/phase and returns the outputs written. Vector paths
+// differ from the scalar one only by summation order.
+size_t polyphaseFir(const float* coeffs, size_t taps, size_t up, size_t down, const float* in, size_t count,
+                    size_t& pos, size_t& phase, float* out);
+
+// out[i] = x[i] / 32768, the int16 PCM to float mapping libsndfile uses
+void int16ToFloat(const int16_t* x, size_t n, float* out);
+
+// out[i] = (x[i] - offset) / range
+void rescaleToUnit(const double* x, size_t n, double offset, double range, double* out);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Lock-free single-producer single-consumer ring buffer. One thread calls write(), another
+// calls read(); neither ever waits for the other. Capacity is rounded up to a power of two so
+// the positions wrap with a mask. The positions sit on separate cache lines so the producer and
+// consumer do not invalidate each other's line on every call.
+template <typename T>
+class SpscRingBuffer {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "ring elements are copied as raw values");
+
+    explicit SpscRingBuffer(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t capacity() const { return buffer_.size(); }
+
+    // Producer: copy up to `count` values in; returns how many fit.
+    size_t write(const T* values, size_t count) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, capacity() - (head - tail));
+        copyIn(head, values, n);
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: copy up to `count` values out; returns how many were available.
+    size_t read(T* values, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, head - tail);
+        copyOut(tail, values, n);
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Values waiting: a lower bound from the consumer, as the producer may push meanwhile, and an
+    // upper bound from the producer, as the consumer may pop.
+    size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    void copyIn(size_t position, const T* values, size_t n) {
+        const size_t start = position & mask_;
+        const size_t first = std::min(n, capacity() - start);
+        std::copy(values, values + first, buffer_.begin() + static_cast<std::ptrdiff_t>(start));
+        std::copy(values + first, values + n, buffer_.begin());
+    }
+
+    void copyOut(size_t position, T* values, size_t n) const {
+        const size_t start = position & mask_;
+        const size_t first = std::min(n, capacity() - start);
+        const auto from = buffer_.begin() + static_cast<std::ptrdiff_t>(start);
+        std::copy(from, from + static_cast<std::ptrdiff_t>(first), values);
+        std::copy(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(n - first), values + first);
+    }
+
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    // Free-running counts of values written and read; head - tail is the fill level.
+    alignas(kCacheLine) std::atomic<size_t> head_{0};
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "AnalysisWorkspace.hpp"
+#include "AudioLoader.hpp"
+#include "BpmAnalyzer.hpp"
+#include "KeyAnalyzer.hpp"
+#include "Resampler.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct TempoKeyOptions {
+    double stepSeconds = 4.0;    // spacing of the estimates
+    double windowSeconds = 16.0; // audio each estimate covers, rounded to whole steps
+    double minBpm = 80.0;
+    double maxBpm = 180.0;
+};
+
+struct TempoKeyPoint {
+    double seconds = 0.0; // centre of the window the estimate covers
+    double bpm = 0.0;     // 0 when the window is too short
+    std::string key = "Unknown";
+};
+
+// Tempo and key as functions of time: one point per step, in time order.
+struct TempoKeyTrack {
+    double stepSeconds = 0.0;
+    double windowSeconds = 0.0;
+    std::vector<TempoKeyPoint> points;
+
+    // Point whose window centre is nearest `seconds`; null when there are none.
+    const TempoKeyPoint* at(double seconds) const;
+};
+
+// Sliding-window BPM and key over a native-rate mono stream. Each step's onset novelty and
+// chroma are computed once: the step keeps its products x[t] * x[t - lag] for the lags of the
+// BPM range and its pitch-class histogram, and a window's autocorrelation and histogram are the
+// sums over its steps, corrected at the window's start. A window costs O(steps * lags) on top
+// of the single pass, however long the window, so an hour-long mix analyzes at the speed of
+// estimateBPM() plus estimateKey(). Each point's BPM is what estimateBPM() would find on the
+// window's novelty curve.
+class TempoKeyTracker {
+public:
+    // Throws std::invalid_argument on a non-positive rate or step, a window shorter than a step
+    // or an empty BPM range. Scratch buffers and decimation come from `workspace` when given.
+    TempoKeyTracker(int sampleRate, const TempoKeyOptions& options = {}, AnalysisWorkspace* workspace = nullptr);
+
+    TempoKeyTracker(const TempoKeyTracker&) = delete;
+    TempoKeyTracker& operator=(const TempoKeyTracker&) = delete;
+
+    void push(const float* samples, size_t count);
+
+    // Close the last partial step and return every point.
+    TempoKeyTrack finish();
+
+private:
+    void addHops();
+    void closeStep();
+
+    int sampleRate_ = 0;
+    TempoKeyOptions options_;
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace_;
+    AnalysisWorkspace& ws_; // hopEnergies: hops not yet turned into novelty
+    AnalysisDecimator decimator_;
+    BpmAccumulator bpm_;
+    KeyAccumulator key_;
+
+    uint64_t stepSamples_ = 0;
+    size_t windowSteps_ = 1;
+    size_t lagCount_ = 0; // lags 0 .. maxLag + 1 of the BPM range
+    double hopSeconds_ = 0.0;
+
+    uint64_t position_ = 0; // native samples pushed
+    uint64_t stepEnd_ = 0;  // native position closing the current step
+    uint64_t steps_ = 0;    // steps closed
+
+    bool haveHop_ = false;
+    double lastHop_ = 0.0;    // energy of the previous hop
+    double lastFrame_ = 0.0;  // energy of the previous two-hop frame
+    std::vector<double> novelty_; // recent novelty, novelty_[0] at stream index noveltyBase_
+    uint64_t noveltyBase_ = 0;
+
+    // Per step of the current window, a ring indexed by step % windowSteps_.
+    std::vector<double> stepProducts_; // lagCount_ lag products per step
+    std::vector<uint64_t> stepStart_;  // novelty index where the step starts
+    std::vector<std::array<double, 12>> stepChroma_;
+    std::array<double, 12> chromaAtStepStart_{};
+
+    std::vector<double> autocorr_; // scratch for a window's autocorrelation
+    TempoKeyTrack track_;
+};
+
+// Tempo and key over time for a track in memory.
+TempoKeyTrack trackTempoAndKey(const AudioData& audio,
+                               const TempoKeyOptions& options = {},
+                               AnalysisWorkspace* workspace = nullptr);
+
+// Same, decoding a file in a streaming pass so hour-long recordings never sit in memory. Fills
+// `info` when non-null. Throws std::runtime_error on failure.
+TempoKeyTrack trackTempoAndKeyFile(const std::string& path,
+                                   const TempoKeyOptions& options = {},
+                                   AudioStreamInfo* info = nullptr,
+                                   AnalysisWorkspace* workspace = nullptr);
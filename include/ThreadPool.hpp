@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Each worker owns a deque: it pops its own tasks newest-first and,
+// when empty, steals the oldest task from another worker. Tasks submitted from a worker go to
+// that worker's deque; tasks from other threads are spread round-robin.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads == 0 uses std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool(); // finishes queued tasks, then joins
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    void submit(Task task);
+
+    // Run queued tasks on the calling thread until `done()` holds. Lets a task wait for tasks
+    // it spawned without tying up a worker.
+    void helpUntil(const std::function<bool()>& done);
+
+    // Block until every submitted task has finished. Rethrows the first exception a task threw.
+    void wait();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool tryRunOne(size_t preferred);
+    void finishTask();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> nextWorker_{0};
+    std::atomic<size_t> queued_{0};     // tasks waiting in a deque
+    std::atomic<size_t> unfinished_{0}; // queued + running
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    bool stopping_ = false;
+    std::exception_ptr firstError_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Key column code: root pitch class, plus 12 for minor keys.
+constexpr uint8_t kUnknownKeyCode = 0xFF;
+// Energy byte of a window that was not decoded (see analyzeTrackRegions()).
+constexpr uint8_t kMissingEnergy = 0xFF;
+// Quantization steps over a curve's min-max range; codes 0..kEnergySteps.
+constexpr int kEnergySteps = 254;
+// Chroma codes run 0..kChromaSteps, the track's strongest pitch class being kChromaSteps.
+constexpr int kChromaSteps = 255;
+
+// One track of a TrackStore, pointing into its columns. Valid while the store is open.
+struct TrackView {
+    std::string_view name;
+    double bpm = 0.0;
+    uint8_t keyCode = kUnknownKeyCode;
+    const uint8_t* chromaCodes = nullptr; // 12
+    BeatGrid beatGrid;
+    double windowSeconds = 0.0;
+    double energyMin = 0.0; // RMS range the curve was quantized over
+    double energyMax = 0.0;
+    const uint8_t* energy = nullptr;
+    size_t windows = 0;
+
+    // Pitch class as pitchClassFromKeyString() gives it for key(); -1 if unknown.
+    int pitchClass() const;
+    std::string key() const;
+
+    // TrackAnalysis::chroma, dequantized (sums to 1; all 0 if unknown).
+    std::array<double, 12> chroma() const;
+
+    // Window level on the curve's own 0-1 range, as TransitionProfile normalizes it; NaN for a
+    // window that was not decoded.
+    double normalizedEnergy(size_t i) const {
+        return energy[i] == kMissingEnergy ? std::numeric_limits<double>::quiet_NaN()
+                                           : static_cast<double>(energy[i]) / kEnergySteps;
+    }
+
+    // Dequantized RMS of window i; NaN for a window that was not decoded.
+    double energyAt(size_t i) const { return energyMin + normalizedEnergy(i) * (energyMax - energyMin); }
+
+    // The analysis as a TrackAnalysis, with the dequantized curve and no energy index.
+    TrackAnalysis toAnalysis() const;
+};
+
+// Columnar store of a library's analyses. BPM, key, chroma, beat grid, window size and energy
+// range sit in dense per-track arrays, the energy curves in one blob of 8-bit codes with
+// offsets, and the names in one blob of bytes. A curve is quantized over its own min-max range,
+// so each window costs one byte and findBestTransition() on views differs from the full analysis
+// only by that rounding and the grid's, kept in floats.
+// The file is memory-mapped where the platform allows, so opening a million-track store reads
+// no more than the header and offsets it validates; pages load as tracks are visited.
+class TrackStore {
+public:
+    // Throws std::runtime_error if the file cannot be read or is not a track store.
+    explicit TrackStore(const std::string& path);
+    ~TrackStore();
+
+    TrackStore(const TrackStore&) = delete;
+    TrackStore& operator=(const TrackStore&) = delete;
+
+    size_t size() const { return count_; }
+    TrackView track(size_t i) const;
+
+    // Checksum of every track's name, tempo and curve length, to tell whether something built
+    // from a store (such as a CandidateIndex) still matches it. Reads all the names.
+    uint64_t identity() const;
+
+private:
+    void* base_ = nullptr; // mapping, or null when the file was read into `buffer_`
+    size_t length_ = 0;
+    std::vector<uint64_t> buffer_;
+    size_t count_ = 0;
+
+    const float* bpm_ = nullptr;
+    const float* windowSeconds_ = nullptr;
+    const float* energyMin_ = nullptr;
+    const float* energyMax_ = nullptr;
+    const uint8_t* keyCodes_ = nullptr;
+    const uint8_t* chromaCodes_ = nullptr;    // 12 per track
+    const float* firstBeat_ = nullptr;        // beat grid
+    const float* beatSeconds_ = nullptr;
+    const uint32_t* beats_ = nullptr;
+    const uint8_t* downbeats_ = nullptr;
+    const uint64_t* energyOffsets_ = nullptr; // count_ + 1
+    const uint64_t* nameOffsets_ = nullptr;   // count_ + 1
+    const uint8_t* energy_ = nullptr;
+    const char* names_ = nullptr;
+};
+
+// Key column code of a key name such as "A minor"; kUnknownKeyCode if it is not one.
+uint8_t keyCodeFromString(const std::string& key);
+
+// Write `tracks` under `names` as a track store. Throws std::invalid_argument if the two differ
+// in size and std::runtime_error if the file cannot be written.
+void writeTrackStore(const std::string& path,
+                     const std::vector<std::string>& names,
+                     const std::vector<TrackAnalysis>& tracks);
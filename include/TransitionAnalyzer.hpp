@@ -2,6 +2,81 @@
 
 #include "AnalysisTypes.hpp"
 
-// Find the best transition window between two tracks based on BPM, key, and energy alignment.
-// Fills component scores (0-1) and overall score (0-10).
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Component scores (0-1). Unknown tempo or key scores a neutral 0.5.
+// Tempos are compared by relative difference after moving B to A's closest octave, so
+// half- and double-time count as the same tempo.
+double bpmCompatibility(double bpmA, double bpmB);
+double keyCompatibility(const std::string& keyA, const std::string& keyB);
+
+// bpmB / bpmA after moving B to A's closest octave (within a factor of about 1.41 of 1); 1 if
+// either tempo is unknown. Scoring, sequencing and rendering all fold tempos through this.
+double foldedTempoRatio(double bpmA, double bpmB);
+
+// Pitch class (C = 0 .. B = 11) of a key name such as "A minor"; -1 if unknown.
+int pitchClassFromKeyString(const std::string& key);
+
+// keyCompatibility() on pitch classes; -1 is unknown.
+double pitchClassCompatibility(int pcA, int pcB);
+
+struct TrackView;
+struct TransitionProfileData;
+
+// Per-track transition features (normalized energy, entry hull), computed once so a track can
+// be searched against many others without repeating the work. With a beat grid, transitions
+// start on bar boundaries, scored on the energy curve averaged per bar, with 8-, 16- and 32-bar
+// phrase starts preferred among near-equal scores; without one, on any energy window. Cheap to
+// copy.
+class TransitionProfile {
+public:
+    explicit TransitionProfile(const TrackAnalysis& analysis);
+    // Straight from a TrackStore's columns, without materializing a TrackAnalysis.
+    explicit TransitionProfile(const TrackView& view);
+
+    double bpm() const;
+    int pitchClass() const;
+    bool empty() const; // no energy curve
+
+    // Largest energy rise into any window, as seen by an entry into this track.
+    double maxEntryRise() const;
+
+    // Upper bound on the energy component of a transition out of this track into any track
+    // whose maxEntryRise() is at most `entryRise`.
+    double energyUpperBound(double entryRise) const;
+
+private:
+    friend std::vector<TransitionSuggestion> findTopTransitions(const TransitionProfile&,
+                                                                const TransitionProfile&,
+                                                                size_t,
+                                                                double);
+
+    std::shared_ptr<const TransitionProfileData> data_;
+};
+
+// Overall score (0-10) from component scores; monotonic in each, so component upper bounds
+// give a score upper bound.
+double transitionScore(double bpmScore, double keyScore, double energyScore);
+
+// Find the best transition window between two tracks based on BPM, key, and energy alignment,
+// on bar boundaries where the tracks have beat grids (see TransitionProfile). Fills
+// component scores (0-1) and overall score (0-10).
 TransitionSuggestion findBestTransition(const TrackAnalysis& a, const TrackAnalysis& b);
+TransitionSuggestion findBestTransition(const TransitionProfile& a, const TransitionProfile& b);
+TransitionSuggestion findBestTransition(const TrackView& a, const TrackView& b);
+
+// Up to k best transitions, best first. Energy scores in the same 0.02 step rank by the phrase
+// both cue points start, so a phrase start may come ahead of a marginally better bar.
+// Two candidates closer than minSeparationSeconds on both tracks count as the same transition;
+// only the better one is kept. Empty on invalid input.
+std::vector<TransitionSuggestion> findTopTransitions(const TrackAnalysis& a,
+                                                     const TrackAnalysis& b,
+                                                     size_t k,
+                                                     double minSeparationSeconds = 8.0);
+std::vector<TransitionSuggestion> findTopTransitions(const TransitionProfile& a,
+                                                     const TransitionProfile& b,
+                                                     size_t k,
+                                                     double minSeparationSeconds = 8.0);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TrackStore;
+
+struct MatrixOptions {
+    size_t jobs = 0;        // worker threads; 0 = hardware concurrency
+    double minScore = 6.0;  // keep transitions scoring at least this (0-10)
+    size_t blockRows = 256; // rows scored between writes and progress reports
+};
+
+// One stored transition: out of the row track into `column`.
+struct MatrixEntry {
+    uint32_t column;
+    float score; // 0-10
+    float timeA; // seconds in the row track
+    float timeB; // seconds in the column track
+};
+
+struct MatrixStats {
+    size_t rows = 0;
+    size_t rowsDone = 0;
+    uint64_t pairsScored = 0; // energy searches run
+    uint64_t pairsPruned = 0; // pairs skipped because their upper bound is below minScore
+    uint64_t entries = 0;     // pairs written
+    double elapsedSeconds = 0.0;
+};
+
+// Score every ordered pair of tracks (out of row, into column) and write those scoring at least
+// options.minScore to `outputPath` as a sparse matrix, see loadTransitionMatrix().
+// Tracks are bucketed by pitch class and by tempo folded into one octave, so each row only
+// visits the buckets whose BPM and key components, together with an energy upper bound, can
+// reach minScore; the remaining energy searches run in parallel. `onProgress` is called from
+// the calling thread after every block of rows.
+// Throws std::invalid_argument if `names` and `tracks` differ in size and std::runtime_error
+// if the file cannot be written.
+MatrixStats buildTransitionMatrix(const std::vector<std::string>& names,
+                                  const std::vector<TrackAnalysis>& tracks,
+                                  const std::string& outputPath,
+                                  const MatrixOptions& options,
+                                  const std::function<void(const MatrixStats&)>& onProgress = {});
+
+// Same, scoring a TrackStore's views directly.
+MatrixStats buildTransitionMatrix(const TrackStore& store,
+                                  const std::string& outputPath,
+                                  const MatrixOptions& options,
+                                  const std::function<void(const MatrixStats&)>& onProgress = {});
+
+// Compressed sparse rows: the entries of row r are entries[rowOffsets[r] .. rowOffsets[r + 1]),
+// columns ascending.
+struct TransitionMatrix {
+    double minScore = 0.0;
+    std::vector<std::string> tracks;
+    std::vector<uint64_t> rowOffsets;
+    std::vector<MatrixEntry> entries;
+};
+
+// Throws std::runtime_error if the file cannot be read or is not a transition matrix.
+TransitionMatrix loadTransitionMatrix(const std::string& path);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AnalysisTypes.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct RenderOptions {
+    double leadSeconds = 16.0; // of Track A before the crossfade
+    double fadeSeconds = 16.0; // equal-power crossfade, starting at the cue points
+    double tailSeconds = 16.0; // of Track B after the crossfade
+    bool stretch = true;       // play B at A's tempo (half and double time folded)
+    double maxStretch = 0.12;  // larger tempo changes leave B at its own tempo
+    bool beatAlign = true;     // shift B by up to half a beat so its onsets land on A's
+    bool eqSwap = true;        // hand the bass over from A to B in the middle of the fade
+    double bassHz = 200.0;     // crossover of the bass band
+    double swapSeconds = 0.25; // length of the bass hand-over
+    size_t blockFrames = 8192; // output frames mixed and written at a time
+};
+
+struct RenderStats {
+    int sampleRate = 0;         // of the output, A's rate
+    uint64_t frames = 0;        // written
+    double stretchRatio = 1.0;  // seconds of B played per second of output
+    double alignSeconds = 0.0;  // B's delay to line its beats up with A's; negative is earlier
+    uint64_t decodedFrames = 0; // read from both tracks, alignment included
+    double elapsedSeconds = 0.0;
+};
+
+// Render the transition `cue` (out of A at timeA, into B at timeB) to a 16-bit stereo WAV at A's
+// sample rate: leadSeconds of A, the crossfade, then tailSeconds of B. B is resampled to A's
+// rate and time-stretched to A's tempo with WSOLA, which overlap-adds windowed grains of B at
+// the stretched rate, each shifted by up to a quarter grain to the offset that best continues
+// the previous one, so the pitch is unchanged. With beatAlign, onset envelopes of both tracks
+// around the cue are cross-correlated over lags of up to half of A's beat to line B's beats up
+// with A's. The crossfade keeps the summed power constant; with eqSwap, B comes in without its
+// bass, and the bass band (a two-pole low-pass, the rest being the signal minus that band) moves
+// from A to B over swapSeconds at the middle of the fade. Only the cue regions are decoded, and
+// everything runs block by block into libsndfile, so memory does not depend on the lengths.
+// Mono tracks play on both channels; tracks with more than two channels play their first two.
+// Throws std::invalid_argument on negative durations or a non-positive block size, and
+// std::runtime_error if a track cannot be read or the output cannot be written.
+RenderStats renderTransition(const std::string& pathA,
+                             double bpmA,
+                             const std::string& pathB,
+                             double bpmB,
+                             const TransitionSuggestion& cue,
+                             const std::string& outputPath,
+                             const RenderOptions& options = {});
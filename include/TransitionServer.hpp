@@ -0,0 +1,91 @@
+#pragma once
+
+#include "AnalysisPipeline.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class AnalysisCache;
+class TrackStore;
+
+struct ServerOptions {
+    std::string socketPath;
+    size_t jobs = 0; // worker threads; 0 = hardware concurrency
+    double windowSeconds = kDefaultEnergyWindowSeconds;
+    AnalysisCache* cache = nullptr;    // consulted before decoding an unseen track when set
+    const TrackStore* store = nullptr; // tracks found here by name are never decoded
+    size_t maxTopK = 32;               // largest "k" a request may ask for
+};
+
+struct ServerStats {
+    uint64_t requests = 0; // answered, errors included
+    uint64_t errors = 0;
+    size_t tracks = 0;     // analyzed and resident
+    double p50Ms = 0.0;    // over the most recent requests, from line read to response sent
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Resident transition service on a Unix domain socket. Clients send one JSON object per line
+// and get one back per request, tagged with the request's "id" (responses to one connection
+// may come back out of order):
+//   {"id": 1, "a": "/music/x.wav", "b": "/music/y.wav", "k": 3}
+//       -> {"id":1,"ok":true,"transitions":[{"score":8.80,"timeA":86.6,"timeB":19.5,...}]}
+//   {"op": "analyze", "path": "/music/x.wav"} -> {"ok":true,"bpm":120.05,"key":"F major"}
+//   {"op": "stats"}    -> request count and p50/p99 latency
+//   {"op": "shutdown"} -> stops the server once in-flight requests are answered
+// Requests run on a work-stealing pool. A track is analyzed once, on first use, in the
+// background: requests that need it wait without holding a worker and are answered as soon as
+// it is ready, while requests on resident tracks keep being served. Failed analyses are not
+// kept, so a later request retries. A client that stops reading is disconnected once 4 MB of
+// responses are queued for it. POSIX only.
+class TransitionServer {
+public:
+    // Binds and listens on options.socketPath, replacing a stale socket file left by a server
+    // that is no longer running. Throws std::runtime_error if the socket cannot be set up or
+    // another server answers on it, std::invalid_argument on an empty path.
+    explicit TransitionServer(const ServerOptions& options);
+    ~TransitionServer(); // removes the socket file
+
+    TransitionServer(const TransitionServer&) = delete;
+    TransitionServer& operator=(const TransitionServer&) = delete;
+
+    // Serve until stop() or a shutdown request, then answer what is in flight and return.
+    void run();
+
+    // Ask run() to return. Async-signal-safe, so it may be called from a signal handler.
+    void stop();
+
+    ServerStats stats() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// Blocking client for a TransitionServer: one request line out, one response line back.
+class TransitionClient {
+public:
+    // Throws std::runtime_error if nothing is listening on `socketPath`.
+    explicit TransitionClient(const std::string& socketPath);
+    ~TransitionClient();
+
+    TransitionClient(const TransitionClient&) = delete;
+    TransitionClient& operator=(const TransitionClient&) = delete;
+
+    // Send `line` (without its newline) and return the next response line. Throws
+    // std::runtime_error if the connection fails or closes first.
+    std::string request(const std::string& line);
+
+private:
+    int fd_ = -1;
+    std::string pending_; // bytes read past the last response
+};
+
+// Default socket path: djtransition.sock in the system temp directory.
+std::string defaultServerSocket();
+
+// JSON string literal for `text`, quotes included.
+std::string jsonQuote(const std::string& text);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class PcmFormat { Int16, Int24, Int32, Float32 };
+
+// Read-only view of the interleaved little-endian sample data of a WAV file.
+struct PcmView {
+    const unsigned char* data = nullptr; // first byte of the data chunk
+    uint64_t frames = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    PcmFormat format = PcmFormat::Int16;
+    size_t bytesPerSample = 0;
+};
+
+// Memory-mapped uncompressed WAV file (PCM 16/24/32-bit or 32-bit float). The data chunk is
+// read straight from the page cache; samples are converted only when a block is requested.
+class MappedWavFile {
+public:
+    // Returns nullptr when the file is not a WAV layout we can map; callers then fall back to
+    // libsndfile. Never throws for format reasons.
+    static std::unique_ptr<MappedWavFile> open(const std::string& path);
+    ~MappedWavFile();
+
+    MappedWavFile(const MappedWavFile&) = delete;
+    MappedWavFile& operator=(const MappedWavFile&) = delete;
+
+    const PcmView& view() const { return view_; }
+
+private:
+    MappedWavFile() = default;
+
+    void* base_ = nullptr;
+    size_t length_ = 0;
+    PcmView view_;
+};
+
+// Convert `frames` interleaved frames starting at `firstFrame` to float, with the same
+// full-scale mapping libsndfile uses (e.g. int16 / 32768). Caller checks bounds.
+void convertPcmToFloat(const PcmView& view, uint64_t firstFrame, size_t frames, float* out);
@@ -0,0 +1,431 @@
+#include "AnalysisCache.hpp"
+
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DJT_HAVE_POSIX_CACHE 1
+#endif
+
+namespace fs = std::filesystem;
+
+struct AnalysisCache::Record {
+    uint64_t fileSize;
+    int64_t mtimeNs;
+    uint64_t contentHash;
+    uint64_t paramsHash;
+    uint64_t dataOffset;
+    uint32_t dataLength;
+    uint32_t checksum; // FNV-1a of the payload
+};
+
+namespace {
+constexpr char kIndexMagic[8] = {'D', 'J', 'T', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t kIndexFormat = 1;
+constexpr size_t kHeaderSize = 16; // magic, format, record size
+constexpr size_t kHashSampleBytes = 64 * 1024;
+
+uint64_t fnv1a64(const unsigned char* data, size_t size, uint64_t hash = 1469598103934665603ull) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t hashValue(const T& value, uint64_t hash) {
+    return fnv1a64(reinterpret_cast<const unsigned char*>(&value), sizeof(T), hash);
+}
+
+uint32_t checksum32(const std::vector<unsigned char>& data) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint64_t keyDigest(const CacheKey& key) {
+    uint64_t h = hashValue(key.fileSize, 1469598103934665603ull);
+    h = hashValue(key.mtimeNs, h);
+    h = hashValue(key.contentHash, h);
+    return hashValue(key.paramsHash, h);
+}
+
+// Payload encoding: native byte order; the cache is local to one machine.
+template <typename T>
+void appendPod(std::vector<unsigned char>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool readPod(const std::vector<unsigned char>& in, size_t& pos, T& value) {
+    if (in.size() - pos < sizeof(T)) return false;
+    std::memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+std::vector<unsigned char> encodeAnalysis(const TrackAnalysis& analysis, const AudioStreamInfo& info) {
+    std::vector<unsigned char> out;
+    appendPod(out, static_cast<uint32_t>(info.sampleRate));
+    appendPod(out, static_cast<uint32_t>(info.channels));
+    appendPod(out, info.frames);
+    appendPod(out, analysis.bpm);
+    appendPod(out, analysis.windowSeconds);
+    appendPod(out, static_cast<uint32_t>(analysis.key.size()));
+    out.insert(out.end(), analysis.key.begin(), analysis.key.end());
+    for (double v : analysis.chroma) appendPod(out, v);
+    const BeatGrid& grid = analysis.beatGrid;
+    appendPod(out, grid.firstBeat);
+    appendPod(out, grid.beatSeconds);
+    appendPod(out, static_cast<uint64_t>(grid.beats));
+    appendPod(out, static_cast<uint32_t>(grid.downbeat));
+    appendPod(out, static_cast<uint64_t>(analysis.energyCurve.size()));
+    for (double v : analysis.energyCurve) appendPod(out, v);
+    const EnergyIndex& index = analysis.energyIndex;
+    appendPod(out, static_cast<uint32_t>(index.sampleRate()));
+    appendPod(out, index.totalSamples());
+    appendPod(out, static_cast<uint64_t>(index.blockCount()));
+    for (float v : index.blockSums()) appendPod(out, v);
+    return out;
+}
+
+bool decodeAnalysis(const std::vector<unsigned char>& in, TrackAnalysis& analysis, AudioStreamInfo& info) {
+    size_t pos = 0;
+    uint32_t sampleRate = 0, channels = 0, keyLength = 0, downbeat = 0;
+    uint64_t beats = 0, energyCount = 0;
+    if (!readPod(in, pos, sampleRate) || !readPod(in, pos, channels) || !readPod(in, pos, info.frames) ||
+        !readPod(in, pos, analysis.bpm) || !readPod(in, pos, analysis.windowSeconds) ||
+        !readPod(in, pos, keyLength) || in.size() - pos < keyLength) {
+        return false;
+    }
+    info.sampleRate = static_cast<int>(sampleRate);
+    info.channels = static_cast<int>(channels);
+    analysis.key.assign(reinterpret_cast<const char*>(in.data() + pos), keyLength);
+    pos += keyLength;
+    for (double& v : analysis.chroma) {
+        if (!readPod(in, pos, v)) return false;
+    }
+    BeatGrid& grid = analysis.beatGrid;
+    if (!readPod(in, pos, grid.firstBeat) || !readPod(in, pos, grid.beatSeconds) || !readPod(in, pos, beats) ||
+        !readPod(in, pos, downbeat) || downbeat >= BeatGrid::kBeatsPerBar) {
+        return false;
+    }
+    grid.beats = static_cast<size_t>(beats);
+    grid.downbeat = downbeat;
+    if (!readPod(in, pos, energyCount) || (in.size() - pos) / sizeof(double) < energyCount) return false;
+    analysis.energyCurve.resize(static_cast<size_t>(energyCount));
+    for (double& v : analysis.energyCurve) readPod(in, pos, v);
+
+    uint32_t indexRate = 0;
+    uint64_t indexSamples = 0, blockCount = 0;
+    if (!readPod(in, pos, indexRate) || !readPod(in, pos, indexSamples) || !readPod(in, pos, blockCount) ||
+        (in.size() - pos) / sizeof(float) < blockCount) {
+        return false;
+    }
+    std::vector<float> blocks(static_cast<size_t>(blockCount));
+    for (float& v : blocks) readPod(in, pos, v);
+    analysis.energyIndex = EnergyIndex(static_cast<int>(indexRate), indexSamples, std::move(blocks));
+    if (analysis.energyIndex.blockCount() != blockCount) return false;
+    return pos == in.size();
+}
+
+#ifdef DJT_HAVE_POSIX_CACHE
+bool writeAll(int fd, const void* data, size_t size, off_t offset) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, p, size, offset);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+// Advisory lock on the index file, held while appending.
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd_(fd) { ::flock(fd_, LOCK_EX); }
+    ~FileLock() { ::flock(fd_, LOCK_UN); }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+// Whether `path` still names the file open as `fd`, rather than one renamed over it.
+bool stillAt(int fd, const std::string& path) {
+    struct stat open {}, named {};
+    return ::fstat(fd, &open) == 0 && ::stat(path.c_str(), &named) == 0 && open.st_dev == named.st_dev &&
+           open.st_ino == named.st_ino;
+}
+
+// Fresh, empty index and data files built beside the old ones and renamed over them. A process
+// that still maps the old index keeps its copy rather than faulting on a truncated file.
+bool replaceCacheFiles(const std::string& indexPath, const std::string& dataPath, const unsigned char* header) {
+    const std::string indexTemp = indexPath + ".tmp";
+    const std::string dataTemp = dataPath + ".tmp";
+    const int indexFd = ::open(indexTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    const int dataFd = ::open(dataTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = indexFd >= 0 && dataFd >= 0 && writeAll(indexFd, header, kHeaderSize, 0);
+    if (indexFd >= 0) ok = ::close(indexFd) == 0 && ok;
+    if (dataFd >= 0) ok = ::close(dataFd) == 0 && ok;
+    // Data first: an index left behind by a failure here names no valid payloads anyway.
+    ok = ok && ::rename(dataTemp.c_str(), dataPath.c_str()) == 0 &&
+         ::rename(indexTemp.c_str(), indexPath.c_str()) == 0;
+    if (!ok) {
+        ::unlink(indexTemp.c_str());
+        ::unlink(dataTemp.c_str());
+    }
+    return ok;
+}
+#endif
+} // namespace
+
+CacheKey makeCacheKey(const std::string& path) {
+    std::error_code ec;
+    const uint64_t size = fs::file_size(path, ec);
+    if (ec) throw std::runtime_error("Failed to stat file: " + path);
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec) throw std::runtime_error("Failed to stat file: " + path);
+
+    CacheKey key;
+    key.fileSize = size;
+    key.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open file: " + path);
+    uint64_t hash = hashValue(size, 1469598103934665603ull);
+    std::vector<unsigned char> buffer(kHashSampleBytes);
+    const uint64_t offsets[3] = {0, size / 2, size > kHashSampleBytes ? size - kHashSampleBytes : 0};
+    for (uint64_t offset : offsets) {
+        in.seekg(static_cast<std::streamoff>(offset));
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        hash = fnv1a64(buffer.data(), static_cast<size_t>(in.gcount()), hash);
+        in.clear();
+    }
+    key.contentHash = hash;
+
+    key.paramsHash = hashValue(kAnalyzerVersion, 1469598103934665603ull);
+    return key;
+}
+
+#ifdef DJT_HAVE_POSIX_CACHE
+AnalysisCache::AnalysisCache(const std::string& directory) : directory_(directory) {
+    static_assert(sizeof(Record) == 48, "index records are fixed-size");
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) throw std::runtime_error("Failed to create cache directory: " + directory);
+
+    const std::string indexPath = (fs::path(directory) / "index.bin").string();
+    const std::string dataPath = (fs::path(directory) / "data.bin").string();
+    unsigned char header[kHeaderSize] = {};
+    std::memcpy(header, kIndexMagic, sizeof(kIndexMagic));
+    const uint32_t format = kIndexFormat;
+    const uint32_t recordSize = sizeof(Record);
+    std::memcpy(header + 8, &format, sizeof(format));
+    std::memcpy(header + 12, &recordSize, sizeof(recordSize));
+
+    // Start over when the index is new or was written in another format, then open the files
+    // that replaced it. Another process may replace them while this one waits for the lock, so
+    // the files are reopened until the locked index is the one in the directory.
+    for (;;) {
+        indexFd_ = ::open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+        dataFd_ = ::open(dataPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (indexFd_ < 0 || dataFd_ < 0) {
+            if (indexFd_ >= 0) ::close(indexFd_);
+            if (dataFd_ >= 0) ::close(dataFd_);
+            throw std::runtime_error("Failed to open cache in: " + directory);
+        }
+        bool current = false;
+        bool replaced = true;
+        {
+            FileLock lock(indexFd_);
+            if (stillAt(indexFd_, indexPath)) {
+                unsigned char existing[kHeaderSize] = {};
+                current = ::pread(indexFd_, existing, kHeaderSize, 0) == static_cast<ssize_t>(kHeaderSize) &&
+                          std::memcmp(existing, header, kHeaderSize) == 0;
+                if (!current) replaced = replaceCacheFiles(indexPath, dataPath, header);
+            }
+        }
+        if (current) break;
+        ::close(indexFd_);
+        ::close(dataFd_);
+        indexFd_ = dataFd_ = -1;
+        if (!replaced) throw std::runtime_error("Failed to initialize cache in: " + directory);
+    }
+    refreshIndex();
+}
+
+AnalysisCache::~AnalysisCache() {
+    if (mapped_) ::munmap(const_cast<unsigned char*>(mapped_), mappedLength_);
+    if (indexFd_ >= 0) ::close(indexFd_);
+    if (dataFd_ >= 0) ::close(dataFd_);
+}
+
+void AnalysisCache::refreshIndex() {
+    struct stat st {};
+    if (::fstat(indexFd_, &st) != 0) return;
+    const size_t length = static_cast<size_t>(st.st_size);
+    if (length < mappedLength_) {
+        // Truncated under us (by an older build); the records read so far may be gone.
+        ::munmap(const_cast<unsigned char*>(mapped_), mappedLength_);
+        mapped_ = nullptr;
+        mappedLength_ = 0;
+        recordsIndexed_ = 0;
+        byDigest_.clear();
+    }
+    if (length <= mappedLength_) return;
+
+    void* base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, indexFd_, 0);
+    if (base == MAP_FAILED) return;
+    if (mapped_) ::munmap(const_cast<unsigned char*>(mapped_), mappedLength_);
+    mapped_ = static_cast<const unsigned char*>(base);
+    mappedLength_ = length;
+
+    // A concurrent writer may have appended only part of a record; it is picked up next time.
+    const size_t records = length < kHeaderSize ? 0 : (length - kHeaderSize) / sizeof(Record);
+    for (; recordsIndexed_ < records; ++recordsIndexed_) {
+        Record record;
+        std::memcpy(&record, mapped_ + kHeaderSize + recordsIndexed_ * sizeof(Record), sizeof(Record));
+        CacheKey key{record.fileSize, record.mtimeNs, record.contentHash, record.paramsHash};
+        byDigest_[keyDigest(key)] = recordsIndexed_; // later records win
+    }
+}
+
+bool AnalysisCache::readPayload(const Record& record, std::vector<unsigned char>& payload) const {
+    payload.resize(record.dataLength);
+    size_t done = 0;
+    while (done < payload.size()) {
+        ssize_t n = ::pread(dataFd_, payload.data() + done, payload.size() - done,
+                            static_cast<off_t>(record.dataOffset + done));
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return checksum32(payload) == record.checksum;
+}
+
+bool AnalysisCache::lookup(const CacheKey& key, TrackAnalysis& out, AudioStreamInfo* info) {
+    DJT_PROFILE_SCOPE("cacheLookup");
+    Record record;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t digest = keyDigest(key);
+        auto it = byDigest_.find(digest);
+        if (it == byDigest_.end()) {
+            refreshIndex(); // another process may have added it
+            it = byDigest_.find(digest);
+            if (it == byDigest_.end()) return false;
+        }
+        std::memcpy(&record, mapped_ + kHeaderSize + it->second * sizeof(Record), sizeof(Record));
+    }
+    if (record.fileSize != key.fileSize || record.mtimeNs != key.mtimeNs ||
+        record.contentHash != key.contentHash || record.paramsHash != key.paramsHash) {
+        return false;
+    }
+
+    std::vector<unsigned char> payload;
+    TrackAnalysis analysis;
+    AudioStreamInfo streamInfo;
+    if (!readPayload(record, payload) || !decodeAnalysis(payload, analysis, streamInfo)) return false;
+    out = std::move(analysis);
+    if (info) *info = streamInfo;
+    return true;
+}
+
+void AnalysisCache::store(const CacheKey& key, const TrackAnalysis& analysis, const AudioStreamInfo& info) {
+    DJT_PROFILE_SCOPE("cacheStore");
+    const std::vector<unsigned char> payload = encodeAnalysis(analysis, info);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    {
+        FileLock fileLock(indexFd_);
+        // Payload first, so a record never points past the end of data.bin.
+        struct stat dataStat {};
+        struct stat indexStat {};
+        if (::fstat(dataFd_, &dataStat) != 0 || ::fstat(indexFd_, &indexStat) != 0) {
+            throw std::runtime_error("Failed to append to cache in: " + directory_);
+        }
+        Record record{key.fileSize, key.mtimeNs, key.contentHash, key.paramsHash,
+                      static_cast<uint64_t>(dataStat.st_size), static_cast<uint32_t>(payload.size()),
+                      checksum32(payload)};
+        // Drop a torn record left by a writer that died mid-append.
+        const off_t indexEnd = static_cast<off_t>(
+            kHeaderSize + (static_cast<size_t>(indexStat.st_size) - kHeaderSize) / sizeof(Record) * sizeof(Record));
+        if (!writeAll(dataFd_, payload.data(), payload.size(), dataStat.st_size) ||
+            !writeAll(indexFd_, &record, sizeof(record), indexEnd)) {
+            throw std::runtime_error("Failed to append to cache in: " + directory_);
+        }
+    }
+    refreshIndex();
+}
+#else
+AnalysisCache::AnalysisCache(const std::string& directory) : directory_(directory) {
+    throw std::runtime_error("Persistent cache is not supported on this platform");
+}
+AnalysisCache::~AnalysisCache() = default;
+void AnalysisCache::refreshIndex() {}
+bool AnalysisCache::readPayload(const Record&, std::vector<unsigned char>&) const { return false; }
+bool AnalysisCache::lookup(const CacheKey&, TrackAnalysis&, AudioStreamInfo*) { return false; }
+void AnalysisCache::store(const CacheKey&, const TrackAnalysis&, const AudioStreamInfo&) {}
+#endif
+
+std::string AnalysisCache::defaultDirectory() {
+    if (const char* dir = std::getenv("DJT_CACHE_DIR"); dir && *dir) return dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return (fs::path(xdg) / "djtransition").string();
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return (fs::path(home) / ".cache" / "djtransition").string();
+    }
+    return {};
+}
+
+TrackAnalysis analyzeTrackCached(AnalysisCache* cache, const std::string& path, double windowSeconds,
+                                 AudioStreamInfo* info, AnalysisWorkspace* workspace, ThreadPool* pool,
+                                 const RoiOptions* roi) {
+    if (!cache) {
+        return roi ? analyzeTrackRegions(path, *roi, windowSeconds, info, workspace)
+                   : analyzeTrackFile(path, windowSeconds, info, workspace, pool);
+    }
+
+    const CacheKey key = makeCacheKey(path);
+    TrackAnalysis analysis;
+    AudioStreamInfo streamInfo;
+    if (cache->lookup(key, analysis, &streamInfo)) {
+        if (analysis.windowSeconds != windowSeconds) {
+            analysis.energyCurve = analysis.energyIndex.curve(windowSeconds);
+            analysis.windowSeconds = windowSeconds;
+        }
+        if (info) *info = streamInfo;
+        return analysis;
+    }
+
+    if (roi) return analyzeTrackRegions(path, *roi, windowSeconds, info, workspace);
+    analysis = analyzeTrackFile(path, windowSeconds, &streamInfo, workspace, pool);
+    try {
+        cache->store(key, analysis, streamInfo);
+    } catch (const std::exception&) {
+        // A cache that cannot be written (full disk, read-only media) must not fail analysis.
+    }
+    if (info) *info = streamInfo;
+    return analysis;
+}
@@ -0,0 +1,225 @@
+#include "AnalysisPipeline.hpp"
+
+#include "BeatTracker.hpp"
+#include "BpmAnalyzer.hpp"
+#include "EnergyAnalyzer.hpp"
+#include "KeyAnalyzer.hpp"
+#include "Profiler.hpp"
+#include "Resampler.hpp"
+#include "SegmentedAnalysis.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// Region analysis falls back to a full pass once it would decode this share of the track.
+constexpr double kRoiFullShare = 0.8;
+
+struct Region {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    bool energy = false; // part of the intro or outro, where transitions are searched
+};
+
+uint64_t framesFor(double seconds, int sampleRate) {
+    return static_cast<uint64_t>(seconds * sampleRate + 0.5);
+}
+
+// Head, middle probes and tail of a `frames`-long track, widened to multiples of `grid`,
+// sorted and merged.
+std::vector<Region> roiRegions(uint64_t frames, int sampleRate, uint64_t grid, const RoiOptions& roi) {
+    const uint64_t head = std::min(frames, framesFor(roi.headSeconds, sampleRate));
+    const uint64_t tail = std::min(frames - head, framesFor(roi.tailSeconds, sampleRate));
+    const uint64_t middle = frames - head - tail;
+    const uint64_t probe = std::min(middle, framesFor(roi.probeSeconds, sampleRate));
+
+    std::vector<Region> regions;
+    regions.push_back({0, head, true});
+    if (probe > 0) {
+        for (size_t i = 0; i < roi.probes; ++i) {
+            // Probes centred on evenly spaced points of the middle.
+            const double at = (static_cast<double>(i) + 0.5) / static_cast<double>(roi.probes);
+            const uint64_t centre = head + static_cast<uint64_t>(at * static_cast<double>(middle));
+            const uint64_t begin = std::min(centre - std::min(centre - head, probe / 2), head + middle - probe);
+            regions.push_back({begin, begin + probe, false});
+        }
+    }
+    regions.push_back({frames - tail, frames, true});
+
+    for (Region& region : regions) {
+        region.begin -= region.begin % grid;
+        region.end = std::min(frames, (region.end + grid - 1) / grid * grid);
+    }
+    std::sort(regions.begin(), regions.end(), [](const Region& x, const Region& y) { return x.begin < y.begin; });
+    std::vector<Region> merged;
+    for (const Region& region : regions) {
+        if (region.end <= region.begin) continue;
+        if (!merged.empty() && region.begin <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, region.end);
+            merged.back().energy = merged.back().energy || region.energy;
+        } else {
+            merged.push_back(region);
+        }
+    }
+    return merged;
+}
+
+TrackAnalysis analyzeRegions(AudioStreamReader& reader, const std::vector<Region>& regions, double windowSeconds,
+                             uint64_t windowSamples, AnalysisWorkspace& ws) {
+    const int rate = reader.info().sampleRate;
+    const uint64_t frames = reader.info().frames;
+    TrackAnalysis analysis;
+    analysis.windowSeconds = windowSeconds;
+    if (windowSamples > 0) {
+        analysis.energyCurve.assign(static_cast<size_t>((frames + windowSamples - 1) / windowSamples),
+                                    std::numeric_limits<double>::quiet_NaN());
+    }
+
+    std::vector<double> autocorr;
+    std::vector<OnsetSpan> onsets;
+    double hopSeconds = 0.0;
+    std::array<double, 12> histogram{};
+    for (const Region& region : regions) {
+        // Each region is a stream of its own: its decimation, onsets and windows start afresh.
+        AnalysisDecimator decimator(rate, ws);
+        BpmAccumulator bpm(decimator.bpmRate(), &ws);
+        KeyAccumulator key(decimator.keyRate(), &ws);
+        EnergyAccumulator energy(rate, windowSeconds, &ws, region.begin);
+        reader.seek(region.begin);
+        const float* block = nullptr;
+        while (reader.position() < region.end) {
+            const size_t count = reader.readBlock(block, static_cast<size_t>(region.end - reader.position()));
+            if (count == 0) break;
+            decimator.push(block, count);
+            bpm.push(decimator.bpmBlock(), decimator.bpmCount());
+            key.push(decimator.keyBlock(), decimator.keyCount());
+            energy.push(block, count);
+        }
+
+        // The lags of the BPM range and one past either end, as the estimator reads them.
+        hopSeconds = static_cast<double>(BpmAccumulator::kHopSize) / static_cast<double>(decimator.bpmRate());
+        autocorr.resize(static_cast<size_t>(std::ceil(60.0 / 80.0 / hopSeconds)) + 2, 0.0);
+        const TempoSpectrum spectrum = bpm.tempoSpectrum();
+        const std::vector<double>& lags = spectrum.autocorrelation();
+        for (size_t lag = 0; lag < std::min(lags.size(), autocorr.size()); ++lag) autocorr[lag] += lags[lag];
+        onsets.push_back(bpm.onsets(static_cast<double>(region.begin) / rate));
+        for (size_t pc = 0; pc < 12; ++pc) histogram[pc] += key.histogram()[pc];
+
+        if (windowSamples > 0 && region.energy) {
+            const std::vector<double> windows = energy.finish();
+            const size_t first = static_cast<size_t>(region.begin / windowSamples);
+            const size_t count = std::min(windows.size(), analysis.energyCurve.size() - first);
+            std::copy(windows.begin(), windows.begin() + static_cast<std::ptrdiff_t>(count),
+                      analysis.energyCurve.begin() + static_cast<std::ptrdiff_t>(first));
+        }
+    }
+
+    analysis.bpm = bestBpmFromAutocorrelation(autocorr.data(), autocorr.size(), hopSeconds, 80.0, 180.0);
+    analysis.beatGrid = fitBeatGrid(onsets, analysis.bpm, static_cast<double>(frames) / rate);
+    analysis.key = keyFromHistogram(histogram);
+    analysis.chroma = chromaFromHistogram(histogram);
+    const double gain = normalizationGain(reader.peak());
+    for (double& rms : analysis.energyCurve) rms *= gain;
+    return analysis;
+}
+} // namespace
+
+TrackAnalysis analyzeTrackFile(const std::string& path,
+                               double windowSeconds,
+                               AudioStreamInfo* info,
+                               AnalysisWorkspace* workspace,
+                               ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("analyzeTrackFile");
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace;
+    if (!workspace) {
+        ownWorkspace = std::make_unique<AnalysisWorkspace>();
+        workspace = ownWorkspace.get();
+    }
+
+    AudioStreamReader reader(path, AudioStreamReader::kDefaultBlockFrames, &workspace->audioBlock);
+
+    // Energy is measured at the native rate; tempo and key on decimated streams.
+    SegmentedAnalysis segments(reader.info().sampleRate, windowSeconds, kAnalyzeAll, workspace, pool);
+    segments.reserve(reader.info().frames);
+
+    const float* block = nullptr;
+    while (size_t frames = reader.readBlock(block)) {
+        segments.push(block, frames);
+    }
+    segments.finish();
+
+    // BPM and key are invariant to the normalization gain; only the energy curve and index need it.
+    TrackAnalysis analysis;
+    analysis.bpm = segments.bpm();
+    analysis.beatGrid = segments.beatGrid(analysis.bpm);
+    analysis.windowSeconds = windowSeconds;
+    const float gain = normalizationGain(reader.peak());
+    analysis.energyCurve = segments.energyCurve(gain);
+    analysis.energyIndex = segments.energyIndex(gain);
+    analysis.key = segments.key();
+    analysis.chroma = segments.chroma();
+
+    if (info) *info = reader.info();
+    return analysis;
+}
+
+TrackAnalysis analyzeAudio(const AudioData& audio, double windowSeconds, AnalysisWorkspace* workspace,
+                           ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("analyzeAudio");
+    TrackAnalysis analysis;
+    analysis.windowSeconds = windowSeconds;
+    if (audio.sampleRate <= 0 || audio.samples.empty()) return analysis;
+
+    const unsigned analyzers = windowSeconds > 0.0 ? kAnalyzeAll : kAnalyzeBpm | kAnalyzeKey;
+    SegmentedAnalysis segments(audio.sampleRate, windowSeconds, analyzers, workspace, pool);
+    segments.reserve(audio.samples.size());
+    segments.analyze(audio.samples.data(), audio.samples.size());
+    analysis.bpm = segments.bpm();
+    analysis.beatGrid = segments.beatGrid(analysis.bpm);
+    analysis.energyCurve = segments.energyCurve();
+    analysis.energyIndex = segments.energyIndex();
+    analysis.key = segments.key();
+    analysis.chroma = segments.chroma();
+    return analysis;
+}
+
+TrackAnalysis analyzeTrackRegions(const std::string& path,
+                                  const RoiOptions& roi,
+                                  double windowSeconds,
+                                  AudioStreamInfo* info,
+                                  AnalysisWorkspace* workspace) {
+    DJT_PROFILE_SCOPE("analyzeTrackRegions");
+    if (!(roi.headSeconds >= 0.0) || !(roi.tailSeconds >= 0.0) || !(roi.probeSeconds >= 0.0)) {
+        throw std::invalid_argument("analyzeTrackRegions: durations must not be negative");
+    }
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace;
+    if (!workspace) {
+        ownWorkspace = std::make_unique<AnalysisWorkspace>();
+        workspace = ownWorkspace.get();
+    }
+
+    {
+        AudioStreamReader reader(path, AudioStreamReader::kDefaultBlockFrames, &workspace->audioBlock);
+        if (info) *info = reader.info();
+        const int rate = reader.info().sampleRate;
+        const uint64_t frames = reader.info().frames;
+        const long windowSamples = windowSeconds > 0.0 && rate > 0 ? std::lround(windowSeconds * rate) : 0;
+        const uint64_t grid = static_cast<uint64_t>(std::max(1L, windowSamples));
+        if (rate > 0 && frames > 0) {
+            const std::vector<Region> regions = roiRegions(frames, rate, grid, roi);
+            uint64_t decoded = 0;
+            for (const Region& region : regions) decoded += region.end - region.begin;
+            if (static_cast<double>(decoded) < kRoiFullShare * static_cast<double>(frames)) {
+                return analyzeRegions(reader, regions, windowSeconds, static_cast<uint64_t>(std::max(0L, windowSamples)),
+                                      *workspace);
+            }
+        }
+    }
+    // Nearly everything is of interest: one sequential pass costs less than the seeks.
+    return analyzeTrackFile(path, windowSeconds, info, workspace);
+}
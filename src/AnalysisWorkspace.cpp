@@ -0,0 +1,27 @@
+#include "AnalysisWorkspace.hpp"
+
+#include "SegmentedAnalysis.hpp"
+
+#include <tuple>
+
+// Out of line, where SegmentSlot is complete.
+AnalysisWorkspace::AnalysisWorkspace() = default;
+AnalysisWorkspace::~AnalysisWorkspace() = default;
+
+const FftPlan& AnalysisWorkspace::fftPlan(size_t size) {
+    for (const auto& entry : plans_) {
+        if (entry.first == size) return entry.second;
+    }
+    plans_.emplace_back(std::piecewise_construct, std::forward_as_tuple(size), std::forward_as_tuple(size));
+    return plans_.back().second;
+}
+
+PolyphaseResampler& AnalysisWorkspace::resampler(int inputRate, int outputRate, double passband) {
+    for (auto& entry : resamplers_) {
+        if (entry.inputRate() == inputRate && entry.outputRate() == outputRate && entry.passband() == passband) {
+            entry.reset();
+            return entry;
+        }
+    }
+    return resamplers_.emplace_back(inputRate, outputRate, passband);
+}
@@ -1,5 +1,9 @@
 #include "AudioLoader.hpp"
 
+#include "Profiler.hpp"
+#include "SimdKernels.hpp"
+#include "WavMapping.hpp"
+
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
@@ -8,65 +12,155 @@
 #include <sndfile.h>
 
 namespace {
-float computeMaxAbs(const std::vector<float>& data) {
-    float maxVal = 0.0f;
-    for (float v : data) {
-        maxVal = std::max(maxVal, std::abs(v));
-    }
-    return maxVal;
-}
+// Normalize to -0.99..0.99 peak to avoid clipping; preserves silence.
+constexpr float kTargetPeak = 0.99f;
 } // namespace
 
-AudioData loadAudioFile(const std::string& path) {
-    SF_INFO info{};
-    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+struct AudioStreamReader::Impl {
+    std::string path;
+    std::unique_ptr<MappedWavFile> mapped; // zero-copy fast path for plain WAV
+    SNDFILE* file = nullptr;               // libsndfile fallback for everything else
+    AudioStreamInfo info;
+    size_t blockFrames = 0;
+    std::vector<float> ownBuffer;
+    std::vector<float>* buffer = nullptr; // interleaved block, downmixed in place
+    uint64_t framesRead = 0;
+    float peak = 0.0f;
+};
+
+AudioStreamReader::AudioStreamReader(const std::string& path, size_t blockFrames, std::vector<float>* blockBuffer)
+    : impl_(std::make_unique<Impl>()) {
+    impl_->path = path;
+    impl_->blockFrames = std::max<size_t>(1, blockFrames);
+    impl_->buffer = blockBuffer ? blockBuffer : &impl_->ownBuffer;
+
+    if ((impl_->mapped = MappedWavFile::open(path))) {
+        const PcmView& view = impl_->mapped->view();
+        impl_->info.sampleRate = view.sampleRate;
+        impl_->info.channels = view.channels;
+        impl_->info.frames = view.frames;
+        impl_->buffer->resize(impl_->blockFrames * static_cast<size_t>(view.channels));
+        return;
+    }
+
+    SF_INFO sfInfo{};
+    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfInfo);
     if (!file) {
         throw std::runtime_error("Failed to open audio file: " + path);
     }
 
-    if (info.channels <= 0 || info.samplerate <= 0) {
+    if (sfInfo.channels <= 0 || sfInfo.samplerate <= 0 || sfInfo.frames < 0) {
         sf_close(file);
         throw std::runtime_error("Invalid audio metadata in file: " + path);
     }
 
-    const int frames = static_cast<int>(info.frames);
-    std::vector<float> interleaved(static_cast<size_t>(frames) * info.channels);
-    sf_count_t readFrames = sf_readf_float(file, interleaved.data(), frames);
-    sf_close(file);
+    impl_->file = file;
+    impl_->info.sampleRate = sfInfo.samplerate;
+    impl_->info.channels = sfInfo.channels;
+    impl_->info.frames = static_cast<uint64_t>(sfInfo.frames);
+    impl_->buffer->resize(impl_->blockFrames * static_cast<size_t>(sfInfo.channels));
+}
+
+AudioStreamReader::~AudioStreamReader() {
+    if (impl_ && impl_->file) {
+        sf_close(impl_->file);
+    }
+}
+
+const AudioStreamInfo& AudioStreamReader::info() const { return impl_->info; }
+
+float AudioStreamReader::peak() const { return impl_->peak; }
+
+const PcmView* AudioStreamReader::pcmView() const {
+    return impl_->mapped ? &impl_->mapped->view() : nullptr;
+}
+
+uint64_t AudioStreamReader::position() const { return impl_->framesRead; }
 
-    if (readFrames != frames) {
-        throw std::runtime_error("Short read from file: " + path);
+void AudioStreamReader::seek(uint64_t frame) {
+    Impl& s = *impl_;
+    frame = std::min(frame, s.info.frames);
+    if (s.file && sf_seek(s.file, static_cast<sf_count_t>(frame), SEEK_SET) < 0) {
+        throw std::runtime_error("Failed to seek in file: " + s.path);
     }
+    s.framesRead = frame;
+}
+
+size_t AudioStreamReader::readInterleaved(const float*& frames, size_t maxFrames) {
+    DJT_PROFILE_SCOPE("decode");
+    Impl& s = *impl_;
+    const uint64_t remaining = s.info.frames - s.framesRead;
+    const size_t want = static_cast<size_t>(std::min<uint64_t>({remaining, s.blockFrames, maxFrames}));
+    if (want == 0) return 0;
 
-    // Convert to mono by averaging channels if needed.
-    std::vector<float> mono(static_cast<size_t>(frames));
-    if (info.channels == 1) {
-        mono = std::move(interleaved);
+    float* data = s.buffer->data();
+    if (s.mapped) {
+        convertPcmToFloat(s.mapped->view(), s.framesRead, want, data);
     } else {
-        for (int i = 0; i < frames; ++i) {
-            float sum = 0.0f;
-            for (int ch = 0; ch < info.channels; ++ch) {
-                sum += interleaved[static_cast<size_t>(i) * info.channels + ch];
-            }
-            mono[static_cast<size_t>(i)] = sum / static_cast<float>(info.channels);
+        sf_count_t got = sf_readf_float(s.file, data, static_cast<sf_count_t>(want));
+        if (got != static_cast<sf_count_t>(want)) {
+            throw std::runtime_error("Short read from file: " + s.path);
         }
     }
+    s.framesRead += want;
+    DJT_PROFILE_COUNT(DecodedFrames, want);
+    DJT_PROFILE_COUNT(DecodedBytes, want * static_cast<uint64_t>(s.info.channels) * sizeof(float));
+    frames = data;
+    return want;
+}
 
-    // Normalize to -0.99..0.99 peak to avoid clipping; preserves silence.
-    float maxAbs = computeMaxAbs(mono);
-    if (maxAbs > 0.000001f) {
-        const float targetPeak = 0.99f;
-        if (maxAbs > targetPeak) {
-            const float gain = targetPeak / maxAbs;
-            for (float& v : mono) {
-                v *= gain;
-            }
-        }
+size_t AudioStreamReader::readBlock(const float*& mono, size_t maxFrames) {
+    const float* frames = nullptr;
+    const size_t count = readInterleaved(frames, maxFrames);
+    if (count == 0) return 0;
+
+    // Convert to mono by averaging channels, in place, and track the peak in the same pass.
+    Impl& s = *impl_;
+    float* data = s.buffer->data();
+    s.peak = std::max(s.peak, downmixToMonoPeak(data, count, s.info.channels, data));
+    mono = data;
+    return count;
+}
+
+AudioStreamInfo streamAudioFile(const std::string& path,
+                                const AudioBlockCallback& onBlock,
+                                float* peakOut,
+                                size_t blockFrames) {
+    AudioStreamReader reader(path, blockFrames);
+    const float* block = nullptr;
+    while (size_t frames = reader.readBlock(block)) {
+        onBlock(block, frames);
+    }
+    if (peakOut) *peakOut = reader.peak();
+    return reader.info();
+}
+
+float normalizationGain(float peak) {
+    if (peak > 0.000001f && peak > kTargetPeak) {
+        return kTargetPeak / peak;
+    }
+    return 1.0f;
+}
+
+AudioData loadAudioFile(const std::string& path) {
+    DJT_PROFILE_SCOPE("loadAudioFile");
+    AudioStreamReader reader(path);
+
+    std::vector<float> mono;
+    mono.reserve(static_cast<size_t>(reader.info().frames));
+    const float* block = nullptr;
+    while (size_t frames = reader.readBlock(block)) {
+        mono.insert(mono.end(), block, block + frames);
+    }
+
+    const float gain = normalizationGain(reader.peak());
+    if (gain != 1.0f) {
+        scaleInPlace(mono.data(), mono.size(), gain);
     }
 
     AudioData out;
     out.samples = std::move(mono);
-    out.sampleRate = info.samplerate;
-    out.channels = info.channels;
+    out.sampleRate = reader.info().sampleRate;
+    out.channels = reader.info().channels;
     return out;
 }
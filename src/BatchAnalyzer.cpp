@@ -0,0 +1,108 @@
+#include "BatchAnalyzer.hpp"
+
+#include "AnalysisCache.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+bool hasAudioExtension(const fs::path& path) {
+    static const std::array<const char*, 7> extensions = {
+        ".wav", ".wave", ".aif", ".aiff", ".flac", ".ogg", ".mp3"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+void appendListFile(const fs::path& listPath, std::vector<std::string>& out) {
+    std::ifstream in(listPath);
+    if (!in) {
+        throw std::runtime_error("Failed to read track list: " + listPath.string());
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        // Relative entries are relative to the list file, as in M3U playlists.
+        fs::path entry(line);
+        if (entry.is_relative()) entry = listPath.parent_path() / entry;
+        out.push_back(entry.string());
+    }
+}
+} // namespace
+
+std::vector<std::string> collectTrackPaths(const std::vector<std::string>& inputs) {
+    std::vector<std::string> paths;
+    for (const auto& input : inputs) {
+        const fs::path path(input);
+        if (fs::is_directory(path)) {
+            std::vector<std::string> found;
+            for (const auto& entry : fs::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file() && hasAudioExtension(entry.path())) {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end()); // directory order is unspecified
+            paths.insert(paths.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(path)) {
+            if (hasAudioExtension(path)) {
+                paths.push_back(input);
+            } else {
+                appendListFile(path, paths);
+            }
+        } else {
+            throw std::runtime_error("No such file or directory: " + input);
+        }
+    }
+    return paths;
+}
+
+size_t analyzeBatch(const std::vector<std::string>& paths,
+                    const BatchOptions& options,
+                    const std::function<void(const BatchResult&)>& onResult) {
+    ThreadPool pool(options.jobs);
+    const size_t maxInFlight = options.maxInFlight > 0 ? options.maxInFlight : 2 * pool.size();
+
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    size_t inFlight = 0;
+    size_t failures = 0;
+
+    for (const auto& path : paths) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFreed.wait(lock, [&] { return inFlight < maxInFlight; });
+            ++inFlight;
+        }
+        pool.submit([&, path] {
+            BatchResult result;
+            result.path = path;
+            // Each worker keeps its scratch buffers and FFT plans from one track to the next.
+            thread_local AnalysisWorkspace workspace;
+            try {
+                result.analysis =
+                    analyzeTrackCached(options.cache, path, options.windowSeconds, &result.info, &workspace);
+            } catch (const std::exception& ex) {
+                result.error = ex.what();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            --inFlight;
+            slotFreed.notify_one();
+            if (!result.error.empty()) ++failures;
+            onResult(result);
+        });
+    }
+    pool.wait();
+    return failures;
+}
@@ -0,0 +1,179 @@
+#include "BeatTracker.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+// Periods searched around the estimate, as a share of it.
+constexpr double kTempoSlack = 0.01;
+// Coarse period step: small enough to move the last beat by no more than kCoarseDrift beats.
+constexpr double kCoarseDrift = 0.25;
+// Fine steps on either side of the best coarse period, each 1/kFineSteps of a coarse step.
+constexpr int kFineSteps = 20;
+// Resolution of the folded beat period.
+constexpr int kPhaseBins = 64;
+
+struct Onset {
+    double beats; // time in periods of the tempo estimate
+    double strength;
+};
+
+// Positive frame energy differences, as BpmAccumulator's novelty curve, at the time of the hop
+// they rise into, in periods of `estimate`. A span's first frame has nothing before it and is
+// left out, so the start of a span is not taken for an onset.
+std::vector<Onset> onsetsOf(const std::vector<OnsetSpan>& spans, double estimate) {
+    size_t hops = 0;
+    for (const OnsetSpan& span : spans) hops += span.hopEnergies.size();
+    std::vector<Onset> onsets;
+    onsets.reserve(hops);
+    for (const OnsetSpan& span : spans) {
+        const std::vector<double>& energies = span.hopEnergies;
+        for (size_t h = 2; h < energies.size(); ++h) {
+            const double diff = energies[h] - energies[h - 2];
+            const double seconds = span.startSeconds + static_cast<double>(h) * span.hopSeconds;
+            if (diff > 0.0) onsets.push_back({seconds / estimate, diff});
+        }
+    }
+    return onsets;
+}
+
+struct Fold {
+    double phase = 0.0; // share of the period, in [0, 1)
+    double strength = -1.0;
+};
+
+// Onsets folded onto one period of `scale` times the estimate and smoothed over neighbouring
+// bins: the strongest phase, refined between bins.
+Fold foldOnsets(const std::vector<Onset>& onsets, double scale) {
+    const double rate = 1.0 / scale;
+    std::array<double, kPhaseBins> bins{};
+    for (const Onset& onset : onsets) {
+        const double turns = onset.beats * rate;
+        const double position = (turns - std::floor(turns)) * kPhaseBins;
+        const int bin = std::min(static_cast<int>(position), kPhaseBins - 1);
+        const double frac = position - bin;
+        bins[static_cast<size_t>(bin)] += onset.strength * (1.0 - frac);
+        bins[static_cast<size_t>((bin + 1) % kPhaseBins)] += onset.strength * frac;
+    }
+
+    auto smoothed = [&](int bin) {
+        const int b = (bin + kPhaseBins) % kPhaseBins;
+        return bins[static_cast<size_t>((b + kPhaseBins - 1) % kPhaseBins)] + 2.0 * bins[static_cast<size_t>(b)] +
+               bins[static_cast<size_t>((b + 1) % kPhaseBins)];
+    };
+    int best = 0;
+    double bestStrength = smoothed(0);
+    for (int bin = 1; bin < kPhaseBins; ++bin) {
+        const double strength = smoothed(bin);
+        if (strength > bestStrength) {
+            bestStrength = strength;
+            best = bin;
+        }
+    }
+    const double left = smoothed(best - 1);
+    const double right = smoothed(best + 1);
+    const double curvature = left - 2.0 * bestStrength + right;
+    const double offset = curvature < 0.0 ? 0.5 * (left - right) / curvature : 0.0;
+
+    Fold fold;
+    fold.strength = bestStrength;
+    fold.phase = (static_cast<double>(best) + offset) / kPhaseBins;
+    fold.phase -= std::floor(fold.phase);
+    if (fold.phase >= 1.0) fold.phase = 0.0;
+    return fold;
+}
+
+// Best period scale over `steps` steps either side of `centre`, ties going to the first.
+double bestScale(const std::vector<Onset>& onsets, double centre, double step, int steps) {
+    double best = centre;
+    double bestStrength = -1.0;
+    for (int k = -steps; k <= steps; ++k) {
+        const double scale = centre + k * step;
+        const double strength = foldOnsets(onsets, scale).strength;
+        if (strength > bestStrength) {
+            bestStrength = strength;
+            best = scale;
+        }
+    }
+    return best;
+}
+
+// Bar phase whose bars differ most in log energy from one to the next. Bars missing a beat's
+// energy (outside every span) break the chain.
+size_t findDownbeat(const std::vector<OnsetSpan>& spans, const BeatGrid& grid) {
+    std::vector<double> sums(grid.beats, 0.0);
+    std::vector<size_t> counts(grid.beats, 0);
+    for (const OnsetSpan& span : spans) {
+        for (size_t h = 0; h < span.hopEnergies.size(); ++h) {
+            const double centre = span.startSeconds + (static_cast<double>(h) + 0.5) * span.hopSeconds;
+            const double beat = std::floor((centre - grid.firstBeat) / grid.beatSeconds);
+            if (beat < 0.0 || beat >= static_cast<double>(grid.beats)) continue;
+            sums[static_cast<size_t>(beat)] += span.hopEnergies[h];
+            ++counts[static_cast<size_t>(beat)];
+        }
+    }
+    double loudest = 0.0;
+    for (size_t k = 0; k < grid.beats; ++k) {
+        if (counts[k] > 0) loudest = std::max(loudest, sums[k] / static_cast<double>(counts[k]));
+    }
+    if (!(loudest > 0.0)) return 0;
+    const double floor = 1e-10 * loudest; // keeps silence finite
+
+    size_t best = 0;
+    double bestChange = -1.0;
+    for (size_t phase = 0; phase < BeatGrid::kBeatsPerBar; ++phase) {
+        double change = 0.0;
+        double previous = std::numeric_limits<double>::quiet_NaN();
+        for (size_t first = phase; first + BeatGrid::kBeatsPerBar <= grid.beats; first += BeatGrid::kBeatsPerBar) {
+            double sum = 0.0;
+            size_t count = 0;
+            bool complete = true;
+            for (size_t k = first; k < first + BeatGrid::kBeatsPerBar; ++k) {
+                complete = complete && counts[k] > 0;
+                sum += sums[k];
+                count += counts[k];
+            }
+            if (!complete) {
+                previous = std::numeric_limits<double>::quiet_NaN();
+                continue;
+            }
+            const double level = std::log(sum / static_cast<double>(count) + floor);
+            if (!std::isnan(previous)) change += (level - previous) * (level - previous);
+            previous = level;
+        }
+        if (change > bestChange) {
+            bestChange = change;
+            best = phase;
+        }
+    }
+    return best;
+}
+} // namespace
+
+BeatGrid fitBeatGrid(const std::vector<OnsetSpan>& spans, double bpm, double durationSeconds) {
+    DJT_PROFILE_SCOPE("beatGrid");
+    BeatGrid grid;
+    if (!(bpm > 0.0) || !(durationSeconds > 0.0)) return grid;
+    const double estimate = 60.0 / bpm;
+    const std::vector<Onset> onsets = onsetsOf(spans, estimate);
+    if (onsets.empty()) return grid;
+
+    const double coarse = std::min(kTempoSlack, kCoarseDrift / std::max(1.0, durationSeconds / estimate));
+    const int coarseSteps = static_cast<int>(std::ceil(kTempoSlack / coarse));
+    const double scale = bestScale(onsets, bestScale(onsets, 1.0, coarse, coarseSteps), coarse / kFineSteps, kFineSteps);
+    const double period = estimate * scale;
+
+    grid.beatSeconds = period;
+    grid.firstBeat = foldOnsets(onsets, scale).phase * period;
+    if (grid.firstBeat < durationSeconds) {
+        grid.beats = static_cast<size_t>(std::ceil((durationSeconds - grid.firstBeat) / period));
+    }
+    if (grid.empty()) return BeatGrid{};
+    grid.downbeat = findDownbeat(spans, grid);
+    return grid;
+}
@@ -1,83 +1,195 @@
 #include "BpmAnalyzer.hpp"
 
+#include "Fft.hpp"
+#include "Profiler.hpp"
+#include "SegmentedAnalysis.hpp"
+#include "SimdKernels.hpp"
+
 #include <algorithm>
 #include <cmath>
+#include <complex>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace {
-// Build a simple energy-based novelty curve using half-wave rectified energy differences.
-std::vector<double> computeNovelty(const AudioData& audio, int frameSize, int hopSize) {
-    const size_t totalSamples = audio.samples.size();
-    if (totalSamples < static_cast<size_t>(frameSize)) return {};
-
-    std::vector<double> novelty;
-    double prevEnergy = 0.0;
-    for (size_t start = 0; start + frameSize <= totalSamples; start += hopSize) {
-        double energy = 0.0;
-        for (int i = 0; i < frameSize; ++i) {
-            float v = audio.samples[start + static_cast<size_t>(i)];
-            energy += static_cast<double>(v) * static_cast<double>(v);
-        }
-        double diff = energy - prevEnergy;
-        novelty.push_back(diff > 0.0 ? diff : 0.0);
-        prevEnergy = energy;
-    }
+size_t nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Linear autocorrelation of `novelty` (made zero-mean) via the power spectrum. `plan` must be at
+// least twice the curve length so the circular correlation equals the linear one. Leaves the
+// result for lags [0, n) at the start of `padded`.
+void autocorrelate(const std::vector<double>& novelty, const FftPlan& plan, std::vector<double>& padded,
+                   std::vector<std::complex<double>>& spectrum) {
+    const size_t n = novelty.size();
 
     // Normalize novelty to zero-mean to help autocorrelation.
-    if (!novelty.empty()) {
-        double mean = 0.0;
-        for (double v : novelty) mean += v;
-        mean /= static_cast<double>(novelty.size());
-        for (double& v : novelty) v -= mean;
-    }
-    return novelty;
-}
+    double mean = 0.0;
+    for (double v : novelty) mean += v;
+    mean /= static_cast<double>(n);
 
-double autocorrelationAtLag(const std::vector<double>& x, size_t lag) {
-    double sum = 0.0;
-    const size_t N = x.size();
-    for (size_t i = 0; i + lag < N; ++i) {
-        sum += x[i] * x[i + lag];
-    }
-    return sum;
+    padded.assign(plan.size(), 0.0);
+    for (size_t i = 0; i < n; ++i) padded[i] = novelty[i] - mean;
+
+    spectrum.resize(plan.binCount());
+    plan.forward(padded.data(), spectrum.data());
+    for (auto& bin : spectrum) bin = std::norm(bin);
+    plan.inverse(spectrum.data(), padded.data());
 }
 } // namespace
 
-double estimateBPM(const AudioData& audio, double minBpm, double maxBpm) {
-    if (audio.sampleRate <= 0 || audio.samples.empty()) return 0.0;
+double bestBpmFromAutocorrelation(const double* autocorr, size_t size, double hopSeconds, double minBpm,
+                                  double maxBpm) {
+    if (size < 4) return 0.0;
     if (minBpm <= 0.0 || maxBpm <= 0.0 || minBpm >= maxBpm) return 0.0;
 
-    // Parameters: short frame for onset sensitivity, overlap hop.
-    const int frameSize = 1024;
-    const int hopSize = 512;
-
-    auto novelty = computeNovelty(audio, frameSize, hopSize);
-    if (novelty.size() < 4) return 0.0;
-
     // Convert BPM bounds to lag bounds in novelty frames.
-    const double hopSeconds = static_cast<double>(hopSize) / static_cast<double>(audio.sampleRate);
     const double minPeriod = 60.0 / maxBpm; // shortest period corresponds to max BPM
     const double maxPeriod = 60.0 / minBpm; // longest period corresponds to min BPM
 
     size_t minLag = static_cast<size_t>(std::max(1.0, std::floor(minPeriod / hopSeconds)));
     size_t maxLag = static_cast<size_t>(std::ceil(maxPeriod / hopSeconds));
-    if (maxLag >= novelty.size()) {
-        maxLag = novelty.size() - 1;
+    if (maxLag >= size) {
+        maxLag = size - 1;
     }
     if (minLag >= maxLag) return 0.0;
 
     double bestScore = -1e18;
     size_t bestLag = minLag;
     for (size_t lag = minLag; lag <= maxLag; ++lag) {
-        double score = autocorrelationAtLag(novelty, lag);
-        if (score > bestScore) {
-            bestScore = score;
+        if (autocorr[lag] > bestScore) {
+            bestScore = autocorr[lag];
             bestLag = lag;
         }
     }
 
-    double periodSeconds = static_cast<double>(bestLag) * hopSeconds;
+    // Fit a parabola through the peak and its neighbours so the period is not quantized to
+    // the hop size; stay within half a lag of the integer peak.
+    double refinedLag = static_cast<double>(bestLag);
+    if (bestLag + 1 < size) {
+        const double left = autocorr[bestLag - 1];
+        const double right = autocorr[bestLag + 1];
+        const double curvature = left - 2.0 * bestScore + right;
+        if (curvature < 0.0) {
+            double offset = 0.5 * (left - right) / curvature;
+            refinedLag += std::max(-0.5, std::min(0.5, offset));
+        }
+    }
+
+    double periodSeconds = refinedLag * hopSeconds;
     if (periodSeconds <= 0.0) return 0.0;
     double bpm = 60.0 / periodSeconds;
     return bpm;
 }
+
+TempoSpectrum::TempoSpectrum(const std::vector<double>& novelty, double hopSeconds)
+    : hopSeconds_(hopSeconds) {
+    DJT_PROFILE_SCOPE("autocorrelation");
+    const size_t n = novelty.size();
+    if (n < 2 || hopSeconds <= 0.0) return;
+
+    const FftPlan plan(nextPowerOfTwo(2 * n));
+    std::vector<double> padded;
+    std::vector<std::complex<double>> spectrum;
+    autocorrelate(novelty, plan, padded, spectrum);
+    autocorr_.assign(padded.begin(), padded.begin() + static_cast<std::ptrdiff_t>(n));
+}
+
+double TempoSpectrum::bestBpm(double minBpm, double maxBpm) const {
+    return bestBpmFromAutocorrelation(autocorr_.data(), autocorr_.size(), hopSeconds_, minBpm, maxBpm);
+}
+
+BpmAccumulator::BpmAccumulator(int sampleRate, AnalysisWorkspace* workspace)
+    : sampleRate_(sampleRate),
+      ownWorkspace_(workspace ? nullptr : std::make_unique<AnalysisWorkspace>()),
+      ws_(workspace ? *workspace : *ownWorkspace_) {
+    ws_.hopEnergies.clear();
+}
+
+void BpmAccumulator::reserve(uint64_t totalSamples) {
+    ws_.hopEnergies.reserve(static_cast<size_t>(totalSamples / kHopSize));
+}
+
+void BpmAccumulator::push(const float* samples, size_t count) {
+    DJT_PROFILE_SCOPE("novelty");
+    while (count > 0) {
+        const size_t take = std::min(count, kHopSize - hopFill_);
+        hopEnergy_ += sumOfSquares(samples, take);
+        hopFill_ += take;
+        samples += take;
+        count -= take;
+        if (hopFill_ < kHopSize) break;
+
+        ws_.hopEnergies.push_back(hopEnergy_);
+        hopEnergy_ = 0.0;
+        hopFill_ = 0;
+    }
+}
+
+void BpmAccumulator::append(const BpmAccumulator& next) {
+    if (hopFill_ != 0) {
+        throw std::invalid_argument("BpmAccumulator::append: not on a hop boundary");
+    }
+    ws_.hopEnergies.insert(ws_.hopEnergies.end(), next.ws_.hopEnergies.begin(), next.ws_.hopEnergies.end());
+    hopEnergy_ = next.hopEnergy_;
+    hopFill_ = next.hopFill_;
+}
+
+void BpmAccumulator::keepRecent(size_t hops) {
+    std::vector<double>& energies = ws_.hopEnergies;
+    if (energies.size() <= hops) return;
+    energies.erase(energies.begin(), energies.end() - static_cast<std::ptrdiff_t>(hops));
+}
+
+// Build a simple energy-based novelty curve using half-wave rectified energy differences of
+// frames of two hops.
+const std::vector<double>& BpmAccumulator::novelty() const {
+    const std::vector<double>& hops = ws_.hopEnergies;
+    ws_.novelty.clear();
+    double prevFrameEnergy = 0.0;
+    for (size_t h = 1; h < hops.size(); ++h) {
+        const double energy = hops[h - 1] + hops[h];
+        const double diff = energy - prevFrameEnergy;
+        ws_.novelty.push_back(diff > 0.0 ? diff : 0.0);
+        prevFrameEnergy = energy;
+    }
+    return ws_.novelty;
+}
+
+OnsetSpan BpmAccumulator::onsets(double startSeconds) const {
+    OnsetSpan span;
+    span.startSeconds = startSeconds;
+    if (sampleRate_ > 0) span.hopSeconds = static_cast<double>(kHopSize) / static_cast<double>(sampleRate_);
+    span.hopEnergies = ws_.hopEnergies;
+    return span;
+}
+
+TempoSpectrum BpmAccumulator::tempoSpectrum() const {
+    if (sampleRate_ <= 0) return {};
+    return TempoSpectrum(novelty(), static_cast<double>(kHopSize) / static_cast<double>(sampleRate_));
+}
+
+double BpmAccumulator::estimate(double minBpm, double maxBpm) const {
+    DJT_PROFILE_SCOPE("autocorrelation");
+    const std::vector<double>& curve = novelty();
+    const size_t n = curve.size();
+    if (n < 4 || sampleRate_ <= 0) return 0.0;
+    // Same as tempoSpectrum().bestBpm() but in the workspace buffers.
+    autocorrelate(curve, ws_.fftPlan(nextPowerOfTwo(2 * n)), ws_.tempoPadded, ws_.tempoBins);
+    return bestBpmFromAutocorrelation(ws_.tempoPadded.data(), n,
+                                      static_cast<double>(kHopSize) / static_cast<double>(sampleRate_), minBpm,
+                                      maxBpm);
+}
+
+double estimateBPM(const AudioData& audio, double minBpm, double maxBpm, AnalysisWorkspace* workspace,
+                   ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("estimateBPM");
+    if (audio.sampleRate <= 0 || audio.samples.empty()) return 0.0;
+
+    SegmentedAnalysis analysis(audio.sampleRate, 0.0, kAnalyzeBpm, workspace, pool);
+    analysis.analyze(audio.samples.data(), audio.samples.size());
+    return analysis.bpm(minBpm, maxBpm);
+}
@@ -0,0 +1,549 @@
+#include "CandidateIndex.hpp"
+
+#include "FileUtils.hpp"
+#include "Profiler.hpp"
+#include "SimdKernels.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// Vector layout: tempo harmonics (cos, sin), chroma, intro/outro level and slope, the coordinate
+// that brings indexed vectors to one length, and padding.
+constexpr size_t kTempoHarmonics = 4;
+constexpr size_t kChromaAt = 2 * kTempoHarmonics;
+constexpr size_t kEnergyAt = kChromaAt + 12;
+constexpr size_t kLengthAt = kEnergyAt + 2;
+constexpr size_t kDims = 24;
+
+// Score points each term is worth, as in transitionScore(): tempo 4, key 3 and energy 3, 0.6 of
+// it on levels and 0.4 on slopes. Chroma similarity runs from -1 to 1, so it gets half of 3.
+constexpr double kTempoWeight = 4.0;
+constexpr double kChromaWeight = 1.5;
+constexpr double kLevelWeight = 1.8;
+constexpr double kSlopeWeight = 1.2;
+
+// Batches take at most this fraction of the nodes already linked, so most of a node's
+// neighbours are in the graph it searches.
+constexpr size_t kBatchShare = 16;
+constexpr size_t kDefaultBeam = 64;
+constexpr size_t kMinShortlist = 64;
+constexpr int kMaxLevel = 31;
+
+constexpr char kIndexMagic[8] = {'D', 'J', 'T', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t kIndexFormat = 2;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t dims;
+    uint64_t count;
+    uint32_t neighbors;
+    int32_t topLevel;
+    uint32_t entry;
+    uint32_t reserved;
+    uint64_t upperLinks;
+    uint64_t source; // TrackStore::identity() of the indexed store
+};
+
+uint64_t mixBits(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+// Tempo and chroma, the coordinates both sides of a transition share; energy is left at 0.
+void embedCommon(const TrackFingerprint& track, float* v) {
+    std::fill(v, v + kDims, 0.0f);
+    if (track.bpm > 0.0) {
+        // Harmonic k weighted (K + 1 - k): the tempo kernel peaks at equal tempos (mod octaves)
+        // and falls off within about a tenth of an octave.
+        const double angle = 2.0 * kPi * std::log2(track.bpm);
+        const double total = static_cast<double>(kTempoHarmonics * (kTempoHarmonics + 1) / 2);
+        for (size_t k = 1; k <= kTempoHarmonics; ++k) {
+            const double w = std::sqrt(kTempoWeight * static_cast<double>(kTempoHarmonics + 1 - k) / total);
+            v[2 * (k - 1)] = static_cast<float>(w * std::cos(static_cast<double>(k) * angle));
+            v[2 * (k - 1) + 1] = static_cast<float>(w * std::sin(static_cast<double>(k) * angle));
+        }
+    }
+    double mean = 0.0;
+    for (double c : track.chroma) mean += c / 12.0;
+    double norm = 0.0;
+    for (double c : track.chroma) norm += (c - mean) * (c - mean);
+    norm = std::sqrt(norm);
+    if (norm > 1e-9) {
+        for (size_t pc = 0; pc < 12; ++pc) {
+            v[kChromaAt + pc] = static_cast<float>(std::sqrt(kChromaWeight) * (track.chroma[pc] - mean) / norm);
+        }
+    }
+}
+
+// The track as the one mixed into.
+void embedEntry(const TrackFingerprint& track, float* v) {
+    embedCommon(track, v);
+    v[kEnergyAt] = static_cast<float>(std::sqrt(kLevelWeight) * track.introLevel);
+    v[kEnergyAt + 1] = static_cast<float>(std::sqrt(kSlopeWeight) * track.introRise);
+}
+
+// The track as the one mixed out of.
+void embedExit(const TrackFingerprint& track, float* v) {
+    embedCommon(track, v);
+    v[kEnergyAt] = static_cast<float>(std::sqrt(kLevelWeight) * track.outroLow);
+    v[kEnergyAt + 1] = static_cast<float>(std::sqrt(kSlopeWeight) * track.outroDrop);
+}
+
+// Intro and outro statistics of a curve whose window i has normalized level norm(i) (NaN if not
+// decoded); slopes as TransitionProfile takes them, from the previous window.
+template <typename Norm>
+void fillEdges(TrackFingerprint& track, size_t windows, double windowSeconds, Norm norm) {
+    if (windows == 0 || !(windowSeconds > 0.0)) return;
+    const size_t edge =
+        std::min(windows, std::max<size_t>(1, static_cast<size_t>(std::lround(kFingerprintEdgeSeconds / windowSeconds))));
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < edge; ++i) {
+        const double level = norm(i);
+        if (std::isnan(level)) continue;
+        sum += level;
+        ++count;
+        if (i > 0 && !std::isnan(norm(i - 1))) track.introRise = std::max(track.introRise, level - norm(i - 1));
+    }
+    track.introLevel = count > 0 ? sum / static_cast<double>(count) : 0.0;
+
+    sum = 0.0;
+    count = 0;
+    for (size_t i = windows - edge; i < windows; ++i) {
+        const double level = norm(i);
+        if (std::isnan(level)) continue;
+        sum += 1.0 - level;
+        ++count;
+        if (i > 0 && !std::isnan(norm(i - 1))) track.outroDrop = std::max(track.outroDrop, norm(i - 1) - level);
+    }
+    track.outroLow = count > 0 ? sum / static_cast<double>(count) : 0.0;
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    writeBytes(out, values.data(), values.size() * sizeof(T));
+}
+
+template <typename T>
+bool readArray(std::ifstream& in, std::vector<T>& values, size_t count) {
+    values.resize(count);
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T))));
+}
+} // namespace
+
+TrackFingerprint makeFingerprint(const TrackAnalysis& analysis) {
+    TrackFingerprint track;
+    track.bpm = analysis.bpm;
+    track.chroma = analysis.chroma;
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -lo;
+    for (double rms : analysis.energyCurve) {
+        if (std::isnan(rms)) continue;
+        lo = std::min(lo, rms);
+        hi = std::max(hi, rms);
+    }
+    // Normalized as TransitionProfile does: a flat curve is 0 throughout.
+    const double range = hi - lo >= 1e-12 ? hi - lo : 0.0;
+    const std::vector<double>& curve = analysis.energyCurve;
+    fillEdges(track, curve.size(), analysis.windowSeconds, [&](size_t i) {
+        return std::isnan(curve[i]) ? curve[i] : range > 0.0 ? (curve[i] - lo) / range : 0.0;
+    });
+    return track;
+}
+
+TrackFingerprint makeFingerprint(const TrackView& view) {
+    TrackFingerprint track;
+    track.bpm = view.bpm;
+    track.chroma = view.chroma();
+    fillEdges(track, view.windows, view.windowSeconds, [&](size_t i) { return view.normalizedEnergy(i); });
+    return track;
+}
+
+struct CandidateIndex::Scored {
+    float distance; // negative dot product: smaller is nearer
+    uint32_t node;
+
+    bool operator<(const Scored& other) const {
+        return distance < other.distance || (distance == other.distance && node < other.node);
+    }
+    bool operator>(const Scored& other) const { return other < *this; }
+};
+
+// Nodes one search has reached: a mark per node, cleared by moving to the next epoch.
+class CandidateIndex::Visited {
+public:
+    void reset(size_t nodes) {
+        if (marks_.size() < nodes) {
+            marks_.assign(nodes, 0);
+            epoch_ = 0;
+        }
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    // False if `node` was already reached.
+    bool insert(uint32_t node) {
+        if (marks_[node] == epoch_) return false;
+        marks_[node] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks_;
+    uint32_t epoch_ = 0;
+};
+
+const float* CandidateIndex::vector(uint32_t node) const { return vectors_.data() + static_cast<size_t>(node) * kDims; }
+
+uint32_t* CandidateIndex::links(uint32_t node, int level) {
+    return const_cast<uint32_t*>(static_cast<const CandidateIndex&>(*this).links(node, level));
+}
+
+const uint32_t* CandidateIndex::links(uint32_t node, int level) const {
+    if (level == 0) return bottomLinks_.data() + static_cast<size_t>(node) * (capacity(0) + 1);
+    return upperLinks_.data() + upperOffsets_[node] + static_cast<size_t>(level - 1) * (capacity(1) + 1);
+}
+
+float CandidateIndex::distance(const float* query, uint32_t node) const {
+    return -dotProduct(query, vector(node), kDims);
+}
+
+// Greedy walk from the entry point down to the layer above `level`.
+uint32_t CandidateIndex::descend(const float* query, int level) const {
+    uint32_t current = entry_;
+    Scored best{distance(query, current), current};
+    for (int l = topLevel_; l > level; --l) {
+        for (bool moved = true; moved;) {
+            moved = false;
+            const uint32_t* list = links(best.node, l);
+            for (uint32_t j = 1; j <= list[0]; ++j) {
+                const Scored next{distance(query, list[j]), list[j]};
+                if (next < best) {
+                    best = next;
+                    moved = true;
+                }
+            }
+        }
+    }
+    return best.node;
+}
+
+// The `beam` nodes nearest to `query` on layer `level` that a best-first search from `entry`
+// finds, nearest first.
+std::vector<CandidateIndex::Scored> CandidateIndex::searchLayer(const float* query, uint32_t entry, size_t beam,
+                                                                int level, Visited& visited) const {
+    visited.reset(count_);
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> frontier; // nearest on top
+    std::priority_queue<Scored> nearest;                                             // farthest on top
+    const Scored start{distance(query, entry), entry};
+    visited.insert(entry);
+    frontier.push(start);
+    nearest.push(start);
+    while (!frontier.empty()) {
+        const Scored current = frontier.top();
+        if (nearest.size() >= beam && nearest.top() < current) break;
+        frontier.pop();
+        const uint32_t* list = links(current.node, level);
+        for (uint32_t j = 1; j <= list[0]; ++j) {
+            const uint32_t node = list[j];
+            if (!visited.insert(node)) continue;
+            const Scored next{distance(query, node), node};
+            if (nearest.size() < beam || next < nearest.top()) {
+                frontier.push(next);
+                nearest.push(next);
+                if (nearest.size() > beam) nearest.pop();
+            }
+        }
+    }
+    std::vector<Scored> found(nearest.size());
+    for (size_t i = found.size(); i-- > 0;) {
+        found[i] = nearest.top();
+        nearest.pop();
+    }
+    return found;
+}
+
+// Keep `keep` of `candidates` (nearest first): a candidate nearer to an already kept one than to
+// the base node is skipped, so links spread in all directions; skipped ones fill what is left.
+void CandidateIndex::selectNeighbors(std::vector<Scored>& candidates, size_t keep) const {
+    if (candidates.size() <= keep) return;
+    std::vector<Scored> kept;
+    std::vector<Scored> skipped;
+    for (const Scored& c : candidates) {
+        if (kept.size() >= keep) break;
+        const bool diverse = std::none_of(kept.begin(), kept.end(), [&](const Scored& k) {
+            return distance(vector(c.node), k.node) < c.distance;
+        });
+        (diverse ? kept : skipped).push_back(c);
+    }
+    for (size_t i = 0; i < skipped.size() && kept.size() < keep; ++i) kept.push_back(skipped[i]);
+    candidates = std::move(kept);
+}
+
+CandidateIndex::CandidateIndex(const std::vector<TrackFingerprint>& tracks, const IndexOptions& options)
+    : count_(tracks.size()), neighbors_(options.neighbors), source_(options.source) {
+    DJT_PROFILE_SCOPE("buildCandidateIndex");
+    if (neighbors_ < 2 || neighbors_ > 1024 || options.buildBeam == 0) {
+        throw std::invalid_argument("CandidateIndex: neighbors must be 2-1024 and the build beam positive");
+    }
+    if (count_ > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("CandidateIndex: too many tracks");
+
+    // Entry vectors, then the coordinate that brings them all to the longest one's length: the
+    // nearest neighbour of a query is then the indexed vector with the largest dot product.
+    vectors_.assign(count_ * kDims, 0.0f);
+    float longest = 0.0f;
+    for (size_t i = 0; i < count_; ++i) {
+        float* v = vectors_.data() + i * kDims;
+        embedEntry(tracks[i], v);
+        longest = std::max(longest, dotProduct(v, v, kDims));
+    }
+    for (size_t i = 0; i < count_; ++i) {
+        float* v = vectors_.data() + i * kDims;
+        v[kLengthAt] = std::sqrt(std::max(0.0f, longest - dotProduct(v, v, kDims)));
+    }
+
+    // Layers: P(level >= l) = neighbors^-l, drawn from the seed and the node alone.
+    const double scale = 1.0 / std::log(static_cast<double>(neighbors_));
+    levels_.resize(count_);
+    upperOffsets_.assign(count_ + 1, 0);
+    for (size_t i = 0; i < count_; ++i) {
+        const double uniform = static_cast<double>(mixBits(options.seed * 0x9e3779b97f4a7c15ull + i) >> 11) * 0x1.0p-53;
+        levels_[i] = static_cast<uint8_t>(std::min<double>(kMaxLevel, std::floor(-std::log(1.0 - uniform) * scale)));
+        upperOffsets_[i + 1] = upperOffsets_[i] + levels_[i] * (capacity(1) + 1);
+    }
+    bottomLinks_.assign(count_ * (capacity(0) + 1), 0);
+    upperLinks_.assign(static_cast<size_t>(upperOffsets_[count_]), 0);
+    if (count_ == 0) return;
+    entry_ = 0;
+    topLevel_ = levels_[0];
+
+    ThreadPool pool(options.jobs);
+    struct Link {
+        uint32_t target;
+        int level;
+        uint32_t source;
+        bool operator<(const Link& o) const {
+            if (target != o.target) return target < o.target;
+            return level != o.level ? level < o.level : source < o.source;
+        }
+    };
+    std::vector<Link> reverse;
+    std::vector<size_t> groups;
+    for (size_t done = 1; done < count_;) {
+        const size_t batch = std::min(count_ - done, std::max<size_t>(1, done / kBatchShare));
+        const uint32_t first = static_cast<uint32_t>(done);
+
+        // Links of the new nodes, found in the graph as it stood before the batch.
+        size_t tasks = std::min(batch, pool.size() * 4);
+        for (size_t task = 0; task < tasks; ++task) {
+            pool.submit([&, task] {
+                thread_local Visited visited;
+                for (size_t b = task; b < batch; b += tasks) {
+                    const uint32_t node = first + static_cast<uint32_t>(b);
+                    const float* query = vector(node);
+                    const int top = std::min<int>(levels_[node], topLevel_);
+                    uint32_t entry = descend(query, top);
+                    for (int l = top; l >= 0; --l) {
+                        std::vector<Scored> near = searchLayer(query, entry, options.buildBeam, l, visited);
+                        entry = near.front().node;
+                        selectNeighbors(near, neighbors_);
+                        uint32_t* list = links(node, l);
+                        list[0] = static_cast<uint32_t>(near.size());
+                        for (size_t j = 0; j < near.size(); ++j) list[j + 1] = near[j].node;
+                    }
+                }
+            });
+        }
+        pool.wait();
+
+        // Links back, merged per target list so each list has one writer.
+        reverse.clear();
+        for (uint32_t node = first; node < first + batch; ++node) {
+            for (int l = std::min<int>(levels_[node], topLevel_); l >= 0; --l) {
+                const uint32_t* list = links(node, l);
+                for (uint32_t j = 1; j <= list[0]; ++j) reverse.push_back({list[j], l, node});
+            }
+        }
+        std::sort(reverse.begin(), reverse.end());
+        groups.clear();
+        for (size_t i = 0; i < reverse.size(); ++i) {
+            if (i == 0 || reverse[i].target != reverse[i - 1].target || reverse[i].level != reverse[i - 1].level) {
+                groups.push_back(i);
+            }
+        }
+        groups.push_back(reverse.size());
+        tasks = std::min(groups.size() - 1, pool.size() * 4);
+        for (size_t task = 0; task < tasks; ++task) {
+            pool.submit([&, task] {
+                std::vector<Scored> merged;
+                for (size_t g = task; g + 1 < groups.size(); g += tasks) {
+                    const Link& head = reverse[groups[g]];
+                    uint32_t* list = links(head.target, head.level);
+                    const size_t added = groups[g + 1] - groups[g];
+                    if (list[0] + added <= capacity(head.level)) {
+                        for (size_t i = groups[g]; i < groups[g + 1]; ++i) list[++list[0]] = reverse[i].source;
+                        continue;
+                    }
+                    const float* base = vector(head.target);
+                    merged.clear();
+                    for (uint32_t j = 1; j <= list[0]; ++j) merged.push_back({distance(base, list[j]), list[j]});
+                    for (size_t i = groups[g]; i < groups[g + 1]; ++i) {
+                        merged.push_back({distance(base, reverse[i].source), reverse[i].source});
+                    }
+                    std::sort(merged.begin(), merged.end());
+                    selectNeighbors(merged, capacity(head.level));
+                    list[0] = static_cast<uint32_t>(merged.size());
+                    for (size_t j = 0; j < merged.size(); ++j) list[j + 1] = merged[j].node;
+                }
+            });
+        }
+        pool.wait();
+
+        for (uint32_t node = first; node < first + batch; ++node) {
+            if (levels_[node] > topLevel_) {
+                topLevel_ = levels_[node];
+                entry_ = node;
+            }
+        }
+        done += batch;
+    }
+}
+
+std::vector<IndexMatch> CandidateIndex::search(const TrackFingerprint& from, size_t k, size_t beam,
+                                               size_t exclude) const {
+    DJT_PROFILE_SCOPE("candidateSearch");
+    std::vector<IndexMatch> matches;
+    if (k == 0 || count_ == 0) return matches;
+    float query[kDims];
+    embedExit(from, query);
+    const size_t wanted = k + (exclude < count_ ? 1 : 0);
+    beam = std::max(beam == 0 ? std::max(k, kDefaultBeam) : beam, wanted);
+
+    thread_local Visited visited;
+    for (const Scored& s : searchLayer(query, descend(query, 0), beam, 0, visited)) {
+        if (s.node == exclude) continue;
+        matches.push_back({s.node, -s.distance});
+        if (matches.size() == k) break;
+    }
+    return matches;
+}
+
+float CandidateIndex::affinity(const TrackFingerprint& from, size_t track) const {
+    float query[kDims];
+    embedExit(from, query);
+    return -distance(query, static_cast<uint32_t>(track));
+}
+
+void CandidateIndex::save(const std::string& path) const {
+    replaceFile(path, "candidate index", [&](std::ofstream& out) {
+        IndexHeader header{};
+        std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+        header.format = kIndexFormat;
+        header.dims = static_cast<uint32_t>(kDims);
+        header.count = count_;
+        header.neighbors = static_cast<uint32_t>(neighbors_);
+        header.topLevel = topLevel_;
+        header.entry = entry_;
+        header.upperLinks = upperLinks_.size();
+        header.source = source_;
+        writeBytes(out, &header, sizeof(header));
+        writeArray(out, vectors_);
+        writeArray(out, levels_);
+        writeArray(out, bottomLinks_);
+        writeArray(out, upperLinks_);
+    });
+}
+
+CandidateIndex::CandidateIndex(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("Failed to open candidate index: " + path);
+    const uint64_t length = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    IndexHeader header{};
+    if (length < sizeof(header) || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        throw std::runtime_error("Not a candidate index: " + path);
+    }
+    if (header.format != kIndexFormat || header.dims != kDims) {
+        throw std::runtime_error("Candidate index from another version, rebuild it: " + path);
+    }
+    // Bound the counts by the file size before allocating anything.
+    if (header.count > length || header.upperLinks > length || header.neighbors < 2 || header.neighbors > 1024) {
+        throw std::runtime_error("Corrupt candidate index: " + path);
+    }
+    count_ = static_cast<size_t>(header.count);
+    neighbors_ = header.neighbors;
+    const uint64_t expected = sizeof(header) + count_ * (kDims * sizeof(float) + 1) +
+                              count_ * (capacity(0) + 1) * sizeof(uint32_t) + header.upperLinks * sizeof(uint32_t);
+    if (expected != length || !readArray(in, vectors_, count_ * kDims) || !readArray(in, levels_, count_) ||
+        !readArray(in, bottomLinks_, count_ * (capacity(0) + 1)) ||
+        !readArray(in, upperLinks_, static_cast<size_t>(header.upperLinks))) {
+        throw std::runtime_error("Corrupt candidate index: " + path);
+    }
+    upperOffsets_.assign(count_ + 1, 0);
+    for (size_t i = 0; i < count_; ++i) upperOffsets_[i + 1] = upperOffsets_[i] + levels_[i] * (capacity(1) + 1);
+    entry_ = header.entry;
+    topLevel_ = header.topLevel;
+    source_ = header.source;
+    bool valid = upperOffsets_[count_] == header.upperLinks &&
+                 (count_ == 0 ? topLevel_ == -1 : entry_ < count_ && topLevel_ == levels_[entry_]);
+    for (uint32_t node = 0; valid && node < count_; ++node) {
+        for (int l = 0; valid && l <= levels_[node]; ++l) {
+            const uint32_t* list = links(node, l);
+            valid = list[0] <= capacity(l) &&
+                    std::all_of(list + 1, list + 1 + list[0], [&](uint32_t j) { return j < count_; });
+        }
+    }
+    if (!valid) throw std::runtime_error("Corrupt candidate index: " + path);
+}
+
+CandidateIndex::CandidateIndex(const std::string& path, const TrackStore& store) : CandidateIndex(path) {
+    if (source_ != store.identity()) {
+        throw std::runtime_error("Candidate index built over another track store, rebuild it: " + path);
+    }
+}
+
+std::vector<NextTrack> suggestNextTracks(const TrackStore& store,
+                                         const CandidateIndex& index,
+                                         size_t from,
+                                         size_t k,
+                                         size_t shortlist) {
+    DJT_PROFILE_SCOPE("suggestNextTracks");
+    if (index.size() != store.size()) {
+        throw std::invalid_argument("suggestNextTracks: the index covers another number of tracks");
+    }
+    if (from >= store.size()) throw std::invalid_argument("suggestNextTracks: track out of range");
+    std::vector<NextTrack> next;
+    if (k == 0) return next;
+
+    const TrackView view = store.track(from);
+    const size_t wanted = shortlist == 0 ? std::max(4 * k, kMinShortlist) : std::max(shortlist, k);
+    const TransitionProfile profile(view);
+    for (const IndexMatch& match : index.search(makeFingerprint(view), wanted, wanted, from)) {
+        next.push_back({match.track, findBestTransition(profile, TransitionProfile(store.track(match.track)))});
+    }
+    // Ties keep the index's order.
+    std::stable_sort(next.begin(), next.end(),
+                     [](const NextTrack& x, const NextTrack& y) { return x.transition.score > y.transition.score; });
+    if (next.size() > k) next.resize(k);
+    return next;
+}
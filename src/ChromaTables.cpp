@@ -0,0 +1,37 @@
+#include "ChromaTables.hpp"
+
+#include <cmath>
+
+namespace {
+template <int SampleRate, size_t FrameSize>
+bool useTable(int sampleRate, size_t frameSize, const ChromaSegment*& segments, size_t& count) {
+    if (sampleRate != SampleRate || frameSize != FrameSize) return false;
+    segments = kChromaTable<SampleRate, FrameSize>.segments.data();
+    count = kChromaTable<SampleRate, FrameSize>.count;
+    return true;
+}
+} // namespace
+
+ChromaFilterbank::ChromaFilterbank(int sampleRate, size_t frameSize) {
+    if (sampleRate <= 0 || frameSize < 2) return;
+    if (useTable<11025, 512>(sampleRate, frameSize, segments_, count_)) return;
+
+    auto table = std::make_shared<std::vector<ChromaSegment>>(frameSize / 2 + 1);
+    table->resize(buildChromaSegments(sampleRate, frameSize, table->data()));
+    segments_ = table->data();
+    count_ = table->size();
+    runtime_ = std::move(table);
+}
+
+void ChromaFilterbank::accumulate(const std::complex<double>* bins, std::array<double, 12>& histogram) const {
+    for (size_t s = 0; s < count_; ++s) {
+        const ChromaSegment& seg = segments_[s];
+        double sum = 0.0;
+        for (uint32_t k = seg.firstBin; k < seg.endBin; ++k) {
+            const double re = bins[k].real();
+            const double im = bins[k].imag();
+            sum += std::sqrt(re * re + im * im);
+        }
+        histogram[seg.pitchClass] += sum;
+    }
+}
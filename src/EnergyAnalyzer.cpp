@@ -1,28 +1,134 @@
 #include "EnergyAnalyzer.hpp"
 
+#include "Profiler.hpp"
+#include "SegmentedAnalysis.hpp"
+#include "SimdKernels.hpp"
+
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
-std::vector<double> computeEnergyCurve(const AudioData& audio, double windowSeconds) {
-    if (audio.sampleRate <= 0 || audio.samples.empty() || windowSeconds <= 0.0) {
-        return {};
+EnergyAccumulator::EnergyAccumulator(int sampleRate, double windowSeconds, AnalysisWorkspace* workspace,
+                                     uint64_t startSample)
+    : ownWorkspace_(workspace ? nullptr : std::make_unique<AnalysisWorkspace>()),
+      ws_(workspace ? *workspace : *ownWorkspace_) {
+    ws_.energyWindows.clear();
+    ws_.energyBlocks.clear();
+    if (sampleRate <= 0 || windowSeconds <= 0.0) return;
+    const long windowSamples = std::lround(windowSeconds * sampleRate);
+    if (windowSamples <= 0) return;
+    windowSamples_ = static_cast<size_t>(windowSamples);
+    sampleRate_ = sampleRate;
+    startSample_ = startSample;
+    position_ = startSample;
+    fill_ = static_cast<size_t>(startSample % windowSamples_);
+    // First block boundary after the start; the estimate is off by at most one block.
+    nextBlock_ = startSample * EnergyIndex::kBlocksPerSecond / static_cast<uint64_t>(sampleRate);
+    while (nextBlock_ > 0 && energyBlockStart(nextBlock_, sampleRate) > startSample) --nextBlock_;
+    while (energyBlockStart(nextBlock_, sampleRate) <= startSample) ++nextBlock_;
+    blockEnd_ = energyBlockStart(nextBlock_, sampleRate);
+}
+
+void EnergyAccumulator::reserve(uint64_t totalSamples) {
+    if (windowSamples_ == 0) return;
+    ws_.energyWindows.reserve(static_cast<size_t>(totalSamples / windowSamples_ + 1));
+    ws_.energyBlocks.reserve(energyBlockCount(totalSamples, sampleRate_));
+}
+
+void EnergyAccumulator::push(const float* samples, size_t count) {
+    DJT_PROFILE_SCOPE("energy");
+    if (windowSamples_ == 0) return;
+    while (count > 0) {
+        // Stop at whichever boundary comes first, so each run is summed once for both.
+        const size_t toBlock = static_cast<size_t>(blockEnd_ - position_);
+        const size_t take = std::min({count, windowSamples_ - fill_, toBlock});
+        const double runSumSq = sumOfSquares(samples, take);
+        sumSq_ += runSumSq;
+        blockSumSq_ += runSumSq;
+        fill_ += take;
+        position_ += take;
+        samples += take;
+        count -= take;
+        if (fill_ == windowSamples_) {
+            ws_.energyWindows.push_back(sumSq_);
+            sumSq_ = 0.0;
+            fill_ = 0;
+        }
+        if (position_ == blockEnd_) {
+            ws_.energyBlocks.push_back(blockSumSq_);
+            blockSumSq_ = 0.0;
+            blockEnd_ = energyBlockStart(++nextBlock_, sampleRate_);
+        }
     }
-    const int windowSamples = static_cast<int>(std::round(windowSeconds * audio.sampleRate));
-    if (windowSamples <= 0) return {};
+}
 
+void EnergyAccumulator::append(const EnergyAccumulator& next) {
+    if (next.startSample_ != position_ || next.sampleRate_ != sampleRate_ ||
+        next.windowSamples_ != windowSamples_) {
+        throw std::invalid_argument("EnergyAccumulator::append: accumulator does not continue this one");
+    }
+    // The open window and block here are the first ones `next` completes, if any.
+    double carry = sumSq_;
+    for (double sum : next.ws_.energyWindows) {
+        ws_.energyWindows.push_back(carry + sum);
+        carry = 0.0;
+    }
+    sumSq_ = carry + next.sumSq_;
+    fill_ = next.fill_;
+
+    carry = blockSumSq_;
+    for (double sum : next.ws_.energyBlocks) {
+        ws_.energyBlocks.push_back(carry + sum);
+        carry = 0.0;
+    }
+    blockSumSq_ = carry + next.blockSumSq_;
+    position_ = next.position_;
+    blockEnd_ = next.blockEnd_;
+    nextBlock_ = next.nextBlock_;
+}
+
+std::vector<double> EnergyAccumulator::finish(double gain) const {
     std::vector<double> curve;
-    const size_t total = audio.samples.size();
-    for (size_t start = 0; start < total; start += static_cast<size_t>(windowSamples)) {
-        size_t end = std::min(total, start + static_cast<size_t>(windowSamples));
-        double sumSq = 0.0;
-        size_t count = end - start;
-        for (size_t i = start; i < end; ++i) {
-            double v = audio.samples[i];
-            sumSq += v * v;
-        }
-        if (count == 0) continue;
-        double rms = std::sqrt(sumSq / static_cast<double>(count));
-        curve.push_back(rms);
+    curve.reserve(ws_.energyWindows.size() + 1);
+    const double windowSamples = static_cast<double>(windowSamples_);
+    for (double sum : ws_.energyWindows) curve.push_back(std::sqrt(sum / windowSamples) * gain);
+    if (fill_ > 0) {
+        curve.push_back(std::sqrt(sumSq_ / static_cast<double>(fill_)) * gain);
     }
     return curve;
 }
+
+EnergyIndex EnergyAccumulator::finishIndex(double gain) const {
+    DJT_PROFILE_SCOPE("energyIndex");
+    if (position_ == 0) return {};
+    std::vector<float> blocks;
+    blocks.reserve(ws_.energyBlocks.size() + 1);
+    const double gainSq = gain * gain;
+    for (double sum : ws_.energyBlocks) blocks.push_back(static_cast<float>(sum * gainSq));
+    if (position_ > energyBlockStart(ws_.energyBlocks.size(), sampleRate_)) {
+        blocks.push_back(static_cast<float>(blockSumSq_ * gainSq));
+    }
+    return EnergyIndex(sampleRate_, position_, std::move(blocks));
+}
+
+std::vector<double> computeEnergyCurve(const AudioData& audio, double windowSeconds, AnalysisWorkspace* workspace,
+                                       ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("computeEnergyCurve");
+    if (audio.sampleRate <= 0 || audio.samples.empty() || windowSeconds <= 0.0) {
+        return {};
+    }
+    SegmentedAnalysis analysis(audio.sampleRate, windowSeconds, kAnalyzeEnergy, workspace, pool);
+    analysis.analyze(audio.samples.data(), audio.samples.size());
+    return analysis.energyCurve();
+}
+
+EnergyIndex computeEnergyIndex(const AudioData& audio, AnalysisWorkspace* workspace, ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("computeEnergyIndex");
+    if (audio.sampleRate <= 0 || audio.samples.empty()) return {};
+    // Any valid window: only the index is used.
+    SegmentedAnalysis analysis(audio.sampleRate, EnergyIndex::kBlockSeconds, kAnalyzeEnergy, workspace, pool);
+    analysis.analyze(audio.samples.data(), audio.samples.size());
+    return analysis.energyIndex();
+}
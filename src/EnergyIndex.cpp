@@ -0,0 +1,102 @@
+#include "EnergyIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+size_t energyBlockCount(uint64_t totalSamples, int sampleRate) {
+    if (sampleRate <= 0 || totalSamples == 0) return 0;
+    // Estimate from the rate, then settle on the first block boundary at or past the end.
+    uint64_t n = totalSamples * EnergyIndex::kBlocksPerSecond / static_cast<uint64_t>(sampleRate);
+    while (energyBlockStart(n, sampleRate) < totalSamples) ++n;
+    while (n > 1 && energyBlockStart(n - 1, sampleRate) >= totalSamples) --n;
+    return static_cast<size_t>(n);
+}
+
+EnergyIndex::EnergyIndex(int sampleRate, uint64_t totalSamples, std::vector<float> blockSums) {
+    if (blockSums.empty() || blockSums.size() != energyBlockCount(totalSamples, sampleRate)) return;
+    sampleRate_ = sampleRate;
+    totalSamples_ = totalSamples;
+    blockSums_ = std::move(blockSums);
+
+    // Kahan summation keeps the running total exact to double precision over long tracks, so a
+    // difference of two prefixes is as accurate as summing the span directly.
+    const size_t n = blockSums_.size();
+    prefix_.resize(n + 1);
+    double sum = 0.0;
+    double compensation = 0.0;
+    prefix_[0] = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        const double y = static_cast<double>(blockSums_[i]) - compensation;
+        const double t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+        prefix_[i + 1] = sum;
+    }
+
+    for (size_t span = 1;; span *= 2) {
+        std::vector<float> values((n + span - 1) / span);
+        for (size_t j = 0; j < values.size(); ++j) {
+            const size_t first = j * span;
+            const size_t last = std::min(n, first + span);
+            const uint64_t end = std::min(energyBlockStart(last, sampleRate), totalSamples);
+            const double samples = static_cast<double>(end - energyBlockStart(first, sampleRate));
+            const double meanSquare = samples > 0.0 ? (prefix_[last] - prefix_[first]) / samples : 0.0;
+            values[j] = static_cast<float>(std::sqrt(meanSquare));
+        }
+        levels_.push_back(std::move(values));
+        if (span >= n) break;
+    }
+}
+
+double EnergyIndex::duration() const {
+    return sampleRate_ > 0 ? static_cast<double>(totalSamples_) / static_cast<double>(sampleRate_) : 0.0;
+}
+
+double EnergyIndex::sumOfSquaresBefore(uint64_t sample) const {
+    if (sample >= totalSamples_) return prefix_.back();
+    // The block holding `sample`, then its share assuming uniform energy within the block.
+    size_t block = static_cast<size_t>(sample * kBlocksPerSecond / static_cast<uint64_t>(sampleRate_));
+    while (block + 1 < blockSums_.size() && energyBlockStart(block + 1, sampleRate_) <= sample) ++block;
+    while (block > 0 && energyBlockStart(block, sampleRate_) > sample) --block;
+    const uint64_t start = energyBlockStart(block, sampleRate_);
+    const uint64_t end = std::min(energyBlockStart(block + 1, sampleRate_), totalSamples_);
+    const double fraction = static_cast<double>(sample - start) / static_cast<double>(end - start);
+    return prefix_[block] + fraction * static_cast<double>(blockSums_[block]);
+}
+
+double EnergyIndex::rms(double t0, double t1) const {
+    if (empty()) return 0.0;
+    const double rate = static_cast<double>(sampleRate_);
+    const double total = static_cast<double>(totalSamples_);
+    const auto a = static_cast<uint64_t>(std::llround(std::clamp(t0 * rate, 0.0, total)));
+    const auto b = static_cast<uint64_t>(std::llround(std::clamp(t1 * rate, 0.0, total)));
+    if (b <= a) return 0.0;
+    const double sumSq = std::max(0.0, sumOfSquaresBefore(b) - sumOfSquaresBefore(a));
+    return std::sqrt(sumSq / static_cast<double>(b - a));
+}
+
+std::vector<double> EnergyIndex::curve(double windowSeconds) const {
+    if (empty() || windowSeconds <= 0.0) return {};
+    const long windowSamples = std::lround(windowSeconds * sampleRate_);
+    if (windowSamples <= 0) return {};
+    const auto window = static_cast<uint64_t>(windowSamples);
+
+    std::vector<double> out;
+    out.reserve(static_cast<size_t>((totalSamples_ + window - 1) / window));
+    double before = 0.0;
+    for (uint64_t start = 0; start < totalSamples_; start += window) {
+        const uint64_t end = std::min(start + window, totalSamples_);
+        const double after = sumOfSquaresBefore(end);
+        out.push_back(std::sqrt(std::max(0.0, after - before) / static_cast<double>(end - start)));
+        before = after;
+    }
+    return out;
+}
+
+size_t EnergyIndex::levelFor(double seconds) const {
+    for (size_t k = 0; k < levels_.size(); ++k) {
+        if (levelSeconds(k) >= seconds) return k;
+    }
+    return levels_.empty() ? 0 : levels_.size() - 1;
+}
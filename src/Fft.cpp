@@ -0,0 +1,119 @@
+#include "Fft.hpp"
+
+#include "Profiler.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+bool isPowerOfTwo(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+} // namespace
+
+FftPlan::FftPlan(size_t size) : size_(size), half_(size / 2) {
+    if (size < 2 || !isPowerOfTwo(size)) {
+        throw std::invalid_argument("FFT size must be a power of two >= 2: " + std::to_string(size));
+    }
+
+    // Bit-reversal permutation for the half-size complex transform.
+    bitReverse_.resize(half_);
+    size_t bits = 0;
+    while ((size_t{1} << bits) < half_) ++bits;
+    for (size_t i = 0; i < half_; ++i) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            if (i & (size_t{1} << b)) r |= size_t{1} << (bits - 1 - b);
+        }
+        bitReverse_[i] = r;
+    }
+
+    twiddles_.resize(half_ / 2);
+    for (size_t k = 0; k < twiddles_.size(); ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(half_);
+        twiddles_[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+
+    realTwiddles_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size_);
+        realTwiddles_[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+}
+
+void FftPlan::forward(const float* input, std::complex<double>* output) const {
+    forwardImpl(input, output);
+}
+
+void FftPlan::forward(const double* input, std::complex<double>* output) const {
+    forwardImpl(input, output);
+}
+
+template <typename T>
+void FftPlan::forwardImpl(const T* input, std::complex<double>* output) const {
+    DJT_PROFILE_COUNT(Ffts, 1);
+    // Pack even/odd samples as one complex sequence of half the length, already bit-reversed.
+    for (size_t n = 0; n < half_; ++n) {
+        const size_t src = 2 * bitReverse_[n];
+        output[n] = std::complex<double>(static_cast<double>(input[src]),
+                                         static_cast<double>(input[src + 1]));
+    }
+    transformHalf(output, false);
+
+    // Split the half-size spectrum into the spectrum of the real input, in place.
+    const std::complex<double> z0 = output[0];
+    output[0] = std::complex<double>(z0.real() + z0.imag(), 0.0);
+    output[half_] = std::complex<double>(z0.real() - z0.imag(), 0.0);
+    const std::complex<double> minusHalfI(0.0, -0.5);
+    for (size_t k = 1; k <= half_ / 2; ++k) {
+        const size_t m = half_ - k;
+        const std::complex<double> zk = output[k];
+        const std::complex<double> zm = output[m];
+        const std::complex<double> even = 0.5 * (zk + std::conj(zm));
+        const std::complex<double> odd = minusHalfI * (zk - std::conj(zm));
+        output[k] = even + realTwiddles_[k] * odd;
+        output[m] = std::conj(even) + realTwiddles_[m] * std::conj(odd);
+    }
+}
+
+void FftPlan::inverse(const std::complex<double>* input, double* output) const {
+    DJT_PROFILE_COUNT(Ffts, 1);
+    // The real output doubles as storage for the half-size complex sequence (even, odd) pairs.
+    auto* z = reinterpret_cast<std::complex<double>*>(output);
+    const std::complex<double> plusI(0.0, 1.0);
+    for (size_t k = 0; k < half_; ++k) {
+        const std::complex<double> xk = input[k];
+        const std::complex<double> xm = std::conj(input[half_ - k]);
+        const std::complex<double> even = 0.5 * (xk + xm);
+        const std::complex<double> odd = 0.5 * (xk - xm) * std::conj(realTwiddles_[k]);
+        z[k] = even + plusI * odd;
+    }
+    for (size_t n = 0; n < half_; ++n) {
+        const size_t r = bitReverse_[n];
+        if (n < r) std::swap(z[n], z[r]);
+    }
+    transformHalf(z, true);
+
+    const double scale = 1.0 / static_cast<double>(half_);
+    for (size_t n = 0; n < size_; ++n) {
+        output[n] *= scale;
+    }
+}
+
+// Iterative radix-2 decimation-in-time butterflies over bit-reversed input.
+void FftPlan::transformHalf(std::complex<double>* data, bool inverse) const {
+    for (size_t len = 2; len <= half_; len <<= 1) {
+        const size_t halfLen = len / 2;
+        const size_t step = half_ / len;
+        for (size_t i = 0; i < half_; i += len) {
+            for (size_t j = 0; j < halfLen; ++j) {
+                std::complex<double> w = twiddles_[j * step];
+                if (inverse) w = std::conj(w);
+                const std::complex<double> u = data[i + j];
+                const std::complex<double> v = data[i + j + halfLen] * w;
+                data[i + j] = u + v;
+                data[i + j + halfLen] = u - v;
+            }
+        }
+    }
+}
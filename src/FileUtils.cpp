@@ -0,0 +1,31 @@
+#include "FileUtils.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+void writeBytes(std::ofstream& out, const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+void replaceFile(const std::string& path, const std::string& what, const std::function<void(std::ofstream&)>& write) {
+    const std::string temp = path + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to create " + what + ": " + temp);
+    try {
+        write(out);
+    } catch (...) {
+        out.close();
+        std::remove(temp.c_str());
+        throw;
+    }
+    out.flush();
+    out.close();
+    if (!out) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Failed to write " + what + ": " + path);
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Failed to replace " + what + ": " + path);
+    }
+}
@@ -0,0 +1,208 @@
+#include "JsonParser.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text_(text) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue();
+        skipSpace();
+        if (pos_ != text_.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    void skipSpace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r' || text_[pos_] == '\n')) {
+            ++pos_;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) fail(std::string("expected '") + c + "'");
+    }
+
+    bool consumeWord(const char* word) {
+        const std::string w(word);
+        if (text_.compare(pos_, w.size(), w) != 0) return false;
+        pos_ += w.size();
+        return true;
+    }
+
+    size_t skipDigits() {
+        const size_t start = pos_;
+        while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') ++pos_;
+        return pos_ - start;
+    }
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos_ >= text_.size()) fail("unexpected end of input");
+        JsonValue value;
+        const size_t start = pos_;
+        const char c = text_[pos_];
+        if (c == '{') {
+            ++pos_;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) return value;
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.members.emplace_back(std::move(key), parseValue());
+            } while (consume(','));
+            expect('}');
+        } else if (c == '[') {
+            ++pos_;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) return value;
+            do {
+                value.items.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        } else if (c == '"') {
+            value.type = JsonValue::Type::String;
+            value.text = parseString();
+        } else if (consumeWord("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.number = 1.0;
+            value.text = "true";
+        } else if (consumeWord("false")) {
+            value.type = JsonValue::Type::Bool;
+            value.text = "false";
+        } else if (consumeWord("null")) {
+            value.type = JsonValue::Type::Null;
+            value.text = "null";
+        } else {
+            // The JSON grammar, checked before strtod(), which would also take "nan" or hex.
+            if (text_[pos_] == '-') ++pos_;
+            if (skipDigits() == 0) fail("unexpected character");
+            if (pos_ < text_.size() && text_[pos_] == '.') {
+                ++pos_;
+                if (skipDigits() == 0) fail("expected digits");
+            }
+            if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+                ++pos_;
+                if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) ++pos_;
+                if (skipDigits() == 0) fail("expected digits");
+            }
+            value.type = JsonValue::Type::Number;
+            value.text = text_.substr(start, pos_ - start);
+            value.number = std::strtod(value.text.c_str(), nullptr);
+        }
+        return value;
+    }
+
+    uint32_t parseHex4() {
+        if (pos_ + 4 > text_.size()) fail("truncated \\u escape");
+        uint32_t out = 0;
+        for (size_t end = pos_ + 4; pos_ < end; ++pos_) {
+            const char c = text_[pos_];
+            out <<= 4;
+            if (c >= '0' && c <= '9') {
+                out |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                out |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                out |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                fail("bad \\u escape");
+            }
+        }
+        return out;
+    }
+
+    std::string parseString() {
+        if (pos_ >= text_.size() || text_[pos_] != '"') fail("expected string");
+        ++pos_;
+        std::string out;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            const char c = text_[pos_++];
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) break;
+            switch (text_[pos_++]) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp = parseHex4();
+                // A surrogate pair spells one code point outside the basic plane.
+                if (cp >= 0xD800 && cp < 0xDC00 && text_.compare(pos_, 2, "\\u") == 0) {
+                    const size_t high = pos_;
+                    pos_ += 2;
+                    const uint32_t low = parseHex4();
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        pos_ = high;
+                    }
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: --pos_; fail("bad escape");
+            }
+        }
+        if (pos_ >= text_.size()) fail("unterminated string");
+        ++pos_;
+        return out;
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+} // namespace
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    for (auto it = members.rbegin(); it != members.rend(); ++it) {
+        if (it->first == key) return &it->second;
+    }
+    return nullptr;
+}
+
+JsonValue parseJson(const std::string& text) { return JsonParser(text).parseDocument(); }
@@ -1,9 +1,14 @@
 #include "KeyAnalyzer.hpp"
 
+#include "Profiler.hpp"
+#include "SegmentedAnalysis.hpp"
+#include "SimdKernels.hpp"
+
 #include <algorithm>
 #include <array>
 #include <cmath>
 #include <complex>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,35 +22,6 @@ const std::array<double, 12> MINOR_PROFILE = {
 const std::array<const char*, 12> NOTE_NAMES = {
     "C", "C#/Db", "D", "D#/Eb", "E", "F", "F#/Gb", "G", "G#/Ab", "A", "A#/Bb", "B"};
 
-double noteIndexFromFreq(double freq) {
-    // MIDI note index (A4=69 at 440 Hz)
-    return 69.0 + 12.0 * std::log2(freq / 440.0);
-}
-
-// Simple Hann window.
-std::vector<double> makeHann(int N) {
-    std::vector<double> w(N);
-    for (int n = 0; n < N; ++n) {
-        w[n] = 0.5 * (1.0 - std::cos(2.0 * M_PI * n / (N - 1)));
-    }
-    return w;
-}
-
-// Naive DFT magnitude for a single frame.
-std::vector<double> magnitudeSpectrum(const std::vector<float>& frame) {
-    const int N = static_cast<int>(frame.size());
-    std::vector<double> mag(static_cast<size_t>(N / 2 + 1), 0.0);
-    for (int k = 0; k <= N / 2; ++k) {
-        std::complex<double> sum{0.0, 0.0};
-        for (int n = 0; n < N; ++n) {
-            double angle = -2.0 * M_PI * k * n / static_cast<double>(N);
-            sum += std::complex<double>(frame[n] * std::cos(angle), frame[n] * std::sin(angle));
-        }
-        mag[static_cast<size_t>(k)] = std::abs(sum);
-    }
-    return mag;
-}
-
 std::array<double, 12> normalizeProfile(const std::array<double, 12>& profile) {
     std::array<double, 12> out{};
     double sum = 0.0;
@@ -62,52 +38,57 @@ double correlate(const std::array<double, 12>& a, const std::array<double, 12>&
 }
 } // namespace
 
-std::string estimateKey(const AudioData& audio) {
-    if (audio.sampleRate <= 0 || audio.samples.empty()) return "Unknown";
+template <size_t FrameSize, size_t HopSize>
+BasicKeyAccumulator<FrameSize, HopSize>::BasicKeyAccumulator(int sampleRate, AnalysisWorkspace* workspace)
+    : sampleRate_(sampleRate),
+      ownWorkspace_(workspace ? nullptr : std::make_unique<AnalysisWorkspace>()),
+      ws_(workspace ? *workspace : *ownWorkspace_),
+      plan_(ws_.fftPlan(FrameSize)),
+      chroma_(sampleRate, FrameSize) {
+    ws_.keyPending.resize(FrameSize);
+    ws_.keyFrame.resize(FrameSize);
+    ws_.keyBins.resize(plan_.binCount());
+}
 
-    const int frameSize = 2048; // smaller for speed
-    const int hopSize = 1024;
-    if (audio.samples.size() < static_cast<size_t>(frameSize)) return "Unknown";
-
-    // Limit number of analyzed frames to keep runtime reasonable on long files.
-    const size_t maxFrames = 120;
-    const size_t totalSamples = audio.samples.size();
-    const size_t totalHops = (totalSamples > static_cast<size_t>(frameSize))
-                                 ? (totalSamples - static_cast<size_t>(frameSize)) / hopSize
-                                 : 0;
-    size_t hopStride = 1;
-    if (totalHops > maxFrames && maxFrames > 0) {
-        hopStride = totalHops / maxFrames;
-        if (hopStride == 0) hopStride = 1;
+template <size_t FrameSize, size_t HopSize>
+void BasicKeyAccumulator<FrameSize, HopSize>::push(const float* samples, size_t count) {
+    DJT_PROFILE_SCOPE("chroma");
+    if (sampleRate_ <= 0) return;
+    while (count > 0) {
+        size_t take = std::min(count, FrameSize - fill_);
+        std::copy(samples, samples + take, ws_.keyPending.begin() + static_cast<std::ptrdiff_t>(fill_));
+        fill_ += take;
+        samples += take;
+        count -= take;
+        if (fill_ == FrameSize) {
+            processFrame();
+            // Keep the overlap for the next frame.
+            std::copy(ws_.keyPending.begin() + HopSize, ws_.keyPending.end(), ws_.keyPending.begin());
+            fill_ = FrameSize - HopSize;
+        }
     }
+}
 
-    auto window = makeHann(frameSize);
-    std::array<double, 12> histogram{};
-    size_t framesProcessed = 0;
-    for (size_t hopIdx = 0; hopIdx <= totalHops; hopIdx += hopStride) {
-        size_t start = hopIdx * hopSize;
-        if (start + static_cast<size_t>(frameSize) > totalSamples) break;
+template <size_t FrameSize, size_t HopSize>
+void BasicKeyAccumulator<FrameSize, HopSize>::append(const BasicKeyAccumulator& next) {
+    for (size_t i = 0; i < histogram_.size(); ++i) histogram_[i] += next.histogram_[i];
+}
 
-        std::vector<float> frame(frameSize);
-        for (int n = 0; n < frameSize; ++n) {
-            frame[n] = static_cast<float>(audio.samples[start + static_cast<size_t>(n)] * window[n]);
-        }
-        auto mag = magnitudeSpectrum(frame);
-
-        const double binHz = static_cast<double>(audio.sampleRate) / frameSize;
-        for (size_t k = 1; k < mag.size(); ++k) { // skip DC
-            double freq = binHz * static_cast<double>(k);
-            if (freq < 30.0 || freq > 5000.0) continue; // ignore extremes
-            double midi = noteIndexFromFreq(freq);
-            int pc = static_cast<int>(std::lround(midi)) % 12;
-            if (pc < 0) pc += 12;
-            histogram[static_cast<size_t>(pc)] += mag[k];
-        }
+template <size_t FrameSize, size_t HopSize>
+void BasicKeyAccumulator<FrameSize, HopSize>::decay(double factor) {
+    for (double& v : histogram_) v *= factor;
+}
 
-        ++framesProcessed;
-        if (framesProcessed >= maxFrames) break;
-    }
+template <size_t FrameSize, size_t HopSize>
+void BasicKeyAccumulator<FrameSize, HopSize>::processFrame() {
+    multiplyWindow(ws_.keyPending.data(), kHannWindow<FrameSize>.data(), ws_.keyFrame.data(), FrameSize);
+    plan_.forward(ws_.keyFrame.data(), ws_.keyBins.data());
+    chroma_.accumulate(ws_.keyBins.data(), histogram_);
+}
 
+std::string keyFromHistogram(const std::array<double, 12>& counts) {
+    DJT_PROFILE_SCOPE("keyMatch");
+    std::array<double, 12> histogram = counts;
     double histSum = 0.0;
     for (double v : histogram) histSum += v;
     if (histSum <= 0.0) return "Unknown";
@@ -139,6 +120,35 @@ std::string estimateKey(const AudioData& audio) {
         }
     }
 
-    const char* note = NOTE_NAMES[static_cast<size_t>(bestRoot)];
-    return std::string(note) + (bestIsMajor ? " major" : " minor");
+    return keyName(bestRoot, bestIsMajor);
+}
+
+std::array<double, 12> chromaFromHistogram(const std::array<double, 12>& histogram) {
+    double sum = 0.0;
+    for (double v : histogram) sum += v;
+    std::array<double, 12> chroma{};
+    if (!(sum > 0.0)) return chroma;
+    for (size_t pc = 0; pc < 12; ++pc) chroma[pc] = histogram[pc] / sum;
+    return chroma;
+}
+
+std::string keyName(int root, bool major) {
+    if (root < 0 || root >= 12) return "Unknown";
+    return std::string(NOTE_NAMES[static_cast<size_t>(root)]) + (major ? " major" : " minor");
+}
+
+template <size_t FrameSize, size_t HopSize>
+std::string BasicKeyAccumulator<FrameSize, HopSize>::estimate() const {
+    return keyFromHistogram(histogram_);
+}
+
+template class BasicKeyAccumulator<512, 256>;
+
+std::string estimateKey(const AudioData& audio, AnalysisWorkspace* workspace, ThreadPool* pool) {
+    DJT_PROFILE_SCOPE("estimateKey");
+    if (audio.sampleRate <= 0 || audio.samples.empty()) return "Unknown";
+
+    SegmentedAnalysis analysis(audio.sampleRate, 0.0, kAnalyzeKey, workspace, pool);
+    analysis.analyze(audio.samples.data(), audio.samples.size());
+    return analysis.key();
 }
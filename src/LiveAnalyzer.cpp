@@ -0,0 +1,242 @@
+#include "LiveAnalyzer.hpp"
+
+#include "Profiler.hpp"
+#include "SimdKernels.hpp"
+#include "SpscRingBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#define DJT_HAVE_POLL 1
+#endif
+
+namespace {
+// Frames moved per read from the input and per hand-off to the analysis.
+constexpr size_t kBlockFrames = 4096;
+
+bool positive(double seconds) { return seconds > 0.0 && std::isfinite(seconds); }
+
+// Throws std::invalid_argument unless the analysis parameters are usable at `sampleRate`.
+int checkedRate(int sampleRate, const LiveOptions& options) {
+    if (sampleRate <= 0) {
+        throw std::invalid_argument("LiveAnalyzer: sample rate must be positive");
+    }
+    if (!positive(options.tempoSeconds) || !positive(options.keySeconds) || !positive(options.windowSeconds) ||
+        !positive(options.historySeconds)) {
+        throw std::invalid_argument("LiveAnalyzer: durations must be positive");
+    }
+    return sampleRate;
+}
+
+size_t bytesPerSample(PcmFormat format) {
+    switch (format) {
+    case PcmFormat::Int16: return 2;
+    case PcmFormat::Int24: return 3;
+    default: return 4;
+    }
+}
+
+// Read up to `size` bytes of `input`, returning 0 at end of stream, on an error (setting
+// `failed`) or once `stop` is set. Where poll() exists the wait is bounded, so a live feed that
+// goes quiet does not hold the reader past a stop; the stdio buffer is bypassed for the same reason.
+size_t readSome(std::FILE* input, unsigned char* data, size_t size, const std::atomic<bool>& stop,
+                std::atomic<bool>& failed) {
+#if defined(DJT_HAVE_POLL)
+    const int fd = ::fileno(input);
+    while (!stop.load(std::memory_order_relaxed)) {
+        pollfd entry{fd, POLLIN, 0};
+        const int ready = ::poll(&entry, 1, 100);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+        const ssize_t got = ready < 0 ? -1 : ::read(fd, data, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) failed.store(true, std::memory_order_relaxed);
+        return got < 0 ? 0 : static_cast<size_t>(got);
+    }
+    return 0;
+#else
+    if (stop.load(std::memory_order_relaxed)) return 0;
+    const size_t got = std::fread(data, 1, size, input);
+    if (got == 0 && std::ferror(input)) failed.store(true, std::memory_order_relaxed);
+    return got;
+#endif
+}
+
+// Producer side of analyzeLiveStream(): decode `input` to mono into `ring` until end of stream
+// or until `stop` is set.
+void readInput(std::FILE* input, const LiveOptions& options, SpscRingBuffer<float>& ring,
+               std::atomic<uint64_t>& framesRead, std::atomic<uint64_t>& framesDropped, std::atomic<bool>& failed,
+               const std::atomic<bool>& stop) {
+    const size_t channels = static_cast<size_t>(options.channels);
+    PcmView view;
+    view.channels = options.channels;
+    view.sampleRate = options.sampleRate;
+    view.format = options.format;
+    view.bytesPerSample = bytesPerSample(options.format);
+    const size_t frameBytes = channels * view.bytesPerSample;
+    std::vector<unsigned char> bytes(kBlockFrames * frameBytes);
+    std::vector<float> samples(kBlockFrames * channels);
+    size_t held = 0; // bytes of a partial frame carried to the next read
+
+    for (;;) {
+        const size_t got = readSome(input, bytes.data() + held, bytes.size() - held, stop, failed);
+        if (got == 0) break;
+        held += got;
+        const size_t frames = held / frameBytes;
+        if (frames == 0) continue;
+
+        view.data = bytes.data();
+        view.frames = frames;
+        convertPcmToFloat(view, 0, frames, samples.data());
+        downmixToMonoPeak(samples.data(), frames, options.channels, samples.data());
+
+        const size_t written = ring.write(samples.data(), frames);
+        framesRead.fetch_add(frames, std::memory_order_relaxed);
+        if (written < frames) framesDropped.fetch_add(frames - written, std::memory_order_relaxed);
+
+        held -= frames * frameBytes;
+        std::memmove(bytes.data(), bytes.data() + frames * frameBytes, held);
+    }
+}
+} // namespace
+
+LiveAnalyzer::LiveAnalyzer(int sampleRate, const LiveOptions& options)
+    : sampleRate_(checkedRate(sampleRate, options)),
+      decimator_(sampleRate, ws_),
+      bpm_(decimator_.bpmRate(), &ws_),
+      key_(decimator_.keyRate(), &ws_) {
+    tempoHops_ = static_cast<size_t>(options.tempoSeconds * decimator_.bpmRate() / BpmAccumulator::kHopSize);
+    keyDecayPerSample_ = -1.0 / (options.keySeconds * sampleRate);
+    windowSamples_ = std::max<size_t>(1, static_cast<size_t>(options.windowSeconds * sampleRate + 0.5));
+    windows_.assign(std::max<size_t>(1, static_cast<size_t>(options.historySeconds / options.windowSeconds + 0.5)),
+                    0.0);
+    ws_.hopEnergies.reserve(2 * tempoHops_);
+}
+
+void LiveAnalyzer::push(const float* samples, size_t count) {
+    DJT_PROFILE_SCOPE("liveAnalyze");
+    decimator_.push(samples, count);
+    bpm_.push(decimator_.bpmBlock(), decimator_.bpmCount());
+    key_.push(decimator_.keyBlock(), decimator_.keyCount());
+    key_.decay(std::exp(keyDecayPerSample_ * static_cast<double>(count)));
+    // Drop old hops as they arrive, in batches, so the history stays bounded between estimates.
+    if (ws_.hopEnergies.size() >= 2 * tempoHops_) bpm_.keepRecent(tempoHops_);
+    samples_ += count;
+
+    while (count > 0) {
+        const size_t take = std::min(count, windowSamples_ - fill_);
+        sumSq_ += sumOfSquares(samples, take);
+        fill_ += take;
+        samples += take;
+        count -= take;
+        if (fill_ < windowSamples_) break;
+
+        windows_[windowCount_ % windows_.size()] = std::sqrt(sumSq_ / static_cast<double>(windowSamples_));
+        ++windowCount_;
+        sumSq_ = 0.0;
+        fill_ = 0;
+    }
+}
+
+void LiveAnalyzer::estimate(LiveEstimate& estimate) {
+    DJT_PROFILE_SCOPE("liveEstimate");
+    estimate.seconds = static_cast<double>(samples_) / static_cast<double>(sampleRate_);
+    bpm_.keepRecent(tempoHops_);
+    estimate.bpm = bpm_.estimate();
+    estimate.key = key_.estimate();
+
+    const size_t kept = static_cast<size_t>(std::min<uint64_t>(windowCount_, windows_.size()));
+    estimate.energyCurve.resize(kept);
+    for (size_t i = 0; i < kept; ++i) {
+        estimate.energyCurve[i] = windows_[(windowCount_ - kept + i) % windows_.size()];
+    }
+}
+
+LiveStats analyzeLiveStream(std::FILE* input, const LiveOptions& options,
+                            const std::function<void(const LiveEstimate&)>& onEstimate) {
+    if (options.channels <= 0) {
+        throw std::invalid_argument("analyzeLiveStream: channel count must be positive");
+    }
+    if (!positive(options.intervalSeconds) || !positive(options.bufferSeconds)) {
+        throw std::invalid_argument("analyzeLiveStream: interval and buffer must be positive");
+    }
+    LiveAnalyzer analyzer(options.sampleRate, options);
+    const uint64_t interval =
+        std::max<uint64_t>(1, static_cast<uint64_t>(options.intervalSeconds * options.sampleRate + 0.5));
+
+    SpscRingBuffer<float> ring(static_cast<size_t>(options.bufferSeconds * options.sampleRate));
+    std::atomic<uint64_t> framesRead{0};
+    std::atomic<uint64_t> framesDropped{0};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> done{false};
+    std::atomic<bool> stop{false};
+    std::thread reader([&] {
+        readInput(input, options, ring, framesRead, framesDropped, failed, stop);
+        done.store(true, std::memory_order_release);
+    });
+
+    LiveStats stats;
+    LiveEstimate estimate;
+    double totalMs = 0.0;
+    auto emit = [&] {
+        const auto started = std::chrono::steady_clock::now();
+        analyzer.estimate(estimate);
+        estimate.updateMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        estimate.backlogSeconds = static_cast<double>(ring.size()) / static_cast<double>(options.sampleRate);
+        ++stats.updates;
+        totalMs += estimate.updateMs;
+        stats.maxUpdateMs = std::max(stats.maxUpdateMs, estimate.updateMs);
+        if (onEstimate) onEstimate(estimate);
+    };
+
+    // The analysis side polls: waiting on the reader would need a lock or a syscall per block.
+    std::vector<float> block(kBlockFrames);
+    uint64_t nextUpdate = interval;
+    try {
+        for (;;) {
+            const bool finished = done.load(std::memory_order_acquire);
+            size_t count = ring.read(block.data(), block.size());
+            if (count == 0) {
+                if (finished) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            const float* samples = block.data();
+            while (count > 0) {
+                const size_t take =
+                    static_cast<size_t>(std::min<uint64_t>(count, nextUpdate - analyzer.samplesPushed()));
+                analyzer.push(samples, take);
+                samples += take;
+                count -= take;
+                if (analyzer.samplesPushed() == nextUpdate) {
+                    emit();
+                    nextUpdate += interval;
+                }
+            }
+        }
+        if (analyzer.samplesPushed() != nextUpdate - interval) emit();
+    } catch (...) {
+        // The reader must not outlive the ring; a live feed may never end on its own.
+        stop.store(true, std::memory_order_relaxed);
+        reader.join();
+        throw;
+    }
+    reader.join();
+
+    stats.samplesRead = framesRead.load();
+    stats.samplesDropped = framesDropped.load();
+    stats.meanUpdateMs = stats.updates > 0 ? totalMs / static_cast<double>(stats.updates) : 0.0;
+    if (failed.load()) {
+        throw std::runtime_error("Failed to read live input");
+    }
+    return stats;
+}
@@ -0,0 +1,289 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace profiling {
+namespace detail {
+std::atomic<bool> gEnabled{false};
+} // namespace detail
+
+namespace {
+// Beyond this many trace events a thread keeps only its per-stage totals, so a long batch run
+// cannot exhaust memory (24 bytes per event).
+constexpr size_t kMaxEventsPerThread = size_t{1} << 21;
+
+constexpr size_t kCounterCount = static_cast<size_t>(Counter::kCount);
+const std::array<const char*, kCounterCount> kCounterNames = {
+    "decoded bytes", "decoded frames", "FFTs", "pair evaluations"};
+const std::array<const char*, kCounterCount> kCounterKeys = {
+    "decodedBytes", "decodedFrames", "ffts", "pairEvaluations"};
+
+struct TraceEvent {
+    uint32_t stage = 0;
+    uint32_t allocs = 0;
+    uint64_t startNs = 0;
+    uint64_t durNs = 0;
+};
+
+struct StageTotals {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t selfNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t allocs = 0;
+};
+
+// Written only by its own thread; read by the exporters once the work is done.
+struct ThreadState {
+    uint32_t tid = 0;
+    std::vector<TraceEvent> events;
+    uint64_t droppedEvents = 0;
+    std::vector<StageTotals> stages; // indexed by stage id
+    std::array<uint64_t, kCounterCount> counters{};
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t lastNs = 0;
+};
+
+std::mutex gMutex; // guards the registries below, not the thread states' contents
+std::vector<std::unique_ptr<ThreadState>> gThreads;
+std::vector<const char*> gStages;
+std::chrono::steady_clock::time_point gEpoch = std::chrono::steady_clock::now();
+
+thread_local ThreadState* tState = nullptr;
+thread_local ScopedTimer* tCurrent = nullptr;
+thread_local bool tHoldsRegistry = false;
+
+// gMutex, held while the registries grow. The allocations that growth makes must not try to
+// register a thread state under the same lock.
+class RegistryLock {
+public:
+    RegistryLock() : lock_(gMutex) { tHoldsRegistry = true; }
+    ~RegistryLock() { tHoldsRegistry = false; }
+
+private:
+    std::lock_guard<std::mutex> lock_;
+};
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gEpoch).count());
+}
+
+// The calling thread's state, created on first use. Returns null while it is being created, so
+// the allocation hook does not recurse into it.
+ThreadState* threadState() {
+    if (tState) return tState;
+    static thread_local bool creating = false;
+    if (creating || tHoldsRegistry) return nullptr;
+    creating = true;
+    auto state = std::make_unique<ThreadState>();
+    state->events.reserve(4096);
+    {
+        RegistryLock lock;
+        state->tid = static_cast<uint32_t>(gThreads.size() + 1);
+        gThreads.push_back(std::move(state));
+        tState = gThreads.back().get();
+    }
+    creating = false;
+    return tState;
+}
+
+std::string jsonEscape(const char* text) {
+    std::string out;
+    for (const char* p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') out.push_back('\\');
+        out.push_back(*p);
+    }
+    return out;
+}
+
+double toMicros(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+} // namespace
+
+void setEnabled(bool on) {
+    if (on) {
+        RegistryLock lock;
+        for (auto& state : gThreads) {
+            const uint32_t tid = state->tid;
+            *state = ThreadState();
+            state->tid = tid;
+        }
+        gEpoch = std::chrono::steady_clock::now();
+    }
+    detail::gEnabled.store(on, std::memory_order_relaxed);
+}
+
+int registerStage(const char* name) {
+    RegistryLock lock;
+    for (size_t i = 0; i < gStages.size(); ++i) {
+        if (std::strcmp(gStages[i], name) == 0) return static_cast<int>(i);
+    }
+    gStages.push_back(name);
+    return static_cast<int>(gStages.size() - 1);
+}
+
+void addCount(Counter counter, uint64_t amount) {
+    if (ThreadState* state = threadState()) {
+        state->counters[static_cast<size_t>(counter)] += amount;
+    }
+}
+
+void noteAllocation(size_t bytes) {
+    if (!enabled()) return;
+    if (ThreadState* state = threadState()) {
+        ++state->allocations;
+        state->allocatedBytes += bytes;
+    }
+}
+
+void ScopedTimer::begin(int stage) {
+    ThreadState* state = threadState();
+    if (!state) return;
+    active_ = true;
+    stage_ = stage;
+    parent_ = tCurrent;
+    tCurrent = this;
+    startAllocs_ = state->allocations;
+    startNs_ = nowNs();
+}
+
+void ScopedTimer::end() {
+    const uint64_t endNs = nowNs();
+    ThreadState& state = *tState;
+    const uint64_t dur = endNs - startNs_;
+    tCurrent = parent_;
+    if (parent_) parent_->childNs_ += dur;
+
+    const uint64_t allocs = state.allocations - startAllocs_;
+    if (state.stages.size() <= static_cast<size_t>(stage_)) state.stages.resize(static_cast<size_t>(stage_) + 1);
+    StageTotals& totals = state.stages[static_cast<size_t>(stage_)];
+    ++totals.calls;
+    totals.totalNs += dur;
+    totals.selfNs += dur - std::min(dur, childNs_);
+    totals.maxNs = std::max(totals.maxNs, dur);
+    totals.allocs += allocs;
+    state.lastNs = std::max(state.lastNs, endNs);
+
+    if (state.events.size() < kMaxEventsPerThread) {
+        state.events.push_back({static_cast<uint32_t>(stage_), static_cast<uint32_t>(std::min<uint64_t>(allocs, UINT32_MAX)),
+                                startNs_, dur});
+    } else {
+        ++state.droppedEvents;
+    }
+}
+
+void writeChromeTrace(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        throw std::runtime_error("Failed to create trace file: " + path);
+    }
+
+    RegistryLock lock;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&] {
+        if (!first) std::fputs(",\n", f);
+        first = false;
+    };
+    for (const auto& state : gThreads) {
+        separator();
+        std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                     state->tid, state->tid == 1 ? "main" : "worker", state->tid);
+        for (const TraceEvent& e : state->events) {
+            separator();
+            std::fprintf(f,
+                         "{\"name\":\"%s\",\"cat\":\"djt\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                         "\"dur\":%.3f,\"args\":{\"allocs\":%u}}",
+                         jsonEscape(gStages[e.stage]).c_str(), state->tid, toMicros(e.startNs), toMicros(e.durNs),
+                         e.allocs);
+        }
+        // One sample of each thread's counters at its last event, as counter tracks.
+        separator();
+        std::fprintf(f, "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{",
+                     state->tid, toMicros(state->lastNs));
+        for (size_t c = 0; c < kCounterCount; ++c) {
+            std::fprintf(f, "\"%s\":%llu,", kCounterKeys[c], static_cast<unsigned long long>(state->counters[c]));
+        }
+        std::fprintf(f, "\"allocations\":%llu,\"allocatedBytes\":%llu}}",
+                     static_cast<unsigned long long>(state->allocations),
+                     static_cast<unsigned long long>(state->allocatedBytes));
+    }
+    std::fprintf(f, "\n]}\n");
+
+    const bool failed = std::ferror(f) != 0;
+    if (std::fclose(f) != 0 || failed) {
+        throw std::runtime_error("Failed to write trace file: " + path);
+    }
+}
+
+void printSummary(std::ostream& out) {
+    RegistryLock lock;
+    std::vector<StageTotals> totals(gStages.size());
+    std::array<uint64_t, kCounterCount> counters{};
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t dropped = 0;
+    for (const auto& state : gThreads) {
+        for (size_t s = 0; s < state->stages.size(); ++s) {
+            const StageTotals& t = state->stages[s];
+            totals[s].calls += t.calls;
+            totals[s].totalNs += t.totalNs;
+            totals[s].selfNs += t.selfNs;
+            totals[s].maxNs = std::max(totals[s].maxNs, t.maxNs);
+            totals[s].allocs += t.allocs;
+        }
+        for (size_t c = 0; c < kCounterCount; ++c) counters[c] += state->counters[c];
+        allocations += state->allocations;
+        allocatedBytes += state->allocatedBytes;
+        dropped += state->droppedEvents;
+    }
+
+    std::vector<size_t> order;
+    uint64_t selfSum = 0;
+    for (size_t s = 0; s < totals.size(); ++s) {
+        if (totals[s].calls == 0) continue;
+        order.push_back(s);
+        selfSum += totals[s].selfNs;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return totals[a].selfNs > totals[b].selfNs; });
+
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "\n=== Profile (" << gThreads.size() << " thread" << (gThreads.size() == 1 ? "" : "s") << ", "
+        << std::fixed << std::setprecision(1) << static_cast<double>(nowNs()) / 1e6 << " ms wall) ===\n";
+    out << std::left << std::setw(22) << "stage" << std::right << std::setw(10) << "calls" << std::setw(12)
+        << "total ms" << std::setw(12) << "self ms" << std::setw(8) << "self%" << std::setw(12) << "mean us"
+        << std::setw(12) << "max us" << std::setw(10) << "allocs" << "\n";
+    for (size_t s : order) {
+        const StageTotals& t = totals[s];
+        const double share = selfSum > 0 ? 100.0 * static_cast<double>(t.selfNs) / static_cast<double>(selfSum) : 0.0;
+        out << std::left << std::setw(22) << gStages[s] << std::right << std::setw(10) << t.calls << std::fixed
+            << std::setprecision(2) << std::setw(12) << static_cast<double>(t.totalNs) / 1e6 << std::setw(12)
+            << static_cast<double>(t.selfNs) / 1e6 << std::setprecision(1) << std::setw(8) << share
+            << std::setw(12) << toMicros(t.totalNs) / static_cast<double>(t.calls) << std::setw(12)
+            << toMicros(t.maxNs) << std::setw(10) << t.allocs << "\n";
+    }
+    for (size_t c = 0; c < kCounterCount; ++c) {
+        out << std::left << std::setw(22) << kCounterNames[c] << std::right << std::setw(10) << counters[c] << "\n";
+    }
+    out << std::left << std::setw(22) << "allocations" << std::right << std::setw(10) << allocations << " ("
+        << allocatedBytes << " bytes)\n";
+    if (dropped > 0) {
+        out << dropped << " trace events dropped beyond " << kMaxEventsPerThread
+            << " per thread; totals above include them\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace profiling
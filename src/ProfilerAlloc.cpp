@@ -0,0 +1,33 @@
+// Global allocation hook for the djtransition executable: reports every heap allocation to the
+// profiler so stages can show how much they allocate. Linked into the executable only, so the
+// library never replaces operator new behind an embedding program's back.
+#ifdef DJT_ENABLE_PROFILING
+
+#include "Profiler.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+void* profiledAlloc(std::size_t size) {
+    profiling::noteAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = profiledAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* p = profiledAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return profiledAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return profiledAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
@@ -0,0 +1,189 @@
+#include "Resampler.hpp"
+
+#include "AnalysisWorkspace.hpp"
+#include "Profiler.hpp"
+#include "SimdKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kStopbandDb = 60.0;
+constexpr double kKaiserBeta = 0.1102 * (kStopbandDb - 8.7);
+
+// The BPM stream only needs its onset energy intact: highs folding back above ~6.6 kHz keep
+// their energy, and the key stage strips that band again. The key stream keeps up to 5 kHz,
+// the top of the chroma range, free of aliases.
+constexpr double kBpmPassband = 0.6;
+constexpr double kKeyPassband = 0.92;
+
+// Zeroth-order modified Bessel function of the first kind, by its power series.
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = 0.25 * x * x;
+    for (int k = 1; k < 50; ++k) {
+        term *= q / (static_cast<double>(k) * static_cast<double>(k));
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler(int inputRate, int outputRate, double passband)
+    : inputRate_(inputRate), outputRate_(outputRate), passband_(passband) {
+    if (inputRate <= 0 || outputRate <= 0 || !(passband > 0.0 && passband < 1.0)) {
+        throw std::invalid_argument("Invalid resampler parameters");
+    }
+    const int g = std::gcd(inputRate, outputRate);
+    up_ = static_cast<size_t>(outputRate / g);
+    down_ = static_cast<size_t>(inputRate / g);
+
+    // Cut off at the lower Nyquist frequency; see tapsFor() for the length.
+    const double nyquist = 0.5 * static_cast<double>(std::min(inputRate, outputRate));
+    taps_ = tapsFor(inputRate, outputRate, passband);
+
+    const size_t total = taps_ * up_;
+    const double upRate = static_cast<double>(inputRate) * static_cast<double>(up_);
+    const double center = 0.5 * static_cast<double>(total - 1);
+    const double norm = besselI0(kKaiserBeta);
+
+    std::vector<double> prototype(total);
+    double sum = 0.0;
+    for (size_t n = 0; n < total; ++n) {
+        const double t = static_cast<double>(n) - center;
+        const double x = 2.0 * nyquist * t / upRate;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        const double r = t / center;
+        const double window = besselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+        prototype[n] = sinc * window;
+        sum += prototype[n];
+    }
+
+    // Unity DC gain per output: the L phases together sum to L. Phase p holds taps p, p + L, ...
+    // stored oldest-input-first so each output is a plain dot product over the input buffer.
+    const double gain = static_cast<double>(up_) / sum;
+    coeffs_.resize(total);
+    for (size_t p = 0; p < up_; ++p) {
+        for (size_t j = 0; j < taps_; ++j) {
+            coeffs_[p * taps_ + (taps_ - 1 - j)] = static_cast<float>(prototype[p + j * up_] * gain);
+        }
+    }
+    reset();
+}
+
+size_t PolyphaseResampler::tapsFor(int inputRate, int outputRate, double passband) {
+    // A transition band symmetric around the lower Nyquist frequency, so anything folding back
+    // lands above `passband` of Nyquist. Kaiser's estimate gives the length for the stopband
+    // attenuation; the prototype runs at the upsampled rate.
+    const double nyquist = 0.5 * static_cast<double>(std::min(inputRate, outputRate));
+    const double transition = 2.0 * (1.0 - passband) * nyquist; // Hz
+    const double length = (kStopbandDb - 7.95) / (2.285 * 2.0 * kPi * transition / inputRate) + 1.0;
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(length)));
+}
+
+size_t PolyphaseResampler::maxOutput(size_t count) const {
+    return static_cast<size_t>((static_cast<uint64_t>(buffer_.size() + count) * up_) / down_) + 1;
+}
+
+size_t PolyphaseResampler::process(const float* in, size_t count, float* out) {
+    buffer_.insert(buffer_.end(), in, in + count);
+
+    size_t pos = 0;
+    const size_t written = polyphaseFir(coeffs_.data(), taps_, up_, down_, buffer_.data(), buffer_.size(), pos,
+                                        phase_, out);
+    // Keep the inputs the next outputs still need. An output step (at most ceil(M / L) inputs)
+    // is shorter than the filter, so `pos` never passes the end of the buffer.
+    buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(pos));
+    return written;
+}
+
+void PolyphaseResampler::reset() {
+    // Start as if preceded by silence, so the first output lines up with the first input.
+    buffer_.assign(taps_ - 1, 0.0f);
+    phase_ = 0;
+}
+
+AnalysisDecimator::AnalysisDecimator(int nativeRate, AnalysisWorkspace& workspace, bool withKeyStream)
+    : ws_(workspace), nativeRate_(nativeRate), withKey_(withKeyStream) {
+    bpmRate_ = nativeRate;
+    if (nativeRate > kBpmAnalysisRate) {
+        toBpm_ = &ws_.resampler(nativeRate, kBpmAnalysisRate, kBpmPassband);
+        bpmRate_ = kBpmAnalysisRate;
+    }
+    keyRate_ = bpmRate_;
+    if (withKeyStream && bpmRate_ > kKeyAnalysisRate) {
+        toKey_ = &ws_.resampler(bpmRate_, kKeyAnalysisRate, kKeyPassband);
+        keyRate_ = kKeyAnalysisRate;
+    }
+}
+
+void AnalysisDecimator::push(const float* samples, size_t count) {
+    DJT_PROFILE_SCOPE("decimate");
+    bpmBlock_ = samples;
+    bpmCount_ = count;
+    if (toBpm_) {
+        ws_.bpmStream.resize(toBpm_->maxOutput(count));
+        bpmCount_ = toBpm_->process(samples, count, ws_.bpmStream.data());
+        bpmBlock_ = ws_.bpmStream.data();
+    }
+
+    keyBlock_ = nullptr;
+    keyCount_ = 0;
+    if (!withKey_) return;
+    keyBlock_ = bpmBlock_;
+    keyCount_ = bpmCount_;
+    if (toKey_) {
+        ws_.keyStream.resize(toKey_->maxOutput(bpmCount_));
+        keyCount_ = toKey_->process(bpmBlock_, bpmCount_, ws_.keyStream.data());
+        keyBlock_ = ws_.keyStream.data();
+    }
+}
+
+uint64_t AnalysisDecimator::streamLength(uint64_t nativeSamples, int rate) const {
+    if (nativeRate_ <= 0) return 0;
+    return nativeSamples * static_cast<uint64_t>(rate) / static_cast<uint64_t>(nativeRate_);
+}
+
+uint64_t AnalysisDecimator::alignment(int nativeRate) {
+    if (nativeRate <= 0) return 1;
+    // One period of the first stage: M inputs for L outputs.
+    uint64_t native = 1;
+    uint64_t bpm = 1;
+    int bpmRate = nativeRate;
+    if (nativeRate > kBpmAnalysisRate) {
+        const uint64_t g = static_cast<uint64_t>(std::gcd(nativeRate, kBpmAnalysisRate));
+        native = static_cast<uint64_t>(nativeRate) / g;
+        bpm = static_cast<uint64_t>(kBpmAnalysisRate) / g;
+        bpmRate = kBpmAnalysisRate;
+    }
+    // Enough of those for a whole number of second-stage periods.
+    if (bpmRate > kKeyAnalysisRate) {
+        const uint64_t down = static_cast<uint64_t>(bpmRate / std::gcd(bpmRate, kKeyAnalysisRate));
+        native *= down / std::gcd(bpm, down);
+    }
+    return native;
+}
+
+uint64_t AnalysisDecimator::warmup(int nativeRate) {
+    if (nativeRate <= 0) return 0;
+    // The first stage's output is exact once a filter length of real input has gone in, and the
+    // second stage needs a filter length of exact first-stage output before the cut.
+    uint64_t history = 0;
+    int bpmRate = nativeRate;
+    if (nativeRate > kBpmAnalysisRate) {
+        history += PolyphaseResampler::tapsFor(nativeRate, kBpmAnalysisRate, kBpmPassband);
+        bpmRate = kBpmAnalysisRate;
+    }
+    if (bpmRate > kKeyAnalysisRate) {
+        const uint64_t taps = PolyphaseResampler::tapsFor(bpmRate, kKeyAnalysisRate, kKeyPassband);
+        history += (taps * static_cast<uint64_t>(nativeRate) + static_cast<uint64_t>(bpmRate) - 1) /
+                   static_cast<uint64_t>(bpmRate);
+    }
+    const uint64_t step = alignment(nativeRate);
+    return (history + step - 1) / step * step;
+}
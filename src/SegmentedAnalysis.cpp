@@ -0,0 +1,301 @@
+#include "SegmentedAnalysis.hpp"
+
+#include "BeatTracker.hpp"
+#include "Profiler.hpp"
+#include "Resampler.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <utility>
+
+namespace {
+// Long enough that warm-up and the key frame overlap stay around 1% of a segment's work, short
+// enough that a single track spreads over many cores.
+constexpr double kSegmentSeconds = 4.0;
+
+// Native samples decimated per step within a segment, bounding the stream buffers.
+constexpr size_t kStepSamples = 8192;
+
+int bpmRateFor(int sampleRate) { return std::min(sampleRate, kBpmAnalysisRate); }
+int keyRateFor(int sampleRate) { return std::min(bpmRateFor(sampleRate), kKeyAnalysisRate); }
+
+uint64_t atRate(uint64_t nativeSamples, int rate, int sampleRate) {
+    return nativeSamples * static_cast<uint64_t>(rate) / static_cast<uint64_t>(sampleRate);
+}
+
+// Smallest cut spacing that puts both analysis streams on a decimator phase and a hop boundary.
+uint64_t segmentQuantum(int sampleRate) {
+    const uint64_t step = AnalysisDecimator::alignment(sampleRate);
+    uint64_t quantum = step;
+    while (atRate(quantum, bpmRateFor(sampleRate), sampleRate) % BpmAccumulator::kHopSize != 0 ||
+           atRate(quantum, keyRateFor(sampleRate), sampleRate) % KeyAccumulator::kHopSize != 0) {
+        quantum += step;
+    }
+    return quantum;
+}
+} // namespace
+
+SegmentedAnalysis::SegmentedAnalysis(int sampleRate, double windowSeconds, unsigned analyzers,
+                                     AnalysisWorkspace* workspace, ThreadPool* pool)
+    : sampleRate_(sampleRate),
+      windowSeconds_(windowSeconds),
+      analyzers_(sampleRate > 0 ? analyzers : 0u),
+      pool_(pool),
+      ownWorkspace_(workspace ? nullptr : std::make_unique<AnalysisWorkspace>()),
+      ws_(workspace ? *workspace : *ownWorkspace_) {
+    if (sampleRate <= 0) return;
+    segmentSamples_ = segmentSamples(sampleRate);
+    warmup_ = AnalysisDecimator::warmup(sampleRate);
+    const uint64_t keyRate = static_cast<uint64_t>(keyRateFor(sampleRate));
+    const uint64_t keyOverlap = KeyAccumulator::kFrameSize - KeyAccumulator::kHopSize;
+    overlap_ = (keyOverlap * static_cast<uint64_t>(sampleRate) + keyRate - 1) / keyRate +
+               AnalysisDecimator::alignment(sampleRate);
+    // Enough queued segments to keep every worker busy while the oldest is merged.
+    if (pool_) maxInFlight_ = std::min<size_t>(2 * pool_->size() + 1, kMaxInFlight);
+
+    if (analyzers_ & kAnalyzeBpm) bpm_.emplace(bpmRateFor(sampleRate), &ws_);
+    if (analyzers_ & kAnalyzeEnergy) energy_.emplace(sampleRate, windowSeconds, &ws_);
+    if (analyzers_ & kAnalyzeKey) key_.emplace(keyRateFor(sampleRate), &ws_);
+}
+
+SegmentedAnalysis::~SegmentedAnalysis() {
+    for (; inFlightCount_ > 0; --inFlightCount_) {
+        SegmentSlot& segment = *inFlight_[inFlightHead_];
+        inFlightHead_ = (inFlightHead_ + 1) % kMaxInFlight;
+        if (pool_) pool_->helpUntil([&segment] { return segment.pending.load(std::memory_order_acquire) == 0; });
+        release(segment);
+    }
+    if (filling_) release(*filling_);
+}
+
+uint64_t SegmentedAnalysis::segmentSamples(int sampleRate) {
+    if (sampleRate <= 0) return 0;
+    const uint64_t quantum = segmentQuantum(sampleRate);
+    const double target = kSegmentSeconds * sampleRate / static_cast<double>(quantum);
+    return quantum * std::max<uint64_t>(1, static_cast<uint64_t>(target + 0.5));
+}
+
+void SegmentedAnalysis::reserve(uint64_t totalSamples) {
+    if (bpm_) bpm_->reserve(atRate(totalSamples, bpmRateFor(sampleRate_), sampleRate_));
+    if (energy_) energy_->reserve(totalSamples);
+}
+
+SegmentSlot& SegmentedAnalysis::newSegment(uint64_t begin) {
+    SegmentSlot* segment = nullptr;
+    for (auto& slot : ws_.segmentSlots) {
+        if (!slot->inUse) {
+            segment = slot.get();
+            break;
+        }
+    }
+    if (!segment) {
+        ws_.segmentSlots.push_back(std::make_unique<SegmentSlot>());
+        segment = ws_.segmentSlots.back().get();
+    }
+    segment->inUse = true;
+    segment->begin = begin;
+    segment->end = begin + segmentSamples_;
+    segment->last = false;
+    segment->dataBegin = begin - std::min(begin, warmup_);
+    segment->data = nullptr;
+    segment->dataCount = 0;
+    segment->samples.clear();
+    segment->energyError = nullptr;
+    segment->streamError = nullptr;
+    return *segment;
+}
+
+void SegmentedAnalysis::push(const float* samples, size_t count) {
+    if (analyzers_ == 0) return;
+    while (count > 0) {
+        if (!filling_) filling_ = &newSegment(0);
+        std::vector<float>& buffer = filling_->samples;
+        const uint64_t wanted = filling_->end + overlap_;
+        const size_t take = static_cast<size_t>(std::min<uint64_t>(count, wanted - position_));
+        if (buffer.capacity() < wanted - filling_->dataBegin) {
+            buffer.reserve(static_cast<size_t>(wanted - filling_->dataBegin));
+        }
+        buffer.insert(buffer.end(), samples, samples + take);
+        position_ += take;
+        samples += take;
+        count -= take;
+        if (position_ < wanted) break;
+
+        // Full: the next segment starts with this one's warm-up region and overlap.
+        SegmentSlot& next = newSegment(filling_->end);
+        const auto from = buffer.begin() + static_cast<std::ptrdiff_t>(next.dataBegin - filling_->dataBegin);
+        next.samples.assign(from, buffer.end());
+        filling_->data = buffer.data();
+        filling_->dataCount = buffer.size();
+        submit(*std::exchange(filling_, &next));
+    }
+}
+
+void SegmentedAnalysis::analyze(const float* samples, size_t count) {
+    if (analyzers_ != 0) {
+        position_ = count;
+        for (uint64_t begin = 0; begin < count; begin += segmentSamples_) {
+            SegmentSlot& segment = newSegment(begin);
+            segment.end = std::min<uint64_t>(segment.end, count);
+            segment.last = segment.end == count;
+            segment.data = samples + segment.dataBegin;
+            segment.dataCount =
+                static_cast<size_t>(std::min<uint64_t>(segment.end + overlap_, count) - segment.dataBegin);
+            submit(segment);
+        }
+    }
+    finish();
+}
+
+void SegmentedAnalysis::finish() {
+    if (filling_) {
+        // The stream ended inside this segment or its overlap; in the latter case a short last
+        // segment follows, cut exactly where analyze() would cut it.
+        SegmentSlot& segment = *std::exchange(filling_, nullptr);
+        SegmentSlot* tail = nullptr;
+        if (position_ > segment.end) {
+            tail = &newSegment(segment.end);
+            tail->end = position_;
+            tail->last = true;
+            tail->samples.assign(segment.samples.begin() + static_cast<std::ptrdiff_t>(tail->dataBegin - segment.dataBegin),
+                                 segment.samples.end());
+            tail->data = tail->samples.data();
+            tail->dataCount = tail->samples.size();
+        } else {
+            segment.end = position_;
+            segment.last = true;
+        }
+        segment.data = segment.samples.data();
+        segment.dataCount = segment.samples.size();
+        if (segment.end > segment.begin) {
+            submit(segment);
+        } else {
+            release(segment);
+        }
+        if (tail) submit(*tail);
+    }
+    while (inFlightCount_ > 0) mergeOldest();
+}
+
+void SegmentedAnalysis::submit(SegmentSlot& s) {
+    inFlight_[(inFlightHead_ + inFlightCount_) % kMaxInFlight] = &s;
+    ++inFlightCount_;
+    const bool energy = (analyzers_ & kAnalyzeEnergy) != 0;
+    const bool streams = (analyzers_ & (kAnalyzeBpm | kAnalyzeKey)) != 0;
+    s.pending.store((energy ? 1 : 0) + (streams ? 1 : 0), std::memory_order_relaxed);
+    if (pool_) {
+        // The two tasks share the segment's workspace but touch disjoint members of it.
+        if (energy) pool_->submit([this, &s] { runEnergy(s); });
+        if (streams) pool_->submit([this, &s] { runStreams(s); });
+    } else {
+        if (energy) runEnergy(s);
+        if (streams) runStreams(s);
+    }
+    while (inFlightCount_ >= maxInFlight_) mergeOldest();
+}
+
+void SegmentedAnalysis::runEnergy(SegmentSlot& segment) const {
+    try {
+        segment.energy.emplace(sampleRate_, windowSeconds_, &segment.workspace, segment.begin);
+        segment.energy->push(segment.data + (segment.begin - segment.dataBegin),
+                             static_cast<size_t>(segment.end - segment.begin));
+    } catch (...) {
+        segment.energyError = std::current_exception();
+    }
+    segment.pending.fetch_sub(1, std::memory_order_release);
+}
+
+void SegmentedAnalysis::runStreams(SegmentSlot& segment) const {
+    try {
+        DJT_PROFILE_SCOPE("analyzeSegment");
+        AnalysisWorkspace& ws = segment.workspace;
+        const bool withKey = (analyzers_ & kAnalyzeKey) != 0;
+        AnalysisDecimator decimator(sampleRate_, ws, withKey);
+        if (analyzers_ & kAnalyzeBpm) segment.bpm.emplace(decimator.bpmRate(), &ws);
+        if (withKey) segment.key.emplace(decimator.keyRate(), &ws);
+
+        // Stream samples this segment accounts for: its own hops, and the frames starting in its
+        // range. The last segment takes whatever the decimator produces, like a single pass.
+        const uint64_t span = segment.end - segment.begin;
+        uint64_t bpmLeft = std::numeric_limits<uint64_t>::max();
+        uint64_t keyLeft = std::numeric_limits<uint64_t>::max();
+        if (!segment.last) {
+            bpmLeft = segment.bpm ? decimator.streamLength(span, decimator.bpmRate()) : 0;
+            keyLeft = withKey ? decimator.streamLength(span, decimator.keyRate()) + KeyAccumulator::kFrameSize -
+                                    KeyAccumulator::kHopSize
+                              : 0;
+        }
+
+        const size_t warm = static_cast<size_t>(segment.begin - segment.dataBegin);
+        for (size_t offset = 0; offset < warm; offset += kStepSamples) {
+            decimator.push(segment.data + offset, std::min(kStepSamples, warm - offset));
+        }
+        for (size_t offset = warm; offset < segment.dataCount && (bpmLeft > 0 || keyLeft > 0);
+             offset += kStepSamples) {
+            decimator.push(segment.data + offset, std::min(kStepSamples, segment.dataCount - offset));
+            if (segment.bpm) {
+                const size_t n = static_cast<size_t>(std::min<uint64_t>(decimator.bpmCount(), bpmLeft));
+                segment.bpm->push(decimator.bpmBlock(), n);
+                bpmLeft -= n;
+            }
+            if (segment.key) {
+                const size_t n = static_cast<size_t>(std::min<uint64_t>(decimator.keyCount(), keyLeft));
+                segment.key->push(decimator.keyBlock(), n);
+                keyLeft -= n;
+            }
+        }
+    } catch (...) {
+        segment.streamError = std::current_exception();
+    }
+    segment.pending.fetch_sub(1, std::memory_order_release);
+}
+
+void SegmentedAnalysis::mergeOldest() {
+    SegmentSlot& s = *inFlight_[inFlightHead_];
+    inFlightHead_ = (inFlightHead_ + 1) % kMaxInFlight;
+    --inFlightCount_;
+    if (pool_) pool_->helpUntil([&s] { return s.pending.load(std::memory_order_acquire) == 0; });
+
+    std::exception_ptr error = s.energyError ? s.energyError : s.streamError;
+    if (!error) {
+        if (bpm_ && s.bpm) bpm_->append(*s.bpm);
+        if (energy_ && s.energy) energy_->append(*s.energy);
+        if (key_ && s.key) key_->append(*s.key);
+    }
+    release(s);
+    if (error) std::rethrow_exception(error);
+}
+
+void SegmentedAnalysis::release(SegmentSlot& segment) {
+    // The accumulators refer to the slot's workspace; drop them so the next use starts clean.
+    segment.bpm.reset();
+    segment.energy.reset();
+    segment.key.reset();
+    segment.inUse = false;
+}
+
+double SegmentedAnalysis::bpm(double minBpm, double maxBpm) const {
+    return bpm_ ? bpm_->estimate(minBpm, maxBpm) : 0.0;
+}
+
+BeatGrid SegmentedAnalysis::beatGrid(double bpm) const {
+    if (!bpm_ || sampleRate_ <= 0) return {};
+    return fitBeatGrid({bpm_->onsets()}, bpm, static_cast<double>(position_) / sampleRate_);
+}
+
+std::string SegmentedAnalysis::key() const { return key_ ? key_->estimate() : "Unknown"; }
+
+std::array<double, 12> SegmentedAnalysis::chroma() const {
+    return key_ ? chromaFromHistogram(key_->histogram()) : std::array<double, 12>{};
+}
+
+std::vector<double> SegmentedAnalysis::energyCurve(double gain) const {
+    return energy_ ? energy_->finish(gain) : std::vector<double>();
+}
+
+EnergyIndex SegmentedAnalysis::energyIndex(double gain) const {
+    return energy_ ? energy_->finishIndex(gain) : EnergyIndex();
+}
@@ -0,0 +1,481 @@
+#include "SetSequencer.hpp"
+
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Well above any transition score, so a set breaks the tempo limit only where it has to.
+constexpr double kTempoPenalty = 100.0;
+// Smallest objective gain that counts as an improvement.
+constexpr double kMinGain = 1e-9;
+// Where the Peak arc tops out, as a share of the set.
+constexpr double kPeakAt = 0.7;
+// The longer part of an or-opt move is arbitrary; the moved segment is at most this long.
+constexpr size_t kMaxMovedTracks = 3;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Relative tempo change from a to b after moving b to a's closest octave; 0 if either is unknown.
+double tempoStep(double bpmA, double bpmB) {
+    const double ratio = foldedTempoRatio(bpmA, bpmB);
+    return std::abs(1.0 - ratio) / (0.5 * (1.0 + ratio));
+}
+
+// Energy rank the arc asks for at position x of the set (0 first track, 1 last).
+double arcTarget(EnergyArc arc, double x) {
+    switch (arc) {
+    case EnergyArc::Rise: return x;
+    case EnergyArc::Fall: return 1.0 - x;
+    case EnergyArc::Peak: return x < kPeakAt ? x / kPeakAt : (1.0 - x) / (1.0 - kPeakAt);
+    case EnergyArc::None: break;
+    }
+    return 0.0;
+}
+
+// Rank of each track by mean energy: 0 quietest .. 1 loudest.
+std::vector<double> energyRanks(const std::vector<double>& means) {
+    const size_t n = means.size();
+    std::vector<size_t> byEnergy(n);
+    std::iota(byEnergy.begin(), byEnergy.end(), size_t{0});
+    std::stable_sort(byEnergy.begin(), byEnergy.end(), [&](size_t a, size_t b) { return means[a] < means[b]; });
+    std::vector<double> ranks(n, 0.0);
+    for (size_t r = 1; r < n; ++r) ranks[byEnergy[r]] = static_cast<double>(r) / static_cast<double>(n - 1);
+    return ranks;
+}
+
+// Mean of the windows that were decoded; 0 if none were.
+template <typename Level>
+double meanEnergy(size_t windows, Level level) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < windows; ++i) {
+        const double value = level(i);
+        if (std::isnan(value)) continue;
+        sum += value;
+        ++count;
+    }
+    return count > 0 ? sum / static_cast<double>(count) : 0.0;
+}
+
+// splitmix64 finalizer: spreads track indices over 64 bits for the visited-set hashes.
+uint64_t mixBits(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Dense edge weights (transition score less any tempo penalty), every track's successors best
+// edge first, and what the energy arc costs each track at each position.
+class SetGraph {
+public:
+    SetGraph(const std::vector<TransitionProfile>& profiles,
+             const std::vector<double>& ranks,
+             const SequenceOptions& options,
+             ThreadPool& pool)
+        : n_(profiles.size()), ranks_(ranks) {
+        weights_.resize(n_ * n_, 0.0f);
+        successors_.resize(n_ * (n_ > 0 ? n_ - 1 : 0));
+        for (size_t a = 0; a < n_; ++a) {
+            pool.submit([&, a] {
+                DJT_PROFILE_SCOPE("sequenceRow");
+                float* row = &weights_[a * n_];
+                for (size_t b = 0; b < n_; ++b) {
+                    if (b == a) continue;
+                    double w = findBestTransition(profiles[a], profiles[b]).score;
+                    if (options.maxBpmStep > 0.0 &&
+                        tempoStep(profiles[a].bpm(), profiles[b].bpm()) > options.maxBpmStep) {
+                        w -= kTempoPenalty;
+                    }
+                    row[b] = static_cast<float>(w);
+                }
+                uint32_t* next = successors_.data() + a * (n_ - 1);
+                for (size_t b = 0, k = 0; b < n_; ++b) {
+                    if (b != a) next[k++] = static_cast<uint32_t>(b);
+                }
+                std::stable_sort(next, next + (n_ - 1), [row](uint32_t x, uint32_t y) { return row[x] > row[y]; });
+            });
+        }
+        pool.wait();
+
+        if (options.arc != EnergyArc::None && options.arcWeight > 0.0) {
+            arcWeight_ = options.arcWeight;
+            targets_.resize(n_);
+            for (size_t p = 0; p < n_; ++p) {
+                targets_[p] = arcTarget(options.arc, n_ > 1 ? static_cast<double>(p) / static_cast<double>(n_ - 1) : 0.0);
+            }
+        }
+    }
+
+    size_t size() const { return n_; }
+    bool hasArc() const { return arcWeight_ > 0.0; }
+
+    double weight(uint32_t a, uint32_t b) const { return weights_[a * n_ + b]; }
+
+    // Every other track, best edge out of `a` first; size() - 1 of them.
+    const uint32_t* successors(uint32_t a) const { return successors_.data() + a * (n_ - 1); }
+
+    double arcCost(uint32_t track, size_t position) const {
+        return hasArc() ? arcWeight_ * std::abs(ranks_[track] - targets_[position]) : 0.0;
+    }
+
+    double rank(uint32_t track) const { return ranks_[track]; }
+    double target(size_t position) const { return hasArc() ? targets_[position] : 0.0; }
+
+private:
+    size_t n_;
+    std::vector<float> weights_;
+    std::vector<uint32_t> successors_;
+    std::vector<double> ranks_;
+    std::vector<double> targets_;
+    double arcWeight_ = 0.0;
+};
+
+struct BeamState {
+    std::vector<uint32_t> path;
+    std::vector<uint64_t> visited; // bitset over tracks
+    uint64_t hash = 0;             // of the visited set
+    double value = 0.0;
+};
+
+struct BeamCandidate {
+    size_t parent;
+    uint32_t next;
+    double value;
+    uint64_t key; // visited set and last track: candidates with equal keys have the same future
+};
+
+// Greedy construction: extend each partial set by its best few edges and keep the beamWidth best
+// distinct results, one track position at a time.
+std::vector<uint32_t> beamSearch(const SetGraph& graph, const SequenceOptions& options, ThreadPool& pool) {
+    DJT_PROFILE_SCOPE("sequenceBeam");
+    const size_t n = graph.size();
+    const size_t words = (n + 63) / 64;
+    const size_t beamWidth = std::max<size_t>(1, options.beamWidth);
+    const size_t branching = std::max<size_t>(1, options.branching);
+    const bool fixedEnd = options.endTrack != kAnyTrack;
+    const uint32_t endTrack = fixedEnd ? static_cast<uint32_t>(options.endTrack) : UINT32_MAX;
+
+    std::vector<BeamState> beam;
+    for (uint32_t t = 0; t < n; ++t) {
+        if (options.startTrack != kAnyTrack ? t != options.startTrack : (t == endTrack && n > 1)) continue;
+        BeamState state;
+        state.path.reserve(n);
+        state.path.push_back(t);
+        state.visited.assign(words, 0);
+        state.visited[t / 64] |= uint64_t{1} << (t % 64);
+        state.hash = mixBits(t);
+        state.value = -graph.arcCost(t, 0);
+        beam.push_back(std::move(state));
+    }
+
+    std::vector<std::vector<BeamCandidate>> expansions;
+    std::vector<BeamCandidate> candidates;
+    std::unordered_set<uint64_t> seen;
+    for (size_t position = 1; position < n; ++position) {
+        expansions.assign(beam.size(), {});
+        const size_t tasks = std::min(beam.size(), pool.size() * 4);
+        for (size_t task = 0; task < tasks; ++task) {
+            pool.submit([&, task] {
+                for (size_t i = task; i < beam.size(); i += tasks) {
+                    const BeamState& state = beam[i];
+                    std::vector<BeamCandidate>& out = expansions[i];
+                    const uint32_t last = state.path.back();
+                    auto add = [&](uint32_t next) {
+                        const uint64_t visitedHash = state.hash ^ mixBits(next);
+                        out.push_back({i, next, state.value + graph.weight(last, next) - graph.arcCost(next, position),
+                                       mixBits(visitedHash + next)});
+                    };
+                    if (fixedEnd && position == n - 1) {
+                        add(endTrack);
+                        continue;
+                    }
+                    // Edges come best first; with an arc, rank a few more of them by arc cost too.
+                    const size_t wanted = graph.hasArc() ? branching * 4 : branching;
+                    const uint32_t* next = graph.successors(last);
+                    for (size_t k = 0; k + 1 < n && out.size() < wanted; ++k) {
+                        const uint32_t t = next[k];
+                        if (t == endTrack || (state.visited[t / 64] >> (t % 64) & 1) != 0) continue;
+                        add(t);
+                    }
+                    if (out.size() > branching) {
+                        std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(branching), out.end(),
+                                          [](const BeamCandidate& x, const BeamCandidate& y) { return x.value > y.value; });
+                        out.resize(branching);
+                    }
+                }
+            });
+        }
+        pool.wait();
+
+        candidates.clear();
+        for (const auto& expansion : expansions) candidates.insert(candidates.end(), expansion.begin(), expansion.end());
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const BeamCandidate& x, const BeamCandidate& y) { return x.value > y.value; });
+        seen.clear();
+        std::vector<BeamState> nextBeam;
+        nextBeam.reserve(beamWidth);
+        for (const BeamCandidate& c : candidates) {
+            if (nextBeam.size() == beamWidth) break;
+            if (!seen.insert(c.key).second) continue;
+            BeamState state = beam[c.parent];
+            state.path.push_back(c.next);
+            state.visited[c.next / 64] |= uint64_t{1} << (c.next % 64);
+            state.hash ^= mixBits(c.next);
+            state.value = c.value;
+            nextBeam.push_back(std::move(state));
+        }
+        beam = std::move(nextBeam);
+    }
+    return beam.front().path;
+}
+
+// 2-opt and or-opt over a complete order. Positions outside [first, last] stay put.
+class LocalSearch {
+public:
+    LocalSearch(const SetGraph& graph, std::vector<uint32_t> order, size_t first, size_t last)
+        : graph_(graph), order_(std::move(order)), first_(first), last_(last) {
+        refresh();
+    }
+
+    const std::vector<uint32_t>& order() const { return order_; }
+
+    // Find the best improving move starting at each position, in parallel, then apply as many as
+    // touch disjoint stretches of the order, best first. Returns how many were applied.
+    size_t sweep(ThreadPool& pool) {
+        DJT_PROFILE_SCOPE("sequenceSweep");
+        const size_t n = order_.size();
+        if (last_ <= first_) return 0;
+        std::vector<Move> best(n);
+        const size_t starts = last_ - first_;
+        const size_t tasks = std::min(starts, pool.size() * 4);
+        for (size_t task = 0; task < tasks; ++task) {
+            // Strided, since early positions have the most moves.
+            pool.submit([&, task] {
+                for (size_t lo = first_ + task; lo < last_; lo += tasks) best[lo] = bestMoveFrom(lo);
+            });
+        }
+        pool.wait();
+
+        std::vector<Move> moves;
+        for (const Move& move : best) {
+            if (move.gain > kMinGain) moves.push_back(move);
+        }
+        std::stable_sort(moves.begin(), moves.end(), [](const Move& x, const Move& y) { return x.gain > y.gain; });
+        // A move's gain reads positions lo - 1 .. hi + 1, and it rewrites lo .. hi.
+        std::vector<char> touched(n, 0);
+        size_t applied = 0;
+        for (const Move& move : moves) {
+            const size_t from = move.lo > 0 ? move.lo - 1 : 0;
+            const size_t to = std::min(move.hi + 1, n - 1);
+            if (std::find(touched.begin() + static_cast<std::ptrdiff_t>(from),
+                          touched.begin() + static_cast<std::ptrdiff_t>(to) + 1, 1) !=
+                touched.begin() + static_cast<std::ptrdiff_t>(to) + 1) {
+                continue;
+            }
+            auto begin = order_.begin();
+            if (move.reverse) {
+                std::reverse(begin + static_cast<std::ptrdiff_t>(move.lo), begin + static_cast<std::ptrdiff_t>(move.hi) + 1);
+            } else {
+                std::rotate(begin + static_cast<std::ptrdiff_t>(move.lo), begin + static_cast<std::ptrdiff_t>(move.mid),
+                            begin + static_cast<std::ptrdiff_t>(move.hi) + 1);
+            }
+            std::fill(touched.begin() + static_cast<std::ptrdiff_t>(from), touched.begin() + static_cast<std::ptrdiff_t>(to) + 1, 1);
+            ++applied;
+        }
+        if (applied > 0) refresh();
+        return applied;
+    }
+
+private:
+    // Reverse order_[lo..hi], or rotate it so that order_[mid..hi] comes first.
+    struct Move {
+        double gain = 0.0;
+        size_t lo = 0;
+        size_t mid = 0;
+        size_t hi = 0;
+        bool reverse = false;
+    };
+
+    double w(size_t from, size_t to) const { return graph_.weight(order_[from], order_[to]); }
+
+    // Prefix sums over the current order: edges forward and reversed, and arc costs.
+    void refresh() {
+        const size_t n = order_.size();
+        forward_.assign(n, 0.0);
+        backward_.assign(n, 0.0);
+        arc_.assign(n + 1, 0.0);
+        for (size_t p = 0; p + 1 < n; ++p) {
+            forward_[p + 1] = forward_[p] + w(p, p + 1);
+            backward_[p + 1] = backward_[p] + w(p + 1, p);
+        }
+        for (size_t p = 0; p < n; ++p) arc_[p + 1] = arc_[p] + graph_.arcCost(order_[p], p);
+    }
+
+    // Best move over order_[lo..hi] for every hi: reversals, and rotations that move at most
+    // kMaxMovedTracks tracks from one end of the stretch to the other. A rotation shifts the rest
+    // of the stretch by the moved count, so its arc cost is kept as a running sum as hi grows.
+    Move bestMoveFrom(size_t lo) const {
+        const size_t n = order_.size();
+        const bool arc = graph_.hasArc();
+        double shiftedLeft[kMaxMovedTracks + 1] = {};  // [s]: order_[lo + s..hi] moved s places earlier
+        double shiftedRight[kMaxMovedTracks + 1] = {}; // [s]: order_[lo..hi - s] moved s places later
+        Move best;
+        for (size_t hi = lo + 1; hi <= last_; ++hi) {
+            const size_t length = hi - lo + 1;
+            if (arc) {
+                for (size_t s = 1; s <= kMaxMovedTracks && s < length; ++s) {
+                    shiftedLeft[s] += graph_.arcCost(order_[hi], hi - s);
+                    shiftedRight[s] += graph_.arcCost(order_[hi - s], hi);
+                }
+            }
+            // Edges into and out of the stretch; the arc can at most give back what it costs now.
+            const double arcNow = arc_[hi + 1] - arc_[lo];
+            const double outer = (lo > 0 ? -w(lo - 1, lo) : 0.0) + (hi + 1 < n ? -w(hi, hi + 1) : 0.0);
+
+            double gain = outer + (lo > 0 ? w(lo - 1, hi) : 0.0) + (hi + 1 < n ? w(lo, hi + 1) : 0.0) +
+                          (backward_[hi] - backward_[lo]) - (forward_[hi] - forward_[lo]);
+            if (gain + arcNow > best.gain) {
+                if (arc) {
+                    double arcAfter = 0.0;
+                    for (size_t k = lo; k <= hi; ++k) arcAfter += graph_.arcCost(order_[lo + hi - k], k);
+                    gain += arcNow - arcAfter;
+                }
+                if (gain > best.gain) best = {gain, lo, 0, hi, true};
+            }
+
+            // Move the first s tracks to the back (split at lo + s), or the last s to the front
+            // (split at hi + 1 - s) unless that split was already tried from the front.
+            for (size_t s = 1; s <= kMaxMovedTracks && s < length; ++s) {
+                for (const bool toBack : {true, false}) {
+                    const size_t mid = toBack ? lo + s : hi + 1 - s;
+                    if (!toBack && mid - lo <= kMaxMovedTracks) continue;
+                    double rotated = outer + (lo > 0 ? w(lo - 1, mid) : 0.0) + w(hi, lo) - w(mid - 1, mid) +
+                                     (hi + 1 < n ? w(mid - 1, hi + 1) : 0.0);
+                    if (rotated + arcNow <= best.gain) continue;
+                    if (arc) {
+                        double arcAfter = toBack ? shiftedLeft[s] : shiftedRight[s];
+                        for (size_t q = 0; q < s; ++q) {
+                            arcAfter += toBack ? graph_.arcCost(order_[lo + q], hi + 1 - s + q)
+                                               : graph_.arcCost(order_[mid + q], lo + q);
+                        }
+                        rotated += arcNow - arcAfter;
+                    }
+                    if (rotated > best.gain) best = {rotated, lo, mid, hi, false};
+                }
+            }
+        }
+        return best;
+    }
+
+    const SetGraph& graph_;
+    std::vector<uint32_t> order_;
+    size_t first_;
+    size_t last_;
+    std::vector<double> forward_;  // forward_[k]: edges order_[p] -> order_[p + 1] for p < k
+    std::vector<double> backward_; // the same edges taken in reverse
+    std::vector<double> arc_;      // arc_[k]: arc cost of positions before k
+};
+
+SetPlan sequence(const std::vector<TransitionProfile>& profiles,
+                 const std::vector<double>& meanEnergies,
+                 const SequenceOptions& options) {
+    const size_t n = profiles.size();
+    if (n > UINT32_MAX) throw std::invalid_argument("sequenceSet: too many tracks");
+    if ((options.startTrack != kAnyTrack && options.startTrack >= n) ||
+        (options.endTrack != kAnyTrack && options.endTrack >= n)) {
+        throw std::invalid_argument("sequenceSet: start or end track out of range");
+    }
+    if (n > 1 && options.startTrack != kAnyTrack && options.startTrack == options.endTrack) {
+        throw std::invalid_argument("sequenceSet: start and end track are the same");
+    }
+    SetPlan plan;
+    if (n == 0) return plan;
+    if (n == 1) {
+        // Nothing to order or score; a lone track has no energy rank to hold to an arc.
+        plan.order.push_back(0);
+        return plan;
+    }
+
+    ThreadPool pool(options.jobs);
+    auto started = Clock::now();
+    const SetGraph graph(profiles, energyRanks(meanEnergies), options, pool);
+    plan.stats.pairsScored = static_cast<uint64_t>(n) * (n - 1);
+    plan.stats.scoreSeconds = secondsSince(started);
+
+    started = Clock::now();
+    std::vector<uint32_t> order = beamSearch(graph, options, pool);
+    plan.stats.beamSeconds = secondsSince(started);
+
+    started = Clock::now();
+    const size_t first = options.startTrack != kAnyTrack ? 1 : 0;
+    const size_t last = n - 1 - (options.endTrack != kAnyTrack && n > 1 ? 1 : 0);
+    LocalSearch search(graph, std::move(order), first, std::max(first, last));
+    while (plan.stats.passes < options.maxPasses) {
+        ++plan.stats.passes;
+        const size_t applied = search.sweep(pool);
+        plan.stats.moves += applied;
+        if (applied == 0) break;
+    }
+    plan.stats.searchSeconds = secondsSince(started);
+
+    const std::vector<uint32_t>& best = search.order();
+    plan.order.assign(best.begin(), best.end());
+    double arcDistance = 0.0;
+    for (size_t p = 0; p < n; ++p) {
+        plan.objective -= graph.arcCost(best[p], p);
+        if (graph.hasArc()) arcDistance += std::abs(graph.rank(best[p]) - graph.target(p));
+    }
+    plan.arcDeviation = arcDistance / static_cast<double>(n);
+    for (size_t p = 0; p + 1 < n; ++p) {
+        plan.transitions.push_back(findBestTransition(profiles[best[p]], profiles[best[p + 1]]));
+        plan.totalScore += plan.transitions.back().score;
+        plan.objective += graph.weight(best[p], best[p + 1]);
+        if (options.maxBpmStep > 0.0 &&
+            tempoStep(profiles[best[p]].bpm(), profiles[best[p + 1]].bpm()) > options.maxBpmStep) {
+            ++plan.tempoViolations;
+        }
+    }
+    return plan;
+}
+} // namespace
+
+SetPlan sequenceSet(const std::vector<TrackAnalysis>& tracks, const SequenceOptions& options) {
+    DJT_PROFILE_SCOPE("sequenceSet");
+    std::vector<TransitionProfile> profiles;
+    std::vector<double> means;
+    profiles.reserve(tracks.size());
+    means.reserve(tracks.size());
+    for (const TrackAnalysis& track : tracks) {
+        profiles.emplace_back(track);
+        means.push_back(meanEnergy(track.energyCurve.size(), [&](size_t i) { return track.energyCurve[i]; }));
+    }
+    return sequence(profiles, means, options);
+}
+
+SetPlan sequenceSet(const TrackStore& store, const SequenceOptions& options) {
+    DJT_PROFILE_SCOPE("sequenceSet");
+    std::vector<TransitionProfile> profiles;
+    std::vector<double> means;
+    profiles.reserve(store.size());
+    means.reserve(store.size());
+    for (size_t i = 0; i < store.size(); ++i) {
+        const TrackView view = store.track(i);
+        profiles.emplace_back(view);
+        means.push_back(meanEnergy(view.windows, [&](size_t w) { return view.energyAt(w); }));
+    }
+    return sequence(profiles, means, options);
+}
@@ -0,0 +1,697 @@
+#include "SimdKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define DJT_SIMD_X86 1
+#define DJT_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+// ---- Scalar reference implementations ----
+
+double sumOfSquaresScalar(const float* x, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double v = x[i];
+        sum += v * v;
+    }
+    return sum;
+}
+
+float maxAbsScalar(const float* x, size_t n) {
+    float maxVal = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        maxVal = std::max(maxVal, std::abs(x[i]));
+    }
+    return maxVal;
+}
+
+// Generic channel average from frame `first` on; also the tail handler for the vector paths.
+void downmixScalar(const float* in, size_t first, size_t frames, int channels, float* out) {
+    const size_t ch = static_cast<size_t>(channels);
+    for (size_t i = first; i < frames; ++i) {
+        float sum = 0.0f;
+        for (size_t c = 0; c < ch; ++c) {
+            sum += in[i * ch + c];
+        }
+        out[i] = sum / static_cast<float>(channels);
+    }
+}
+
+float downmixPeakScalar(const float* in, size_t frames, int channels, float* out) {
+    if (channels == 1) {
+        if (out != in) std::memcpy(out, in, frames * sizeof(float));
+    } else {
+        downmixScalar(in, 0, frames, channels, out);
+    }
+    return maxAbsScalar(out, frames);
+}
+
+void scaleScalar(float* x, size_t n, float gain) {
+    for (size_t i = 0; i < n; ++i) x[i] *= gain;
+}
+
+void multiplyScalar(const float* x, const float* w, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = x[i] * w[i];
+}
+
+float dotScalar(const float* a, const float* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+void multiplyAccumulateScalar(const float* x, const float* w, float* acc, size_t n) {
+    for (size_t i = 0; i < n; ++i) acc[i] += x[i] * w[i];
+}
+
+void mixWeightedScalar(const float* a, const float* ga, const float* b, const float* gb, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = a[i] * ga[i] + b[i] * gb[i];
+}
+
+size_t polyphaseScalar(const float* coeffs, size_t taps, size_t up, size_t down, const float* in,
+                       size_t count, size_t& pos, size_t& phase, float* out) {
+    const size_t step = down / up;
+    const size_t rem = down % up;
+    size_t written = 0;
+    while (pos + taps <= count) {
+        out[written++] = dotScalar(coeffs + phase * taps, in + pos, taps);
+        pos += step;
+        phase += rem;
+        if (phase >= up) {
+            phase -= up;
+            ++pos;
+        }
+    }
+    return written;
+}
+
+void int16ToFloatScalar(const int16_t* x, size_t n, float* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(x[i]) * (1.0f / 32768.0f);
+}
+
+void rescaleScalar(const double* x, size_t n, double offset, double range, double* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = (x[i] - offset) / range;
+}
+
+#ifdef DJT_SIMD_X86
+// ---- SSE2 ----
+
+DJT_TARGET("sse2") double sumOfSquaresSse2(const float* x, size_t n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128d lo = _mm_cvtps_pd(v);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(lo, lo));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(hi, hi));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + sumOfSquaresScalar(x + i, n - i);
+}
+
+DJT_TARGET("sse2") float maxAbsSse2(const float* x, size_t n) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        // maxps returns its second operand when either is NaN, which keeps NaNs out of acc.
+        acc = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(x + i), absMask), acc);
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    float m = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return std::max(m, maxAbsScalar(x + i, n - i));
+}
+
+DJT_TARGET("sse2") float downmixPeakSse2(const float* in, size_t frames, int channels, float* out) {
+    if (channels != 2) return downmixPeakScalar(in, frames, channels, out);
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t i = 0;
+    // Frame i is read (at 2i) before mono sample i is written, so out may alias in.
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(in + 2 * i);
+        __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+        __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+    downmixScalar(in, i, frames, channels, out);
+    return maxAbsSse2(out, frames);
+}
+
+DJT_TARGET("sse2") void scaleSse2(float* x, size_t n, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), g));
+    scaleScalar(x + i, n - i, gain);
+}
+
+DJT_TARGET("sse2") void multiplySse2(const float* x, const float* w, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(w + i)));
+    }
+    multiplyScalar(x + i, w + i, out + i, n - i);
+}
+
+DJT_TARGET("sse2") void multiplyAccumulateSse2(const float* x, const float* w, float* acc, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(w + i))));
+    }
+    multiplyAccumulateScalar(x + i, w + i, acc + i, n - i);
+}
+
+DJT_TARGET("sse2") void mixWeightedSse2(const float* a, const float* ga, const float* b, const float* gb, float* out,
+                                        size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 wa = _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(ga + i));
+        const __m128 wb = _mm_mul_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(gb + i));
+        _mm_storeu_ps(out + i, _mm_add_ps(wa, wb));
+    }
+    mixWeightedScalar(a + i, ga + i, b + i, gb + i, out + i, n - i);
+}
+
+DJT_TARGET("sse2") float dotSse2(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotScalar(a + i, b + i, n - i);
+}
+
+DJT_TARGET("sse2") size_t polyphaseSse2(const float* coeffs, size_t taps, size_t up, size_t down, const float* in,
+                                        size_t count, size_t& pos, size_t& phase, float* out) {
+    const size_t step = down / up;
+    const size_t rem = down % up;
+    size_t written = 0;
+    while (pos + taps <= count) {
+        out[written++] = dotSse2(coeffs + phase * taps, in + pos, taps);
+        pos += step;
+        phase += rem;
+        if (phase >= up) {
+            phase -= up;
+            ++pos;
+        }
+    }
+    return written;
+}
+
+DJT_TARGET("sse2") void int16ToFloatSse2(const int16_t* x, size_t n, float* out) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        // Widen with sign extension: put each int16 in the top half, then shift back down.
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    int16ToFloatScalar(x + i, n - i, out + i);
+}
+
+DJT_TARGET("sse2") void rescaleSse2(const double* x, size_t n, double offset, double range, double* out) {
+    const __m128d o = _mm_set1_pd(offset);
+    const __m128d r = _mm_set1_pd(range);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_div_pd(_mm_sub_pd(_mm_loadu_pd(x + i), o), r));
+    }
+    rescaleScalar(x + i, n - i, offset, range, out + i);
+}
+
+// ---- AVX2 ----
+
+DJT_TARGET("avx2") double sumOfSquaresAvx2(const float* x, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d lo = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+        __m256d hi = _mm256_cvtps_pd(_mm_loadu_ps(x + i + 4));
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(lo, lo));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(hi, hi));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumOfSquaresScalar(x + i, n - i);
+}
+
+DJT_TARGET("avx2") float maxAbsAvx2(const float* x, size_t n) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(x + i), absMask), acc);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    float m = *std::max_element(lanes, lanes + 8);
+    return std::max(m, maxAbsScalar(x + i, n - i));
+}
+
+DJT_TARGET("avx2") float downmixPeakAvx2(const float* in, size_t frames, int channels, float* out) {
+    if (channels != 2) return downmixPeakScalar(in, frames, channels, out);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a = _mm256_loadu_ps(in + 2 * i);
+        __m256 b = _mm256_loadu_ps(in + 2 * i + 8);
+        // In-lane shuffles leave 64-bit pairs as [0,1 | 4,5 | 2,3 | 6,7]; permute restores order.
+        __m256 left = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 right = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        left = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(left), _MM_SHUFFLE(3, 1, 2, 0)));
+        right = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(right), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(left, right), half));
+    }
+    downmixScalar(in, i, frames, channels, out);
+    return maxAbsAvx2(out, frames);
+}
+
+DJT_TARGET("avx2") void scaleAvx2(float* x, size_t n, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), g));
+    scaleScalar(x + i, n - i, gain);
+}
+
+DJT_TARGET("avx2") void multiplyAvx2(const float* x, const float* w, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(w + i)));
+    }
+    multiplyScalar(x + i, w + i, out + i, n - i);
+}
+
+DJT_TARGET("avx2") void multiplyAccumulateAvx2(const float* x, const float* w, float* acc, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 product = _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(w + i));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), product));
+    }
+    multiplyAccumulateScalar(x + i, w + i, acc + i, n - i);
+}
+
+DJT_TARGET("avx2") void mixWeightedAvx2(const float* a, const float* ga, const float* b, const float* gb, float* out,
+                                        size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 wa = _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(ga + i));
+        const __m256 wb = _mm256_mul_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(gb + i));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(wa, wb));
+    }
+    mixWeightedScalar(a + i, ga + i, b + i, gb + i, out + i, n - i);
+}
+
+DJT_TARGET("avx2") float dotAvx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+    float sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    return sum + dotScalar(a + i, b + i, n - i);
+}
+
+DJT_TARGET("avx2") size_t polyphaseAvx2(const float* coeffs, size_t taps, size_t up, size_t down, const float* in,
+                                        size_t count, size_t& pos, size_t& phase, float* out) {
+    size_t written = 0;
+    if (up == 1) {
+        // Integer decimation: four outputs share each coefficient load (see polyphaseAvx512).
+        while (pos + 3 * down + taps <= count) {
+            __m256 acc[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+            const float* x = in + pos;
+            size_t i = 0;
+            for (; i + 8 <= taps; i += 8) {
+                const __m256 c = _mm256_loadu_ps(coeffs + i);
+                for (size_t k = 0; k < 4; ++k) {
+                    acc[k] = _mm256_add_ps(acc[k], _mm256_mul_ps(c, _mm256_loadu_ps(x + k * down + i)));
+                }
+            }
+            for (size_t k = 0; k < 4; ++k) {
+                float lanes[8];
+                _mm256_storeu_ps(lanes, acc[k]);
+                const float sum =
+                    ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+                out[written++] = sum + dotScalar(coeffs + i, x + k * down + i, taps - i);
+            }
+            pos += 4 * down;
+        }
+    }
+    const size_t step = down / up;
+    const size_t rem = down % up;
+    while (pos + taps <= count) {
+        out[written++] = dotAvx2(coeffs + phase * taps, in + pos, taps);
+        pos += step;
+        phase += rem;
+        if (phase >= up) {
+            phase -= up;
+            ++pos;
+        }
+    }
+    return written;
+}
+
+DJT_TARGET("avx2") void int16ToFloatAvx2(const int16_t* x, size_t n, float* out) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    int16ToFloatScalar(x + i, n - i, out + i);
+}
+
+DJT_TARGET("avx2") void rescaleAvx2(const double* x, size_t n, double offset, double range, double* out) {
+    const __m256d o = _mm256_set1_pd(offset);
+    const __m256d r = _mm256_set1_pd(range);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_sub_pd(_mm256_loadu_pd(x + i), o), r));
+    }
+    rescaleScalar(x + i, n - i, offset, range, out + i);
+}
+
+// ---- AVX-512 ----
+
+// GCC's avx512fintrin.h seeds the unmasked loads and conversions with _mm512_undefined_*, which
+// -Wall reports as uninitialized once these kernels are inlined; every lane is overwritten.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+DJT_TARGET("avx512f") double sumOfSquaresAvx512(const float* x, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d lo = _mm512_cvtps_pd(_mm256_loadu_ps(x + i));
+        __m512d hi = _mm512_cvtps_pd(_mm256_loadu_ps(x + i + 8));
+        acc0 = _mm512_add_pd(acc0, _mm512_mul_pd(lo, lo));
+        acc1 = _mm512_add_pd(acc1, _mm512_mul_pd(hi, hi));
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1)) + sumOfSquaresScalar(x + i, n - i);
+}
+
+DJT_TARGET("avx512f") float maxAbsAvx512(const float* x, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm512_max_ps(_mm512_abs_ps(_mm512_loadu_ps(x + i)), acc);
+    }
+    return std::max(_mm512_reduce_max_ps(acc), maxAbsScalar(x + i, n - i));
+}
+
+DJT_TARGET("avx512f") float downmixPeakAvx512(const float* in, size_t frames, int channels, float* out) {
+    if (channels != 2) return downmixPeakScalar(in, frames, channels, out);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512i evenIdx = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i oddIdx = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    size_t i = 0;
+    for (; i + 16 <= frames; i += 16) {
+        __m512 a = _mm512_loadu_ps(in + 2 * i);
+        __m512 b = _mm512_loadu_ps(in + 2 * i + 16);
+        __m512 left = _mm512_permutex2var_ps(a, evenIdx, b);
+        __m512 right = _mm512_permutex2var_ps(a, oddIdx, b);
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_add_ps(left, right), half));
+    }
+    downmixScalar(in, i, frames, channels, out);
+    return maxAbsAvx512(out, frames);
+}
+
+DJT_TARGET("avx512f") void scaleAvx512(float* x, size_t n, float gain) {
+    const __m512 g = _mm512_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(x + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), g));
+    scaleScalar(x + i, n - i, gain);
+}
+
+DJT_TARGET("avx512f") void multiplyAvx512(const float* x, const float* w, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(w + i)));
+    }
+    multiplyScalar(x + i, w + i, out + i, n - i);
+}
+
+DJT_TARGET("avx512f") void multiplyAccumulateAvx512(const float* x, const float* w, float* acc, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 product = _mm512_mul_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(w + i));
+        _mm512_storeu_ps(acc + i, _mm512_add_ps(_mm512_loadu_ps(acc + i), product));
+    }
+    multiplyAccumulateScalar(x + i, w + i, acc + i, n - i);
+}
+
+DJT_TARGET("avx512f") void mixWeightedAvx512(const float* a, const float* ga, const float* b, const float* gb,
+                                             float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 wa = _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(ga + i));
+        const __m512 wb = _mm512_mul_ps(_mm512_loadu_ps(b + i), _mm512_loadu_ps(gb + i));
+        _mm512_storeu_ps(out + i, _mm512_add_ps(wa, wb));
+    }
+    mixWeightedScalar(a + i, ga + i, b + i, gb + i, out + i, n - i);
+}
+
+DJT_TARGET("avx512f") float dotAvx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    if (i + 16 <= n) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        i += 16;
+    }
+    if (i < n) { // masked tail
+        const __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1u);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+DJT_TARGET("avx512f") size_t polyphaseAvx512(const float* coeffs, size_t taps, size_t up, size_t down, const float* in,
+                                             size_t count, size_t& pos, size_t& phase, float* out) {
+    size_t written = 0;
+    if (up == 1) {
+        // Integer decimation: every output uses the same taps, so four outputs share each
+        // coefficient load and run as independent accumulator chains.
+        const __mmask16 tail = static_cast<__mmask16>((1u << (taps % 16)) - 1u);
+        while (pos + 3 * down + taps <= count) {
+            __m512 acc0 = _mm512_setzero_ps();
+            __m512 acc1 = _mm512_setzero_ps();
+            __m512 acc2 = _mm512_setzero_ps();
+            __m512 acc3 = _mm512_setzero_ps();
+            const float* x = in + pos;
+            size_t i = 0;
+            for (; i + 16 <= taps; i += 16) {
+                const __m512 c = _mm512_loadu_ps(coeffs + i);
+                acc0 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + i), acc0);
+                acc1 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + down + i), acc1);
+                acc2 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + 2 * down + i), acc2);
+                acc3 = _mm512_fmadd_ps(c, _mm512_loadu_ps(x + 3 * down + i), acc3);
+            }
+            if (i < taps) {
+                const __m512 c = _mm512_maskz_loadu_ps(tail, coeffs + i);
+                acc0 = _mm512_fmadd_ps(c, _mm512_maskz_loadu_ps(tail, x + i), acc0);
+                acc1 = _mm512_fmadd_ps(c, _mm512_maskz_loadu_ps(tail, x + down + i), acc1);
+                acc2 = _mm512_fmadd_ps(c, _mm512_maskz_loadu_ps(tail, x + 2 * down + i), acc2);
+                acc3 = _mm512_fmadd_ps(c, _mm512_maskz_loadu_ps(tail, x + 3 * down + i), acc3);
+            }
+            out[written++] = _mm512_reduce_add_ps(acc0);
+            out[written++] = _mm512_reduce_add_ps(acc1);
+            out[written++] = _mm512_reduce_add_ps(acc2);
+            out[written++] = _mm512_reduce_add_ps(acc3);
+            pos += 4 * down;
+        }
+    }
+    const size_t step = down / up;
+    const size_t rem = down % up;
+    while (pos + taps <= count) {
+        out[written++] = dotAvx512(coeffs + phase * taps, in + pos, taps);
+        pos += step;
+        phase += rem;
+        if (phase >= up) {
+            phase -= up;
+            ++pos;
+        }
+    }
+    return written;
+}
+
+DJT_TARGET("avx512f") void int16ToFloatAvx512(const int16_t* x, size_t n, float* out) {
+    const __m512 scale = _mm512_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)));
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_cvtepi32_ps(v), scale));
+    }
+    int16ToFloatScalar(x + i, n - i, out + i);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif // DJT_SIMD_X86
+
+struct KernelTable {
+    SimdLevel level = SimdLevel::Scalar;
+    double (*sumOfSquares)(const float*, size_t) = sumOfSquaresScalar;
+    float (*maxAbs)(const float*, size_t) = maxAbsScalar;
+    float (*downmixPeak)(const float*, size_t, int, float*) = downmixPeakScalar;
+    void (*scale)(float*, size_t, float) = scaleScalar;
+    void (*multiply)(const float*, const float*, float*, size_t) = multiplyScalar;
+    float (*dot)(const float*, const float*, size_t) = dotScalar;
+    void (*multiplyAccumulate)(const float*, const float*, float*, size_t) = multiplyAccumulateScalar;
+    void (*mixWeighted)(const float*, const float*, const float*, const float*, float*, size_t) = mixWeightedScalar;
+    size_t (*polyphase)(const float*, size_t, size_t, size_t, const float*, size_t, size_t&, size_t&, float*) =
+        polyphaseScalar;
+    void (*int16ToFloat)(const int16_t*, size_t, float*) = int16ToFloatScalar;
+    void (*rescale)(const double*, size_t, double, double, double*) = rescaleScalar;
+};
+
+SimdLevel detectSimdLevel() {
+#ifdef DJT_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::Sse2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel selectSimdLevel() {
+    SimdLevel level = detectSimdLevel();
+    if (const char* env = std::getenv("DJT_SIMD")) {
+        const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Avx512};
+        for (SimdLevel requested : levels) {
+            if (std::strcmp(env, simdLevelName(requested)) == 0) {
+                level = std::min(level, requested);
+            }
+        }
+    }
+    return level;
+}
+
+KernelTable makeKernelTable(SimdLevel level) {
+    KernelTable t;
+    t.level = level;
+#ifdef DJT_SIMD_X86
+    if (level >= SimdLevel::Sse2) {
+        t.sumOfSquares = sumOfSquaresSse2;
+        t.maxAbs = maxAbsSse2;
+        t.downmixPeak = downmixPeakSse2;
+        t.scale = scaleSse2;
+        t.multiply = multiplySse2;
+        t.dot = dotSse2;
+        t.multiplyAccumulate = multiplyAccumulateSse2;
+        t.mixWeighted = mixWeightedSse2;
+        t.polyphase = polyphaseSse2;
+        t.int16ToFloat = int16ToFloatSse2;
+        t.rescale = rescaleSse2;
+    }
+    if (level >= SimdLevel::Avx2) {
+        t.sumOfSquares = sumOfSquaresAvx2;
+        t.maxAbs = maxAbsAvx2;
+        t.downmixPeak = downmixPeakAvx2;
+        t.scale = scaleAvx2;
+        t.multiply = multiplyAvx2;
+        t.dot = dotAvx2;
+        t.multiplyAccumulate = multiplyAccumulateAvx2;
+        t.mixWeighted = mixWeightedAvx2;
+        t.polyphase = polyphaseAvx2;
+        t.int16ToFloat = int16ToFloatAvx2;
+        t.rescale = rescaleAvx2;
+    }
+    if (level >= SimdLevel::Avx512) {
+        t.sumOfSquares = sumOfSquaresAvx512;
+        t.maxAbs = maxAbsAvx512;
+        t.downmixPeak = downmixPeakAvx512;
+        t.scale = scaleAvx512;
+        t.multiply = multiplyAvx512;
+        t.dot = dotAvx512;
+        t.multiplyAccumulate = multiplyAccumulateAvx512;
+        t.mixWeighted = mixWeightedAvx512;
+        t.polyphase = polyphaseAvx512;
+        t.int16ToFloat = int16ToFloatAvx512;
+    }
+#endif
+    return t;
+}
+
+const KernelTable& kernels() {
+    static const KernelTable table = makeKernelTable(selectSimdLevel());
+    return table;
+}
+} // namespace
+
+SimdLevel activeSimdLevel() { return kernels().level; }
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    }
+    return "scalar";
+}
+
+double sumOfSquares(const float* x, size_t n) { return kernels().sumOfSquares(x, n); }
+
+float maxAbsValue(const float* x, size_t n) { return kernels().maxAbs(x, n); }
+
+float downmixToMonoPeak(const float* interleaved, size_t frames, int channels, float* mono) {
+    return kernels().downmixPeak(interleaved, frames, channels, mono);
+}
+
+void scaleInPlace(float* x, size_t n, float gain) { kernels().scale(x, n, gain); }
+
+void multiplyWindow(const float* x, const float* w, float* out, size_t n) {
+    kernels().multiply(x, w, out, n);
+}
+
+float dotProduct(const float* a, const float* b, size_t n) { return kernels().dot(a, b, n); }
+
+void multiplyAccumulate(const float* x, const float* w, float* acc, size_t n) {
+    kernels().multiplyAccumulate(x, w, acc, n);
+}
+
+void mixWeighted(const float* a, const float* gainA, const float* b, const float* gainB, float* out, size_t n) {
+    kernels().mixWeighted(a, gainA, b, gainB, out, n);
+}
+
+size_t polyphaseFir(const float* coeffs, size_t taps, size_t up, size_t down, const float* in, size_t count,
+                    size_t& pos, size_t& phase, float* out) {
+    return kernels().polyphase(coeffs, taps, up, down, in, count, pos, phase, out);
+}
+
+void int16ToFloat(const int16_t* x, size_t n, float* out) { kernels().int16ToFloat(x, n, out); }
+
+void rescaleToUnit(const double* x, size_t n, double offset, double range, double* out) {
+    kernels().rescale(x, n, offset, range, out);
+}
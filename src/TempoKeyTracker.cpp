@@ -0,0 +1,204 @@
+#include "TempoKeyTracker.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+// Native samples decimated per step of push(), bounding the stream buffers.
+constexpr size_t kPushSamples = 8192;
+
+bool positive(double value) { return value > 0.0 && std::isfinite(value); }
+
+// Throws std::invalid_argument unless the options are usable at `sampleRate`.
+int checkedRate(int sampleRate, const TempoKeyOptions& options) {
+    if (sampleRate <= 0 || !positive(options.stepSeconds)) {
+        throw std::invalid_argument("TempoKeyTracker: sample rate and step must be positive");
+    }
+    if (!(options.windowSeconds >= options.stepSeconds) || !std::isfinite(options.windowSeconds)) {
+        throw std::invalid_argument("TempoKeyTracker: window must be at least one step");
+    }
+    if (!positive(options.minBpm) || !(options.maxBpm > options.minBpm) || !std::isfinite(options.maxBpm)) {
+        throw std::invalid_argument("TempoKeyTracker: invalid BPM range");
+    }
+    return sampleRate;
+}
+} // namespace
+
+const TempoKeyPoint* TempoKeyTrack::at(double seconds) const {
+    if (points.empty()) return nullptr;
+    auto it = std::lower_bound(points.begin(), points.end(), seconds,
+                               [](const TempoKeyPoint& p, double t) { return p.seconds < t; });
+    if (it == points.end()) return &points.back();
+    if (it != points.begin() && seconds - std::prev(it)->seconds <= it->seconds - seconds) --it;
+    return &*it;
+}
+
+TempoKeyTracker::TempoKeyTracker(int sampleRate, const TempoKeyOptions& options, AnalysisWorkspace* workspace)
+    : sampleRate_(checkedRate(sampleRate, options)),
+      options_(options),
+      ownWorkspace_(workspace ? nullptr : std::make_unique<AnalysisWorkspace>()),
+      ws_(workspace ? *workspace : *ownWorkspace_),
+      decimator_(sampleRate, ws_),
+      bpm_(decimator_.bpmRate(), &ws_),
+      key_(decimator_.keyRate(), &ws_) {
+    stepSamples_ = std::max<uint64_t>(1, static_cast<uint64_t>(options.stepSeconds * sampleRate + 0.5));
+    windowSteps_ = std::max<size_t>(1, static_cast<size_t>(options.windowSeconds / options.stepSeconds + 0.5));
+    hopSeconds_ = static_cast<double>(BpmAccumulator::kHopSize) / static_cast<double>(decimator_.bpmRate());
+    // The estimator reads the lags of the BPM range and one past either end.
+    lagCount_ = static_cast<size_t>(std::ceil(60.0 / options.minBpm / hopSeconds_)) + 2;
+
+    stepProducts_.assign(windowSteps_ * lagCount_, 0.0);
+    stepStart_.assign(windowSteps_, 0);
+    stepChroma_.assign(windowSteps_, {});
+    autocorr_.resize(lagCount_);
+    stepEnd_ = stepSamples_;
+    track_.stepSeconds = static_cast<double>(stepSamples_) / static_cast<double>(sampleRate);
+    track_.windowSeconds = track_.stepSeconds * static_cast<double>(windowSteps_);
+}
+
+void TempoKeyTracker::push(const float* samples, size_t count) {
+    while (count > 0) {
+        const size_t take = static_cast<size_t>(std::min<uint64_t>({count, kPushSamples, stepEnd_ - position_}));
+        decimator_.push(samples, take);
+        bpm_.push(decimator_.bpmBlock(), decimator_.bpmCount());
+        addHops();
+        key_.push(decimator_.keyBlock(), decimator_.keyCount());
+        position_ += take;
+        samples += take;
+        count -= take;
+        if (position_ == stepEnd_) closeStep();
+    }
+}
+
+// Turn the hops the accumulator completed into novelty, the same curve BpmAccumulator derives,
+// and add each value's lag products to the current step.
+void TempoKeyTracker::addHops() {
+    DJT_PROFILE_SCOPE("novelty");
+    double* products = &stepProducts_[(steps_ % windowSteps_) * lagCount_];
+    for (double energy : ws_.hopEnergies) {
+        if (!haveHop_) {
+            haveHop_ = true;
+            lastHop_ = energy;
+            continue;
+        }
+        const double frame = lastHop_ + energy;
+        const double x = std::max(0.0, frame - lastFrame_);
+        lastHop_ = energy;
+        lastFrame_ = frame;
+
+        novelty_.push_back(x);
+        const size_t newest = novelty_.size() - 1;
+        const size_t lags = std::min(lagCount_, novelty_.size());
+        for (size_t lag = 0; lag < lags; ++lag) products[lag] += x * novelty_[newest - lag];
+    }
+    bpm_.keepRecent(0);
+}
+
+void TempoKeyTracker::closeStep() {
+    DJT_PROFILE_SCOPE("tempoKeyWindow");
+    const size_t slot = steps_ % windowSteps_;
+    const std::array<double, 12>& chroma = key_.histogram();
+    for (size_t pc = 0; pc < 12; ++pc) stepChroma_[slot][pc] = chroma[pc] - chromaAtStepStart_[pc];
+    chromaAtStepStart_ = chroma;
+    ++steps_;
+
+    const uint64_t firstStep = steps_ - std::min<uint64_t>(steps_, windowSteps_);
+    const uint64_t w0 = stepStart_[firstStep % windowSteps_];
+    const uint64_t w1 = noveltyBase_ + novelty_.size();
+    const size_t n = static_cast<size_t>(w1 - w0);
+    auto x = [&](uint64_t t) { return novelty_[static_cast<size_t>(t - noveltyBase_)]; };
+
+    // Sum of x[t] * x[t - lag] over t in the window, then drop the pairs reaching back before
+    // it; what remains is the autocorrelation of the window alone.
+    std::fill(autocorr_.begin(), autocorr_.end(), 0.0);
+    std::array<double, 12> histogram{};
+    for (uint64_t s = firstStep; s < steps_; ++s) {
+        const double* products = &stepProducts_[(s % windowSteps_) * lagCount_];
+        for (size_t lag = 0; lag < lagCount_; ++lag) autocorr_[lag] += products[lag];
+        for (size_t pc = 0; pc < 12; ++pc) histogram[pc] += stepChroma_[s % windowSteps_][pc];
+    }
+    for (size_t lag = 1; lag < lagCount_; ++lag) {
+        for (uint64_t t = std::max<uint64_t>(w0, lag); t < std::min<uint64_t>(w0 + lag, w1); ++t) {
+            autocorr_[lag] -= x(t) * x(t - lag);
+        }
+    }
+
+    // Zero-mean, as estimateBPM() does: sum (x[t] - m)(x[t - lag] - m) over the window's pairs.
+    TempoKeyPoint point;
+    if (n >= 4) {
+        double total = 0.0;
+        for (uint64_t t = w0; t < w1; ++t) total += x(t);
+        const double mean = total / static_cast<double>(n);
+        double head = 0.0; // x[w0 .. w0 + lag)
+        double tail = 0.0; // x[w1 - lag .. w1)
+        const size_t lags = std::min(lagCount_, n);
+        for (size_t lag = 0; lag < lags; ++lag) {
+            const double later = total - head;  // x[t] over pairs
+            const double earlier = total - tail; // x[t - lag] over pairs
+            autocorr_[lag] += -mean * (later + earlier) + static_cast<double>(n - lag) * mean * mean;
+            head += x(w0 + lag);
+            tail += x(w1 - 1 - lag);
+        }
+        point.bpm = bestBpmFromAutocorrelation(autocorr_.data(), lags, hopSeconds_, options_.minBpm, options_.maxBpm);
+    }
+    point.key = keyFromHistogram(histogram);
+    const double start = static_cast<double>(firstStep * stepSamples_);
+    point.seconds = 0.5 * (start + static_cast<double>(position_)) / static_cast<double>(sampleRate_);
+    track_.points.push_back(std::move(point));
+
+    // Start the next step in the slot of the one leaving the window.
+    const size_t next = steps_ % windowSteps_;
+    std::fill(stepProducts_.begin() + static_cast<std::ptrdiff_t>(next * lagCount_),
+              stepProducts_.begin() + static_cast<std::ptrdiff_t>((next + 1) * lagCount_), 0.0);
+    stepStart_[next] = w1;
+    stepEnd_ += stepSamples_;
+
+    // Later windows start no earlier than the oldest step still in the ring, and their
+    // correction reaches lagCount_ values further back.
+    const uint64_t oldest = steps_ + 1 - std::min<uint64_t>(steps_ + 1, windowSteps_);
+    const uint64_t keepFrom = stepStart_[oldest % windowSteps_];
+    const uint64_t drop = keepFrom > noveltyBase_ + lagCount_ ? keepFrom - lagCount_ - noveltyBase_ : 0;
+    if (drop > 0) {
+        novelty_.erase(novelty_.begin(), novelty_.begin() + static_cast<std::ptrdiff_t>(drop));
+        noveltyBase_ += drop;
+    }
+}
+
+TempoKeyTrack TempoKeyTracker::finish() {
+    if (position_ + stepSamples_ > stepEnd_) closeStep(); // samples since the last full step
+    return std::move(track_);
+}
+
+TempoKeyTrack trackTempoAndKey(const AudioData& audio, const TempoKeyOptions& options, AnalysisWorkspace* workspace) {
+    DJT_PROFILE_SCOPE("trackTempoAndKey");
+    if (audio.sampleRate <= 0 || audio.samples.empty()) return {};
+
+    TempoKeyTracker tracker(audio.sampleRate, options, workspace);
+    tracker.push(audio.samples.data(), audio.samples.size());
+    return tracker.finish();
+}
+
+TempoKeyTrack trackTempoAndKeyFile(const std::string& path, const TempoKeyOptions& options, AudioStreamInfo* info,
+                                   AnalysisWorkspace* workspace) {
+    DJT_PROFILE_SCOPE("trackTempoAndKey");
+    std::unique_ptr<AnalysisWorkspace> ownWorkspace;
+    if (!workspace) {
+        ownWorkspace = std::make_unique<AnalysisWorkspace>();
+        workspace = ownWorkspace.get();
+    }
+
+    AudioStreamReader reader(path, AudioStreamReader::kDefaultBlockFrames, &workspace->audioBlock);
+    if (info) *info = reader.info();
+    if (reader.info().sampleRate <= 0) return {};
+
+    TempoKeyTracker tracker(reader.info().sampleRate, options, workspace);
+    const float* block = nullptr;
+    while (size_t frames = reader.readBlock(block)) {
+        tracker.push(block, frames);
+    }
+    return tracker.finish();
+}
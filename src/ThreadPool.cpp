@@ -0,0 +1,111 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Pool and index of the worker running on this thread, if any.
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local size_t tlsWorker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        idle_.wait(lock, [this] { return unfinished_.load() == 0; });
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void ThreadPool::submit(Task task) {
+    const size_t target = (tlsPool == this) ? tlsWorker : nextWorker_++ % workers_.size();
+    unfinished_.fetch_add(1);
+    {
+        // Count under the sleep mutex so a worker cannot miss the wake-up between its check of
+        // queued_ and going to sleep. A woken worker may briefly find the deque still empty.
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        queued_.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::tryRunOne(size_t preferred) {
+    Task task;
+    const size_t n = workers_.size();
+    for (size_t k = 0; k < n && !task; ++k) {
+        const size_t idx = (preferred + k) % n;
+        Worker& w = *workers_[idx];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (w.tasks.empty()) continue;
+        if (k == 0) { // own deque: newest first for cache locality
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+        } else { // steal the oldest, usually the largest remaining piece of work
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+
+    queued_.fetch_sub(1);
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        if (!firstError_) firstError_ = std::current_exception();
+    }
+    finishTask();
+    return true;
+}
+
+void ThreadPool::finishTask() {
+    if (unfinished_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        idle_.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    tlsPool = this;
+    tlsWorker = index;
+    for (;;) {
+        if (tryRunOne(index)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) return;
+    }
+}
+
+void ThreadPool::helpUntil(const std::function<bool()>& done) {
+    const size_t preferred = (tlsPool == this) ? tlsWorker : 0;
+    while (!done()) {
+        if (!tryRunOne(preferred)) std::this_thread::yield();
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    idle_.wait(lock, [this] { return unfinished_.load() == 0; });
+    if (firstError_) {
+        std::exception_ptr error = std::exchange(firstError_, nullptr);
+        std::rethrow_exception(error);
+    }
+}
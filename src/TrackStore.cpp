@@ -0,0 +1,358 @@
+#include "TrackStore.hpp"
+
+#include "FileUtils.hpp"
+#include "KeyAnalyzer.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DJT_HAVE_MMAP 1
+#endif
+
+namespace {
+// File layout (native byte order, like the analysis cache): header, then the columns bpm,
+// windowSeconds, energyMin, energyMax (float each), keyCode (uint8), chroma (12 uint8 each), the
+// beat grid as firstBeat, beatSeconds (float each), beats (uint32) and downbeat (uint8),
+// energyOffsets and nameOffsets (uint64, tracks + 1 each), the energy blob and the name blob.
+// Every section starts 8-byte aligned so a mapping can be read in place.
+constexpr char kStoreMagic[8] = {'D', 'J', 'T', 'S', 'T', 'O', 'R', 'E'};
+constexpr uint32_t kStoreFormat = 3; // 1 had no chroma, 2 no beat grid
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t trackCount;
+    uint64_t energyBytes;
+    uint64_t nameBytes;
+};
+
+uint64_t aligned(uint64_t offset) { return (offset + 7) & ~uint64_t{7}; }
+
+struct StoreLayout {
+    uint64_t bpm = 0;
+    uint64_t windowSeconds = 0;
+    uint64_t energyMin = 0;
+    uint64_t energyMax = 0;
+    uint64_t keyCodes = 0;
+    uint64_t chroma = 0;
+    uint64_t firstBeat = 0;
+    uint64_t beatSeconds = 0;
+    uint64_t beats = 0;
+    uint64_t downbeat = 0;
+    uint64_t energyOffsets = 0;
+    uint64_t nameOffsets = 0;
+    uint64_t energy = 0;
+    uint64_t names = 0;
+    uint64_t total = 0;
+};
+
+StoreLayout layoutFor(uint64_t tracks, uint64_t energyBytes, uint64_t nameBytes) {
+    StoreLayout l;
+    l.bpm = aligned(sizeof(StoreHeader));
+    l.windowSeconds = aligned(l.bpm + tracks * sizeof(float));
+    l.energyMin = aligned(l.windowSeconds + tracks * sizeof(float));
+    l.energyMax = aligned(l.energyMin + tracks * sizeof(float));
+    l.keyCodes = aligned(l.energyMax + tracks * sizeof(float));
+    l.chroma = aligned(l.keyCodes + tracks);
+    l.firstBeat = aligned(l.chroma + tracks * 12);
+    l.beatSeconds = aligned(l.firstBeat + tracks * sizeof(float));
+    l.beats = aligned(l.beatSeconds + tracks * sizeof(float));
+    l.downbeat = aligned(l.beats + tracks * sizeof(uint32_t));
+    l.energyOffsets = aligned(l.downbeat + tracks);
+    l.nameOffsets = l.energyOffsets + (tracks + 1) * sizeof(uint64_t);
+    l.energy = l.nameOffsets + (tracks + 1) * sizeof(uint64_t);
+    l.names = aligned(l.energy + energyBytes);
+    l.total = l.names + nameBytes;
+    return l;
+}
+
+// Offsets must start at 0, never decrease and end at the blob size.
+bool validOffsets(const uint64_t* offsets, size_t tracks, uint64_t bytes) {
+    if (offsets[0] != 0 || offsets[tracks] != bytes) return false;
+    for (size_t i = 0; i < tracks; ++i) {
+        if (offsets[i + 1] < offsets[i]) return false;
+    }
+    return true;
+}
+
+// Finite RMS range of a curve; 0..0 when no window was decoded.
+std::pair<double, double> energyRange(const std::vector<double>& curve) {
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -lo;
+    for (double rms : curve) {
+        if (std::isnan(rms)) continue;
+        lo = std::min(lo, rms);
+        hi = std::max(hi, rms);
+    }
+    if (lo > hi) return {0.0, 0.0};
+    return {lo, hi};
+}
+
+void padTo(std::ofstream& out, uint64_t& position, uint64_t offset) {
+    static const char zeros[8] = {};
+    writeBytes(out, zeros, static_cast<size_t>(offset - position));
+    position = offset;
+}
+} // namespace
+
+int TrackView::pitchClass() const {
+    // Decoded once from the names, so views agree with the string-based scoring exactly.
+    static const std::array<int, 24> pitchClasses = [] {
+        std::array<int, 24> table{};
+        for (int code = 0; code < 24; ++code) {
+            table[static_cast<size_t>(code)] = pitchClassFromKeyString(keyName(code % 12, code < 12));
+        }
+        return table;
+    }();
+    return keyCode < 24 ? pitchClasses[keyCode] : -1;
+}
+
+std::string TrackView::key() const {
+    return keyCode < 24 ? keyName(keyCode % 12, keyCode < 12) : "Unknown";
+}
+
+std::array<double, 12> TrackView::chroma() const {
+    std::array<double, 12> codes{};
+    for (size_t pc = 0; pc < 12; ++pc) codes[pc] = chromaCodes[pc];
+    return chromaFromHistogram(codes);
+}
+
+TrackAnalysis TrackView::toAnalysis() const {
+    TrackAnalysis analysis;
+    analysis.bpm = bpm;
+    analysis.key = key();
+    analysis.chroma = chroma();
+    analysis.beatGrid = beatGrid;
+    analysis.windowSeconds = windowSeconds;
+    analysis.energyCurve.resize(windows);
+    for (size_t i = 0; i < windows; ++i) analysis.energyCurve[i] = energyAt(i);
+    return analysis;
+}
+
+uint8_t keyCodeFromString(const std::string& key) {
+    for (int code = 0; code < 24; ++code) {
+        if (key == keyName(code % 12, code < 12)) return static_cast<uint8_t>(code);
+    }
+    return kUnknownKeyCode;
+}
+
+TrackStore::TrackStore(const std::string& path) {
+#if defined(DJT_HAVE_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open track store: " + path);
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to open track store: " + path);
+    }
+    length_ = static_cast<size_t>(st.st_size);
+    if (length_ > 0) {
+        base_ = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base_ == MAP_FAILED) base_ = nullptr;
+    }
+    ::close(fd); // the mapping keeps the file referenced
+    if (length_ > 0 && !base_) throw std::runtime_error("Failed to map track store: " + path);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("Failed to open track store: " + path);
+    length_ = static_cast<size_t>(in.tellg());
+    buffer_.resize((length_ + 7) / 8);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(length_))) {
+        throw std::runtime_error("Failed to read track store: " + path);
+    }
+#endif
+    const unsigned char* bytes =
+        base_ ? static_cast<const unsigned char*>(base_) : reinterpret_cast<const unsigned char*>(buffer_.data());
+
+    // The destructor does not run if the constructor throws.
+    auto fail = [&](const char* what) {
+#if defined(DJT_HAVE_MMAP)
+        if (base_) ::munmap(base_, length_);
+        base_ = nullptr;
+#endif
+        throw std::runtime_error(what + path);
+    };
+
+    StoreHeader header{};
+    if (length_ < sizeof(header)) fail("Not a track store: ");
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, kStoreMagic, sizeof(kStoreMagic)) != 0) fail("Not a track store: ");
+    if (header.format != kStoreFormat) fail("Track store from another version, rebuild it with analyze --store: ");
+    // Bound the counts before the layout arithmetic can overflow.
+    if (header.trackCount > length_ || header.energyBytes > length_ || header.nameBytes > length_) {
+        fail("Corrupt track store: ");
+    }
+    const StoreLayout layout = layoutFor(header.trackCount, header.energyBytes, header.nameBytes);
+    if (layout.total != length_) fail("Corrupt track store: ");
+
+    count_ = static_cast<size_t>(header.trackCount);
+    bpm_ = reinterpret_cast<const float*>(bytes + layout.bpm);
+    windowSeconds_ = reinterpret_cast<const float*>(bytes + layout.windowSeconds);
+    energyMin_ = reinterpret_cast<const float*>(bytes + layout.energyMin);
+    energyMax_ = reinterpret_cast<const float*>(bytes + layout.energyMax);
+    keyCodes_ = bytes + layout.keyCodes;
+    chromaCodes_ = bytes + layout.chroma;
+    firstBeat_ = reinterpret_cast<const float*>(bytes + layout.firstBeat);
+    beatSeconds_ = reinterpret_cast<const float*>(bytes + layout.beatSeconds);
+    beats_ = reinterpret_cast<const uint32_t*>(bytes + layout.beats);
+    downbeats_ = bytes + layout.downbeat;
+    energyOffsets_ = reinterpret_cast<const uint64_t*>(bytes + layout.energyOffsets);
+    nameOffsets_ = reinterpret_cast<const uint64_t*>(bytes + layout.nameOffsets);
+    energy_ = bytes + layout.energy;
+    names_ = reinterpret_cast<const char*>(bytes + layout.names);
+    if (!validOffsets(energyOffsets_, count_, header.energyBytes) ||
+        !validOffsets(nameOffsets_, count_, header.nameBytes)) {
+        fail("Corrupt track store: ");
+    }
+}
+
+TrackStore::~TrackStore() {
+#if defined(DJT_HAVE_MMAP)
+    if (base_) ::munmap(base_, length_);
+#endif
+}
+
+TrackView TrackStore::track(size_t i) const {
+    TrackView view;
+    view.name = std::string_view(names_ + nameOffsets_[i], static_cast<size_t>(nameOffsets_[i + 1] - nameOffsets_[i]));
+    view.bpm = bpm_[i];
+    view.keyCode = keyCodes_[i];
+    view.chromaCodes = chromaCodes_ + 12 * i;
+    view.beatGrid.firstBeat = firstBeat_[i];
+    view.beatGrid.beatSeconds = beatSeconds_[i];
+    view.beatGrid.beats = beats_[i];
+    view.beatGrid.downbeat = std::min<size_t>(downbeats_[i], BeatGrid::kBeatsPerBar - 1);
+    view.windowSeconds = windowSeconds_[i];
+    view.energyMin = energyMin_[i];
+    view.energyMax = energyMax_[i];
+    view.energy = energy_ + energyOffsets_[i];
+    view.windows = static_cast<size_t>(energyOffsets_[i + 1] - energyOffsets_[i]);
+    return view;
+}
+
+uint64_t TrackStore::identity() const {
+    uint64_t hash = 1469598103934665603ull; // FNV-1a
+    auto mix = [&](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(&count_, sizeof(count_));
+    for (size_t i = 0; i < count_; ++i) {
+        const uint64_t nameBytes = nameOffsets_[i + 1] - nameOffsets_[i];
+        const uint64_t windows = energyOffsets_[i + 1] - energyOffsets_[i];
+        mix(&nameBytes, sizeof(nameBytes));
+        mix(names_ + nameOffsets_[i], static_cast<size_t>(nameBytes));
+        mix(&windows, sizeof(windows));
+        mix(bpm_ + i, sizeof(float));
+    }
+    return hash;
+}
+
+void writeTrackStore(const std::string& path,
+                     const std::vector<std::string>& names,
+                     const std::vector<TrackAnalysis>& tracks) {
+    if (names.size() != tracks.size()) {
+        throw std::invalid_argument("writeTrackStore: one name per track required");
+    }
+    const size_t n = tracks.size();
+    std::vector<float> bpm(n);
+    std::vector<float> windowSeconds(n);
+    std::vector<float> energyMin(n);
+    std::vector<float> energyMax(n);
+    std::vector<uint8_t> keyCodes(n);
+    std::vector<uint8_t> chromaCodes(12 * n, 0);
+    std::vector<float> firstBeat(n);
+    std::vector<float> beatSeconds(n);
+    std::vector<uint32_t> beats(n);
+    std::vector<uint8_t> downbeats(n);
+    std::vector<uint64_t> energyOffsets(n + 1, 0);
+    std::vector<uint64_t> nameOffsets(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        const TrackAnalysis& t = tracks[i];
+        bpm[i] = static_cast<float>(t.bpm);
+        windowSeconds[i] = static_cast<float>(t.windowSeconds);
+        const auto range = energyRange(t.energyCurve);
+        energyMin[i] = static_cast<float>(range.first);
+        energyMax[i] = static_cast<float>(range.second);
+        keyCodes[i] = keyCodeFromString(t.key);
+        const double strongest = *std::max_element(t.chroma.begin(), t.chroma.end());
+        for (size_t pc = 0; strongest > 0.0 && pc < 12; ++pc) {
+            chromaCodes[12 * i + pc] = static_cast<uint8_t>(std::lround(t.chroma[pc] / strongest * kChromaSteps));
+        }
+        firstBeat[i] = static_cast<float>(t.beatGrid.firstBeat);
+        beatSeconds[i] = static_cast<float>(t.beatGrid.beatSeconds);
+        beats[i] = static_cast<uint32_t>(std::min<size_t>(t.beatGrid.beats, std::numeric_limits<uint32_t>::max()));
+        downbeats[i] = static_cast<uint8_t>(t.beatGrid.downbeat);
+        energyOffsets[i + 1] = energyOffsets[i] + t.energyCurve.size();
+        nameOffsets[i + 1] = nameOffsets[i] + names[i].size();
+    }
+
+    replaceFile(path, "track store", [&](std::ofstream& out) {
+        StoreHeader header{};
+        std::memcpy(header.magic, kStoreMagic, sizeof(kStoreMagic));
+        header.format = kStoreFormat;
+        header.trackCount = n;
+        header.energyBytes = energyOffsets[n];
+        header.nameBytes = nameOffsets[n];
+        const StoreLayout layout = layoutFor(n, header.energyBytes, header.nameBytes);
+
+        uint64_t position = sizeof(header);
+        writeBytes(out, &header, sizeof(header));
+        auto column = [&](uint64_t offset, const void* data, size_t size) {
+            padTo(out, position, offset);
+            writeBytes(out, data, size);
+            position += size;
+        };
+        column(layout.bpm, bpm.data(), n * sizeof(float));
+        column(layout.windowSeconds, windowSeconds.data(), n * sizeof(float));
+        column(layout.energyMin, energyMin.data(), n * sizeof(float));
+        column(layout.energyMax, energyMax.data(), n * sizeof(float));
+        column(layout.keyCodes, keyCodes.data(), n);
+        column(layout.chroma, chromaCodes.data(), 12 * n);
+        column(layout.firstBeat, firstBeat.data(), n * sizeof(float));
+        column(layout.beatSeconds, beatSeconds.data(), n * sizeof(float));
+        column(layout.beats, beats.data(), n * sizeof(uint32_t));
+        column(layout.downbeat, downbeats.data(), n);
+        column(layout.energyOffsets, energyOffsets.data(), (n + 1) * sizeof(uint64_t));
+        column(layout.nameOffsets, nameOffsets.data(), (n + 1) * sizeof(uint64_t));
+
+        // Codes are taken over the float range written above, so decoding reproduces them.
+        padTo(out, position, layout.energy);
+        std::vector<uint8_t> codes;
+        for (size_t i = 0; i < n; ++i) {
+            const std::vector<double>& curve = tracks[i].energyCurve;
+            const double lo = energyMin[i];
+            const double range = static_cast<double>(energyMax[i]) - lo;
+            codes.resize(curve.size());
+            for (size_t w = 0; w < curve.size(); ++w) {
+                if (std::isnan(curve[w])) {
+                    codes[w] = kMissingEnergy;
+                } else if (range < 1e-12) {
+                    codes[w] = 0;
+                } else {
+                    const double level = std::min(1.0, std::max(0.0, (curve[w] - lo) / range));
+                    codes[w] = static_cast<uint8_t>(std::lround(level * kEnergySteps));
+                }
+            }
+            writeBytes(out, codes.data(), codes.size());
+            position += codes.size();
+        }
+        padTo(out, position, layout.names);
+        for (const std::string& name : names) writeBytes(out, name.data(), name.size());
+    });
+}
@@ -1,19 +1,56 @@
 #include "TransitionAnalyzer.hpp"
 
+#include "Profiler.hpp"
+#include "SimdKernels.hpp"
+#include "TrackStore.hpp"
+
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <limits>
+#include <queue>
 #include <string>
 #include <vector>
 
 namespace {
 double clamp01(double v) { return std::max(0.0, std::min(1.0, v)); }
 
+// Windows that were not decoded (NaN, see analyzeTrackRegions()) stay NaN and do not count
+// towards the range.
+std::vector<double> normalizeMinMax(const std::vector<double>& v) {
+    if (v.empty()) return {};
+    double mn = std::numeric_limits<double>::infinity();
+    double mx = -mn;
+    for (double x : v) {
+        if (std::isnan(x)) continue;
+        mn = std::min(mn, x);
+        mx = std::max(mx, x);
+    }
+    if (!(mx - mn >= 1e-12)) {
+        std::vector<double> out(v.size(), 0.0);
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (std::isnan(v[i])) out[i] = v[i];
+        }
+        return out;
+    }
+    std::vector<double> out(v.size());
+    rescaleToUnit(v.data(), v.size(), mn, mx - mn, out.data());
+    return out;
+}
+} // namespace
+
+double foldedTempoRatio(double bpmA, double bpmB) {
+    if (bpmA <= 0.0 || bpmB <= 0.0) return 1.0;
+    const double ratio = bpmB / bpmA;
+    const double octaves = std::round(std::log2(ratio));
+    return octaves != 0.0 ? std::ldexp(ratio, -static_cast<int>(octaves)) : ratio;
+}
+
 double bpmCompatibility(double bpmA, double bpmB) {
     if (bpmA <= 0.0 || bpmB <= 0.0) return 0.5; // unknown; neutral
-    double avg = 0.5 * (bpmA + bpmB);
-    if (avg <= 0.0) return 0.0;
-    double relDiff = std::abs(bpmA - bpmB) / avg; // relative mismatch
+    // Half- and double-time mix like the same tempo: compare against B's closest octave.
+    const double ratio = foldedTempoRatio(bpmA, bpmB);
+    double relDiff = std::abs(1.0 - ratio) / (0.5 * (1.0 + ratio)); // relative mismatch
     if (relDiff <= 0.03) return 1.0;   // within ~3%
     if (relDiff <= 0.06) return 0.7;   // small stretch
     if (relDiff <= 0.10) return 0.4;   // moderate stretch
@@ -39,9 +76,7 @@ int pitchClassFromKeyString(const std::string& key) {
     return -1;
 }
 
-double keyCompatibility(const std::string& keyA, const std::string& keyB) {
-    int pcA = pitchClassFromKeyString(keyA);
-    int pcB = pitchClassFromKeyString(keyB);
+double pitchClassCompatibility(int pcA, int pcB) {
     if (pcA < 0 || pcB < 0) return 0.5; // unknown; neutral
     int diff = std::abs(pcA - pcB) % 12;
     // Same key
@@ -57,66 +92,436 @@ double keyCompatibility(const std::string& keyA, const std::string& keyB) {
     return 0.4;
 }
 
-std::vector<double> normalizeMinMax(const std::vector<double>& v) {
-    if (v.empty()) return {};
-    auto [mnIt, mxIt] = std::minmax_element(v.begin(), v.end());
-    double mn = *mnIt;
-    double mx = *mxIt;
-    if (mx - mn < 1e-12) return std::vector<double>(v.size(), 0.0);
-    std::vector<double> out(v.size());
-    for (size_t i = 0; i < v.size(); ++i) {
-        out[i] = (v[i] - mn) / (mx - mn);
+double keyCompatibility(const std::string& keyA, const std::string& keyB) {
+    return pitchClassCompatibility(pitchClassFromKeyString(keyA), pitchClassFromKeyString(keyB));
+}
+
+// Phrase ranks of a point: the longest phrase it starts, none or 8, 16 or 32 bars.
+constexpr size_t kPhraseRanks = 4;
+
+// Upper convex hull of the entry points of at least one phrase rank, and the points it falls
+// back to for zero-weight directions.
+struct EntryHull {
+    std::vector<size_t> points; // level ascending
+    size_t first = 0;           // earliest point
+    size_t firstMaxLevel = 0;
+    size_t firstMaxSlope = 0;
+};
+
+// Energy features of the points a transition may start at, on the min-max normalized curve: the
+// bar starts of the track's beat grid, each with the longest phrase it starts, or every window
+// of the curve without one. An exit point is scored by how low it is and how fast energy falls
+// into it; an entry point by its level and its rise.
+struct TransitionProfileData {
+    double bpm = 0.0;
+    int pitchClass = -1;
+    double windowSeconds = 0.0;
+
+    std::vector<double> times; // seconds of each point
+
+    std::vector<double> exitLevel;  // 1 - norm: prefer exiting on low energy
+    std::vector<double> exitSlope;  // max(0, -slope)
+    std::vector<double> entryLevel; // norm
+    std::vector<double> entrySlope; // max(0, slope)
+    std::vector<uint8_t> phrase;    // phrase rank, 0 .. kPhraseRanks - 1
+
+    // [r]: hull of (entryLevel, entrySlope) over the points of phrase rank r or more; empty if
+    // there are none.
+    std::array<EntryHull, kPhraseRanks> entryHulls;
+
+    double maxExitLevel = 0.0;
+    double maxExitSlope = 0.0;
+};
+
+namespace {
+// Prefer entering on rising energy, or on higher energy than exit point.
+double pairEnergyScore(const TransitionProfileData& a, size_t i, const TransitionProfileData& b, size_t j) {
+    double riseComponent = clamp01(a.exitSlope[i] * b.entrySlope[j]);
+    double levelComponent = clamp01(a.exitLevel[i] * b.entryLevel[j]);
+    return 0.6 * levelComponent + 0.4 * riseComponent; // 0..1
+}
+
+// The pair score is 0.6 * lowA * curB + 0.4 * dropA * riseB (the clamps never bind on
+// normalized curves), i.e. a dot product of (0.6 lowA, 0.4 dropA) with (curB, riseB). For a
+// fixed exit point the best entry is therefore a vertex of the upper convex hull of B's
+// (curB, riseB) points, found by binary search. This makes the exact search
+// O((|A| + |B|) log |B|) instead of O(|A| * |B|). One hull is kept per phrase rank present, over
+// the points of that rank or more, so the best phrase-start entry is found the same way.
+void buildEntryHulls(TransitionProfileData& p) {
+    const std::vector<double>& x = p.entryLevel;
+    const std::vector<double>& y = p.entrySlope;
+    const size_t n = x.size();
+    if (n == 0) return;
+    std::vector<size_t> order(n);
+    for (size_t j = 0; j < n; ++j) order[j] = j;
+    // Among identical points the last one survives the hull scan, so sort ties by index
+    // descending to keep the earliest point.
+    std::sort(order.begin(), order.end(), [&](size_t u, size_t v) {
+        if (x[u] != x[v]) return x[u] < x[v];
+        if (y[u] != y[v]) return y[u] < y[v];
+        return u > v;
+    });
+    auto cross = [&](size_t o, size_t u, size_t v) {
+        return (x[u] - x[o]) * (y[v] - y[o]) - (y[u] - y[o]) * (x[v] - x[o]);
+    };
+
+    const uint8_t longest = *std::max_element(p.phrase.begin(), p.phrase.end());
+    for (uint8_t rank = 0; rank <= longest; ++rank) {
+        EntryHull& entry = p.entryHulls[rank];
+        // Zero-weight directions: first point with the highest level / highest rise.
+        size_t count = 0;
+        for (size_t j = 0; j < n; ++j) {
+            if (p.phrase[j] < rank) continue;
+            if (count++ == 0) entry.first = entry.firstMaxLevel = entry.firstMaxSlope = j;
+            if (x[j] > x[entry.firstMaxLevel]) entry.firstMaxLevel = j;
+            if (y[j] > y[entry.firstMaxSlope]) entry.firstMaxSlope = j;
+        }
+        std::vector<size_t>& hull = entry.points;
+        hull.reserve(count);
+        for (size_t j : order) {
+            if (p.phrase[j] < rank) continue;
+            while (hull.size() >= 2 && cross(hull[hull.size() - 2], hull.back(), j) >= 0.0) {
+                hull.pop_back();
+            }
+            hull.push_back(j);
+        }
     }
-    return out;
 }
-} // namespace
 
-TransitionSuggestion findBestTransition(const TrackAnalysis& a, const TrackAnalysis& b) {
-    TransitionSuggestion best{};
-    if (a.energyCurve.empty() || b.energyCurve.empty() || a.windowSeconds <= 0.0 || b.windowSeconds <= 0.0) {
-        best.score = 0.0;
-        return best;
+// Best entry point of b on `entry` for exit point i of a, ties going to the earliest point.
+size_t bestEntry(const TransitionProfileData& a, size_t i, const TransitionProfileData& b, const EntryHull& entry) {
+    const double wx = 0.6 * a.exitLevel[i];
+    const double wy = 0.4 * a.exitSlope[i];
+    if (wx == 0.0 && wy == 0.0) return entry.first; // every entry scores 0
+    if (wy == 0.0) return entry.firstMaxLevel;
+    if (wx == 0.0) return entry.firstMaxSlope;
+
+    const std::vector<size_t>& hull = entry.points;
+    auto project = [&](size_t j) { return wx * b.entryLevel[j] + wy * b.entrySlope[j]; };
+
+    // The projection onto (wx, wy) is unimodal along the hull: find the first vertex whose
+    // outgoing edge no longer increases it.
+    size_t lo = 0;
+    size_t hi = hull.size() - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (project(hull[mid + 1]) > project(hull[mid])) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // Settle rounding near the peak with the exact pair score of the neighbours.
+    size_t best = hull[lo];
+    double bestScore = pairEnergyScore(a, i, b, best);
+    for (size_t k = (lo > 0 ? lo - 1 : 0); k <= std::min(lo + 1, hull.size() - 1); ++k) {
+        double score = pairEnergyScore(a, i, b, hull[k]);
+        if (score > bestScore || (score == bestScore && hull[k] < best)) {
+            bestScore = score;
+            best = hull[k];
+        }
+    }
+    return best;
+}
+
+// Energy scores in the same step of this size count as near-equal, and the pair on the longer
+// phrase wins among them (0.06 on the 0-10 score).
+constexpr double kPhraseStep = 0.02;
+
+struct Candidate {
+    double energyScore;
+    size_t idxA;
+    size_t idxB;
+    uint8_t phrase; // shorter of the two points' phrase ranks
+    double step;    // kPhraseStep steps in energyScore
+};
+
+Candidate makeCandidate(const TransitionProfileData& a, size_t i, const TransitionProfileData& b, size_t j) {
+    const double score = pairEnergyScore(a, i, b, j);
+    return {score, i, j, std::min(a.phrase[i], b.phrase[j]), std::floor(score / kPhraseStep)};
+}
+
+// Max-heap order: higher score step first, then the longer phrase, the higher score and
+// earlier points (brute-force scan order). Without beat grids every phrase rank is 0 and this
+// is plain score order.
+struct CandidateOrder {
+    bool operator()(const Candidate& x, const Candidate& y) const {
+        if (x.step != y.step) return x.step < y.step;
+        if (x.phrase != y.phrase) return x.phrase < y.phrase;
+        if (x.energyScore != y.energyScore) return x.energyScore < y.energyScore;
+        if (x.idxA != y.idxA) return x.idxA > y.idxA;
+        return x.idxB > y.idxB;
     }
+};
 
+// Best pair for exit point i of a in CandidateOrder. The pair's phrase rank is capped by i's,
+// and on each hull the best entry by score is also the best in that order among pairs of at
+// least the hull's rank, so the hulls up to i's rank cover every entry.
+Candidate bestCandidate(const TransitionProfileData& a, size_t i, const TransitionProfileData& b) {
+    const CandidateOrder before;
+    Candidate best = makeCandidate(a, i, b, bestEntry(a, i, b, b.entryHulls[0]));
+    for (size_t rank = 1; rank <= a.phrase[i] && !b.entryHulls[rank].points.empty(); ++rank) {
+        const Candidate c = makeCandidate(a, i, b, bestEntry(a, i, b, b.entryHulls[rank]));
+        if (before(best, c)) best = c;
+    }
+    return best;
+}
+
+// Combine components; weighted sum mapped to 0-10.
+double combinedScore(double bpmScore, double keyScore, double energyScore) {
+    double total01 = 0.4 * bpmScore + 0.3 * keyScore + 0.3 * energyScore;
+    return clamp01(total01) * 10.0;
+}
+
+TransitionSuggestion makeSuggestion(const Candidate& c, const TransitionProfileData& a,
+                                    const TransitionProfileData& b, double bpmScore, double keyScore) {
+    const double energyScore = clamp01(c.energyScore);
+    TransitionSuggestion s;
+    s.score = combinedScore(bpmScore, keyScore, energyScore);
+    s.timeA = a.times[c.idxA];
+    s.timeB = b.times[c.idxB];
+    s.bpmComponent = bpmScore;
+    s.keyComponent = keyScore;
+    s.energyComponent = energyScore;
+    return s;
+}
+
+// Bars in the shortest phrase; phrases of 2 and 4 times as many bars start on every other and
+// every fourth of its starts.
+constexpr size_t kPhraseBars = 8;
+
+// Exit and entry features of a point at normalized `level`, reached by a change of `slope`,
+// starting a phrase of rank `phrase`. A point that was not decoded (NaN level) scores 0 both
+// ways, and one after it has no slope.
+void addPoint(TransitionProfileData& data, double seconds, double level, double slope, uint8_t phrase = 0) {
+    data.times.push_back(seconds);
+    data.phrase.push_back(phrase);
+    const bool decoded = !std::isnan(level);
+    if (std::isnan(slope)) slope = 0.0;
+    data.exitLevel.push_back(decoded ? 1.0 - level : 0.0);
+    data.exitSlope.push_back(decoded ? std::max(0.0, -slope) : 0.0);
+    data.entryLevel.push_back(decoded ? level : 0.0);
+    data.entrySlope.push_back(decoded ? std::max(0.0, slope) : 0.0);
+    data.maxExitLevel = std::max(data.maxExitLevel, data.exitLevel.back());
+    data.maxExitSlope = std::max(data.maxExitSlope, data.exitSlope.back());
+}
+
+// Every window of a curve whose window i has normalized level norm(i).
+template <typename Norm>
+void fillWindowFeatures(TransitionProfileData& data, size_t n, Norm norm) {
+    data.times.reserve(n);
+    data.phrase.reserve(n);
+    double previous = std::numeric_limits<double>::quiet_NaN();
+    for (size_t i = 0; i < n; ++i) {
+        const double level = norm(i);
+        addPoint(data, static_cast<double>(i) * data.windowSeconds, level, level - previous);
+        previous = level;
+    }
+}
+
+// Mean of level(i) over [t0, t1) seconds of a curve of n windows, each window weighted by its
+// overlap; NaN if one of them was not decoded or the span misses the curve.
+template <typename Level>
+double spanMean(double t0, double t1, size_t n, double windowSeconds, Level level) {
+    const double end = std::min(t1, static_cast<double>(n) * windowSeconds);
+    double sum = 0.0;
+    double weight = 0.0;
+    for (size_t i = static_cast<size_t>(std::max(0.0, t0) / windowSeconds);
+         i < n && static_cast<double>(i) * windowSeconds < end; ++i) {
+        const double overlap = std::min(end, static_cast<double>(i + 1) * windowSeconds) -
+                               std::max(t0, static_cast<double>(i) * windowSeconds);
+        if (overlap <= 0.0) continue;
+        sum += overlap * level(i);
+        weight += overlap;
+    }
+    return weight > 0.0 ? sum / weight : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Bar starts of `grid` on a curve of n windows with level(i): the curve is averaged per bar and
+// normalized over the bars, and a bar scores by its level and its change from the bar before.
+// Each bar is ranked by the longest phrase it starts, counted from the bar phase where the
+// level changes most, so phrases start where the arrangement does rather than at the first bar.
+template <typename Level>
+void fillPhraseFeatures(TransitionProfileData& data, const BeatGrid& grid, size_t n, Level level) {
+    const size_t bars = grid.bars();
+    std::vector<double> barLevels(bars);
+    for (size_t bar = 0; bar < bars; ++bar) {
+        barLevels[bar] = spanMean(grid.barTime(bar), grid.barTime(bar + 1), n, data.windowSeconds, level);
+    }
+    const std::vector<double> norm = normalizeMinMax(barLevels);
+    auto change = [&](size_t bar) {
+        return bar > 0 ? norm[bar] - norm[bar - 1] : std::numeric_limits<double>::quiet_NaN();
+    };
+
+    size_t phase = 0;
+    double mostChange = -1.0;
+    for (size_t start = 0; start < std::min(kPhraseBars, bars); ++start) {
+        double total = 0.0;
+        for (size_t bar = start; bar < bars; bar += kPhraseBars) {
+            if (!std::isnan(change(bar))) total += std::abs(change(bar));
+        }
+        if (total > mostChange) {
+            mostChange = total;
+            phase = start;
+        }
+    }
+    data.times.reserve(bars);
+    data.phrase.reserve(bars);
+    for (size_t bar = 0; bar < bars; ++bar) {
+        const size_t position = (bar + 4 * kPhraseBars - phase) % (4 * kPhraseBars);
+        const uint8_t phrase = position == 0 ? 3 : position % (2 * kPhraseBars) == 0 ? 2 : position % kPhraseBars == 0 ? 1 : 0;
+        addPoint(data, grid.barTime(bar), norm[bar], change(bar), phrase);
+    }
+}
+
+// The bar starts of `grid` when it has any inside the curve, else every window.
+template <typename Level>
+void fillEnergyFeatures(TransitionProfileData& data, const BeatGrid& grid, size_t n, Level level) {
+    if (!grid.empty() && grid.bars() > 0 && data.windowSeconds > 0.0 && n > 0) {
+        fillPhraseFeatures(data, grid, n, level);
+    } else {
+        const std::vector<double> levels = [&] {
+            std::vector<double> v(n);
+            for (size_t i = 0; i < n; ++i) v[i] = level(i);
+            return normalizeMinMax(v);
+        }();
+        fillWindowFeatures(data, n, [&](size_t i) { return levels[i]; });
+    }
+    buildEntryHulls(data);
+}
+} // namespace
+
+TransitionProfile::TransitionProfile(const TrackAnalysis& analysis) {
+    DJT_PROFILE_SCOPE("transitionProfile");
+    auto data = std::make_shared<TransitionProfileData>();
+    data->bpm = analysis.bpm;
+    data->pitchClass = pitchClassFromKeyString(analysis.key);
+    data->windowSeconds = analysis.windowSeconds;
+    const std::vector<double>& curve = analysis.energyCurve;
+    fillEnergyFeatures(*data, analysis.beatGrid, curve.size(), [&](size_t i) { return curve[i]; });
+    data_ = std::move(data);
+}
+
+TransitionProfile::TransitionProfile(const TrackView& view) {
+    DJT_PROFILE_SCOPE("transitionProfile");
+    auto data = std::make_shared<TransitionProfileData>();
+    data->bpm = view.bpm;
+    data->pitchClass = view.pitchClass();
+    data->windowSeconds = view.windowSeconds;
+    // The stored codes are on the curve's own min-max range, which normalizing leaves as it is.
+    fillEnergyFeatures(*data, view.beatGrid, view.windows, [&](size_t i) { return view.normalizedEnergy(i); });
+    data_ = std::move(data);
+}
+
+double TransitionProfile::bpm() const { return data_->bpm; }
+
+int TransitionProfile::pitchClass() const { return data_->pitchClass; }
+
+bool TransitionProfile::empty() const { return data_->exitLevel.empty() || data_->windowSeconds <= 0.0; }
+
+double TransitionProfile::maxEntryRise() const {
+    return data_->entrySlope.empty() ? 0.0 : data_->entrySlope[data_->entryHulls[0].firstMaxSlope];
+}
+
+double TransitionProfile::energyUpperBound(double entryRise) const {
+    // Normalized entry levels never exceed 1.
+    return 0.6 * clamp01(data_->maxExitLevel) + 0.4 * clamp01(data_->maxExitSlope * entryRise);
+}
+
+double transitionScore(double bpmScore, double keyScore, double energyScore) {
+    return combinedScore(bpmScore, keyScore, energyScore);
+}
+
+std::vector<TransitionSuggestion> findTopTransitions(const TransitionProfile& profileA,
+                                                     const TransitionProfile& profileB,
+                                                     size_t k,
+                                                     double minSeparationSeconds) {
+    DJT_PROFILE_SCOPE("transitionSearch");
+    std::vector<TransitionSuggestion> results;
+    if (k == 0 || profileA.empty() || profileB.empty()) return results;
+
+    const TransitionProfileData& a = *profileA.data_;
+    const TransitionProfileData& b = *profileB.data_;
     const double bpmScore = bpmCompatibility(a.bpm, b.bpm);
-    const double keyScore = keyCompatibility(a.key, b.key);
-
-    auto normA = normalizeMinMax(a.energyCurve);
-    auto normB = normalizeMinMax(b.energyCurve);
-
-    double bestEnergyScore = -1.0;
-    size_t bestIdxA = 0;
-    size_t bestIdxB = 0;
-
-    // Brute-force over window indices; for efficiency we could stride, but keep simple for clarity.
-    for (size_t i = 0; i < normA.size(); ++i) {
-        double curA = normA[i];
-        double slopeA = (i > 0) ? (curA - normA[i - 1]) : 0.0;
-        double lowA = 1.0 - curA; // prefer exiting on low energy
-        for (size_t j = 0; j < normB.size(); ++j) {
-            double curB = normB[j];
-            double slopeB = (j > 0) ? (curB - normB[j - 1]) : 0.0;
-            // Prefer entering on rising energy, or on higher energy than exit point.
-            double riseComponent = clamp01(std::max(0.0, -slopeA) * std::max(0.0, slopeB));
-            double levelComponent = clamp01(lowA * curB);
-            double energyScore = 0.6 * levelComponent + 0.4 * riseComponent; // 0..1
-            if (energyScore > bestEnergyScore) {
-                bestEnergyScore = energyScore;
-                bestIdxA = i;
-                bestIdxB = j;
+    const double keyScore = pitchClassCompatibility(a.pitchClass, b.pitchClass);
+
+    // Best entry per exit point; the heap then yields candidates in brute-force order.
+    std::priority_queue<Candidate, std::vector<Candidate>, CandidateOrder> heap;
+    for (size_t i = 0; i < a.exitLevel.size(); ++i) heap.push(bestCandidate(a, i, b));
+    DJT_PROFILE_COUNT(PairEvaluations, a.exitLevel.size()); // one hull search per exit point
+
+    // Windows closer than the separation on both tracks count as the same transition.
+    const double sep = std::max(0.0, minSeparationSeconds);
+    std::vector<Candidate> chosen;
+    auto overlaps = [&](size_t i, size_t j, const Candidate& c) {
+        double dA = std::abs(a.times[i] - a.times[c.idxA]);
+        double dB = std::abs(b.times[j] - b.times[c.idxB]);
+        return dA < sep && dB < sep;
+    };
+    auto conflicts = [&](size_t i, size_t j) {
+        return std::any_of(chosen.begin(), chosen.end(), [&](const Candidate& c) { return overlaps(i, j, c); });
+    };
+
+    // Best entry for exit point i among those not overlapping an accepted candidate.
+    auto rescanExit = [&](size_t i) {
+        DJT_PROFILE_COUNT(PairEvaluations, b.entryLevel.size());
+        const CandidateOrder before;
+        bool found = false;
+        Candidate next{};
+        for (size_t j = 0; j < b.entryLevel.size(); ++j) {
+            if (conflicts(i, j)) continue;
+            const Candidate c = makeCandidate(a, i, b, j);
+            if (!found || before(next, c)) {
+                next = c;
+                found = true;
             }
         }
+        if (found) heap.push(next);
+    };
+
+    // Heap entries are upper bounds for their exit point: a popped candidate that does not
+    // overlap anything accepted is the best remaining pair. Otherwise its point is rescanned
+    // against the accepted set. Only points near accepted candidates are ever rescanned.
+    while (!heap.empty() && chosen.size() < k) {
+        Candidate top = heap.top();
+        heap.pop();
+        if (!conflicts(top.idxA, top.idxB)) {
+            chosen.push_back(top);
+            if (chosen.size() < k) rescanExit(top.idxA); // the same exit may pair with a far entry
+        } else {
+            rescanExit(top.idxA);
+        }
     }
 
-    bestEnergyScore = clamp01(bestEnergyScore);
+    for (const Candidate& c : chosen) {
+        results.push_back(makeSuggestion(c, a, b, bpmScore, keyScore));
+    }
+    return results;
+}
 
-    // Combine components; weighted sum mapped to 0-10.
-    double total01 = 0.4 * bpmScore + 0.3 * keyScore + 0.3 * bestEnergyScore;
-    best.score = clamp01(total01) * 10.0;
-    best.timeA = static_cast<double>(bestIdxA) * a.windowSeconds;
-    best.timeB = static_cast<double>(bestIdxB) * b.windowSeconds;
-    best.bpmComponent = bpmScore;
-    best.keyComponent = keyScore;
-    best.energyComponent = bestEnergyScore;
-    return best;
+std::vector<TransitionSuggestion> findTopTransitions(const TrackAnalysis& a,
+                                                     const TrackAnalysis& b,
+                                                     size_t k,
+                                                     double minSeparationSeconds) {
+    return findTopTransitions(TransitionProfile(a), TransitionProfile(b), k, minSeparationSeconds);
+}
+
+TransitionSuggestion findBestTransition(const TransitionProfile& a, const TransitionProfile& b) {
+    auto top = findTopTransitions(a, b, 1, 0.0);
+    if (top.empty()) {
+        TransitionSuggestion best{};
+        best.score = 0.0;
+        return best;
+    }
+    return top.front();
+}
+
+TransitionSuggestion findBestTransition(const TrackAnalysis& a, const TrackAnalysis& b) {
+    DJT_PROFILE_SCOPE("findBestTransition");
+    return findBestTransition(TransitionProfile(a), TransitionProfile(b));
+}
+
+TransitionSuggestion findBestTransition(const TrackView& a, const TrackView& b) {
+    DJT_PROFILE_SCOPE("findBestTransition");
+    return findBestTransition(TransitionProfile(a), TransitionProfile(b));
 }
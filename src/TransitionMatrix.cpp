@@ -0,0 +1,314 @@
+#include "TransitionMatrix.hpp"
+
+#include "FileUtils.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+// File layout (native byte order, like the analysis cache): header, entries, rowOffsets
+// (rows + 1), then per track a uint32 length and the name bytes.
+constexpr char kMatrixMagic[8] = {'D', 'J', 'T', 'M', 'A', 'T', 'R', 'X'};
+constexpr uint32_t kMatrixFormat = 1;
+
+struct MatrixHeader {
+    char magic[8];
+    uint32_t format;
+    uint32_t entrySize;
+    uint64_t trackCount;
+    uint64_t entryCount;
+    double minScore;
+};
+
+constexpr size_t kKeyBuckets = 13; // pitch classes 0-11, then unknown key
+constexpr double kBoundSlack = 1e-9;
+
+// BPM tiers of bpmCompatibility(): score and the relative difference it allows.
+constexpr std::array<std::pair<double, double>, 3> kTempoTiers = {{{1.0, 0.03}, {0.7, 0.06}, {0.4, 0.10}}};
+constexpr double kFarTempoScore = 0.15;
+constexpr double kUnknownTempoScore = 0.5;
+
+// Tempo as a position on the octave circle [0, 1): half and double time land on the same spot.
+double foldedTempo(double bpm) {
+    double octaves = std::log2(bpm);
+    return octaves - std::floor(octaves);
+}
+
+// Largest folded distance within which bpmCompatibility() sees a relative difference <= relDiff.
+double foldedRadius(double relDiff) { return std::log2((2.0 + relDiff) / (2.0 - relDiff)); }
+
+struct TempoEntry {
+    double position;
+    uint32_t track;
+};
+
+struct KeyBucket {
+    std::vector<TempoEntry> byTempo;     // known tempo, position ascending
+    std::vector<uint32_t> unknownTempo;
+    double maxEntryRise = 0.0;
+};
+
+class CompatibilityIndex {
+public:
+    explicit CompatibilityIndex(const std::vector<TransitionProfile>& profiles) {
+        for (size_t t = 0; t < profiles.size(); ++t) {
+            const TransitionProfile& p = profiles[t];
+            if (p.empty()) continue;
+            KeyBucket& bucket = buckets_[p.pitchClass() >= 0 ? static_cast<size_t>(p.pitchClass()) : 12];
+            if (p.bpm() > 0.0) {
+                bucket.byTempo.push_back({foldedTempo(p.bpm()), static_cast<uint32_t>(t)});
+            } else {
+                bucket.unknownTempo.push_back(static_cast<uint32_t>(t));
+            }
+            bucket.maxEntryRise = std::max(bucket.maxEntryRise, p.maxEntryRise());
+        }
+        for (KeyBucket& bucket : buckets_) {
+            std::sort(bucket.byTempo.begin(), bucket.byTempo.end(),
+                      [](const TempoEntry& x, const TempoEntry& y) { return x.position < y.position; });
+        }
+    }
+
+    // Tracks that a transition out of `a` could reach minScore with, from bucket-level bounds.
+    void candidates(const TransitionProfile& a, double minScore, std::vector<uint32_t>& out) const {
+        out.clear();
+        const double floor = minScore - kBoundSlack;
+        for (size_t k = 0; k < kKeyBuckets; ++k) {
+            const KeyBucket& bucket = buckets_[k];
+            const double keyScore = pitchClassCompatibility(a.pitchClass(), k < 12 ? static_cast<int>(k) : -1);
+            const double energyBound = a.energyUpperBound(bucket.maxEntryRise);
+            auto reachable = [&](double bpmScore) { return transitionScore(bpmScore, keyScore, energyBound) >= floor; };
+
+            if (a.bpm() <= 0.0) {
+                if (reachable(kUnknownTempoScore)) appendAll(bucket, out);
+            } else {
+                if (reachable(kUnknownTempoScore)) out.insert(out.end(), bucket.unknownTempo.begin(), bucket.unknownTempo.end());
+                if (reachable(kFarTempoScore)) {
+                    for (const TempoEntry& e : bucket.byTempo) out.push_back(e.track);
+                } else {
+                    // The loosest tier that can still reach minScore bounds the tempo distance.
+                    double radius = -1.0;
+                    for (const auto& tier : kTempoTiers) {
+                        if (reachable(tier.first)) radius = foldedRadius(tier.second);
+                    }
+                    if (radius >= 0.0) appendTempoRange(bucket, foldedTempo(a.bpm()), radius + kBoundSlack, out);
+                }
+            }
+        }
+    }
+
+private:
+    static void appendAll(const KeyBucket& bucket, std::vector<uint32_t>& out) {
+        for (const TempoEntry& e : bucket.byTempo) out.push_back(e.track);
+        out.insert(out.end(), bucket.unknownTempo.begin(), bucket.unknownTempo.end());
+    }
+
+    // Tracks within `radius` of `center` on the octave circle.
+    static void appendTempoRange(const KeyBucket& bucket, double center, double radius, std::vector<uint32_t>& out) {
+        const auto& v = bucket.byTempo;
+        auto appendSpan = [&](double lo, double hi) {
+            auto first = std::lower_bound(v.begin(), v.end(), lo,
+                                          [](const TempoEntry& e, double x) { return e.position < x; });
+            for (auto it = first; it != v.end() && it->position <= hi; ++it) out.push_back(it->track);
+        };
+        if (radius >= 0.5) {
+            appendSpan(0.0, 1.0);
+            return;
+        }
+        const double lo = center - radius;
+        const double hi = center + radius;
+        if (lo < 0.0) {
+            appendSpan(lo + 1.0, 1.0);
+            appendSpan(0.0, hi);
+        } else if (hi >= 1.0) {
+            appendSpan(lo, 1.0);
+            appendSpan(0.0, hi - 1.0);
+        } else {
+            appendSpan(lo, hi);
+        }
+    }
+
+    std::array<KeyBucket, kKeyBuckets> buckets_;
+};
+
+template <typename T>
+void readPod(std::ifstream& in, T& value, const std::string& path) {
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Truncated transition matrix: " + path);
+    }
+}
+
+// buildTransitionMatrix() on prepared profiles, one per name.
+MatrixStats buildMatrix(const std::vector<std::string_view>& names,
+                        const std::vector<TransitionProfile>& profiles,
+                        const std::string& outputPath,
+                        const MatrixOptions& options,
+                        const std::function<void(const MatrixStats&)>& onProgress) {
+    if (profiles.size() > UINT32_MAX) throw std::invalid_argument("buildTransitionMatrix: too many tracks");
+
+    const auto started = std::chrono::steady_clock::now();
+    const size_t n = profiles.size();
+    MatrixStats stats;
+    stats.rows = n;
+
+    // Written beside the old matrix and renamed over it, so a failed or interrupted run leaves
+    // the previous one intact.
+    replaceFile(outputPath, "transition matrix", [&](std::ofstream& out) {
+        MatrixHeader header{};
+        std::memcpy(header.magic, kMatrixMagic, sizeof(kMatrixMagic));
+        header.format = kMatrixFormat;
+        header.entrySize = sizeof(MatrixEntry);
+        header.trackCount = n;
+        header.minScore = options.minScore;
+        writeBytes(out, &header, sizeof(header)); // entry count is filled in at the end
+
+        ThreadPool pool(options.jobs);
+        const CompatibilityIndex index(profiles);
+
+        std::vector<uint64_t> rowOffsets(n + 1, 0);
+        const size_t blockRows = std::max<size_t>(1, options.blockRows);
+        std::vector<std::vector<MatrixEntry>> rows(blockRows);
+        std::atomic<uint64_t> scored{0};
+        std::atomic<uint64_t> pruned{0};
+
+        for (size_t blockStart = 0; blockStart < n; blockStart += blockRows) {
+            const size_t blockEnd = std::min(n, blockStart + blockRows);
+            for (size_t r = blockStart; r < blockEnd; ++r) {
+                pool.submit([&, r] {
+                    DJT_PROFILE_SCOPE("matrixRow");
+                    std::vector<MatrixEntry>& row = rows[r - blockStart];
+                    row.clear();
+                    const TransitionProfile& a = profiles[r];
+                    uint64_t rowScored = 0;
+                    if (!a.empty()) {
+                        std::vector<uint32_t> columns;
+                        index.candidates(a, options.minScore, columns);
+                        std::sort(columns.begin(), columns.end());
+                        for (uint32_t c : columns) {
+                            if (c == r) continue;
+                            // Pair-level bound with this track's own energy rise.
+                            const TransitionProfile& b = profiles[c];
+                            const double bound = transitionScore(bpmCompatibility(a.bpm(), b.bpm()),
+                                                                 pitchClassCompatibility(a.pitchClass(), b.pitchClass()),
+                                                                 a.energyUpperBound(b.maxEntryRise()));
+                            if (bound < options.minScore - kBoundSlack) continue;
+                            ++rowScored;
+                            TransitionSuggestion s = findBestTransition(a, b);
+                            if (s.score >= options.minScore) {
+                                row.push_back({c, static_cast<float>(s.score), static_cast<float>(s.timeA),
+                                               static_cast<float>(s.timeB)});
+                            }
+                        }
+                    }
+                    scored += rowScored;
+                    pruned += (n - 1) - rowScored;
+                });
+            }
+            pool.wait();
+
+            for (size_t r = blockStart; r < blockEnd; ++r) {
+                const std::vector<MatrixEntry>& row = rows[r - blockStart];
+                writeBytes(out, row.data(), row.size() * sizeof(MatrixEntry));
+                stats.entries += row.size();
+                rowOffsets[r + 1] = stats.entries;
+            }
+            if (!out) throw std::runtime_error("Failed to write transition matrix: " + outputPath);
+
+            stats.rowsDone = blockEnd;
+            stats.pairsScored = scored.load();
+            stats.pairsPruned = pruned.load();
+            stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            if (onProgress) onProgress(stats);
+        }
+
+        writeBytes(out, rowOffsets.data(), rowOffsets.size() * sizeof(uint64_t));
+        for (std::string_view name : names) {
+            const uint32_t length = static_cast<uint32_t>(name.size());
+            writeBytes(out, &length, sizeof(length));
+            writeBytes(out, name.data(), name.size());
+        }
+        header.entryCount = stats.entries;
+        out.seekp(0);
+        writeBytes(out, &header, sizeof(header));
+    });
+    return stats;
+}
+} // namespace
+
+MatrixStats buildTransitionMatrix(const std::vector<std::string>& names,
+                                  const std::vector<TrackAnalysis>& tracks,
+                                  const std::string& outputPath,
+                                  const MatrixOptions& options,
+                                  const std::function<void(const MatrixStats&)>& onProgress) {
+    DJT_PROFILE_SCOPE("buildTransitionMatrix");
+    if (names.size() != tracks.size()) {
+        throw std::invalid_argument("buildTransitionMatrix: one name per track required");
+    }
+    std::vector<TransitionProfile> profiles;
+    profiles.reserve(tracks.size());
+    for (const TrackAnalysis& t : tracks) profiles.emplace_back(t);
+    return buildMatrix(std::vector<std::string_view>(names.begin(), names.end()), profiles, outputPath, options,
+                       onProgress);
+}
+
+MatrixStats buildTransitionMatrix(const TrackStore& store,
+                                  const std::string& outputPath,
+                                  const MatrixOptions& options,
+                                  const std::function<void(const MatrixStats&)>& onProgress) {
+    DJT_PROFILE_SCOPE("buildTransitionMatrix");
+    std::vector<std::string_view> names;
+    std::vector<TransitionProfile> profiles;
+    names.reserve(store.size());
+    profiles.reserve(store.size());
+    for (size_t i = 0; i < store.size(); ++i) {
+        const TrackView view = store.track(i);
+        names.push_back(view.name);
+        profiles.emplace_back(view);
+    }
+    return buildMatrix(names, profiles, outputPath, options, onProgress);
+}
+
+TransitionMatrix loadTransitionMatrix(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Failed to open transition matrix: " + path);
+
+    MatrixHeader header{};
+    readPod(in, header, path);
+    if (std::memcmp(header.magic, kMatrixMagic, sizeof(kMatrixMagic)) != 0 || header.format != kMatrixFormat ||
+        header.entrySize != sizeof(MatrixEntry)) {
+        throw std::runtime_error("Not a transition matrix: " + path);
+    }
+
+    TransitionMatrix matrix;
+    matrix.minScore = header.minScore;
+    matrix.entries.resize(static_cast<size_t>(header.entryCount));
+    matrix.rowOffsets.resize(static_cast<size_t>(header.trackCount) + 1);
+    if (!in.read(reinterpret_cast<char*>(matrix.entries.data()),
+                 static_cast<std::streamsize>(matrix.entries.size() * sizeof(MatrixEntry))) ||
+        !in.read(reinterpret_cast<char*>(matrix.rowOffsets.data()),
+                 static_cast<std::streamsize>(matrix.rowOffsets.size() * sizeof(uint64_t)))) {
+        throw std::runtime_error("Truncated transition matrix: " + path);
+    }
+    if (matrix.rowOffsets.back() != header.entryCount) {
+        throw std::runtime_error("Corrupt transition matrix: " + path);
+    }
+
+    matrix.tracks.resize(static_cast<size_t>(header.trackCount));
+    for (std::string& name : matrix.tracks) {
+        uint32_t length = 0;
+        readPod(in, length, path);
+        name.resize(length);
+        if (!in.read(name.data(), length)) throw std::runtime_error("Truncated transition matrix: " + path);
+    }
+    return matrix;
+}
@@ -0,0 +1,488 @@
+#include "TransitionRenderer.hpp"
+
+#include "AudioLoader.hpp"
+#include "Profiler.hpp"
+#include "Resampler.hpp"
+#include "SimdKernels.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <sndfile.h>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+// Onset envelope frame for beat alignment, and how much of the fade it compares.
+constexpr double kEnvelopeHop = 0.005;
+constexpr double kAlignSeconds = 8.0;
+// WSOLA grain, rounded to a power of two frames (2048 at 44.1 and 48 kHz). Grains overlap by
+// half and may shift by a quarter grain to line up with the previous one.
+constexpr double kGrainSeconds = 0.046;
+// Decimation of the mono signal the coarse grain search correlates; the fine search then
+// checks every offset within one step of the best coarse one.
+constexpr size_t kCoarseStep = 4;
+
+// Planar stereo from interleaved frames: mono plays on both sides, channels past two are dropped.
+void toStereo(const float* in, size_t frames, int channels, float* left, float* right) {
+    const size_t ch = static_cast<size_t>(channels);
+    for (size_t i = 0; i < frames; ++i) {
+        left[i] = in[i * ch];
+        right[i] = in[i * ch + (ch > 1 ? 1 : 0)];
+    }
+}
+
+// Planar stereo frames of a track from a start frame on, with silence before its first frame
+// and after its last.
+class TrackSource {
+public:
+    TrackSource(const std::string& path, size_t blockFrames) : reader_(path, blockFrames) {}
+
+    int sampleRate() const { return reader_.info().sampleRate; }
+    uint64_t decoded() const { return decoded_; }
+
+    void start(int64_t frame) {
+        silence_ = frame < 0 ? static_cast<uint64_t>(-frame) : 0;
+        reader_.seek(std::min<uint64_t>(frame < 0 ? 0 : static_cast<uint64_t>(frame), reader_.info().frames));
+    }
+
+    // Fill `frames` frames of both channels.
+    void read(float* left, float* right, size_t frames) {
+        const size_t quiet = static_cast<size_t>(std::min<uint64_t>(silence_, frames));
+        std::fill(left, left + quiet, 0.0f);
+        std::fill(right, right + quiet, 0.0f);
+        silence_ -= quiet;
+        size_t done = quiet;
+        while (done < frames) {
+            const float* block = nullptr;
+            const size_t got = reader_.readInterleaved(block, frames - done);
+            if (got == 0) break;
+            toStereo(block, got, reader_.info().channels, left + done, right + done);
+            done += got;
+            decoded_ += got;
+        }
+        std::fill(left + done, left + frames, 0.0f);
+        std::fill(right + done, right + frames, 0.0f);
+    }
+
+private:
+    AudioStreamReader reader_;
+    uint64_t silence_ = 0;
+    uint64_t decoded_ = 0;
+};
+
+// A TrackSource at another sample rate, played `ratio` times as fast with WSOLA: each output
+// hop overlap-adds one Hann-windowed grain read from near the stretched position, at the
+// offset whose start best matches how the previous grain's audio continues.
+class StretchedSource {
+public:
+    StretchedSource(TrackSource& source, int outputRate, double ratio, size_t blockFrames)
+        : source_(source), ratio_(ratio), blockFrames_(blockFrames) {
+        if (source.sampleRate() != outputRate) {
+            for (auto& resampler : resamplers_) {
+                resampler = std::make_unique<PolyphaseResampler>(source.sampleRate(), outputRate);
+            }
+        }
+        stretching_ = ratio != 1.0;
+        grain_ = size_t{1} << static_cast<int>(std::lround(std::log2(kGrainSeconds * outputRate)));
+        hop_ = grain_ / 2;
+        search_ = grain_ / 4;
+        window_.resize(grain_);
+        for (size_t i = 0; i < grain_; ++i) {
+            window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / grain_));
+        }
+        for (auto& ola : ola_) ola.assign(grain_, 0.0f);
+    }
+
+    void read(float* left, float* right, size_t frames) {
+        float* out[2] = {left, right};
+        size_t done = 0;
+        while (done < frames) {
+            if (outPos_ == out_[0].size()) {
+                out_[0].clear();
+                out_[1].clear();
+                outPos_ = 0;
+                if (stretching_) {
+                    nextGrain();
+                } else {
+                    // Straight through: pass input on as it arrives.
+                    pull(blockFrames_);
+                    for (size_t c = 0; c < 2; ++c) out_[c].swap(in_[c]);
+                    in_[0].clear();
+                    in_[1].clear();
+                    mono_.clear();
+                    coarse_.clear();
+                }
+            }
+            const size_t n = std::min(frames - done, out_[0].size() - outPos_);
+            for (size_t c = 0; c < 2; ++c) std::memcpy(out[c] + done, out_[c].data() + outPos_, n * sizeof(float));
+            outPos_ += n;
+            done += n;
+        }
+    }
+
+private:
+    // Append at least `frames` frames of input at the output rate.
+    void pull(size_t frames) {
+        scratch_[0].resize(frames);
+        scratch_[1].resize(frames);
+        source_.read(scratch_[0].data(), scratch_[1].data(), frames);
+        for (size_t c = 0; c < 2; ++c) {
+            if (resamplers_[c]) {
+                resampled_.resize(resamplers_[c]->maxOutput(frames));
+                const size_t n = resamplers_[c]->process(scratch_[c].data(), frames, resampled_.data());
+                in_[c].insert(in_[c].end(), resampled_.begin(), resampled_.begin() + static_cast<std::ptrdiff_t>(n));
+            } else {
+                in_[c].insert(in_[c].end(), scratch_[c].begin(), scratch_[c].end());
+            }
+        }
+        if (!stretching_) return;
+        // The grain search correlates the channel sum, and a kCoarseStep-decimated copy of it.
+        for (size_t i = mono_.size(); i < in_[0].size(); ++i) mono_.push_back(in_[0][i] + in_[1][i]);
+        for (size_t j = coarse_.size(); (j + 1) * kCoarseStep <= mono_.size(); ++j) {
+            float sum = 0.0f;
+            for (size_t q = 0; q < kCoarseStep; ++q) sum += mono_[j * kCoarseStep + q];
+            coarse_.push_back(sum);
+        }
+    }
+
+    // Make input frames up to absolute frame `end` available.
+    void require(int64_t end) {
+        while (base_ + static_cast<int64_t>(in_[0].size()) < end) pull(blockFrames_);
+    }
+
+    float correlation(const std::vector<float>& signal, int64_t base, int64_t a, int64_t b, size_t n) const {
+        return dotProduct(signal.data() + (a - base), signal.data() + (b - base), n);
+    }
+
+    void nextGrain() {
+        DJT_PROFILE_SCOPE("renderStretch");
+        const int64_t target = std::llround(static_cast<double>(grains_) * ratio_ * static_cast<double>(hop_));
+        const int64_t span = static_cast<int64_t>(search_);
+        const size_t overlap = grain_ - hop_;
+        int64_t chosen = target;
+        if (grains_ > 0) {
+            const int64_t natural = previous_ + static_cast<int64_t>(hop_);
+            const int64_t lo = std::max<int64_t>(0, target - span);
+            const int64_t hi = target + span;
+            require(std::max(hi, natural) + static_cast<int64_t>(grain_) + static_cast<int64_t>(kCoarseStep));
+
+            const int64_t step = static_cast<int64_t>(kCoarseStep);
+            const int64_t coarseBase = base_ / step;
+            const int64_t coarseNatural = natural / step;
+            int64_t best = target;
+            float bestScore = -std::numeric_limits<float>::infinity();
+            for (int64_t c = (lo + step - 1) / step; c * step <= hi; ++c) {
+                const float score = correlation(coarse_, coarseBase, coarseNatural, c, overlap / kCoarseStep);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = c * step;
+                }
+            }
+            bestScore = -std::numeric_limits<float>::infinity();
+            for (int64_t c = std::max(lo, best - step + 1); c < best + step && c <= hi; ++c) {
+                const float score = correlation(mono_, base_, natural, c, overlap);
+                if (score > bestScore) {
+                    bestScore = score;
+                    chosen = c;
+                }
+            }
+        }
+        require(chosen + static_cast<int64_t>(grain_));
+
+        for (size_t c = 0; c < 2; ++c) {
+            std::vector<float>& ola = ola_[c];
+            multiplyAccumulate(in_[c].data() + (chosen - base_), window_.data(), ola.data(), grain_);
+            out_[c].insert(out_[c].end(), ola.begin(), ola.begin() + static_cast<std::ptrdiff_t>(hop_));
+            std::memmove(ola.data(), ola.data() + hop_, (grain_ - hop_) * sizeof(float));
+            std::fill(ola.begin() + static_cast<std::ptrdiff_t>(grain_ - hop_), ola.end(), 0.0f);
+        }
+        previous_ = chosen;
+        ++grains_;
+
+        // Drop input no later grain can reach, keeping the base on the coarse grid.
+        const int64_t nextTarget = std::llround(static_cast<double>(grains_) * ratio_ * static_cast<double>(hop_));
+        int64_t keep = std::min(previous_ + static_cast<int64_t>(hop_), nextTarget - span) - static_cast<int64_t>(kCoarseStep);
+        keep -= keep % static_cast<int64_t>(kCoarseStep);
+        const size_t drop = keep > base_ ? static_cast<size_t>(keep - base_) : 0;
+        if (drop >= 4 * grain_) {
+            for (auto& channel : in_) channel.erase(channel.begin(), channel.begin() + static_cast<std::ptrdiff_t>(drop));
+            mono_.erase(mono_.begin(), mono_.begin() + static_cast<std::ptrdiff_t>(drop));
+            coarse_.erase(coarse_.begin(), coarse_.begin() + static_cast<std::ptrdiff_t>(drop / kCoarseStep));
+            base_ += static_cast<int64_t>(drop);
+        }
+    }
+
+    TrackSource& source_;
+    std::array<std::unique_ptr<PolyphaseResampler>, 2> resamplers_;
+    double ratio_ = 1.0;
+    bool stretching_ = false;
+    size_t blockFrames_ = 0;
+    size_t grain_ = 0;
+    size_t hop_ = 0;
+    size_t search_ = 0;
+    std::vector<float> window_;
+
+    std::array<std::vector<float>, 2> scratch_;
+    std::vector<float> resampled_;
+    std::array<std::vector<float>, 2> in_; // input from absolute frame base_ on
+    std::vector<float> mono_;              // in_ summed over channels
+    std::vector<float> coarse_;            // mono_ summed over kCoarseStep frames
+    int64_t base_ = 0;
+    uint64_t grains_ = 0;
+    int64_t previous_ = 0; // input frame the last grain started at
+
+    std::array<std::vector<float>, 2> ola_; // overlap-add of the grains not yet complete
+    std::array<std::vector<float>, 2> out_;
+    size_t outPos_ = 0;
+};
+
+// Onset strength (rise in log energy) of `frames` consecutive frames of hopSeconds of a track,
+// from startSeconds on; time outside the track counts as silence.
+std::vector<double> onsetEnvelope(const std::string& path,
+                                  double startSeconds,
+                                  double hopSeconds,
+                                  size_t frames,
+                                  uint64_t& decoded) {
+    AudioStreamReader reader(path);
+    const double rate = reader.info().sampleRate;
+    // energy[0] is the frame before the first, for its rise.
+    std::vector<double> energy(frames + 1, 0.0);
+    const double origin = startSeconds - hopSeconds;
+    const int64_t first = static_cast<int64_t>(std::floor(origin * rate));
+    const int64_t last = static_cast<int64_t>(std::ceil((startSeconds + frames * hopSeconds) * rate));
+    const uint64_t begin = static_cast<uint64_t>(std::max<int64_t>(0, first));
+    if (last > 0 && begin < reader.info().frames) {
+        reader.seek(begin);
+        uint64_t position = begin;
+        const float* block = nullptr;
+        while (position < static_cast<uint64_t>(last)) {
+            const size_t got = reader.readBlock(block, static_cast<size_t>(static_cast<uint64_t>(last) - position));
+            if (got == 0) break;
+            for (size_t i = 0; i < got; ++i) {
+                const double t = static_cast<double>(position + i) / rate - origin;
+                const int64_t j = static_cast<int64_t>(t / hopSeconds);
+                if (j >= 0 && j <= static_cast<int64_t>(frames)) energy[static_cast<size_t>(j)] += block[i] * block[i];
+            }
+            position += got;
+            decoded += got;
+        }
+    }
+    std::vector<double> onset(frames);
+    for (size_t j = 0; j < frames; ++j) {
+        onset[j] = std::max(0.0, std::log(energy[j + 1] + 1e-6) - std::log(energy[j] + 1e-6));
+    }
+    return onset;
+}
+
+// Output seconds to delay B by (negative: bring it forward) so its onsets after its cue fall on
+// A's after A's, within half of A's beat.
+double beatOffset(const std::string& pathA,
+                  double bpmA,
+                  double timeA,
+                  const std::string& pathB,
+                  double timeB,
+                  double ratio,
+                  uint64_t& decoded) {
+    if (bpmA <= 0.0) return 0.0;
+    const size_t frames = static_cast<size_t>(kAlignSeconds / kEnvelopeHop);
+    const size_t maxLag = static_cast<size_t>(0.5 * 60.0 / bpmA / kEnvelopeHop);
+    const std::vector<double> a = onsetEnvelope(pathA, timeA, kEnvelopeHop, frames, decoded);
+    // b[i] is B at output frame i - maxLag of the fade, unshifted.
+    const std::vector<double> b = onsetEnvelope(pathB, timeB - static_cast<double>(maxLag) * kEnvelopeHop * ratio,
+                                                kEnvelopeHop * ratio, frames + 2 * maxLag, decoded);
+    auto score = [&](int64_t lag) {
+        double sum = 0.0;
+        for (size_t j = 0; j < frames; ++j) sum += a[j] * b[static_cast<size_t>(static_cast<int64_t>(j + maxLag) - lag)];
+        return sum;
+    };
+    // Smallest shift first, so ties and silence leave B where it is.
+    int64_t best = 0;
+    double bestScore = score(0);
+    for (int64_t lag = 1; lag <= static_cast<int64_t>(maxLag); ++lag) {
+        for (const int64_t signedLag : {lag, -lag}) {
+            const double s = score(signedLag);
+            if (s > bestScore) {
+                bestScore = s;
+                best = signedLag;
+            }
+        }
+    }
+    return static_cast<double>(best) * kEnvelopeHop;
+}
+
+// Second-order Butterworth low-pass (RBJ biquad), one state per channel.
+class LowPass {
+public:
+    LowPass(double cutoffHz, int sampleRate) {
+        const double w = 2.0 * kPi * cutoffHz / sampleRate;
+        const double alpha = std::sin(w) / std::sqrt(2.0);
+        const double a0 = 1.0 + alpha;
+        b0_ = (1.0 - std::cos(w)) / 2.0 / a0;
+        b1_ = (1.0 - std::cos(w)) / a0;
+        a1_ = -2.0 * std::cos(w) / a0;
+        a2_ = (1.0 - alpha) / a0;
+    }
+
+    void process(size_t channel, const float* in, float* out, size_t n) {
+        double z1 = z1_[channel];
+        double z2 = z2_[channel];
+        for (size_t i = 0; i < n; ++i) {
+            const double x = in[i];
+            const double y = b0_ * x + z1;
+            z1 = b1_ * x - a1_ * y + z2;
+            z2 = b0_ * x - a2_ * y;
+            out[i] = static_cast<float>(y);
+        }
+        z1_[channel] = z1;
+        z2_[channel] = z2;
+    }
+
+private:
+    double b0_ = 0.0; // b2 == b0
+    double b1_ = 0.0;
+    double a1_ = 0.0;
+    double a2_ = 0.0;
+    double z1_[2] = {};
+    double z2_[2] = {};
+};
+
+struct SndFileCloser {
+    void operator()(SNDFILE* file) const { sf_close(file); }
+};
+} // namespace
+
+RenderStats renderTransition(const std::string& pathA,
+                             double bpmA,
+                             const std::string& pathB,
+                             double bpmB,
+                             const TransitionSuggestion& cue,
+                             const std::string& outputPath,
+                             const RenderOptions& options) {
+    DJT_PROFILE_SCOPE("renderTransition");
+    if (!(options.leadSeconds >= 0.0 && options.fadeSeconds >= 0.0 && options.tailSeconds >= 0.0 &&
+          options.swapSeconds >= 0.0 && options.bassHz > 0.0) || options.blockFrames == 0) {
+        throw std::invalid_argument("renderTransition: durations must be non-negative and the block size positive");
+    }
+    const auto started = std::chrono::steady_clock::now();
+    RenderStats stats;
+
+    TrackSource a(pathA, options.blockFrames);
+    TrackSource b(pathB, options.blockFrames);
+    const int rate = a.sampleRate();
+    stats.sampleRate = rate;
+    if (options.stretch) {
+        // Seconds of B per second of output to play B at A's tempo, in B's closest octave.
+        const double ratio = 1.0 / foldedTempoRatio(bpmA, bpmB);
+        if (std::abs(ratio - 1.0) <= options.maxStretch) stats.stretchRatio = ratio;
+    }
+    if (options.beatAlign) {
+        stats.alignSeconds = beatOffset(pathA, bpmA, cue.timeA, pathB, cue.timeB, stats.stretchRatio, stats.decodedFrames);
+    }
+
+    const double timeA = std::max(0.0, cue.timeA);
+    const uint64_t lead = static_cast<uint64_t>(std::llround(std::min(options.leadSeconds, timeA) * rate));
+    const uint64_t fade = static_cast<uint64_t>(std::llround(options.fadeSeconds * rate));
+    const uint64_t tail = static_cast<uint64_t>(std::llround(options.tailSeconds * rate));
+    const uint64_t total = lead + fade + tail;
+    a.start(std::llround(timeA * rate) - static_cast<int64_t>(lead));
+    b.start(std::llround((cue.timeB - stats.alignSeconds * stats.stretchRatio) * b.sampleRate()));
+    StretchedSource stretched(b, rate, stats.stretchRatio, options.blockFrames);
+
+    SF_INFO info{};
+    info.samplerate = rate;
+    info.channels = 2;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    std::unique_ptr<SNDFILE, SndFileCloser> out(sf_open(outputPath.c_str(), SFM_WRITE, &info));
+    if (!out) throw std::runtime_error("Failed to create output file: " + outputPath);
+    sf_command(out.get(), SFC_SET_CLIPPING, nullptr, SF_TRUE);
+
+    // Bass hand-over: A's bass band is scaled by bassA - 1 added back, B's by bassB - 1.
+    const double swapCenter = static_cast<double>(lead) + 0.5 * static_cast<double>(fade);
+    const double swapFrames = std::max(1.0, options.swapSeconds * rate);
+    const bool eq = options.eqSwap && fade > 0;
+    LowPass bassA(options.bassHz, rate);
+    LowPass bassB(options.bassHz, rate);
+
+    const size_t block = options.blockFrames;
+    std::vector<float> aSide[2], bSide[2], low(block), gainA(block), gainB(block), bassGain(block), interleaved(2 * block);
+    for (size_t c = 0; c < 2; ++c) {
+        aSide[c].resize(block);
+        bSide[c].resize(block);
+    }
+    for (uint64_t o = 0; o < total; o += block) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(block, total - o));
+        // A plays until the fade ends, B from its start.
+        const size_t aFrames = o < lead + fade ? static_cast<size_t>(std::min<uint64_t>(n, lead + fade - o)) : 0;
+        const size_t bFirst = o < lead ? static_cast<size_t>(std::min<uint64_t>(n, lead - o)) : 0;
+        for (size_t c = 0; c < 2; ++c) {
+            std::fill(aSide[c].begin() + static_cast<std::ptrdiff_t>(aFrames), aSide[c].begin() + static_cast<std::ptrdiff_t>(n), 0.0f);
+            std::fill(bSide[c].begin(), bSide[c].begin() + static_cast<std::ptrdiff_t>(bFirst), 0.0f);
+        }
+        if (aFrames > 0) a.read(aSide[0].data(), aSide[1].data(), aFrames);
+        if (bFirst < n) stretched.read(bSide[0].data() + bFirst, bSide[1].data() + bFirst, n - bFirst);
+
+        // Equal power: cos/sin over the fade.
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t t = o + i;
+            if (t < lead) {
+                gainA[i] = 1.0f;
+                gainB[i] = 0.0f;
+            } else if (t < lead + fade) {
+                const double x = (static_cast<double>(t - lead) + 0.5) / static_cast<double>(fade) * 0.5 * kPi;
+                gainA[i] = static_cast<float>(std::cos(x));
+                gainB[i] = static_cast<float>(std::sin(x));
+            } else {
+                gainA[i] = 0.0f;
+                gainB[i] = 1.0f;
+            }
+        }
+
+        // EQ only inside the fade; the filters start cold there, where A keeps its full bass and
+        // B is silent.
+        const uint64_t eqBegin = std::max<uint64_t>(o, lead);
+        const uint64_t eqEnd = std::min<uint64_t>(o + n, lead + fade);
+        if (eq && eqBegin < eqEnd) {
+            const size_t offset = static_cast<size_t>(eqBegin - o);
+            const size_t count = static_cast<size_t>(eqEnd - eqBegin);
+            for (size_t i = 0; i < count; ++i) {
+                const double t = static_cast<double>(eqBegin + i);
+                // A's bass share: 1 before the hand-over, 0 after; B's bass is the rest.
+                bassGain[i] = static_cast<float>(std::clamp((swapCenter + 0.5 * swapFrames - t) / swapFrames, 0.0, 1.0) - 1.0);
+            }
+            for (size_t c = 0; c < 2; ++c) {
+                bassA.process(c, aSide[c].data() + offset, low.data(), count);
+                multiplyAccumulate(low.data(), bassGain.data(), aSide[c].data() + offset, count);
+            }
+            for (size_t i = 0; i < count; ++i) bassGain[i] = -1.0f - bassGain[i];
+            for (size_t c = 0; c < 2; ++c) {
+                bassB.process(c, bSide[c].data() + offset, low.data(), count);
+                multiplyAccumulate(low.data(), bassGain.data(), bSide[c].data() + offset, count);
+            }
+        }
+
+        for (size_t c = 0; c < 2; ++c) {
+            mixWeighted(aSide[c].data(), gainA.data(), bSide[c].data(), gainB.data(), aSide[c].data(), n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            interleaved[2 * i] = aSide[0][i];
+            interleaved[2 * i + 1] = aSide[1][i];
+        }
+        if (sf_writef_float(out.get(), interleaved.data(), static_cast<sf_count_t>(n)) != static_cast<sf_count_t>(n)) {
+            throw std::runtime_error("Failed to write output file: " + outputPath);
+        }
+        stats.frames += n;
+    }
+    out.reset();
+
+    stats.decodedFrames += a.decoded() + b.decoded();
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
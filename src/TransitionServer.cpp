@@ -0,0 +1,719 @@
+#include "TransitionServer.hpp"
+
+#include "AnalysisCache.hpp"
+#include "JsonParser.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
+#include "TransitionAnalyzer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define DJT_HAVE_UNIX_SOCKETS 1
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// A request line longer than this closes the connection.
+constexpr size_t kMaxRequestBytes = 1 << 20;
+// Responses queued for a client that is not reading them; past this it is disconnected.
+constexpr size_t kMaxPendingBytes = 4 << 20;
+// How long run() keeps flushing queued responses after it stops serving.
+constexpr std::chrono::milliseconds kDrainTimeout{2000};
+// Latencies kept for the percentiles.
+constexpr size_t kLatencyWindow = 1 << 16;
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL; // a client that hung up must not kill the server
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// The request line as one flat JSON object of scalar fields; false on anything else, nested
+// values included. `out` keeps what did parse, so a rejected request can still have its id echoed.
+bool parseRequest(const std::string& line, JsonValue& out) {
+    try {
+        out = parseJson(line);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return out.type == JsonValue::Type::Object &&
+           std::all_of(out.members.begin(), out.members.end(), [](const auto& m) { return m.second.isScalar(); });
+}
+
+void appendNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    out += buffer;
+}
+
+// Non-negative integer field, or `fallback` when absent; false when malformed.
+bool countField(const JsonValue& request, const char* name, size_t fallback, size_t& out) {
+    const JsonValue* field = request.find(name);
+    if (!field) {
+        out = fallback;
+        return true;
+    }
+    const std::string& text = field->text;
+    if (field->type != JsonValue::Type::Number || text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    out = static_cast<size_t>(std::strtoull(text.c_str(), nullptr, 10));
+    return true;
+}
+
+// A resident track: its transition features, and what "analyze" reports.
+struct TrackInfo {
+    TransitionProfile profile;
+    double bpm = 0.0;
+    std::string key;
+};
+
+// Called with the track, or with null and the reason it could not be analyzed.
+using TrackCallback = std::function<void(const std::shared_ptr<const TrackInfo>&, const std::string&)>;
+// Answers the waiting request with an error, when its TrackCallback throws.
+using FailCallback = std::function<void(const std::string&)>;
+
+struct TrackWaiter {
+    TrackCallback done;
+    FailCallback fail;
+};
+
+struct TrackSlot {
+    std::shared_ptr<const TrackInfo> info; // null while the analysis runs
+    std::vector<TrackWaiter> waiters;
+};
+
+#if defined(DJT_HAVE_UNIX_SOCKETS)
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Connected socket to `path`, or -1.
+int connectTo(const std::string& path) {
+    sockaddr_un address{};
+    if (!fillAddress(path, address)) return -1;
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t sent = ::send(fd, data, size, kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Bytes of `data` a non-blocking socket takes without waiting, or -1 once the peer is gone.
+ssize_t sendAvailable(int fd, const char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t sent = ::send(fd, data + done, size - done, kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        done += static_cast<size_t>(sent);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+void setNonBlocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+// One client, on a non-blocking socket. Lines are read by the polling thread only. Responses
+// are queued whole by workers, which write what the socket takes at once; the polling thread
+// sends the rest when the socket drains, so a client that stops reading never blocks a thread.
+struct Connection {
+    Connection(int socket, int wakeFd) : fd(socket), wake(wakeFd) {}
+    ~Connection() { ::close(fd); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    void send(std::string line) {
+        line.push_back('\n');
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (dropped) return; // a client that left just misses its answer
+            if (output.empty()) {
+                const ssize_t sent = sendAvailable(fd, line.data(), line.size());
+                if (sent == static_cast<ssize_t>(line.size())) return;
+                if (sent < 0) {
+                    dropped = true;
+                } else {
+                    output.assign(line, static_cast<size_t>(sent), std::string::npos);
+                }
+            } else if (output.size() + line.size() > kMaxPendingBytes) {
+                dropped = true;
+                output.clear();
+            } else {
+                output += line;
+                return; // the polling thread already waits for the socket to drain
+            }
+        }
+        const char byte = 1;
+        [[maybe_unused]] const ssize_t ignored = ::write(wake, &byte, 1); // poll this socket again
+    }
+
+    // Send queued output the socket takes now; false once the client is to be dropped.
+    bool flush() {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (dropped) return false;
+        const ssize_t sent = sendAvailable(fd, output.data(), output.size());
+        if (sent < 0) {
+            dropped = true;
+            output.clear();
+            return false;
+        }
+        output.erase(0, static_cast<size_t>(sent));
+        return true;
+    }
+
+    // Events to poll for; 0 once the client is dropped, or closing with nothing left to send.
+    short events() {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (dropped) return 0;
+        const short writing = output.empty() ? 0 : POLLOUT;
+        return closing ? writing : static_cast<short>(POLLIN | writing);
+    }
+
+    // Stop reading; the connection closes once its queued output is sent.
+    void closeAfterSending() {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        closing = true;
+    }
+
+    const int fd;
+    const int wake;    // the server's wake pipe
+    std::string input; // bytes after the last complete line
+
+private:
+    std::mutex outputMutex;
+    std::string output; // response bytes the socket has not taken yet
+    bool dropped = false;
+    bool closing = false;
+};
+#endif
+} // namespace
+
+struct TransitionServer::Impl {
+    explicit Impl(const ServerOptions& serverOptions) : options(serverOptions) {}
+
+    ServerOptions options;
+    std::atomic<bool> stopping{false};
+    std::unique_ptr<ThreadPool> pool;
+    std::unordered_map<std::string, size_t> storeIndex; // store track by name
+
+    mutable std::mutex tracksMutex;
+    std::unordered_map<std::string, TrackSlot> tracks;
+
+    mutable std::mutex statsMutex;
+    std::vector<double> latencies; // ring of the last kLatencyWindow, in ms
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    double maxMs = 0.0;
+
+    ServerStats snapshot() const;
+
+#if defined(DJT_HAVE_UNIX_SOCKETS)
+    int listenFd = -1;
+    int wakeRead = -1; // self-pipe: stop() writes a byte to end the poll
+    int wakeWrite = -1;
+    bool bound = false;
+
+    void requestStop();
+    void withTrack(const std::string& path, TrackCallback done, FailCallback fail);
+    void analyzeTrack(const std::string& path);
+    void handle(const std::shared_ptr<Connection>& connection, const std::string& line, Clock::time_point received);
+    void respond(Connection& connection, const std::string& body, Clock::time_point received, bool failed);
+#endif
+};
+
+ServerStats TransitionServer::Impl::snapshot() const {
+    ServerStats s;
+    std::vector<double> recent;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        s.requests = requests;
+        s.errors = errors;
+        s.maxMs = maxMs;
+        recent.assign(latencies.begin(), latencies.begin() + static_cast<std::ptrdiff_t>(
+                                                                 std::min<uint64_t>(requests, kLatencyWindow)));
+    }
+    {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        for (const auto& entry : tracks) {
+            if (entry.second.info) ++s.tracks;
+        }
+    }
+    auto percentile = [&recent](double p) {
+        const size_t rank = static_cast<size_t>(p * static_cast<double>(recent.size() - 1) + 0.5);
+        std::nth_element(recent.begin(), recent.begin() + static_cast<std::ptrdiff_t>(rank), recent.end());
+        return recent[rank];
+    };
+    if (!recent.empty()) {
+        s.p50Ms = percentile(0.50);
+        s.p99Ms = percentile(0.99);
+    }
+    return s;
+}
+
+#if defined(DJT_HAVE_UNIX_SOCKETS)
+// Run `done` with the track, analyzing it first if no one has asked for it yet. Requests for a
+// track being analyzed are parked on it rather than blocking a worker; `fail` answers a parked
+// request whose `done` throws.
+void TransitionServer::Impl::withTrack(const std::string& path, TrackCallback done, FailCallback fail) {
+    std::unique_lock<std::mutex> lock(tracksMutex);
+    auto [it, inserted] = tracks.try_emplace(path);
+    if (it->second.info) {
+        const std::shared_ptr<const TrackInfo> info = it->second.info;
+        lock.unlock();
+        done(info, std::string());
+        return;
+    }
+    it->second.waiters.push_back({std::move(done), std::move(fail)});
+    lock.unlock();
+    if (inserted) pool->submit([this, path] { analyzeTrack(path); });
+}
+
+void TransitionServer::Impl::analyzeTrack(const std::string& path) {
+    DJT_PROFILE_SCOPE("serverAnalyze");
+    std::shared_ptr<const TrackInfo> info;
+    std::string error;
+    try {
+        auto found = storeIndex.find(path);
+        if (found != storeIndex.end()) {
+            const TrackView view = options.store->track(found->second);
+            info = std::make_shared<const TrackInfo>(TrackInfo{TransitionProfile(view), view.bpm, view.key()});
+        } else {
+            thread_local AnalysisWorkspace workspace;
+            const TrackAnalysis analysis =
+                analyzeTrackCached(options.cache, path, options.windowSeconds, nullptr, &workspace);
+            info = std::make_shared<const TrackInfo>(TrackInfo{TransitionProfile(analysis), analysis.bpm, analysis.key});
+        }
+    } catch (const std::exception& ex) {
+        error = ex.what();
+    }
+
+    std::vector<TrackWaiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        auto it = tracks.find(path);
+        waiters = std::move(it->second.waiters);
+        if (info) {
+            it->second.info = info;
+        } else {
+            tracks.erase(it); // the next request retries
+        }
+    }
+    for (const TrackWaiter& waiter : waiters) {
+        try {
+            waiter.done(info, error);
+        } catch (const std::exception& ex) {
+            waiter.fail(ex.what());
+        }
+    }
+}
+
+void TransitionServer::Impl::respond(Connection& connection, const std::string& body, Clock::time_point received,
+                                     bool failed) {
+    connection.send(body);
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - received).count();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    latencies[requests % kLatencyWindow] = ms;
+    ++requests;
+    if (failed) ++errors;
+    maxMs = std::max(maxMs, ms);
+}
+
+void TransitionServer::Impl::handle(const std::shared_ptr<Connection>& connection, const std::string& line,
+                                    Clock::time_point received) {
+    DJT_PROFILE_SCOPE("serverRequest");
+    JsonValue request;
+    const bool parsed = parseRequest(line, request);
+
+    // Every response starts with the request's id, echoed as it was sent.
+    std::string head = "{";
+    const JsonValue* id = request.find("id");
+    if (id && id->isScalar()) {
+        head += "\"id\":" + (id->type == JsonValue::Type::String ? jsonQuote(id->text) : id->text) + ",";
+    }
+    auto fail = [this, connection, head, received](const std::string& error) {
+        respond(*connection, head + "\"ok\":false,\"error\":" + jsonQuote(error) + "}", received, true);
+    };
+    if (!parsed) {
+        fail("request is not a flat JSON object");
+        return;
+    }
+    auto text = [&](const char* name) -> const std::string* {
+        const JsonValue* field = request.find(name);
+        return field && field->type == JsonValue::Type::String ? &field->text : nullptr;
+    };
+    const std::string* opField = text("op");
+    const std::string op = opField ? *opField : "transition";
+
+    if (op == "transition") {
+        const std::string* a = text("a");
+        const std::string* b = text("b");
+        size_t k = 0;
+        if (!a || !b) {
+            fail("transition needs track paths \"a\" and \"b\"");
+            return;
+        }
+        if (!countField(request, "k", 1, k) || k == 0 || k > options.maxTopK) {
+            fail("\"k\" must be between 1 and " + std::to_string(options.maxTopK));
+            return;
+        }
+        const std::string pathB = *b;
+        withTrack(*a, [this, connection, head, received, fail, pathB, k](const std::shared_ptr<const TrackInfo>& trackA,
+                                                                          const std::string& errorA) {
+            if (!trackA) {
+                fail(errorA);
+                return;
+            }
+            withTrack(pathB, [this, connection, head, received, fail, trackA, k](
+                                 const std::shared_ptr<const TrackInfo>& trackB, const std::string& errorB) {
+                if (!trackB) {
+                    fail(errorB);
+                    return;
+                }
+                std::string body = head + "\"ok\":true,\"transitions\":[";
+                const auto top = findTopTransitions(trackA->profile, trackB->profile, k);
+                for (size_t i = 0; i < top.size(); ++i) {
+                    const TransitionSuggestion& s = top[i];
+                    body += i == 0 ? "{\"score\":" : ",{\"score\":";
+                    appendNumber(body, s.score);
+                    body += ",\"timeA\":";
+                    appendNumber(body, s.timeA);
+                    body += ",\"timeB\":";
+                    appendNumber(body, s.timeB);
+                    body += ",\"bpm\":";
+                    appendNumber(body, s.bpmComponent);
+                    body += ",\"key\":";
+                    appendNumber(body, s.keyComponent);
+                    body += ",\"energy\":";
+                    appendNumber(body, s.energyComponent);
+                    body += "}";
+                }
+                body += "]}";
+                respond(*connection, body, received, false);
+            }, fail);
+        }, fail);
+    } else if (op == "analyze") {
+        const std::string* path = text("path");
+        if (!path) {
+            fail("analyze needs a track \"path\"");
+            return;
+        }
+        withTrack(*path, [this, connection, head, received, fail](const std::shared_ptr<const TrackInfo>& track,
+                                                                  const std::string& error) {
+            if (!track) {
+                fail(error);
+                return;
+            }
+            std::string body = head + "\"ok\":true,\"bpm\":";
+            appendNumber(body, track->bpm);
+            body += ",\"key\":" + jsonQuote(track->key) + "}";
+            respond(*connection, body, received, false);
+        }, fail);
+    } else if (op == "stats") {
+        const ServerStats s = snapshot();
+        std::string body = head + "\"ok\":true,\"requests\":" + std::to_string(s.requests) +
+                           ",\"errors\":" + std::to_string(s.errors) + ",\"tracks\":" + std::to_string(s.tracks) +
+                           ",\"p50Ms\":";
+        appendNumber(body, s.p50Ms);
+        body += ",\"p99Ms\":";
+        appendNumber(body, s.p99Ms);
+        body += ",\"maxMs\":";
+        appendNumber(body, s.maxMs);
+        body += "}";
+        respond(*connection, body, received, false);
+    } else if (op == "shutdown") {
+        respond(*connection, head + "\"ok\":true}", received, false);
+        requestStop();
+    } else {
+        fail("unknown op \"" + op + "\"");
+    }
+}
+#endif
+
+#if defined(DJT_HAVE_UNIX_SOCKETS)
+TransitionServer::TransitionServer(const ServerOptions& options) : impl_(std::make_unique<Impl>(options)) {
+    Impl& s = *impl_;
+    if (options.socketPath.empty()) throw std::invalid_argument("Server socket path is empty");
+    sockaddr_un address{};
+    if (!fillAddress(options.socketPath, address)) {
+        throw std::runtime_error("Server socket path is too long: " + options.socketPath);
+    }
+    // A socket file nobody answers on was left by a server that died; one that answers is live.
+    std::error_code ec;
+    if (std::filesystem::exists(options.socketPath, ec)) {
+        const int probe = connectTo(options.socketPath);
+        if (probe >= 0) {
+            ::close(probe);
+            throw std::runtime_error("A server is already listening on " + options.socketPath);
+        }
+        ::unlink(options.socketPath.c_str());
+    }
+
+    int wake[2];
+    if (::pipe(wake) != 0) throw std::runtime_error("Failed to create server wake pipe");
+    s.wakeRead = wake[0];
+    s.wakeWrite = wake[1];
+    setNonBlocking(s.wakeRead);
+    setNonBlocking(s.wakeWrite);
+
+    s.listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s.listenFd < 0 || ::bind(s.listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (s.listenFd >= 0) ::close(s.listenFd);
+        ::close(s.wakeRead);
+        ::close(s.wakeWrite);
+        throw std::runtime_error("Failed to bind server socket: " + options.socketPath + " (" + reason + ")");
+    }
+    s.bound = true;
+    if (::listen(s.listenFd, SOMAXCONN) != 0) {
+        ::close(s.listenFd);
+        ::close(s.wakeRead);
+        ::close(s.wakeWrite);
+        ::unlink(options.socketPath.c_str());
+        throw std::runtime_error("Failed to listen on server socket: " + options.socketPath);
+    }
+    setNonBlocking(s.listenFd);
+
+    if (options.store) {
+        s.storeIndex.reserve(options.store->size());
+        for (size_t i = 0; i < options.store->size(); ++i) {
+            s.storeIndex.emplace(std::string(options.store->track(i).name), i);
+        }
+    }
+    s.latencies.resize(kLatencyWindow);
+    s.pool = std::make_unique<ThreadPool>(options.jobs);
+}
+
+TransitionServer::~TransitionServer() {
+    Impl& s = *impl_;
+    s.pool.reset(); // finishes anything still queued before the descriptors go
+    ::close(s.listenFd);
+    ::close(s.wakeRead);
+    ::close(s.wakeWrite);
+    if (s.bound) ::unlink(s.options.socketPath.c_str());
+}
+
+void TransitionServer::run() {
+    Impl& s = *impl_;
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(64 * 1024);
+
+    while (!s.stopping.load()) {
+        fds.clear();
+        fds.push_back({s.wakeRead, POLLIN, 0});
+        fds.push_back({s.listenFd, POLLIN, 0});
+        for (auto it = connections.begin(); it != connections.end();) {
+            const short events = it->second->events();
+            if (events == 0) {
+                it = connections.erase(it); // closed once in-flight responses drop their reference
+                continue;
+            }
+            fds.push_back({it->first, events, 0});
+            ++it;
+        }
+        if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Server poll failed: ") + std::strerror(errno));
+        }
+        if (fds[0].revents != 0) {
+            while (::read(s.wakeRead, buffer.data(), buffer.size()) > 0) {
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            for (;;) {
+                const int fd = ::accept(s.listenFd, nullptr, nullptr);
+                if (fd < 0) break;
+                setNonBlocking(fd);
+                connections.emplace(fd, std::make_shared<Connection>(fd, s.wakeWrite));
+            }
+        }
+        for (size_t i = 2; i < fds.size(); ++i) {
+            if (fds[i].revents == 0) continue;
+            auto it = connections.find(fds[i].fd);
+            if ((fds[i].revents & POLLOUT) && !it->second->flush()) {
+                connections.erase(it);
+                continue;
+            }
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            const ssize_t got = ::read(fds[i].fd, buffer.data(), buffer.size());
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                connections.erase(it); // closed once in-flight responses drop their reference
+                continue;
+            }
+            const Clock::time_point received = Clock::now();
+            std::shared_ptr<Connection> connection = it->second;
+            std::string& input = connection->input;
+            input.append(buffer.data(), static_cast<size_t>(got));
+            size_t begin = 0;
+            for (size_t end; (end = input.find('\n', begin)) != std::string::npos; begin = end + 1) {
+                std::string line = input.substr(begin, end - begin);
+                if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+                s.pool->submit([&s, connection, line = std::move(line), received] {
+                    try {
+                        s.handle(connection, line, received);
+                    } catch (const std::exception& ex) {
+                        s.respond(*connection, "{\"ok\":false,\"error\":" + jsonQuote(ex.what()) + "}", received, true);
+                    }
+                });
+            }
+            input.erase(0, begin);
+            if (input.size() > kMaxRequestBytes) {
+                connection->send("{\"ok\":false,\"error\":\"request line too long\"}");
+                connection->closeAfterSending();
+            }
+        }
+    }
+    s.pool->wait(); // in-flight requests, and the analyses they wait on
+
+    // Send the responses still queued, giving up on clients that do not read them in time.
+    const Clock::time_point deadline = Clock::now() + kDrainTimeout;
+    for (;;) {
+        fds.clear();
+        for (const auto& entry : connections) {
+            if (entry.second->events() & POLLOUT) fds.push_back({entry.first, POLLOUT, 0});
+        }
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (fds.empty() || left.count() <= 0) break;
+        if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), static_cast<int>(left.count())) < 0 && errno != EINTR) {
+            break;
+        }
+        for (const pollfd& fd : fds) {
+            if (fd.revents != 0 && !connections[fd.fd]->flush()) connections.erase(fd.fd);
+        }
+    }
+}
+
+void TransitionServer::Impl::requestStop() {
+    stopping.store(true);
+    const char byte = 1;
+    [[maybe_unused]] const ssize_t ignored = ::write(wakeWrite, &byte, 1); // async-signal-safe
+}
+
+void TransitionServer::stop() { impl_->requestStop(); }
+
+TransitionClient::TransitionClient(const std::string& socketPath) {
+    fd_ = connectTo(socketPath);
+    if (fd_ < 0) throw std::runtime_error("No server listening on " + socketPath);
+}
+
+TransitionClient::~TransitionClient() { ::close(fd_); }
+
+std::string TransitionClient::request(const std::string& line) {
+    std::string message = line;
+    message.push_back('\n');
+    if (!sendAll(fd_, message.data(), message.size())) {
+        throw std::runtime_error(std::string("Failed to send request: ") + std::strerror(errno));
+    }
+    char buffer[4096];
+    for (size_t end; (end = pending_.find('\n')) == std::string::npos;) {
+        const ssize_t got = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) throw std::runtime_error("Server closed the connection");
+        pending_.append(buffer, static_cast<size_t>(got));
+    }
+    const size_t end = pending_.find('\n');
+    std::string response = pending_.substr(0, end);
+    pending_.erase(0, end + 1);
+    return response;
+}
+#else
+TransitionServer::TransitionServer(const ServerOptions& options) : impl_(std::make_unique<Impl>(options)) {
+    throw std::runtime_error("Unix domain sockets are not supported on this platform");
+}
+
+TransitionServer::~TransitionServer() = default;
+
+void TransitionServer::run() {}
+
+void TransitionServer::stop() { impl_->stopping.store(true); }
+
+TransitionClient::TransitionClient(const std::string&) {
+    throw std::runtime_error("Unix domain sockets are not supported on this platform");
+}
+
+TransitionClient::~TransitionClient() = default;
+
+std::string TransitionClient::request(const std::string&) { return std::string(); }
+#endif
+
+ServerStats TransitionServer::stats() const { return impl_->snapshot(); }
+
+std::string defaultServerSocket() {
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    return ((ec ? std::filesystem::path("/tmp") : dir) / "djtransition.sock").string();
+}
+
+std::string jsonQuote(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    out.push_back('"');
+    for (const char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+    return out;
+}
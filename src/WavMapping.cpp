@@ -0,0 +1,169 @@
+#include "WavMapping.hpp"
+
+#include "SimdKernels.hpp"
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DJT_HAVE_MMAP 1
+#endif
+
+namespace {
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint16_t readLe16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Parse RIFF/WAVE chunks; fills `view` (data relative to `base`) on success.
+bool parseWavHeader(const unsigned char* base, size_t length, PcmView& view) {
+    if (length < 12 || std::memcmp(base, "RIFF", 4) != 0 || std::memcmp(base + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool haveFormat = false;
+    uint16_t formatTag = 0;
+    uint16_t bitsPerSample = 0;
+    uint16_t blockAlign = 0;
+    size_t pos = 12;
+    while (pos + 8 <= length) {
+        const unsigned char* chunk = base + pos;
+        const uint64_t chunkSize = readLe32(chunk + 4);
+        const size_t body = pos + 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + 16 > length) return false;
+            formatTag = readLe16(base + body);
+            view.channels = readLe16(base + body + 2);
+            view.sampleRate = static_cast<int>(readLe32(base + body + 4));
+            blockAlign = readLe16(base + body + 12);
+            bitsPerSample = readLe16(base + body + 14);
+            if (formatTag == kFormatExtensible) {
+                // The sub-format GUID starts with the plain format tag.
+                if (chunkSize < 40 || body + 26 > length) return false;
+                formatTag = readLe16(base + body + 24);
+            }
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat || view.channels <= 0 || view.sampleRate <= 0) return false;
+            if (formatTag == kFormatPcm && bitsPerSample == 16) {
+                view.format = PcmFormat::Int16;
+            } else if (formatTag == kFormatPcm && bitsPerSample == 24) {
+                view.format = PcmFormat::Int24;
+            } else if (formatTag == kFormatPcm && bitsPerSample == 32) {
+                view.format = PcmFormat::Int32;
+            } else if (formatTag == kFormatFloat && bitsPerSample == 32) {
+                view.format = PcmFormat::Float32;
+            } else {
+                return false;
+            }
+            view.bytesPerSample = bitsPerSample / 8;
+            const size_t frameBytes = view.bytesPerSample * static_cast<size_t>(view.channels);
+            if (blockAlign != frameBytes) return false;
+
+            // Tolerate streaming writers that leave the size unset or too large.
+            uint64_t dataBytes = chunkSize;
+            if (dataBytes > length - body) dataBytes = length - body;
+            view.data = base + body;
+            view.frames = dataBytes / frameBytes;
+            return true;
+        }
+        pos = body + static_cast<size_t>(chunkSize) + (chunkSize & 1); // chunks are word aligned
+    }
+    return false;
+}
+
+template <typename Decode>
+void decodeSamples(const unsigned char* src, size_t count, size_t bytesPerSample, float* out,
+                   Decode decode) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = decode(src + i * bytesPerSample);
+    }
+}
+} // namespace
+
+std::unique_ptr<MappedWavFile> MappedWavFile::open(const std::string& path) {
+#if defined(DJT_HAVE_MMAP) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size < 44) {
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t length = static_cast<size_t>(st.st_size);
+    void* base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (base == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<MappedWavFile> file(new MappedWavFile());
+    file->base_ = base;
+    file->length_ = length;
+    if (!parseWavHeader(static_cast<const unsigned char*>(base), length, file->view_)) {
+        return nullptr;
+    }
+    ::madvise(base, length, MADV_SEQUENTIAL);
+    return file;
+#else
+    (void)path;
+    return nullptr;
+#endif
+}
+
+MappedWavFile::~MappedWavFile() {
+#if defined(DJT_HAVE_MMAP)
+    if (base_) ::munmap(base_, length_);
+#endif
+}
+
+void convertPcmToFloat(const PcmView& view, uint64_t firstFrame, size_t frames, float* out) {
+    const size_t count = frames * static_cast<size_t>(view.channels);
+    const size_t bps = view.bytesPerSample;
+    const unsigned char* src = view.data + firstFrame * static_cast<uint64_t>(view.channels) * bps;
+
+    switch (view.format) {
+    case PcmFormat::Int16:
+        // The data chunk starts at an even offset in practice, but do not rely on alignment.
+        if (reinterpret_cast<uintptr_t>(src) % alignof(int16_t) == 0) {
+            int16ToFloat(reinterpret_cast<const int16_t*>(src), count, out);
+        } else {
+            decodeSamples(src, count, bps, out, [](const unsigned char* p) {
+                int16_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return static_cast<float>(v) * (1.0f / 32768.0f);
+            });
+        }
+        break;
+    case PcmFormat::Int24:
+        decodeSamples(src, count, bps, out, [](const unsigned char* p) {
+            // Place the 3 bytes in the top of an int32 so the sign extends, then scale.
+            int32_t v = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                             (static_cast<uint32_t>(p[1]) << 16) |
+                                             (static_cast<uint32_t>(p[2]) << 24));
+            return static_cast<float>(v) * (1.0f / 2147483648.0f);
+        });
+        break;
+    case PcmFormat::Int32:
+        decodeSamples(src, count, bps, out, [](const unsigned char* p) {
+            int32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return static_cast<float>(v) * (1.0f / 2147483648.0f);
+        });
+        break;
+    case PcmFormat::Float32:
+        std::memcpy(out, src, count * sizeof(float));
+        break;
+    }
+}
@@ -1,24 +1,154 @@
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <cstdlib>
 #include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "AnalysisCache.hpp"
+#include "AnalysisPipeline.hpp"
 #include "AnalysisTypes.hpp"
 #include "AudioLoader.hpp"
-#include "BpmAnalyzer.hpp"
-#include "EnergyAnalyzer.hpp"
-#include "KeyAnalyzer.hpp"
+#include "BatchAnalyzer.hpp"
+#include "CandidateIndex.hpp"
+#include "LiveAnalyzer.hpp"
+#include "Profiler.hpp"
+#include "SetSequencer.hpp"
+#include "TempoKeyTracker.hpp"
+#include "ThreadPool.hpp"
+#include "TrackStore.hpp"
 #include "TransitionAnalyzer.hpp"
+#include "TransitionMatrix.hpp"
+#include "TransitionRenderer.hpp"
+#include "TransitionServer.hpp"
 
 namespace fs = std::filesystem;
 
 void printUsage(const char* exeName) {
-    std::cerr << "Usage: " << exeName << " <trackA> <trackB>\n";
+    std::cerr << "Usage: " << exeName << " [--window SEC] [--jobs N] [--roi[=SEC]] [cache options] <trackA> <trackB>\n"
+              << "       " << exeName
+              << " analyze [--jobs N] [--window SEC] [--store FILE] [cache options] <dir|list|track>...\n"
+              << "       " << exeName
+              << " matrix [--jobs N] [--window SEC] [--min-score S] [--output FILE] [cache options]"
+                 " <dir|list|track>...\n"
+              << "       " << exeName << " matrix [--jobs N] [--min-score S] [--output FILE] --store FILE\n"
+              << "       " << exeName
+              << " sequence [--jobs N] [--window SEC] [--start TRACK] [--end TRACK] [--max-bpm-step PCT]"
+                 " [--arc none|rise|fall|peak] [--beam N] [cache options] <dir|list|track>... | --store FILE\n"
+              << "       " << exeName << " index [--jobs N] [--output FILE] --store FILE\n"
+              << "       " << exeName << " next [--top K] [--shortlist N] [--index FILE] --store FILE <track>\n"
+              << "       " << exeName
+              << " render [--lead SEC] [--fade SEC] [--tail SEC] [--no-stretch] [--no-align] [--no-eq]"
+                 " [--output FILE] [cache options] <trackA> <trackB>\n"
+              << "       " << exeName << " timeline [--step SEC] [--span SEC] <track>\n"
+              << "       " << exeName
+              << " live [--rate HZ] [--channels N] [--format s16|s24|s32|f32] [--interval SEC] [--window SEC]"
+                 " [FILE|-]\n"
+              << "       " << exeName
+              << " serve [--socket PATH] [--jobs N] [--window SEC] [--store FILE] [cache options]\n"
+              << "       " << exeName
+              << " query [--socket PATH] [--top K] [--repeat N] <trackA> <trackB> | --analyze <track>"
+                 " | --stats | --shutdown\n"
+              << "--window: energy window in seconds (default " << kDefaultEnergyWindowSeconds
+              << "); cached tracks derive it from their energy index without re-decoding\n"
+              << "--roi[=SEC]: decode only the last SEC seconds of track A and the first SEC of track B (default "
+              << RoiOptions().tailSeconds << "), plus a few short probes of each uncached track\n"
+              << "--socket: server socket (default " << defaultServerSocket() << ")\n"
+              << "Cache options: --cache DIR (default: " << AnalysisCache::defaultDirectory()
+              << "), --no-cache\n"
+              << "--profile=FILE (any command): write a Chrome trace of the run to FILE and a stage"
+                 " summary to stderr\n";
+}
+
+// Parse a positive integer option value; returns false on malformed input.
+bool parseCount(const std::string& text, size_t& out) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    out = static_cast<size_t>(std::strtoull(text.c_str(), nullptr, 10));
+    return out > 0;
+}
+
+// Consume a --jobs option at args[i]; returns false if args[i] is not one. Sets `error` on a
+// malformed option.
+bool parseJobsOption(const std::vector<std::string>& args, size_t& i, size_t& jobs, bool& error) {
+    const std::string& arg = args[i];
+    bool ok = true;
+    if (arg == "--jobs" || arg == "-j") {
+        ok = i + 1 < args.size() && parseCount(args[++i], jobs);
+    } else if (arg.rfind("--jobs=", 0) == 0) {
+        ok = parseCount(arg.substr(7), jobs);
+    } else {
+        return false;
+    }
+    if (!ok) {
+        std::cerr << "Error: --jobs expects a positive integer\n";
+        error = true;
+    }
+    return true;
+}
+
+// Consume a --window option at args[i]; returns false if args[i] is not one. Sets `error` on a
+// malformed option.
+bool parseWindowOption(const std::vector<std::string>& args, size_t& i, double& windowSeconds, bool& error) {
+    const std::string& arg = args[i];
+    std::string value;
+    if (arg == "--window") {
+        if (i + 1 < args.size()) value = args[++i];
+    } else if (arg.rfind("--window=", 0) == 0) {
+        value = arg.substr(9);
+    } else {
+        return false;
+    }
+    char* end = nullptr;
+    windowSeconds = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0' || !(windowSeconds > 0.0 && windowSeconds <= 60.0)) {
+        std::cerr << "Error: --window expects a duration in seconds (0-60]\n";
+        error = true;
+    }
+    return true;
+}
+
+// Remove a --profile option from anywhere in `args`, storing its trace path. Returns false
+// (after printing why) on a malformed option or when profiling is not compiled in.
+bool extractProfileOption(std::vector<std::string>& args, std::string& path) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        size_t consumed = 1;
+        if (arg == "--profile") {
+            if (i + 1 < args.size()) path = args[i + 1];
+            consumed = 2;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            path = arg.substr(10);
+        } else {
+            continue;
+        }
+        if (path.empty() || i + consumed > args.size()) {
+            std::cerr << "Error: --profile expects a trace file, e.g. --profile=out.json\n";
+            return false;
+        }
+        if (!profiling::kCompiledIn) {
+            std::cerr << "Error: --profile needs a build with DJT_ENABLE_PROFILING\n";
+            return false;
+        }
+        args.erase(args.begin() + static_cast<std::ptrdiff_t>(i),
+                   args.begin() + static_cast<std::ptrdiff_t>(i + consumed));
+        --i;
+    }
+    return true;
 }
 
 double secondsFromSamples(size_t samples, int sampleRate) {
@@ -37,61 +167,978 @@ std::string formatTime(double seconds) {
     return oss.str();
 }
 
-int main(int argc, char** argv) {
-    if (argc < 3) {
-        printUsage(argv[0]);
+struct CacheOptions {
+    bool enabled = true;
+    std::string directory = AnalysisCache::defaultDirectory();
+};
+
+// Consume a cache option at args[i]; returns false if args[i] is not one. Sets `error` on a
+// malformed option.
+bool parseCacheOption(const std::vector<std::string>& args, size_t& i, CacheOptions& cache, bool& error) {
+    const std::string& arg = args[i];
+    if (arg == "--no-cache") {
+        cache.enabled = false;
+    } else if (arg == "--cache") {
+        if (i + 1 >= args.size()) {
+            std::cerr << "Error: --cache expects a directory\n";
+            error = true;
+        } else {
+            cache.directory = args[++i];
+        }
+    } else if (arg.rfind("--cache=", 0) == 0) {
+        cache.directory = arg.substr(8);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Open the analysis cache; on failure warn and continue uncached.
+std::unique_ptr<AnalysisCache> openCache(const CacheOptions& options) {
+    if (!options.enabled || options.directory.empty()) return nullptr;
+    try {
+        return std::make_unique<AnalysisCache>(options.directory);
+    } catch (const std::exception& ex) {
+        std::cerr << "Warning: analysis cache disabled: " << ex.what() << "\n";
+        return nullptr;
+    }
+}
+
+// Analyze `paths` in parallel into `names` and `tracks`, in library order, reporting failures as
+// they happen and passing each analyzed track to `onAnalyzed` as it finishes. Tracks listed twice
+// are kept once. Returns the number of failures.
+size_t analyzeLibrary(const std::vector<std::string>& paths,
+                      const BatchOptions& options,
+                      std::vector<std::string>& names,
+                      std::vector<TrackAnalysis>& tracks,
+                      const std::function<void(const BatchResult&)>& onAnalyzed = {}) {
+    // Results arrive in completion order.
+    std::unordered_map<std::string, TrackAnalysis> analyzed;
+    const size_t failures = analyzeBatch(paths, options, [&](const BatchResult& result) {
+        if (!result.error.empty()) {
+            std::cerr << "Error: " << result.path << ": " << result.error << "\n";
+            return;
+        }
+        if (onAnalyzed) onAnalyzed(result);
+        // Scoring only needs the curve; a library's worth of energy indexes is not kept.
+        TrackAnalysis analysis = result.analysis;
+        analysis.energyIndex = EnergyIndex();
+        analyzed.emplace(result.path, std::move(analysis));
+    });
+    for (const auto& path : paths) {
+        auto it = analyzed.find(path);
+        if (it == analyzed.end()) continue;
+        names.push_back(path);
+        tracks.push_back(std::move(it->second));
+        analyzed.erase(it); // listed twice: keep the first
+    }
+    return failures;
+}
+
+// analyze: batch-analyze a library in parallel, printing one tab-separated line per track
+// (path, BPM, key, duration) as soon as it finishes; with --store, also write the library as a
+// TrackStore.
+int runAnalyzeCommand(const std::vector<std::string>& args, const char* exeName) {
+    BatchOptions options;
+    CacheOptions cacheOptions;
+    std::string storePath;
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption) || parseJobsOption(args, i, options.jobs, badOption) ||
+            parseWindowOption(args, i, options.windowSeconds, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--store") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: --store expects a file\n";
+                return 1;
+            }
+            storePath = args[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        printUsage(exeName);
         return 1;
     }
 
-    std::vector<std::string> tracks{argv[1], argv[2]};
-    std::array<TrackAnalysis, 2> analyses{};
+    std::vector<std::string> paths;
+    try {
+        paths = collectTrackPaths(inputs);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    auto cache = openCache(cacheOptions);
+    options.cache = cache.get();
+
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<std::string> names;
+    std::vector<TrackAnalysis> tracks;
+    const size_t failures = analyzeLibrary(paths, options, names, tracks, [](const BatchResult& result) {
+        double durationSec = secondsFromSamples(static_cast<size_t>(result.info.frames), result.info.sampleRate);
+        std::cout << result.path << "\t" << std::fixed << std::setprecision(2) << result.analysis.bpm
+                  << "\t" << result.analysis.key << "\t" << durationSec << std::endl;
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cerr << "Analyzed " << paths.size() << " tracks (" << failures << " failed) in "
+              << std::fixed << std::setprecision(2) << elapsed << " s";
+    if (elapsed > 0.0) std::cerr << " (" << static_cast<double>(paths.size()) / elapsed << " tracks/s)";
+    std::cerr << "\n";
 
+    if (!storePath.empty()) {
+        try {
+            writeTrackStore(storePath, names, tracks);
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+        std::cerr << "Wrote " << storePath << ": " << names.size() << " tracks\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// matrix: analyze a library (through the cache) and write the sparse all-pairs transition matrix.
+int runMatrixCommand(const std::vector<std::string>& args, const char* exeName) {
+    BatchOptions batchOptions;
+    MatrixOptions matrixOptions;
+    CacheOptions cacheOptions;
+    std::string outputPath = "transitions.djtm";
+    std::string storePath;
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption) ||
+            parseJobsOption(args, i, batchOptions.jobs, badOption) ||
+            parseWindowOption(args, i, batchOptions.windowSeconds, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--min-score") {
+            char* end = nullptr;
+            matrixOptions.minScore = i + 1 < args.size() ? std::strtod(args[++i].c_str(), &end) : -1.0;
+            if (end == nullptr || *end != '\0' || matrixOptions.minScore < 0.0 || matrixOptions.minScore > 10.0) {
+                std::cerr << "Error: --min-score expects a score between 0 and 10\n";
+                return 1;
+            }
+        } else if (arg == "--output" || arg == "-o") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: --output expects a file\n";
+                return 1;
+            }
+            outputPath = args[++i];
+        } else if (arg == "--store") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: --store expects a file\n";
+                return 1;
+            }
+            storePath = args[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() == storePath.empty()) {
+        printUsage(exeName);
+        return 1;
+    }
+    matrixOptions.jobs = batchOptions.jobs;
+    auto reportProgress = [](const MatrixStats& progress) {
+        const double pairs = static_cast<double>(progress.pairsScored + progress.pairsPruned);
+        std::cerr << "\rRows " << progress.rowsDone << "/" << progress.rows << ", "
+                  << progress.pairsScored << " pairs scored, " << progress.pairsPruned << " pruned, "
+                  << progress.entries << " kept";
+        if (progress.elapsedSeconds > 0.0) {
+            std::cerr << " (" << std::fixed << std::setprecision(0) << pairs / progress.elapsedSeconds
+                      << " pairs/s)";
+        }
+        std::cerr << std::flush;
+    };
+
+    // A stored library is scored from its mapped columns, without analyzing anything.
+    if (!storePath.empty()) {
+        MatrixStats stats;
+        try {
+            const TrackStore store(storePath);
+            stats = buildTransitionMatrix(store, outputPath, matrixOptions, reportProgress);
+        } catch (const std::exception& ex) {
+            std::cerr << "\nError: " << ex.what() << "\n";
+            return 1;
+        }
+        if (stats.rows > 0) std::cerr << "\n";
+        std::cerr << "Wrote " << outputPath << ": " << stats.rows << " tracks, " << stats.entries
+                  << " transitions scoring >= " << std::fixed << std::setprecision(2) << matrixOptions.minScore
+                  << " in " << stats.elapsedSeconds << " s\n";
+        return 0;
+    }
+
+    std::vector<std::string> paths;
     try {
-        for (size_t i = 0; i < tracks.size(); ++i) {
-            const auto& path = tracks[i];
-            if (!fs::exists(path)) {
-                std::cerr << "Error: file does not exist: " << path << "\n";
+        paths = collectTrackPaths(inputs);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    auto cache = openCache(cacheOptions);
+    batchOptions.cache = cache.get();
+    std::vector<std::string> names;
+    std::vector<TrackAnalysis> tracks;
+    const size_t failures = analyzeLibrary(paths, batchOptions, names, tracks);
+
+    MatrixStats stats;
+    try {
+        stats = buildTransitionMatrix(names, tracks, outputPath, matrixOptions, reportProgress);
+    } catch (const std::exception& ex) {
+        std::cerr << "\nError: " << ex.what() << "\n";
+        return 1;
+    }
+    if (stats.rows > 0) std::cerr << "\n";
+
+    std::cerr << "Wrote " << outputPath << ": " << stats.rows << " tracks (" << failures << " failed), "
+              << stats.entries << " transitions scoring >= " << std::fixed << std::setprecision(2)
+              << matrixOptions.minScore << " in " << stats.elapsedSeconds << " s\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// Index of the track called `query`, by full name or else by file name; kAnyTrack, after printing
+// why, if none or several match.
+size_t findTrack(const std::vector<std::string>& names, const std::string& query, const char* option) {
+    size_t found = kAnyTrack;
+    for (int byFileName = 0; byFileName < 2 && found == kAnyTrack; ++byFileName) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            const bool match = byFileName ? fs::path(names[i]).filename() == query : names[i] == query;
+            if (!match) continue;
+            if (found != kAnyTrack) {
+                std::cerr << "Error: " << option << " " << query << " matches more than one track\n";
+                return kAnyTrack;
+            }
+            found = i;
+        }
+    }
+    if (found == kAnyTrack) std::cerr << "Error: " << option << " " << query << " is not in the library\n";
+    return found;
+}
+
+// sequence: order a library into one set with the best total transition score, printing each
+// track with the cue points of the transition out of it.
+int runSequenceCommand(const std::vector<std::string>& args, const char* exeName) {
+    BatchOptions batchOptions;
+    SequenceOptions options;
+    CacheOptions cacheOptions;
+    std::string storePath;
+    std::string startName;
+    std::string endName;
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption) ||
+            parseJobsOption(args, i, batchOptions.jobs, badOption) ||
+            parseWindowOption(args, i, batchOptions.windowSeconds, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--store" || arg == "--start" || arg == "--end") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: " << arg << " expects " << (arg == "--store" ? "a file" : "a track") << "\n";
+                return 1;
+            }
+            (arg == "--store" ? storePath : arg == "--start" ? startName : endName) = args[++i];
+        } else if (arg == "--max-bpm-step") {
+            char* end = nullptr;
+            const double percent = i + 1 < args.size() ? std::strtod(args[++i].c_str(), &end) : -1.0;
+            if (end == nullptr || *end != '\0' || !(percent >= 0.0 && percent <= 100.0)) {
+                std::cerr << "Error: --max-bpm-step expects a percentage (0 for no limit)\n";
+                return 1;
+            }
+            options.maxBpmStep = percent / 100.0;
+        } else if (arg == "--arc") {
+            const std::string arc = i + 1 < args.size() ? args[++i] : "";
+            if (arc == "none") {
+                options.arc = EnergyArc::None;
+            } else if (arc == "rise") {
+                options.arc = EnergyArc::Rise;
+            } else if (arc == "fall") {
+                options.arc = EnergyArc::Fall;
+            } else if (arc == "peak") {
+                options.arc = EnergyArc::Peak;
+            } else {
+                std::cerr << "Error: --arc expects none, rise, fall or peak\n";
+                return 1;
+            }
+        } else if (arg == "--beam") {
+            if (i + 1 >= args.size() || !parseCount(args[++i], options.beamWidth)) {
+                std::cerr << "Error: --beam expects a positive integer\n";
+                return 1;
+            }
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() == storePath.empty()) {
+        printUsage(exeName);
+        return 1;
+    }
+    options.jobs = batchOptions.jobs;
+
+    std::vector<std::string> names;
+    std::vector<double> bpms;
+    std::vector<std::string> keys;
+    std::unique_ptr<TrackStore> store;
+    std::vector<TrackAnalysis> tracks;
+    size_t failures = 0;
+    try {
+        if (!storePath.empty()) {
+            store = std::make_unique<TrackStore>(storePath);
+            for (size_t i = 0; i < store->size(); ++i) {
+                const TrackView view = store->track(i);
+                names.emplace_back(view.name);
+                bpms.push_back(view.bpm);
+                keys.push_back(view.key());
+            }
+        } else {
+            const std::vector<std::string> paths = collectTrackPaths(inputs);
+            auto cache = openCache(cacheOptions);
+            batchOptions.cache = cache.get();
+            failures = analyzeLibrary(paths, batchOptions, names, tracks);
+            for (const TrackAnalysis& track : tracks) {
+                bpms.push_back(track.bpm);
+                keys.push_back(track.key);
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    if (!startName.empty() && (options.startTrack = findTrack(names, startName, "--start")) == kAnyTrack) return 1;
+    if (!endName.empty() && (options.endTrack = findTrack(names, endName, "--end")) == kAnyTrack) return 1;
+
+    SetPlan plan;
+    try {
+        plan = store ? sequenceSet(*store, options) : sequenceSet(tracks, options);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    const int numberWidth = static_cast<int>(std::to_string(plan.order.size()).size());
+    for (size_t p = 0; p < plan.order.size(); ++p) {
+        const size_t t = plan.order[p];
+        std::cout << std::setw(numberWidth) << p + 1 << ". " << names[t] << "  (" << std::fixed
+                  << std::setprecision(2) << bpms[t] << " BPM, " << keys[t] << ")\n";
+        if (p < plan.transitions.size()) {
+            const TransitionSuggestion& s = plan.transitions[p];
+            std::cout << std::string(numberWidth + 2, ' ') << "-> out at " << formatTime(s.timeA) << ", in at "
+                      << formatTime(s.timeB) << "  score " << std::setprecision(2) << s.score << "\n";
+        }
+    }
+    const size_t transitions = plan.transitions.size();
+    std::cerr << "Set of " << plan.order.size() << " tracks";
+    if (failures > 0) std::cerr << " (" << failures << " failed)";
+    std::cerr << ": total score " << std::fixed << std::setprecision(2) << plan.totalScore << " (mean "
+              << (transitions > 0 ? plan.totalScore / static_cast<double>(transitions) : 0.0) << "), "
+              << plan.tempoViolations << " tempo steps over the limit";
+    if (options.arc != EnergyArc::None) std::cerr << ", arc deviation " << plan.arcDeviation;
+    std::cerr << "\nScored " << plan.stats.pairsScored << " pairs in " << plan.stats.scoreSeconds
+              << " s; beam search " << plan.stats.beamSeconds << " s; local search " << plan.stats.searchSeconds
+              << " s (" << plan.stats.passes << " passes, " << plan.stats.moves << " moves)\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// Where index and next keep a store's candidate index unless told otherwise.
+std::string defaultIndexPath(const std::string& storePath) {
+    return fs::path(storePath).replace_extension(".djti").string();
+}
+
+// index: build the next-track candidate index of a track store and save it.
+int runIndexCommand(const std::vector<std::string>& args, const char* exeName) {
+    IndexOptions options;
+    std::string storePath;
+    std::string outputPath;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseJobsOption(args, i, options.jobs, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--store" || arg == "--output") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: " << arg << " expects a file\n";
+                return 1;
+            }
+            (arg == "--store" ? storePath : outputPath) = args[++i];
+        } else {
+            printUsage(exeName);
+            return 1;
+        }
+    }
+    if (storePath.empty()) {
+        printUsage(exeName);
+        return 1;
+    }
+    if (outputPath.empty()) outputPath = defaultIndexPath(storePath);
+
+    try {
+        const auto started = std::chrono::steady_clock::now();
+        const TrackStore store(storePath);
+        std::vector<TrackFingerprint> fingerprints(store.size());
+        for (size_t i = 0; i < store.size(); ++i) fingerprints[i] = makeFingerprint(store.track(i));
+        options.source = store.identity();
+        const CandidateIndex index(fingerprints, options);
+        index.save(outputPath);
+        std::cerr << "Wrote " << outputPath << ": " << index.size() << " tracks in " << std::fixed
+                  << std::setprecision(2)
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() << " s\n";
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// next: the best tracks to play after one track of a store, shortlisted by its candidate index
+// and ranked by the exact transition score.
+int runNextCommand(const std::vector<std::string>& args, const char* exeName) {
+    size_t top = 20;
+    size_t shortlist = 0;
+    std::string storePath;
+    std::string indexPath;
+    std::string trackName;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "--top" || arg == "--shortlist") {
+            if (i + 1 >= args.size() || !parseCount(args[++i], arg == "--top" ? top : shortlist)) {
+                std::cerr << "Error: " << arg << " expects a positive integer\n";
+                return 1;
+            }
+        } else if (arg == "--store" || arg == "--index") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: " << arg << " expects a file\n";
+                return 1;
+            }
+            (arg == "--store" ? storePath : indexPath) = args[++i];
+        } else if (trackName.empty()) {
+            trackName = arg;
+        } else {
+            printUsage(exeName);
+            return 1;
+        }
+    }
+    if (storePath.empty() || trackName.empty()) {
+        printUsage(exeName);
+        return 1;
+    }
+    if (indexPath.empty()) indexPath = defaultIndexPath(storePath);
+
+    try {
+        const TrackStore store(storePath);
+        const CandidateIndex index(indexPath, store);
+        std::vector<std::string> names;
+        names.reserve(store.size());
+        for (size_t i = 0; i < store.size(); ++i) names.emplace_back(store.track(i).name);
+        const size_t from = findTrack(names, trackName, "track");
+        if (from == kAnyTrack) return 1;
+
+        const auto started = std::chrono::steady_clock::now();
+        const std::vector<NextTrack> next = suggestNextTracks(store, index, from, top, shortlist);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        const int numberWidth = static_cast<int>(std::to_string(next.size()).size());
+        for (size_t r = 0; r < next.size(); ++r) {
+            const TrackView view = store.track(next[r].track);
+            const TransitionSuggestion& s = next[r].transition;
+            std::cout << std::setw(numberWidth) << r + 1 << ". " << view.name << "  (" << std::fixed
+                      << std::setprecision(2) << view.bpm << " BPM, " << view.key() << ")  score " << s.score
+                      << ", out at " << formatTime(s.timeA) << ", in at " << formatTime(s.timeB) << "\n";
+        }
+        std::cerr << "Ranked " << next.size() << " of " << store.size() << " tracks in " << std::fixed
+                  << std::setprecision(2) << elapsed * 1000.0 << " ms\n";
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// render: mix the suggested transition from A into B to a WAV file, B stretched to A's tempo
+// and beat-aligned.
+int runRenderCommand(const std::vector<std::string>& args, const char* exeName) {
+    RenderOptions options;
+    CacheOptions cacheOptions;
+    std::string outputPath = "transition.wav";
+    std::vector<std::string> tracks;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--lead" || arg == "--fade" || arg == "--tail") {
+            char* end = nullptr;
+            const double seconds = i + 1 < args.size() ? std::strtod(args[++i].c_str(), &end) : -1.0;
+            if (end == nullptr || *end != '\0' || !(seconds >= 0.0 && seconds <= 600.0)) {
+                std::cerr << "Error: " << arg << " expects a duration in seconds [0-600]\n";
+                return 1;
+            }
+            (arg == "--lead" ? options.leadSeconds : arg == "--fade" ? options.fadeSeconds : options.tailSeconds) =
+                seconds;
+        } else if (arg == "--no-stretch") {
+            options.stretch = false;
+        } else if (arg == "--no-align") {
+            options.beatAlign = false;
+        } else if (arg == "--no-eq") {
+            options.eqSwap = false;
+        } else if (arg == "--output") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: --output expects a file\n";
+                return 1;
+            }
+            outputPath = args[++i];
+        } else {
+            tracks.push_back(arg);
+        }
+    }
+    if (tracks.size() != 2) {
+        printUsage(exeName);
+        return 1;
+    }
+
+    try {
+        auto cache = openCache(cacheOptions);
+        AnalysisWorkspace workspace;
+        const TrackAnalysis a = analyzeTrackCached(cache.get(), tracks[0], kDefaultEnergyWindowSeconds, nullptr,
+                                                   &workspace);
+        const TrackAnalysis b = analyzeTrackCached(cache.get(), tracks[1], kDefaultEnergyWindowSeconds, nullptr,
+                                                   &workspace);
+        if (a.energyCurve.empty() || b.energyCurve.empty()) {
+            std::cerr << "Error: no transition found (a track is too short)\n";
+            return 1;
+        }
+        const TransitionSuggestion cue = findBestTransition(a, b);
+        const RenderStats stats = renderTransition(tracks[0], a.bpm, tracks[1], b.bpm, cue, outputPath, options);
+
+        const double seconds = secondsFromSamples(static_cast<size_t>(stats.frames), stats.sampleRate);
+        std::cout << "Mix out of Track A at " << formatTime(cue.timeA) << " -> into Track B at "
+                  << formatTime(cue.timeB) << "  score " << std::fixed << std::setprecision(2) << cue.score << "\n";
+        std::cout << "Wrote " << outputPath << ": " << formatTime(seconds) << " at " << stats.sampleRate
+                  << " Hz; B " << (stats.stretchRatio == 1.0 ? "unstretched" : "stretched")
+                  << " x" << std::setprecision(4) << stats.stretchRatio << ", shifted "
+                  << std::setprecision(3) << stats.alignSeconds << " s to A's beat\n";
+        std::cerr << "Rendered " << std::fixed << std::setprecision(1) << seconds << " s in " << std::setprecision(3)
+                  << stats.elapsedSeconds << " s (" << std::setprecision(0)
+                  << (stats.elapsedSeconds > 0.0 ? seconds / stats.elapsedSeconds : 0.0) << "x realtime), "
+                  << stats.decodedFrames << " frames decoded\n";
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// timeline: BPM and key over time for long mixes, one line per step (time, BPM, key).
+int runTimelineCommand(const std::vector<std::string>& args, const char* exeName) {
+    TempoKeyOptions options;
+    std::vector<std::string> tracks;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "--step" || arg == "--span") {
+            char* end = nullptr;
+            const double value = i + 1 < args.size() ? std::strtod(args[++i].c_str(), &end) : 0.0;
+            if (end == nullptr || *end != '\0' || !(value > 0.0 && value <= 3600.0)) {
+                std::cerr << "Error: " << arg << " expects a duration in seconds (0-3600]\n";
+                return 1;
+            }
+            (arg == "--step" ? options.stepSeconds : options.windowSeconds) = value;
+        } else {
+            tracks.push_back(arg);
+        }
+    }
+    if (tracks.size() != 1) {
+        printUsage(exeName);
+        return 1;
+    }
+    if (options.windowSeconds < options.stepSeconds) {
+        std::cerr << "Error: --span must be at least --step\n";
+        return 1;
+    }
+
+    TempoKeyTrack track;
+    try {
+        track = trackTempoAndKeyFile(tracks[0], options);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    std::cout << "# " << tracks[0] << ": every " << std::fixed << std::setprecision(2) << track.stepSeconds
+              << " s over " << track.windowSeconds << " s windows\n";
+    for (const TempoKeyPoint& point : track.points) {
+        std::cout << formatTime(point.seconds) << "\t";
+        if (point.bpm > 0.0) {
+            std::cout << std::fixed << std::setprecision(2) << point.bpm;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << "\t" << point.key << "\n";
+    }
+    return 0;
+}
+
+// live: analyze raw PCM from stdin or a FIFO as it arrives, printing running BPM, key and
+// energy at a fixed interval of stream time.
+int runLiveCommand(const std::vector<std::string>& args, const char* exeName) {
+    LiveOptions options;
+    std::string inputPath = "-";
+    bool haveInput = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseWindowOption(args, i, options.windowSeconds, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--rate" || arg == "--channels") {
+            size_t value = 0;
+            if (i + 1 >= args.size() || !parseCount(args[++i], value) || value > 768000 ||
+                (arg == "--channels" && value > 64)) {
+                std::cerr << "Error: " << arg << " expects a positive integer\n";
                 return 1;
             }
-            if (!fs::is_regular_file(path)) {
-                std::cerr << "Error: path is not a regular file: " << path << "\n";
+            (arg == "--rate" ? options.sampleRate : options.channels) = static_cast<int>(value);
+        } else if (arg == "--format") {
+            const std::string format = i + 1 < args.size() ? args[++i] : "";
+            if (format == "s16") {
+                options.format = PcmFormat::Int16;
+            } else if (format == "s24") {
+                options.format = PcmFormat::Int24;
+            } else if (format == "s32") {
+                options.format = PcmFormat::Int32;
+            } else if (format == "f32") {
+                options.format = PcmFormat::Float32;
+            } else {
+                std::cerr << "Error: --format expects s16, s24, s32 or f32\n";
                 return 1;
             }
+        } else if (arg == "--interval") {
+            char* end = nullptr;
+            options.intervalSeconds = i + 1 < args.size() ? std::strtod(args[++i].c_str(), &end) : 0.0;
+            if (end == nullptr || *end != '\0' || !(options.intervalSeconds >= 0.05 && options.intervalSeconds <= 60.0)) {
+                std::cerr << "Error: --interval expects a duration in seconds [0.05-60]\n";
+                return 1;
+            }
+        } else if (!haveInput) {
+            inputPath = arg;
+            haveInput = true;
+        } else {
+            printUsage(exeName);
+            return 1;
+        }
+    }
 
-            AudioData audio = loadAudioFile(path);
-            double durationSec = secondsFromSamples(audio.samples.size(), audio.sampleRate);
+    std::FILE* input = stdin;
+    if (inputPath != "-") {
+        input = std::fopen(inputPath.c_str(), "rb");
+        if (!input) {
+            std::cerr << "Error: cannot open live input: " << inputPath << "\n";
+            return 1;
+        }
+    }
+
+    LiveStats stats;
+    try {
+        stats = analyzeLiveStream(input, options, [](const LiveEstimate& estimate) {
+            std::cout << formatTime(estimate.seconds) << "  BPM ";
+            if (estimate.bpm > 0.0) {
+                std::cout << std::fixed << std::setprecision(2) << estimate.bpm;
+            } else {
+                std::cout << "--";
+            }
+            std::cout << "  Key " << estimate.key << "  Energy " << std::fixed << std::setprecision(6)
+                      << (estimate.energyCurve.empty() ? 0.0 : estimate.energyCurve.back()) << "  (update "
+                      << std::setprecision(2) << estimate.updateMs << " ms, backlog " << estimate.backlogSeconds
+                      << " s)" << std::endl;
+        });
+    } catch (const std::exception& ex) {
+        if (input != stdin) std::fclose(input);
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    if (input != stdin) std::fclose(input);
+
+    std::cerr << "Live: " << std::fixed << std::setprecision(2)
+              << secondsFromSamples(static_cast<size_t>(stats.samplesRead), options.sampleRate) << " s read, "
+              << stats.updates << " updates (mean " << stats.meanUpdateMs << " ms, max " << stats.maxUpdateMs
+              << " ms), " << stats.samplesDropped << " frames dropped\n";
+    return 0;
+}
+
+// Consume a --socket option at args[i]; returns false if args[i] is not one. Sets `error` on a
+// malformed option.
+bool parseSocketOption(const std::vector<std::string>& args, size_t& i, std::string& socketPath, bool& error) {
+    const std::string& arg = args[i];
+    if (arg == "--socket") {
+        if (i + 1 < args.size()) socketPath = args[++i];
+    } else if (arg.rfind("--socket=", 0) == 0) {
+        socketPath = arg.substr(9);
+    } else {
+        return false;
+    }
+    if (socketPath.empty()) {
+        std::cerr << "Error: --socket expects a path\n";
+        error = true;
+    }
+    return true;
+}
+
+// The running server, for the signal handler. Published only after the handler is installed and
+// cleared before it is removed, so the handler never sees a server that is gone.
+std::atomic<TransitionServer*> gServer{nullptr};
+
+void stopServer(int) {
+    if (TransitionServer* server = gServer.load()) server->stop();
+}
+
+void restoreStopSignals() {
+    gServer.store(nullptr);
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+}
+
+// serve: keep analyzed tracks resident and answer transition queries on a Unix socket until
+// interrupted or sent a shutdown request.
+int runServeCommand(const std::vector<std::string>& args, const char* exeName) {
+    ServerOptions options;
+    options.socketPath = defaultServerSocket();
+    CacheOptions cacheOptions;
+    std::string storePath;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption) || parseJobsOption(args, i, options.jobs, badOption) ||
+            parseWindowOption(args, i, options.windowSeconds, badOption) ||
+            parseSocketOption(args, i, options.socketPath, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--store") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "Error: --store expects a file\n";
+                return 1;
+            }
+            storePath = args[++i];
+        } else {
+            printUsage(exeName);
+            return 1;
+        }
+    }
+
+    auto cache = openCache(cacheOptions);
+    options.cache = cache.get();
+    ServerStats stats;
+    try {
+        std::unique_ptr<TrackStore> store;
+        if (!storePath.empty()) store = std::make_unique<TrackStore>(storePath);
+        options.store = store.get();
+        TransitionServer server(options);
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        gServer.store(&server);
+        std::cerr << "Listening on " << options.socketPath;
+        if (store) std::cerr << " (" << store->size() << " stored tracks)";
+        std::cerr << std::endl;
+        server.run();
+        restoreStopSignals();
+        stats = server.stats();
+    } catch (const std::exception& ex) {
+        restoreStopSignals();
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    std::cerr << "Served " << stats.requests << " requests (" << stats.errors << " failed) on " << stats.tracks
+              << " tracks: p50 " << std::fixed << std::setprecision(3) << stats.p50Ms << " ms, p99 "
+              << stats.p99Ms << " ms, max " << stats.maxMs << " ms\n";
+    return 0;
+}
+
+// query: send one request to a running server and print its JSON response; with --repeat, send
+// it N times and report the round-trip latency.
+int runQueryCommand(const std::vector<std::string>& args, const char* exeName) {
+    std::string socketPath = defaultServerSocket();
+    size_t top = 1;
+    size_t repeat = 1;
+    std::string op = "transition";
+    std::vector<std::string> tracks;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool badOption = false;
+        if (parseSocketOption(args, i, socketPath, badOption)) {
+            if (badOption) return 1;
+        } else if (arg == "--top" || arg == "--repeat") {
+            if (i + 1 >= args.size() || !parseCount(args[++i], arg == "--top" ? top : repeat)) {
+                std::cerr << "Error: " << arg << " expects a positive integer\n";
+                return 1;
+            }
+        } else if (arg == "--analyze" || arg == "--stats" || arg == "--shutdown") {
+            op = arg.substr(2);
+        } else {
+            tracks.push_back(arg);
+        }
+    }
+    const size_t expected = op == "transition" ? 2 : op == "analyze" ? 1 : 0;
+    if (tracks.size() != expected) {
+        printUsage(exeName);
+        return 1;
+    }
+
+    // The server resolves paths from its own working directory.
+    for (auto& track : tracks) track = fs::absolute(track).lexically_normal().string();
+    std::string request;
+    if (op == "transition") {
+        request = "{\"a\":" + jsonQuote(tracks[0]) + ",\"b\":" + jsonQuote(tracks[1]) +
+                  ",\"k\":" + std::to_string(top) + "}";
+    } else if (op == "analyze") {
+        request = "{\"op\":\"analyze\",\"path\":" + jsonQuote(tracks[0]) + "}";
+    } else {
+        request = "{\"op\":\"" + op + "\"}";
+    }
+
+    std::vector<double> latencies;
+    std::string response;
+    try {
+        TransitionClient client(socketPath);
+        for (size_t i = 0; i < repeat; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            response = client.request(request);
+            latencies.push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    std::cout << response << "\n";
+    if (repeat > 1) {
+        // The first request may have analyzed the tracks; the rest are warm.
+        std::sort(latencies.begin() + 1, latencies.end());
+        const auto at = [&](double p) {
+            return latencies[1 + static_cast<size_t>(p * static_cast<double>(latencies.size() - 2) + 0.5)];
+        };
+        std::cerr << "First request " << std::fixed << std::setprecision(3) << latencies[0] << " ms; "
+                  << repeat - 1 << " warm: p50 " << at(0.50) << " ms, p99 " << at(0.99) << " ms\n";
+    }
+    return response.find("\"ok\":true") != std::string::npos ? 0 : 1;
+}
+
+// Default command: analyze two tracks and suggest the best transition between them.
+int runPairCommand(const std::vector<std::string>& args, const char* exeName) {
+    CacheOptions cacheOptions;
+    double windowSeconds = kDefaultEnergyWindowSeconds;
+    size_t jobs = 0;
+    RoiOptions roi;
+    bool useRoi = false;
+    std::vector<std::string> tracks;
+    for (size_t i = 0; i < args.size(); ++i) {
+        bool badOption = false;
+        if (parseCacheOption(args, i, cacheOptions, badOption) ||
+            parseWindowOption(args, i, windowSeconds, badOption) || parseJobsOption(args, i, jobs, badOption)) {
+            if (badOption) return 1;
+        } else if (args[i] == "--roi") {
+            useRoi = true;
+        } else if (args[i].rfind("--roi=", 0) == 0) {
+            char* end = nullptr;
+            const std::string value = args[i].substr(6);
+            roi.headSeconds = std::strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0' || !(roi.headSeconds > 0.0 && roi.headSeconds <= 3600.0)) {
+                std::cerr << "Error: --roi expects a duration in seconds (0-3600]\n";
+                return 1;
+            }
+            roi.tailSeconds = roi.headSeconds;
+            useRoi = true;
+        } else {
+            tracks.push_back(args[i]);
+        }
+    }
+    if (tracks.size() != 2) {
+        printUsage(exeName);
+        return 1;
+    }
+    for (const auto& path : tracks) {
+        if (!fs::exists(path)) {
+            std::cerr << "Error: file does not exist: " << path << "\n";
+            return 1;
+        }
+        if (!fs::is_regular_file(path)) {
+            std::cerr << "Error: path is not a regular file: " << path << "\n";
+            return 1;
+        }
+    }
+
+    auto cache = openCache(cacheOptions);
+    std::array<TrackAnalysis, 2> analyses{};
+    std::array<AudioStreamInfo, 2> infos{};
+    std::array<std::exception_ptr, 2> errors{};
+
+    // Both tracks at once, each split into segments across the same pool, so the wait is
+    // bounded by the cores rather than by the sum of the two analyses.
+    {
+        ThreadPool pool(jobs);
+        std::array<AnalysisWorkspace, 2> workspaces;
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            pool.submit([&, i] {
+                try {
+                    // A is mixed out of and B into: each needs only the side the transition uses.
+                    const RoiOptions side = i == 0 ? roi.exitSide() : roi.entrySide();
+                    analyses[i] = analyzeTrackCached(cache.get(), tracks[i], windowSeconds, &infos[i], &workspaces[i],
+                                                     &pool, useRoi ? &side : nullptr);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    try {
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            const auto& path = tracks[i];
+            if (errors[i]) std::rethrow_exception(errors[i]);
+            const AudioStreamInfo& info = infos[i];
+            const TrackAnalysis& analysis = analyses[i];
+            double durationSec = secondsFromSamples(static_cast<size_t>(info.frames), info.sampleRate);
 
             std::cout << "Track " << (i == 0 ? "A" : "B") << ": " << path << "\n";
-            std::cout << "  Sample rate: " << audio.sampleRate << " Hz\n";
-            std::cout << "  Channels   : " << audio.channels << " (converted to mono)\n";
-            std::cout << "  Frames     : " << audio.samples.size() << "\n";
+            std::cout << "  Sample rate: " << info.sampleRate << " Hz\n";
+            std::cout << "  Channels   : " << info.channels << " (converted to mono)\n";
+            std::cout << "  Frames     : " << info.frames << "\n";
             std::cout << "  Duration   : " << std::fixed << std::setprecision(2)
                       << durationSec << " s (" << formatTime(durationSec) << ")\n";
 
-            TrackAnalysis analysis;
-            analysis.bpm = estimateBPM(audio);
-            analysis.windowSeconds = 0.5; // default energy window size in seconds
-            analysis.energyCurve = computeEnergyCurve(audio, analysis.windowSeconds);
-            analysis.key = estimateKey(audio);
-
             if (analysis.bpm <= 0.0) {
                 std::cout << "  BPM        : (could not estimate)\n";
             } else {
                 std::cout << "  BPM        : " << std::fixed << std::setprecision(2) << analysis.bpm << "\n";
             }
+            const BeatGrid& grid = analysis.beatGrid;
+            if (!grid.empty()) {
+                std::cout << "  Beat grid  : " << grid.beats << " beats, " << grid.bars()
+                          << " bars, first downbeat at " << std::fixed << std::setprecision(3)
+                          << grid.beatTime(grid.downbeat) << " s\n";
+            }
 
             if (analysis.energyCurve.empty()) {
                 std::cout << "  Energy     : (could not compute)\n";
             } else {
-                auto [minIt, maxIt] = std::minmax_element(analysis.energyCurve.begin(), analysis.energyCurve.end());
-                std::cout << "  Energy     : windows=" << analysis.energyCurve.size()
-                          << " windowSec=" << analysis.windowSeconds << "\n";
-                std::cout << "               min=" << std::fixed << std::setprecision(6) << *minIt
-                          << " max=" << std::fixed << std::setprecision(6) << *maxIt << "\n";
+                // With --roi, windows outside the decoded regions are NaN.
+                double minRms = std::numeric_limits<double>::infinity();
+                double maxRms = -minRms;
+                size_t decoded = 0;
+                for (double rms : analysis.energyCurve) {
+                    if (std::isnan(rms)) continue;
+                    minRms = std::min(minRms, rms);
+                    maxRms = std::max(maxRms, rms);
+                    ++decoded;
+                }
+                std::cout << "  Energy     : windows=" << analysis.energyCurve.size();
+                if (decoded < analysis.energyCurve.size()) std::cout << " (" << decoded << " decoded)";
+                std::cout << " windowSec=" << analysis.windowSeconds << "\n";
+                std::cout << "               min=" << std::fixed << std::setprecision(6) << minRms
+                          << " max=" << std::fixed << std::setprecision(6) << maxRms << "\n";
             }
 
             std::cout << "  Key        : " << analysis.key << "\n";
-            analyses[i] = analysis;
         }
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
@@ -116,3 +1163,48 @@ int main(int argc, char** argv) {
     std::cout << "Analysis completed.\n";
     return 0;
 }
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string profilePath;
+    if (!extractProfileOption(args, profilePath)) return 1;
+    if (!profilePath.empty()) profiling::setEnabled(true);
+
+    int status = 0;
+    if (!args.empty() && args[0] == "analyze") {
+        status = runAnalyzeCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "matrix") {
+        status = runMatrixCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "sequence") {
+        status = runSequenceCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "index") {
+        status = runIndexCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "next") {
+        status = runNextCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "render") {
+        status = runRenderCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "timeline") {
+        status = runTimelineCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "live") {
+        status = runLiveCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "serve") {
+        status = runServeCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else if (!args.empty() && args[0] == "query") {
+        status = runQueryCommand(std::vector<std::string>(args.begin() + 1, args.end()), argv[0]);
+    } else {
+        status = runPairCommand(args, argv[0]);
+    }
+
+    if (!profilePath.empty()) {
+        profiling::setEnabled(false);
+        profiling::printSummary(std::cerr);
+        try {
+            profiling::writeChromeTrace(profilePath);
+            std::cerr << "Wrote trace " << profilePath << "\n";
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            return 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "AnalysisWorkspace.hpp"
+#include "AudioLoader.hpp"
+#include "BpmAnalyzer.hpp"
+#include "KeyAnalyzer.hpp"
+#include "Resampler.hpp"
+#include "SyntheticAudio.hpp"
+
+// Checks that analysis on a warmed-up AnalysisWorkspace makes no heap allocations: every
+// allocation in the process is counted, and the second pass over a track must not add to it.
+namespace {
+std::atomic<uint64_t> gAllocations{0};
+
+void* countedAlloc(std::size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = countedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* p = countedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+// GCC takes the pointers for the library's operator new and flags std::free on them; they come
+// from countedAlloc()'s malloc.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+volatile double gSink = 0.0;
+
+struct Check {
+    std::string name;
+    std::function<void()> run;
+};
+} // namespace
+
+int main() {
+    SyntheticTrackSpec spec;
+    spec.durationSeconds = 20.0;
+    const AudioData audio = generateSyntheticTrack(spec);
+    AnalysisWorkspace workspace;
+
+    const std::vector<Check> checks = {
+        {"decimate", [&] {
+            AnalysisDecimator decimator(audio.sampleRate, workspace);
+            for (size_t pos = 0; pos < audio.samples.size(); pos += AudioStreamReader::kDefaultBlockFrames) {
+                const size_t count = std::min(AudioStreamReader::kDefaultBlockFrames, audio.samples.size() - pos);
+                decimator.push(audio.samples.data() + pos, count);
+                gSink = gSink + decimator.keyCount();
+            }
+        }},
+        {"estimateBPM", [&] { gSink = gSink + estimateBPM(audio, 80.0, 180.0, &workspace); }},
+        {"estimateKey", [&] { gSink = gSink + estimateKey(audio, &workspace).size(); }},
+    };
+
+    int failures = 0;
+    for (const Check& check : checks) {
+        check.run(); // sizes the workspace's buffers and builds its FFT plans
+        const uint64_t before = gAllocations.load();
+        check.run();
+        const uint64_t allocations = gAllocations.load() - before;
+        if (allocations != 0) {
+            std::cerr << "FAIL " << check.name << ": " << allocations << " allocations on a warm workspace\n";
+            ++failures;
+        } else {
+            std::cout << "ok   " << check.name << "\n";
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}